@@ -15,6 +15,8 @@
 /*> Defines ***************************************************************************************/
 #define BITSET_SIZE 64
 #define BITSET_STRING_SIZE (BITSET_SIZE + 1)
+#define LARGE_BITSET_SIZE 2048
+#define NUM_LARGE_BITSET_WORDS (LARGE_BITSET_SIZE / BITSET_SIZE)
 
 /*> Type Declarations *****************************************************************************/
 /**
@@ -22,6 +24,15 @@
  */
 typedef uint64_t BitSetT;
 
+/**
+ * @brief Bit set of size LARGE_BITSET_SIZE bits, made of 64 bit words.
+ * @param words  The words of the bit set, the lowest numbers first.
+ */
+typedef struct LargeBitSetS
+{
+  BitSetT words[NUM_LARGE_BITSET_WORDS];
+} LargeBitSetS;
+
 /*> Constant Declarations *************************************************************************/
 
 /*> Variable Declarations *************************************************************************/
@@ -48,6 +59,77 @@ static inline bool is_in_bitset(const BitSetT* const bitset_p, const int num)
   return ((*bitset_p) & ((uint64_t) 1 << num)) > 0;
 }
 
+/**
+ * @brief Adds number to large bit set.
+ * @param[in/out]  bitset_p  The bitset.
+ * @param[in]      num       The number to add.
+ */
+static inline void add_to_large_bitset(LargeBitSetS* const bitset_p, const int num)
+{
+  add_to_bitset(&(bitset_p->words[num / BITSET_SIZE]), num % BITSET_SIZE);
+}
+
+/**
+ * @brief Checks if the provided number is in the large bit set.
+ * @param[in]  bitset_p  The bitset.
+ * @param[in]  num       The number.
+ * @return true if num is in the bit set, false otherwise.
+ */
+static inline bool is_in_large_bitset(const LargeBitSetS* const bitset_p, const int num)
+{
+  return is_in_bitset(&(bitset_p->words[num / BITSET_SIZE]), num % BITSET_SIZE);
+}
+
+/**
+ * @brief Adds all numbers of one large bit set to another.
+ * @param[in/out]  bitset_p       The bitset to add to.
+ * @param[in]      otherBitset_p  The bitset whose numbers are added.
+ */
+static inline void add_large_bitset(LargeBitSetS* const bitset_p,
+                                    const LargeBitSetS* const otherBitset_p)
+{
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    bitset_p->words[i] |= otherBitset_p->words[i];
+  }
+}
+
+/**
+ * @brief Checks if two large bit sets contain the same numbers.
+ * @param[in]  bitset1_p  The first bitset.
+ * @param[in]  bitset2_p  The second bitset.
+ * @return true if the bit sets are equal, false otherwise.
+ */
+static inline bool large_bitsets_are_equal(const LargeBitSetS* const bitset1_p,
+                                           const LargeBitSetS* const bitset2_p)
+{
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    if (bitset1_p->words[i] != bitset2_p->words[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Checks if a large bit set is empty.
+ * @param[in]  bitset_p  The bitset.
+ * @return true if the bit set contains no numbers, false otherwise.
+ */
+static inline bool large_bitset_is_empty(const LargeBitSetS* const bitset_p)
+{
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    if (bitset_p->words[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 /**
  * @brief Converts the provided bitset to a string of the bitset in binary form.
  * @param[in]   bitset_p  The bitset.
@@ -0,0 +1,326 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Scanner checkpoints that allow reading tokens from any part of an input without reading it
+*        from the start.
+* @file checkpoint_index.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint_index.h"
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+#define CHECKPOINT_FILE_MAGIC   0x50434c58 // "XLCP"
+#define CHECKPOINT_FILE_VERSION 2
+#define INITIAL_MAX_NUM_CHECKPOINTS 64
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Appends a checkpoint to a checkpoint index, growing it if needed.
+ * @param[in/out]  index_p  The checkpoint index.
+ * @param[in]      charIdx  The index of the char of the checkpoint.
+ * @param[in]      state    The DFA state of the checkpoint.
+ */
+static void add_checkpoint(CheckpointIndexS* const index_p, const size_t charIdx, const int state);
+
+/**
+ * @brief Finds the last checkpoint at or before a char index.
+ * @param[in]  index_p  The checkpoint index.
+ * @param[in]  charIdx  The index of the char.
+ * @return Index of the checkpoint.
+ */
+static int find_checkpoint(const CheckpointIndexS* const index_p, const size_t charIdx);
+
+/**
+ * @brief Checks if the checkpoints of an index can be resumed from with a lexer: the first one is
+ *        at the start of the input, they are in increasing order within the input, and their
+ *        states are states of the lexer's DFA (always 0 if the lexer has several groups).
+ * @param[in]  lexer_p  The lexer.
+ * @param[in]  index_p  The checkpoint index.
+ * @return true if the checkpoints are valid, false otherwise.
+ */
+static bool checkpoints_are_valid(const LexerS* const lexer_p,
+                                  const CheckpointIndexS* const index_p);
+
+/**
+ * @brief Writes an unsigned integer to a file as little endian.
+ * @param[in]  file_p    The file.
+ * @param[in]  value     The value to write.
+ * @param[in]  numBytes  The number of bytes to write.
+ * @return true if the value was written, false otherwise.
+ */
+static bool write_uint(FILE* const file_p, const uint64_t value, const int numBytes);
+
+/**
+ * @brief Reads a little endian unsigned integer from a file.
+ * @param[in]   file_p    The file.
+ * @param[out]  value_p   The read value.
+ * @param[in]   numBytes  The number of bytes to read.
+ * @return true if the value was read, false otherwise.
+ */
+static bool read_uint(FILE* const file_p, uint64_t* const value_p, const int numBytes);
+
+/*> Local Function Definitions ********************************************************************/
+static void add_checkpoint(CheckpointIndexS* const index_p, const size_t charIdx, const int state)
+{
+  if (index_p->numCheckpoints == index_p->maxNumCheckpoints)
+  {
+    int newMaxNumCheckpoints = index_p->maxNumCheckpoints > 0 ?
+                               2 * index_p->maxNumCheckpoints :
+                               INITIAL_MAX_NUM_CHECKPOINTS;
+    index_p->checkpoints_p = realloc(index_p->checkpoints_p,
+                                     sizeof(CheckpointS) * newMaxNumCheckpoints);
+    assert(index_p->checkpoints_p != NULL);
+    index_p->maxNumCheckpoints = newMaxNumCheckpoints;
+  }
+
+  CheckpointS* checkpoint_p = &(index_p->checkpoints_p[index_p->numCheckpoints]);
+  checkpoint_p->charIdx = charIdx;
+  checkpoint_p->state = state;
+  index_p->numCheckpoints++;
+}
+
+static int find_checkpoint(const CheckpointIndexS* const index_p, const size_t charIdx)
+{
+  int low = 0;
+  int high = index_p->numCheckpoints;
+  while (low < high)
+  {
+    int middle = low + (high - low) / 2;
+    if (index_p->checkpoints_p[middle].charIdx <= charIdx)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  // The first checkpoint is always at the start of the input.
+  assert(low > 0);
+  return low - 1;
+}
+
+static bool checkpoints_are_valid(const LexerS* const lexer_p,
+                                  const CheckpointIndexS* const index_p)
+{
+  if (index_p->numCheckpoints == 0 || index_p->checkpoints_p[0].charIdx != 0)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < index_p->numCheckpoints; i++)
+  {
+    const CheckpointS* checkpoint_p = &(index_p->checkpoints_p[i]);
+    if ((i > 0 && checkpoint_p->charIdx <= index_p->checkpoints_p[i - 1].charIdx) ||
+        checkpoint_p->charIdx > index_p->inputLength ||
+        checkpoint_p->state < 0 ||
+        checkpoint_p->state >= lexer_p->dfa_p->numStates ||
+        (lexer_p->numDfas > 1 && checkpoint_p->state != 0))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool write_uint(FILE* const file_p, const uint64_t value, const int numBytes)
+{
+  unsigned char bytes[sizeof(uint64_t)];
+  for (int i = 0; i < numBytes; i++)
+  {
+    bytes[i] = (unsigned char) (value >> (8 * i));
+  }
+  return fwrite(bytes, 1, numBytes, file_p) == (size_t) numBytes;
+}
+
+static bool read_uint(FILE* const file_p, uint64_t* const value_p, const int numBytes)
+{
+  unsigned char bytes[sizeof(uint64_t)];
+  if (fread(bytes, 1, numBytes, file_p) != (size_t) numBytes)
+  {
+    return false;
+  }
+
+  *value_p = 0;
+  for (int i = 0; i < numBytes; i++)
+  {
+    *value_p |= (uint64_t) bytes[i] << (8 * i);
+  }
+  return true;
+}
+
+/*> Global Function Definitions *******************************************************************/
+void create_checkpoint_index(LexerS* const lexer_p,
+                             const size_t intervalKiB,
+                             CheckpointIndexS* const index_p,
+                             TokenArrayS* const tokenArray_p)
+{
+  assert(intervalKiB > 0);
+  assert(lexer_p->currCharIdx == 0);
+  index_p->inputLength = lexer_p->inputLength;
+  index_p->intervalLength = intervalKiB * CHECKPOINT_INTERVAL_UNIT;
+  index_p->numRules = lexer_p->numRules;
+  index_p->numDfaStates = lexer_p->dfa_p->numStates;
+  index_p->checkpoints_p = NULL;
+  index_p->numCheckpoints = 0;
+  index_p->maxNumCheckpoints = 0;
+
+  add_checkpoint(index_p, lexer_p->currCharIdx, lexer_p->currState);
+  size_t nextCheckpointIdx = lexer_p->currCharIdx + index_p->intervalLength;
+
+  TokenS token = get_next_token(lexer_p);
+  while (token.type != TOKEN_TYPE_END)
+  {
+    if (tokenArray_p != NULL)
+    {
+      add_token(tokenArray_p, &token);
+    }
+
+    if (lexer_p->currCharIdx >= nextCheckpointIdx && lexer_p->currCharIdx < lexer_p->inputLength)
+    {
+      add_checkpoint(index_p, lexer_p->currCharIdx, lexer_p->currState);
+      nextCheckpointIdx = lexer_p->currCharIdx + index_p->intervalLength;
+    }
+
+    token = get_next_token(lexer_p);
+  }
+}
+
+void read_tokens_in_range(LexerS* const lexer_p,
+                          const CheckpointIndexS* const index_p,
+                          const size_t startIdx,
+                          const size_t endIdx,
+                          TokenArrayS* const tokenArray_p)
+{
+  assert(lexer_p->inputLength == index_p->inputLength);
+  const CheckpointS* checkpoint_p = &(index_p->checkpoints_p[find_checkpoint(index_p, startIdx)]);
+  resume_reading(lexer_p, checkpoint_p->charIdx, checkpoint_p->state);
+
+  TokenS token = get_next_token(lexer_p);
+  while (token.type != TOKEN_TYPE_END && token.startIdx < endIdx)
+  {
+    if (token.startIdx + token.length > startIdx)
+    {
+      add_token(tokenArray_p, &token);
+    }
+    token = get_next_token(lexer_p);
+  }
+}
+
+bool write_checkpoint_index(const CheckpointIndexS* const index_p, const char* const path_p)
+{
+  FILE* file_p = fopen(path_p, "wb");
+  if (file_p == NULL)
+  {
+    return false;
+  }
+
+  bool isWritten = write_uint(file_p, CHECKPOINT_FILE_MAGIC, 4) &&
+                   write_uint(file_p, CHECKPOINT_FILE_VERSION, 4) &&
+                   write_uint(file_p, index_p->inputLength, 8) &&
+                   write_uint(file_p, index_p->intervalLength, 8) &&
+                   write_uint(file_p, (uint32_t) index_p->numRules, 4) &&
+                   write_uint(file_p, (uint32_t) index_p->numDfaStates, 4) &&
+                   write_uint(file_p, index_p->numCheckpoints, 8);
+  for (int i = 0; isWritten && i < index_p->numCheckpoints; i++)
+  {
+    isWritten = write_uint(file_p, index_p->checkpoints_p[i].charIdx, 8) &&
+                write_uint(file_p, (uint32_t) index_p->checkpoints_p[i].state, 4);
+  }
+
+  return (fclose(file_p) == 0) && isWritten;
+}
+
+bool read_checkpoint_index(const LexerS* const lexer_p,
+                           CheckpointIndexS* const index_p,
+                           const char* const path_p)
+{
+  index_p->inputLength = 0;
+  index_p->intervalLength = 0;
+  index_p->numRules = 0;
+  index_p->numDfaStates = 0;
+  index_p->checkpoints_p = NULL;
+  index_p->numCheckpoints = 0;
+  index_p->maxNumCheckpoints = 0;
+
+  FILE* file_p = fopen(path_p, "rb");
+  if (file_p == NULL)
+  {
+    return false;
+  }
+
+  uint64_t magic;
+  uint64_t version;
+  uint64_t inputLength;
+  uint64_t intervalLength;
+  uint64_t numRules;
+  uint64_t numDfaStates;
+  uint64_t numCheckpoints = 0;
+  bool isRead = read_uint(file_p, &magic, 4) &&
+                read_uint(file_p, &version, 4) &&
+                read_uint(file_p, &inputLength, 8) &&
+                read_uint(file_p, &intervalLength, 8) &&
+                read_uint(file_p, &numRules, 4) &&
+                read_uint(file_p, &numDfaStates, 4) &&
+                read_uint(file_p, &numCheckpoints, 8);
+
+  // The header is only used once all of it is read.
+  if (isRead)
+  {
+    index_p->inputLength = inputLength;
+    index_p->intervalLength = intervalLength;
+    index_p->numRules = (int32_t) (uint32_t) numRules;
+    index_p->numDfaStates = (int32_t) (uint32_t) numDfaStates;
+    isRead = magic == CHECKPOINT_FILE_MAGIC &&
+             version == CHECKPOINT_FILE_VERSION &&
+             index_p->numRules == lexer_p->numRules &&
+             index_p->numDfaStates == lexer_p->dfa_p->numStates &&
+             numCheckpoints > 0 &&
+             numCheckpoints <= INT32_MAX;
+  }
+
+  for (uint64_t i = 0; isRead && i < numCheckpoints; i++)
+  {
+    uint64_t charIdx;
+    uint64_t state;
+    isRead = read_uint(file_p, &charIdx, 8) && read_uint(file_p, &state, 4);
+    if (isRead)
+    {
+      add_checkpoint(index_p, charIdx, (int32_t) (uint32_t) state);
+    }
+  }
+
+  fclose(file_p);
+  isRead = isRead && checkpoints_are_valid(lexer_p, index_p);
+  if (!isRead)
+  {
+    free_checkpoint_index(index_p);
+  }
+  return isRead;
+}
+
+void free_checkpoint_index(CheckpointIndexS* const index_p)
+{
+  free(index_p->checkpoints_p);
+  index_p->checkpoints_p = NULL;
+  index_p->numCheckpoints = 0;
+  index_p->maxNumCheckpoints = 0;
+}
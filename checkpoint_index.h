@@ -0,0 +1,117 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Scanner checkpoints that allow reading tokens from any part of an input without reading
+ *        it from the start.
+ * @file checkpoint_index.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef CHECKPOINT_INDEX_H
+#define CHECKPOINT_INDEX_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+#define CHECKPOINT_INTERVAL_UNIT 1024
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A point in the input where a token starts, and the state reading continues from there.
+ * @param charIdx  The index of the first char of the token.
+ * @param state    The DFA state the token is scanned from.
+ */
+typedef struct CheckpointS
+{
+  size_t charIdx;
+  int state;
+} CheckpointS;
+
+/**
+ * @brief Checkpoints of an input, sorted by char index. The first one is at the start of the input.
+ * @param inputLength       The number of chars in the input the checkpoints were recorded for.
+ * @param intervalLength    The minimum number of chars between two checkpoints.
+ * @param numRules          The number of RegExps of the lexer the checkpoints were recorded with.
+ * @param numDfaStates      The number of states of the DFA of that lexer.
+ * @param checkpoints_p     The checkpoints.
+ * @param numCheckpoints    The number of checkpoints.
+ * @param maxNumCheckpoints The number of checkpoints there is room for.
+ */
+typedef struct CheckpointIndexS
+{
+  size_t inputLength;
+  size_t intervalLength;
+  int numRules;
+  int numDfaStates;
+  CheckpointS* checkpoints_p;
+  int numCheckpoints;
+  int maxNumCheckpoints;
+} CheckpointIndexS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Reads the whole input of the lexer and records a checkpoint at the first token starting
+ *        at or after every intervalKiB KiB.
+ * @param[in/out]  lexer_p       The lexer, which must be at the start of its input.
+ * @param[in]      intervalKiB   The interval between checkpoints in KiB.
+ * @param[out]     index_p       The checkpoint index to fill.
+ * @param[out]     tokenArray_p  Token array to append the read tokens to, or NULL.
+ */
+void create_checkpoint_index(LexerS* const lexer_p,
+                             const size_t intervalKiB,
+                             CheckpointIndexS* const index_p,
+                             TokenArrayS* const tokenArray_p);
+
+/**
+ * @brief Reads the tokens that overlap a range of the input, resuming from the last checkpoint at or
+ *        before the start of the range.
+ * @param[in/out]  lexer_p       The lexer, which must have started reading the indexed input.
+ * @param[in]      index_p       The checkpoint index of the input.
+ * @param[in]      startIdx      The index of the first char of the range.
+ * @param[in]      endIdx        The index after the last char of the range.
+ * @param[out]     tokenArray_p  The token array to append the tokens to.
+ */
+void read_tokens_in_range(LexerS* const lexer_p,
+                          const CheckpointIndexS* const index_p,
+                          const size_t startIdx,
+                          const size_t endIdx,
+                          TokenArrayS* const tokenArray_p);
+
+/**
+ * @brief Writes a checkpoint index to a file.
+ * @param[in]  index_p  The checkpoint index.
+ * @param[in]  path_p   The path of the file.
+ * @return true if the file was written, false otherwise.
+ */
+bool write_checkpoint_index(const CheckpointIndexS* const index_p, const char* const path_p);
+
+/**
+ * @brief Reads a checkpoint index from a file written by write_checkpoint_index(). The index is
+ *        only accepted if it was recorded with a lexer with as many RegExps and DFA states as the
+ *        given one, and its checkpoints can be resumed from: the first one is at index 0, their
+ *        indicies increase and are within the input, and their states exist.
+ * @param[in]   lexer_p  The lexer the index is read for.
+ * @param[out]  index_p  The checkpoint index to fill.
+ * @param[in]   path_p   The path of the file.
+ * @return true if the file was read, false if it could not be opened or is not a valid checkpoint
+ *         index for the lexer.
+ */
+bool read_checkpoint_index(const LexerS* const lexer_p,
+                           CheckpointIndexS* const index_p,
+                           const char* const path_p);
+
+/**
+ * @brief Frees the checkpoints of a checkpoint index and empties it.
+ * @param[in/out]  index_p  The checkpoint index.
+ */
+void free_checkpoint_index(CheckpointIndexS* const index_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
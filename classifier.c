@@ -0,0 +1,197 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Classifies whole strings by the RegExp of a lexer that matches them completely.
+* @file classifier.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+
+#include "classifier.h"
+#include "dfa.h"
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A string being classified by classify_strings().
+ * @param stringIdx  The index of the string, or NO_CLASS if the lane has no string.
+ * @param char_p     The next char to read.
+ * @param end_p      The end of the string.
+ * @param state      The current DFA state.
+ */
+typedef struct ClassifyLaneS
+{
+  int stringIdx;
+  const unsigned char* char_p;
+  const unsigned char* end_p;
+  int state;
+} ClassifyLaneS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Gets the class of a string from the DFA state after reading it.
+ * @param[in]  dfa_p  The DFA.
+ * @param[in]  state  The state, NO_STATE if the DFA got stuck.
+ * @return The class.
+ */
+static int class_of_state(const DfaS* const dfa_p, const int state);
+
+/**
+ * @brief Gives a lane the next string that is not classified yet. Empty strings are classified
+ *        right away.
+ * @param[in]      dfa_p           The DFA.
+ * @param[in/out]  lane_p          The lane.
+ * @param[in]      strs_pp         The strings.
+ * @param[in]      lengths_p       The number of chars in each string.
+ * @param[in]      numStrings      The number of strings.
+ * @param[in/out]  nextStringIdx_p The index of the next string to classify.
+ * @param[out]     classes_p       The class of each string.
+ * @return True if the lane got a string, false if there are no strings left.
+ */
+static bool start_next_string(const DfaS* const dfa_p,
+                              ClassifyLaneS* const lane_p,
+                              const char* const* const strs_pp,
+                              const size_t* const lengths_p,
+                              const int numStrings,
+                              int* const nextStringIdx_p,
+                              int* const classes_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int class_of_state(const DfaS* const dfa_p, const int state)
+{
+  if (state == NO_STATE || !dfa_p->states[state].isEndState)
+  {
+    return NO_CLASS;
+  }
+  return dfa_p->states[state].outputValue;
+}
+
+static bool start_next_string(const DfaS* const dfa_p,
+                              ClassifyLaneS* const lane_p,
+                              const char* const* const strs_pp,
+                              const size_t* const lengths_p,
+                              const int numStrings,
+                              int* const nextStringIdx_p,
+                              int* const classes_p)
+{
+  while (*nextStringIdx_p < numStrings)
+  {
+    int stringIdx = (*nextStringIdx_p)++;
+    if (lengths_p[stringIdx] == 0)
+    {
+      classes_p[stringIdx] = class_of_state(dfa_p, 0);
+      continue;
+    }
+
+    lane_p->stringIdx = stringIdx;
+    lane_p->char_p = (const unsigned char*) strs_pp[stringIdx];
+    lane_p->end_p = lane_p->char_p + lengths_p[stringIdx];
+    lane_p->state = 0;
+    return true;
+  }
+
+  lane_p->stringIdx = NO_CLASS;
+  return false;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int classify_string(const LexerS* const lexer_p, const char* const str_p, const size_t length)
+{
+  // The earliest group whose DFA ends in an end state has the earliest RegExp.
+  for (int i = 0; i < lexer_p->numDfas; i++)
+  {
+    const DfaS* dfa_p = lexer_p->dfas_pp[i];
+    const unsigned char* char_p = (const unsigned char*) str_p;
+    const unsigned char* end_p = char_p + length;
+    int state = 0;
+
+    while (char_p < end_p && state != NO_STATE)
+    {
+      state = dfa_p->states[state].transitions[*char_p];
+      char_p++;
+    }
+
+    int class = class_of_state(dfa_p, state);
+    if (class != NO_CLASS)
+    {
+      return class + lexer_p->ruleOffsets_p[i];
+    }
+  }
+
+  return NO_CLASS;
+}
+
+void classify_strings(const LexerS* const lexer_p,
+                      const char* const* const strs_pp,
+                      const size_t* const lengths_p,
+                      const int numStrings,
+                      int* const classes_p)
+{
+  if (lexer_p->numDfas > 1)
+  {
+    for (int i = 0; i < numStrings; i++)
+    {
+      classes_p[i] = classify_string(lexer_p, strs_pp[i], lengths_p[i]);
+    }
+    return;
+  }
+
+  const DfaS* dfa_p = lexer_p->dfa_p;
+  ClassifyLaneS lanes[NUM_CLASSIFY_LANES];
+  int nextStringIdx = 0;
+  int numActiveLanes = 0;
+
+  for (int i = 0; i < NUM_CLASSIFY_LANES; i++)
+  {
+    if (start_next_string(dfa_p,
+                          &(lanes[i]),
+                          strs_pp,
+                          lengths_p,
+                          numStrings,
+                          &nextStringIdx,
+                          classes_p))
+    {
+      numActiveLanes++;
+    }
+  }
+
+  while (numActiveLanes > 0)
+  {
+    // One step of every lane; the steps do not depend on each other.
+    for (int i = 0; i < NUM_CLASSIFY_LANES; i++)
+    {
+      ClassifyLaneS* lane_p = &(lanes[i]);
+      if (lane_p->stringIdx == NO_CLASS)
+      {
+        continue;
+      }
+
+      lane_p->state = dfa_p->states[lane_p->state].transitions[*(lane_p->char_p)];
+      lane_p->char_p++;
+      if (lane_p->state == NO_STATE || lane_p->char_p == lane_p->end_p)
+      {
+        classes_p[lane_p->stringIdx] = class_of_state(dfa_p, lane_p->state);
+        if (!start_next_string(dfa_p,
+                               lane_p,
+                               strs_pp,
+                               lengths_p,
+                               numStrings,
+                               &nextStringIdx,
+                               classes_p))
+        {
+          numActiveLanes--;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,56 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Classifies whole strings by the RegExp of a lexer that matches them completely.
+ * @file classifier.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef CLASSIFIER_H
+#define CLASSIFIER_H
+
+/*> Includes **************************************************************************************/
+#include <stddef.h>
+
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+#define NO_CLASS           -1
+#define NUM_CLASSIFY_LANES 8
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Finds the RegExp that matches a whole string. Unlike reading tokens, the string is not
+ *        split and nothing but the DFA state is tracked.
+ * @param[in]  lexer_p  The lexer whose RegExps classify the string.
+ * @param[in]  str_p    The string.
+ * @param[in]  length   The number of chars in the string.
+ * @return The output value of the matching RegExp, the earliest one if several match, or NO_CLASS
+ *         if no RegExp matches the whole string.
+ */
+int classify_string(const LexerS* const lexer_p, const char* const str_p, const size_t length);
+
+/**
+ * @brief Classifies many strings like classify_string(). NUM_CLASSIFY_LANES strings are walked in
+ *        an interleaved way, so that the memory accesses of independent walks overlap; a lane
+ *        takes the next string as soon as its string is classified. The strings of a lexer with
+ *        several groups are classified one after the other.
+ * @param[in]   lexer_p     The lexer whose RegExps classify the strings.
+ * @param[in]   strs_pp     The strings.
+ * @param[in]   lengths_p   The number of chars in each string.
+ * @param[in]   numStrings  The number of strings.
+ * @param[out]  classes_p   The class of each string, as returned by classify_string().
+ */
+void classify_strings(const LexerS* const lexer_p,
+                      const char* const* const strs_pp,
+                      const size_t* const lengths_p,
+                      const int numStrings,
+                      int* const classes_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -0,0 +1,304 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Packs the transitions of DFAs into a comb vector by row displacement, like lex and yacc
+*        do: the rows of all states are overlapped in one vector so that their transitions fall
+*        into each other's gaps.
+* @file comb_vector.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "comb_vector.h"
+
+/*> Defines ***************************************************************************************/
+#define INITIAL_MAX_NUM_ENTRIES 1024
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A row of the DFA to place in the comb vector.
+ * @param state           The state of the row.
+ * @param numTransitions  The number of transitions of the state.
+ */
+typedef struct CombRowS
+{
+  int state;
+  int numTransitions;
+} CombRowS;
+
+/**
+ * @brief A set of chars rows have transitions on, and the lowest base a row with them may fit at.
+ *        The entries only get taken while packing, so a base where one row did not fit does not
+ *        fit later rows with the same chars either.
+ * @param chars     The chars.
+ * @param nextBase  The lowest base that has not been found not to fit.
+ */
+typedef struct CombCharSetS
+{
+  BitSetT chars[NUM_CHARS / BITSET_SIZE];
+  int nextBase;
+} CombCharSetS;
+
+/**
+ * @brief What is needed to pack a comb vector.
+ * @param combVector_p    The comb vector.
+ * @param maxNumEntries   The number of entries there is room for.
+ * @param takenEntries_p  The entries that are taken, with room for one word more than the entries
+ *                        so that NUM_CHARS entries can be read from any base.
+ */
+typedef struct CombPackerS
+{
+  CombVectorS* combVector_p;
+  int maxNumEntries;
+  BitSetT* takenEntries_p;
+} CombPackerS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Compares rows so that rows with more transitions come first, and rows with as many in
+ *        order of their states.
+ * @param[in]  row1_p  The first row.
+ * @param[in]  row2_p  The second row.
+ * @return Negative if the first row comes first, positive if the second row does.
+ */
+static int compare_rows(const void* row1_p, const void* row2_p);
+
+/**
+ * @brief Makes room in a comb vector for NUM_CHARS entries after a base, adding free entries.
+ * @param[in/out]  packer_p  The packer.
+ * @param[in]      base      The base.
+ */
+static void add_comb_entries(CombPackerS* const packer_p, const int base);
+
+/**
+ * @brief Checks if the transitions of a row only fall on free entries from a base, one word of
+ *        chars at a time.
+ * @param[in]  packer_p  The packer.
+ * @param[in]  rowChars  The chars the row has transitions on.
+ * @param[in]  base      The base, with room for NUM_CHARS entries after it.
+ * @return True if the row fits.
+ */
+static bool row_fits(const CombPackerS* const packer_p,
+                     const BitSetT* const rowChars,
+                     const int base);
+
+/*> Local Function Definitions ********************************************************************/
+static int compare_rows(const void* row1_p, const void* row2_p)
+{
+  const CombRowS* row1 = row1_p;
+  const CombRowS* row2 = row2_p;
+  if (row1->numTransitions != row2->numTransitions)
+  {
+    return row2->numTransitions - row1->numTransitions;
+  }
+  return row1->state - row2->state;
+}
+
+static void add_comb_entries(CombPackerS* const packer_p, const int base)
+{
+  CombVectorS* combVector_p = packer_p->combVector_p;
+  if (base + NUM_CHARS > packer_p->maxNumEntries)
+  {
+    const int prevNumWords = packer_p->maxNumEntries / BITSET_SIZE + 1;
+    while (base + NUM_CHARS > packer_p->maxNumEntries)
+    {
+      packer_p->maxNumEntries *= 2;
+    }
+    const int numWords = packer_p->maxNumEntries / BITSET_SIZE + 1;
+    combVector_p->entries_p = realloc(combVector_p->entries_p,
+                                      sizeof(CombEntryS) * packer_p->maxNumEntries);
+    packer_p->takenEntries_p = realloc(packer_p->takenEntries_p, sizeof(BitSetT) * numWords);
+    assert(combVector_p->entries_p != NULL && packer_p->takenEntries_p != NULL);
+    memset(&(packer_p->takenEntries_p[prevNumWords]),
+           0,
+           sizeof(BitSetT) * (numWords - prevNumWords));
+  }
+  while (combVector_p->numEntries < base + NUM_CHARS)
+  {
+    combVector_p->entries_p[combVector_p->numEntries].check = NO_STATE;
+    combVector_p->entries_p[combVector_p->numEntries].nextState = NO_STATE;
+    combVector_p->numEntries++;
+  }
+}
+
+static bool row_fits(const CombPackerS* const packer_p,
+                     const BitSetT* const rowChars,
+                     const int base)
+{
+  const BitSetT* takenEntries_p = &(packer_p->takenEntries_p[base / BITSET_SIZE]);
+  const int shift = base % BITSET_SIZE;
+  for (int i = 0; i < NUM_CHARS / BITSET_SIZE; i++)
+  {
+    BitSetT taken = takenEntries_p[i] >> shift;
+    if (shift > 0)
+    {
+      taken |= takenEntries_p[i + 1] << (BITSET_SIZE - shift);
+    }
+    if ((taken & rowChars[i]) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*> Global Function Definitions *******************************************************************/
+CombVectorS* pack_comb_vector(const DfaS* const dfa_p)
+{
+  const int numStates = dfa_p->numStates;
+  CombVectorS* combVector_p = malloc(sizeof(*combVector_p));
+  assert(combVector_p != NULL);
+  combVector_p->states_p = malloc(sizeof(CombStateS) * numStates);
+  combVector_p->numStates = numStates;
+  combVector_p->entries_p = malloc(sizeof(CombEntryS) * INITIAL_MAX_NUM_ENTRIES);
+  combVector_p->numEntries = 0;
+  CombPackerS packer =
+  {
+    .combVector_p = combVector_p,
+    .maxNumEntries = INITIAL_MAX_NUM_ENTRIES,
+    .takenEntries_p = calloc(INITIAL_MAX_NUM_ENTRIES / BITSET_SIZE + 1, sizeof(BitSetT))
+  };
+  CombRowS* rows_p = malloc(sizeof(CombRowS) * numStates);
+  CombCharSetS* charSets_p = malloc(sizeof(CombCharSetS) * numStates);
+  int numCharSets = 0;
+  assert(combVector_p->states_p != NULL && combVector_p->entries_p != NULL &&
+         packer.takenEntries_p != NULL && rows_p != NULL && charSets_p != NULL);
+  add_comb_entries(&packer, 0);
+
+  for (int i = 0; i < numStates; i++)
+  {
+    rows_p[i].state = i;
+    rows_p[i].numTransitions = 0;
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      rows_p[i].numTransitions += (dfa_p->states[i].transitions[j] != NO_STATE);
+    }
+    combVector_p->states_p[i].base = 0;
+    combVector_p->states_p[i].isEndState = dfa_p->states[i].isEndState;
+    combVector_p->states_p[i].outputValue = dfa_p->states[i].outputValue;
+  }
+  qsort(rows_p, numStates, sizeof(CombRowS), compare_rows);
+
+  // Entries below firstFreeIdx are all taken, so no row can start its transitions there.
+  int firstFreeIdx = 0;
+  for (int i = 0; i < numStates && rows_p[i].numTransitions > 0; i++)
+  {
+    const DfaStateS* dfaState_p = &(dfa_p->states[rows_p[i].state]);
+    BitSetT rowChars[NUM_CHARS / BITSET_SIZE] = {0};
+    int firstChar = NO_STATE;
+    for (int j = NUM_CHARS - 1; j >= 0; j--)
+    {
+      if (dfaState_p->transitions[j] != NO_STATE)
+      {
+        add_to_bitset(&(rowChars[j / BITSET_SIZE]), j % BITSET_SIZE);
+        firstChar = j;
+      }
+    }
+
+    int charSetIdx = 0;
+    while (charSetIdx < numCharSets &&
+           memcmp(charSets_p[charSetIdx].chars, rowChars, sizeof(rowChars)) != 0)
+    {
+      charSetIdx++;
+    }
+    if (charSetIdx == numCharSets)
+    {
+      memcpy(charSets_p[charSetIdx].chars, rowChars, sizeof(rowChars));
+      charSets_p[charSetIdx].nextBase = 0;
+      numCharSets++;
+    }
+
+    int base = (firstFreeIdx > firstChar) ? firstFreeIdx - firstChar : 0;
+    if (charSets_p[charSetIdx].nextBase > base)
+    {
+      base = charSets_p[charSetIdx].nextBase;
+    }
+    for (;;)
+    {
+      add_comb_entries(&packer, base);
+      if (row_fits(&packer, rowChars, base))
+      {
+        break;
+      }
+      // Only bases where the first transition falls on a free entry are worth checking.
+      do
+      {
+        base++;
+      } while (base + firstChar < combVector_p->numEntries &&
+               combVector_p->entries_p[base + firstChar].check != NO_STATE);
+    }
+
+    combVector_p->states_p[rows_p[i].state].base = base;
+    charSets_p[charSetIdx].nextBase = base + 1;
+    for (int j = firstChar; j < NUM_CHARS; j++)
+    {
+      if (dfaState_p->transitions[j] != NO_STATE)
+      {
+        combVector_p->entries_p[base + j].check = rows_p[i].state;
+        combVector_p->entries_p[base + j].nextState = dfaState_p->transitions[j];
+        add_to_bitset(&(packer.takenEntries_p[(base + j) / BITSET_SIZE]), (base + j) % BITSET_SIZE);
+      }
+    }
+    while (firstFreeIdx < combVector_p->numEntries &&
+           combVector_p->entries_p[firstFreeIdx].check != NO_STATE)
+    {
+      firstFreeIdx++;
+    }
+  }
+
+  free(packer.takenEntries_p);
+  free(charSets_p);
+  free(rows_p);
+  return combVector_p;
+}
+
+int match_comb_vector(const CombVectorS* const combVector_p,
+                      const char* const input_p,
+                      const size_t inputLength,
+                      size_t* const matchLength_p)
+{
+  const unsigned char* chars_p = (const unsigned char*) input_p;
+  int outputValue = NO_STATE;
+  int state = 0;
+  *matchLength_p = 0;
+
+  for (size_t charIdx = 0; charIdx < inputLength; charIdx++)
+  {
+    state = get_comb_vector_transition(combVector_p, state, chars_p[charIdx]);
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (combVector_p->states_p[state].isEndState)
+    {
+      outputValue = combVector_p->states_p[state].outputValue;
+      *matchLength_p = charIdx + 1;
+    }
+  }
+
+  return outputValue;
+}
+
+size_t get_comb_vector_size(const CombVectorS* const combVector_p)
+{
+  return sizeof(CombVectorS) +
+         sizeof(CombStateS) * combVector_p->numStates +
+         sizeof(CombEntryS) * combVector_p->numEntries;
+}
+
+void free_comb_vector(CombVectorS* const combVector_p)
+{
+  free(combVector_p->states_p);
+  free(combVector_p->entries_p);
+  free(combVector_p);
+}
@@ -0,0 +1,122 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Packs the transitions of DFAs into a comb vector by row displacement, like lex and yacc
+ *        do: the rows of all states are overlapped in one vector so that their transitions fall
+ *        into each other's gaps.
+ * @file comb_vector.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef COMB_VECTOR_H
+#define COMB_VECTOR_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dfa.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A state of a comb vector.
+ * @param base         The index in the comb vector of the entry of the state on char 0.
+ * @param isEndState   True if the state is an end state, false otherwise.
+ * @param outputValue  The output value of the state if it is an end state.
+ */
+typedef struct CombStateS
+{
+  int base;
+  bool isEndState;
+  int outputValue;
+} CombStateS;
+
+/**
+ * @brief An entry of a comb vector. The check and the next state of an entry are stored together
+ *        so that a lookup reads one cache line.
+ * @param check      The state the entry belongs to, NO_STATE if it is free.
+ * @param nextState  The state the transition of the entry goes to.
+ */
+typedef struct CombEntryS
+{
+  int check;
+  int nextState;
+} CombEntryS;
+
+/**
+ * @brief The transitions of a DFA packed into a comb vector. The transition of state s on char c
+ *        is the entry at base(s) + c if its check is s; otherwise there is none. Its states are
+ *        those of the DFA it was made from, with the same indicies.
+ * @param states_p    The states.
+ * @param numStates   The number of states.
+ * @param entries_p   The comb vector, with room for NUM_CHARS entries after every base.
+ * @param numEntries  The number of entries.
+ */
+typedef struct CombVectorS
+{
+  CombStateS* states_p;
+  int numStates;
+  CombEntryS* entries_p;
+  int numEntries;
+} CombVectorS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Packs the transitions of a DFA into a comb vector, first fit decreasing: the states with
+ *        the most transitions are placed first, each at the lowest base where its transitions only
+ *        fall on free entries.
+ * @param[in]  dfa_p  The DFA.
+ * @return Pointer to allocated comb vector.
+ */
+CombVectorS* pack_comb_vector(const DfaS* const dfa_p);
+
+/**
+ * @brief Finds the state a comb vector goes to from a state on a char.
+ * @param[in]  combVector_p  The comb vector.
+ * @param[in]  state         The state.
+ * @param[in]  character     The char.
+ * @return The next state, NO_STATE if there is none.
+ */
+static inline int get_comb_vector_transition(const CombVectorS* const combVector_p,
+                                             const int state,
+                                             const unsigned char character)
+{
+  const CombEntryS* entry_p = &(combVector_p->entries_p[combVector_p->states_p[state].base +
+                                                        character]);
+  return (entry_p->check == state) ? entry_p->nextState : (int) NO_STATE;
+}
+
+/**
+ * @brief Finds the longest match of a comb vector from the start of an input, like a lexer reading
+ *        a token.
+ * @param[in]   combVector_p   The comb vector.
+ * @param[in]   input_p        The input.
+ * @param[in]   inputLength    The number of chars in the input.
+ * @param[out]  matchLength_p  The number of chars of the match.
+ * @return The output value of the match, NO_STATE if there is none.
+ */
+int match_comb_vector(const CombVectorS* const combVector_p,
+                      const char* const input_p,
+                      const size_t inputLength,
+                      size_t* const matchLength_p);
+
+/**
+ * @brief Gets the number of bytes the tables of a comb vector take.
+ * @param[in]  combVector_p  The comb vector.
+ * @return The number of bytes.
+ */
+size_t get_comb_vector_size(const CombVectorS* const combVector_p);
+
+/**
+ * @brief Frees a comb vector.
+ * @param[in]  combVector_p  The comb vector.
+ */
+void free_comb_vector(CombVectorS* const combVector_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -0,0 +1,287 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Compresses DFAs with default transitions (D2FA): a state only stores the transitions that
+*        differ from those of its default state and looks up the others there.
+* @file d2fa.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "d2fa.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Counts the chars a DFA state has no transition on.
+ * @param[in]  dfaState_p  The DFA state.
+ * @return The number of chars.
+ */
+static int count_missing_transitions(const DfaStateS* const dfaState_p);
+
+/**
+ * @brief Counts the chars two DFA states have the same transition on.
+ * @param[in]  dfaState1_p  The first DFA state.
+ * @param[in]  dfaState2_p  The second DFA state.
+ * @return The number of chars.
+ */
+static int count_equal_transitions(const DfaStateS* const dfaState1_p,
+                                   const DfaStateS* const dfaState2_p);
+
+/**
+ * @brief Counts the chars every pair of states of a DFA has the same transition on.
+ * @param[in]  dfa_p  The DFA.
+ * @return The counts of the pairs of states i > j, at index i * (i - 1) / 2 + j.
+ */
+static uint16_t* count_all_equal_transitions(const DfaS* const dfa_p);
+
+/**
+ * @brief Chooses the default states of a DFA by a maximum weight spanning tree, grown from the
+ *        most similar states first, in which no state has more than maxDepth default transitions
+ *        above it.
+ * @param[in]   dfa_p            The DFA.
+ * @param[in]   numsEqual_p      The result of count_all_equal_transitions(), NULL if maxDepth is 0.
+ * @param[in]   maxDepth         The most default transitions a lookup may follow.
+ * @param[out]  defaultStates_p  The default state of each state, NO_STATE for roots.
+ * @param[out]  depth_p          The most default transitions a lookup follows in the tree.
+ * @return The number of labeled transitions the states need with these default states.
+ */
+static int find_default_states(const DfaS* const dfa_p,
+                               const uint16_t* const numsEqual_p,
+                               const int maxDepth,
+                               int* const defaultStates_p,
+                               int* const depth_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int count_missing_transitions(const DfaStateS* const dfaState_p)
+{
+  int numMissing = 0;
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    numMissing += (dfaState_p->transitions[i] == NO_STATE);
+  }
+  return numMissing;
+}
+
+static int count_equal_transitions(const DfaStateS* const dfaState1_p,
+                                   const DfaStateS* const dfaState2_p)
+{
+  int numEqual = 0;
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    numEqual += (dfaState1_p->transitions[i] == dfaState2_p->transitions[i]);
+  }
+  return numEqual;
+}
+
+static uint16_t* count_all_equal_transitions(const DfaS* const dfa_p)
+{
+  const size_t numStates = dfa_p->numStates;
+  uint16_t* numsEqual_p = malloc(sizeof(uint16_t) * (numStates * (numStates - 1) / 2 + 1));
+  assert(numsEqual_p != NULL);
+  for (size_t i = 1; i < numStates; i++)
+  {
+    for (size_t j = 0; j < i; j++)
+    {
+      numsEqual_p[i * (i - 1) / 2 + j] = count_equal_transitions(&(dfa_p->states[i]),
+                                                                 &(dfa_p->states[j]));
+    }
+  }
+  return numsEqual_p;
+}
+
+static int find_default_states(const DfaS* const dfa_p,
+                               const uint16_t* const numsEqual_p,
+                               const int maxDepth,
+                               int* const defaultStates_p,
+                               int* const depth_p)
+{
+  const int numStates = dfa_p->numStates;
+  int* weights_p = malloc(sizeof(int) * numStates);
+  int* depths_p = malloc(sizeof(int) * numStates);
+  bool* isInTree_p = malloc(sizeof(bool) * numStates);
+  assert(weights_p != NULL && depths_p != NULL && isInTree_p != NULL);
+
+  // Prim's algorithm from a virtual root that every state is as similar to as the chars it has no
+  // transition on, since a root only stores the transitions it has.
+  for (int i = 0; i < numStates; i++)
+  {
+    weights_p[i] = count_missing_transitions(&(dfa_p->states[i]));
+    defaultStates_p[i] = NO_STATE;
+    isInTree_p[i] = false;
+  }
+  int numTransitions = 0;
+  *depth_p = 0;
+  for (int i = 0; i < numStates; i++)
+  {
+    int state = NO_STATE;
+    for (int j = 0; j < numStates; j++)
+    {
+      if (!isInTree_p[j] && (state == NO_STATE || weights_p[j] > weights_p[state]))
+      {
+        state = j;
+      }
+    }
+
+    isInTree_p[state] = true;
+    depths_p[state] = (defaultStates_p[state] == NO_STATE) ?
+                      0 :
+                      depths_p[defaultStates_p[state]] + 1;
+    *depth_p = (depths_p[state] > *depth_p) ? depths_p[state] : *depth_p;
+    numTransitions += NUM_CHARS - weights_p[state];
+    if (depths_p[state] == maxDepth)
+    {
+      continue;
+    }
+    for (int j = 0; j < numStates; j++)
+    {
+      if (isInTree_p[j])
+      {
+        continue;
+      }
+      int weight = (state > j) ?
+                   numsEqual_p[(size_t) state * (state - 1) / 2 + j] :
+                   numsEqual_p[(size_t) j * (j - 1) / 2 + state];
+      if (weight > weights_p[j])
+      {
+        weights_p[j] = weight;
+        defaultStates_p[j] = state;
+      }
+    }
+  }
+
+  free(weights_p);
+  free(depths_p);
+  free(isInTree_p);
+  return numTransitions;
+}
+
+/*> Global Function Definitions *******************************************************************/
+D2faS* compress_dfa_with_defaults(const DfaS* const dfa_p, const int maxDepth)
+{
+  assert(maxDepth >= 0);
+  const int numStates = dfa_p->numStates;
+  int* defaultStates_p = malloc(sizeof(int) * numStates);
+  int* candidateDefaultStates_p = malloc(sizeof(int) * numStates);
+  assert(defaultStates_p != NULL && candidateDefaultStates_p != NULL);
+  uint16_t* numsEqual_p = (maxDepth > 0) ? count_all_equal_transitions(dfa_p) : NULL;
+
+  // Capping the depth changes which states the greedy tree picks, so a deeper cap can give more
+  // transitions. Every cap up to maxDepth is tried, until the tree no longer reaches its cap.
+  int depth = 0;
+  int numTransitions = find_default_states(dfa_p, numsEqual_p, 0, defaultStates_p, &depth);
+  int candidateDepth = 0;
+  for (int cap = 1; cap <= maxDepth && candidateDepth == cap - 1; cap++)
+  {
+    int numCandidateTransitions = find_default_states(dfa_p,
+                                                      numsEqual_p,
+                                                      cap,
+                                                      candidateDefaultStates_p,
+                                                      &candidateDepth);
+    if (numCandidateTransitions < numTransitions)
+    {
+      int* swap_p = defaultStates_p;
+      defaultStates_p = candidateDefaultStates_p;
+      candidateDefaultStates_p = swap_p;
+      numTransitions = numCandidateTransitions;
+      depth = candidateDepth;
+    }
+  }
+
+  D2faS* d2fa_p = malloc(sizeof(*d2fa_p));
+  assert(d2fa_p != NULL);
+  d2fa_p->states_p = malloc(sizeof(D2faStateS) * numStates);
+  d2fa_p->transitions_p = malloc(sizeof(int) * numTransitions);
+  assert(d2fa_p->states_p != NULL && (d2fa_p->transitions_p != NULL || numTransitions == 0));
+  d2fa_p->numStates = numStates;
+  d2fa_p->numTransitions = numTransitions;
+  d2fa_p->maxDepth = depth;
+
+  int transitionIdx = 0;
+  for (int i = 0; i < numStates; i++)
+  {
+    const DfaStateS* dfaState_p = &(dfa_p->states[i]);
+    D2faStateS* d2faState_p = &(d2fa_p->states_p[i]);
+    d2faState_p->defaultState = defaultStates_p[i];
+    d2faState_p->firstTransitionIdx = transitionIdx;
+    d2faState_p->isEndState = dfaState_p->isEndState;
+    d2faState_p->outputValue = dfaState_p->outputValue;
+    for (int j = 0; j < NUM_CHAR_WORDS; j++)
+    {
+      d2faState_p->labeledChars[j] = 0;
+    }
+
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      int defaultTransition = (defaultStates_p[i] == NO_STATE) ?
+                              (int) NO_STATE :
+                              dfa_p->states[defaultStates_p[i]].transitions[j];
+      if (dfaState_p->transitions[j] != defaultTransition)
+      {
+        add_to_bitset(&(d2faState_p->labeledChars[j / BITSET_SIZE]), j % BITSET_SIZE);
+        d2fa_p->transitions_p[transitionIdx++] = dfaState_p->transitions[j];
+      }
+    }
+  }
+  assert(transitionIdx == numTransitions);
+
+  free(defaultStates_p);
+  free(candidateDefaultStates_p);
+  free(numsEqual_p);
+  return d2fa_p;
+}
+
+int match_d2fa(const D2faS* const d2fa_p,
+               const char* const input_p,
+               const size_t inputLength,
+               size_t* const matchLength_p)
+{
+  const unsigned char* chars_p = (const unsigned char*) input_p;
+  int outputValue = NO_STATE;
+  int state = 0;
+  *matchLength_p = 0;
+
+  for (size_t charIdx = 0; charIdx < inputLength; charIdx++)
+  {
+    state = get_d2fa_transition(d2fa_p, state, chars_p[charIdx]);
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (d2fa_p->states_p[state].isEndState)
+    {
+      outputValue = d2fa_p->states_p[state].outputValue;
+      *matchLength_p = charIdx + 1;
+    }
+  }
+
+  return outputValue;
+}
+
+size_t get_d2fa_size(const D2faS* const d2fa_p)
+{
+  return sizeof(D2faS) +
+         sizeof(D2faStateS) * d2fa_p->numStates +
+         sizeof(int) * d2fa_p->numTransitions;
+}
+
+void free_d2fa(D2faS* const d2fa_p)
+{
+  free(d2fa_p->states_p);
+  free(d2fa_p->transitions_p);
+  free(d2fa_p);
+}
@@ -0,0 +1,144 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Compresses DFAs with default transitions (D2FA): a state only stores the transitions that
+ *        differ from those of its default state and looks up the others there. A D2FA is a
+ *        standalone representation for keeping a large DFA in little memory; lexers do not scan
+ *        with it, and match_d2fa() reads one token from it.
+ * @file d2fa.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef D2FA_H
+#define D2FA_H
+
+/*> Includes **************************************************************************************/
+#include <stddef.h>
+
+#include "bitset.h"
+#include "dfa.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_CHAR_WORDS (NUM_CHARS / BITSET_SIZE)
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A state of a D2FA.
+ * @param defaultState        The state to look up the transitions on chars not in labeledChars
+ *                            in, NO_STATE if there are none on them.
+ * @param firstTransitionIdx  The index of the transition on the lowest char in labeledChars.
+ * @param labeledChars        The chars the state has its own transitions on, which are stored in
+ *                            order of the chars.
+ * @param isEndState          True if the state is an end state, false otherwise.
+ * @param outputValue         The output value of the state if it is an end state.
+ */
+typedef struct D2faStateS
+{
+  int defaultState;
+  int firstTransitionIdx;
+  BitSetT labeledChars[NUM_CHAR_WORDS];
+  bool isEndState;
+  int outputValue;
+} D2faStateS;
+
+/**
+ * @brief A DFA compressed with default transitions. Its states are those of the DFA it was made
+ *        from, with the same indicies.
+ * @param states_p        The states.
+ * @param numStates       The number of states.
+ * @param transitions_p   The labeled transitions of all states.
+ * @param numTransitions  The number of labeled transitions.
+ * @param maxDepth        The most default transitions a lookup follows, at most the cap it was
+ *                        compressed with.
+ */
+typedef struct D2faS
+{
+  D2faStateS* states_p;
+  int numStates;
+  int* transitions_p;
+  int numTransitions;
+  int maxDepth;
+} D2faS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Compresses a DFA with default transitions. The default states are chosen by a maximum
+ *        weight spanning tree of the states, where the weight of two states is the number of chars
+ *        they have the same transition on; a state is a root if no state is more similar than the
+ *        chars it has no transition on. Only states with fewer than maxDepth default transitions
+ *        above them become default states, so lookups are bounded. The tree is grown greedily, so
+ *        a deeper cap does not always give fewer transitions; the tree with the fewest of all caps
+ *        up to maxDepth is kept. The weights of all pairs of states are counted once, in
+ *        numStates^2 / 2 counters of 16 bits, and shared by the trees.
+ * @param[in]  dfa_p     The DFA.
+ * @param[in]  maxDepth  The most default transitions a lookup may follow.
+ * @return Pointer to allocated D2FA.
+ */
+D2faS* compress_dfa_with_defaults(const DfaS* const dfa_p, const int maxDepth);
+
+/**
+ * @brief Finds the state a D2FA goes to from a state on a char, following default transitions.
+ * @param[in]  d2fa_p     The D2FA.
+ * @param[in]  state      The state.
+ * @param[in]  character  The char.
+ * @return The next state, NO_STATE if there is none.
+ */
+static inline int get_d2fa_transition(const D2faS* const d2fa_p,
+                                      int state,
+                                      const unsigned char character)
+{
+  const int wordIdx = character / BITSET_SIZE;
+  const BitSetT bit = (BitSetT) 1 << (character % BITSET_SIZE);
+  for (;;)
+  {
+    const D2faStateS* d2faState_p = &(d2fa_p->states_p[state]);
+    if ((d2faState_p->labeledChars[wordIdx] & bit) != 0)
+    {
+      int transitionIdx = d2faState_p->firstTransitionIdx +
+                          __builtin_popcountll(d2faState_p->labeledChars[wordIdx] & (bit - 1));
+      for (int i = 0; i < wordIdx; i++)
+      {
+        transitionIdx += __builtin_popcountll(d2faState_p->labeledChars[i]);
+      }
+      return d2fa_p->transitions_p[transitionIdx];
+    }
+    if (d2faState_p->defaultState == NO_STATE)
+    {
+      return (int) NO_STATE;
+    }
+    state = d2faState_p->defaultState;
+  }
+}
+
+/**
+ * @brief Finds the longest match of a D2FA from the start of an input, like a lexer reading a
+ *        token.
+ * @param[in]   d2fa_p         The D2FA.
+ * @param[in]   input_p        The input.
+ * @param[in]   inputLength    The number of chars in the input.
+ * @param[out]  matchLength_p  The number of chars of the match.
+ * @return The output value of the match, NO_STATE if there is none.
+ */
+int match_d2fa(const D2faS* const d2fa_p,
+               const char* const input_p,
+               const size_t inputLength,
+               size_t* const matchLength_p);
+
+/**
+ * @brief Gets the number of bytes the tables of a D2FA take.
+ * @param[in]  d2fa_p  The D2FA.
+ * @return The number of bytes.
+ */
+size_t get_d2fa_size(const D2faS* const d2fa_p);
+
+/**
+ * @brief Frees a D2FA.
+ * @param[in]  d2fa_p  The D2FA.
+ */
+void free_d2fa(D2faS* const d2fa_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
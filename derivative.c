@@ -0,0 +1,949 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Builds DFAs directly from RegExps with Brzozowski derivatives, without an NFA.
+* @file derivative.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "derivative.h"
+#include "unicode.h"
+
+/*> Defines ***************************************************************************************/
+#define EMPTY_TERM                  0
+#define EPSILON_TERM                1
+#define NO_TERM                     -1
+#define UNKNOWN_STATE               -2
+#define INITIAL_MAX_NUM_TERMS       256
+#define INITIAL_TABLE_SIZE          512
+#define INITIAL_MAX_NUM_OPERANDS    16
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief The types of terms derivatives are made of.
+ */
+typedef enum TermTypeE
+{
+  TERM_EMPTY,
+  TERM_EPSILON,
+  TERM_CHARS,
+  TERM_CONCAT,
+  TERM_OR,
+  TERM_STAR
+} TermTypeE;
+
+/**
+ * @brief A term of a derivative. Terms are hash-consed: equal terms are stored once, so two terms
+ *        are equal exactly if their indicies are. An Or is a chain of alternatives sorted by index,
+ *        with all sets of chars in it joined into one, and a Concat is a chain to the right.
+ * @param type        The type of the term.
+ * @param isNullable  True if the term matches the empty string.
+ * @param left        The first part of a Concat, the first alternative of an Or or the repeated
+ *                    term of a Star.
+ * @param right       The rest of a Concat or the other alternatives of an Or.
+ * @param chars       The chars of a Chars term as a bit set.
+ * @param hash        The hash of the term.
+ */
+typedef struct TermS
+{
+  TermTypeE type;
+  bool isNullable;
+  int left;
+  int right;
+  uint64_t chars[NUM_CHAR_CLASS_WORDS];
+  uint32_t hash;
+} TermS;
+
+/**
+ * @brief A memoized derivative of a term.
+ * @param term        The term, NO_TERM if the entry is free.
+ * @param character   The char the term is derived by.
+ * @param derivative  The derivative.
+ */
+typedef struct DerivativeS
+{
+  int term;
+  int character;
+  int derivative;
+} DerivativeS;
+
+/**
+ * @brief What is needed to build a DFA from derivatives.
+ * @param terms_p              The terms.
+ * @param numTerms             The number of terms.
+ * @param maxNumTerms          The number of terms there is room for.
+ * @param termTable_p          Hash table of the indicies of the terms, NO_TERM where free.
+ * @param termTableSize        The number of entries of the term table, a power of 2.
+ * @param derivatives_p        Hash table of the derivatives computed so far.
+ * @param numDerivatives       The number of derivatives in the table.
+ * @param derivativeTableSize  The number of entries of the derivative table, a power of 2.
+ * @param operands_p           Room to collect the alternatives of an Or.
+ * @param maxNumOperands       The number of alternatives there is room for.
+ * @param numRegExps           The number of RegExps, i.e. the number of terms of a DFA state.
+ * @param stateTerms_p         The terms of each DFA state, numRegExps per state.
+ * @param stateHashes_p        The hash of each DFA state.
+ * @param maxNumStates         The number of DFA states there is room for.
+ * @param stateTable_p         Hash table of the indicies of the DFA states, NO_STATE where free.
+ * @param stateTableSize       The number of entries of the state table, a power of 2.
+ * @param maxNumDfaStates      The number of DFA states the DFA may have.
+ */
+typedef struct DerivativeBuilderS
+{
+  TermS* terms_p;
+  int numTerms;
+  int maxNumTerms;
+  int* termTable_p;
+  int termTableSize;
+  DerivativeS* derivatives_p;
+  int numDerivatives;
+  int derivativeTableSize;
+  int* operands_p;
+  int maxNumOperands;
+  int numRegExps;
+  int* stateTerms_p;
+  uint32_t* stateHashes_p;
+  int maxNumStates;
+  int* stateTable_p;
+  int stateTableSize;
+  int maxNumDfaStates;
+} DerivativeBuilderS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Hashes ints with FNV-1a.
+ * @param[in]  hash     The hash to continue from.
+ * @param[in]  ints_p   The ints.
+ * @param[in]  numInts  The number of ints.
+ * @return The hash.
+ */
+static uint32_t hash_ints(uint32_t hash, const int* const ints_p, const int numInts);
+
+/**
+ * @brief Creates a hash table of ints where every entry is free.
+ * @param[in]  size  The number of entries.
+ * @param[in]  free  The value of free entries.
+ * @return The table.
+ */
+static int* create_int_table(const int size, const int free);
+
+/**
+ * @brief Stores a term, or finds the equal term that is already stored.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      term_p     The term, whose hash is set here.
+ * @return Index of the term.
+ */
+static int intern_term(DerivativeBuilderS* const builder_p, TermS* const term_p);
+
+/**
+ * @brief Makes a term matching one of a set of chars.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      chars      The chars as a bit set.
+ * @return Index of the term, EMPTY_TERM if there are no chars.
+ */
+static int make_chars(DerivativeBuilderS* const builder_p,
+                      const uint64_t chars[NUM_CHAR_CLASS_WORDS]);
+
+/**
+ * @brief Makes a term matching a term followed by another.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      first      The first term.
+ * @param[in]      second     The second term.
+ * @return Index of the term.
+ */
+static int make_concat(DerivativeBuilderS* const builder_p, const int first, const int second);
+
+/**
+ * @brief Adds an alternative to the alternatives collected for an Or.
+ * @param[in/out]  builder_p      The builder.
+ * @param[in]      operand        The alternative.
+ * @param[in/out]  numOperands_p  The number of collected alternatives.
+ */
+static void push_or_operand(DerivativeBuilderS* const builder_p,
+                            const int operand,
+                            int* const numOperands_p);
+
+/**
+ * @brief Adds the alternatives of a term to the alternatives collected for an Or. Sets of chars
+ *        are joined instead.
+ * @param[in/out]  builder_p      The builder.
+ * @param[in]      term           The term.
+ * @param[in/out]  numOperands_p  The number of collected alternatives.
+ * @param[in/out]  chars          The chars of the collected Chars alternatives as a bit set.
+ */
+static void add_or_operands(DerivativeBuilderS* const builder_p,
+                            const int term,
+                            int* const numOperands_p,
+                            uint64_t chars[NUM_CHAR_CLASS_WORDS]);
+
+/**
+ * @brief Compares two term indicies for qsort().
+ * @param[in]  term1_p  The first index.
+ * @param[in]  term2_p  The second index.
+ * @return Negative, zero or positive if the first index is lower, equal or higher.
+ */
+static int compare_terms(const void* term1_p, const void* term2_p);
+
+/**
+ * @brief Makes a term matching either of two terms.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      term1      The first term.
+ * @param[in]      term2      The second term.
+ * @return Index of the term.
+ */
+static int make_or(DerivativeBuilderS* const builder_p, const int term1, const int term2);
+
+/**
+ * @brief Makes a term matching a term repeated zero or more times.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      term       The term.
+ * @return Index of the term.
+ */
+static int make_star(DerivativeBuilderS* const builder_p, const int term);
+
+/**
+ * @brief Derives a term by a char, i.e. makes the term matching what the term matches after the
+ *        char.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      term       The term.
+ * @param[in]      character  The char.
+ * @return Index of the derivative.
+ */
+static int derive(DerivativeBuilderS* const builder_p, const int term, const int character);
+
+/**
+ * @brief Splits classes of chars so that the chars of each class derive a term to the same term.
+ *        Only the sets of chars a match of the term can start with matter.
+ * @param[in]      builder_p     The builder.
+ * @param[in]      term          The term.
+ * @param[in/out]  classes_p     The class of each char.
+ * @param[in/out]  numClasses_p  The number of classes.
+ */
+static void split_char_classes(const DerivativeBuilderS* const builder_p,
+                               const int term,
+                               uint8_t* const classes_p,
+                               int* const numClasses_p);
+
+/**
+ * @brief Converts a RegExp to a term.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in]      regExp_p   The RegExp.
+ * @return Index of the term.
+ */
+static int term_of_regexp(DerivativeBuilderS* const builder_p, const RegExpS* const regExp_p);
+
+/**
+ * @brief Converts a state of a UTF-8 automaton to a term.
+ * @param[in/out]  builder_p     The builder.
+ * @param[in]      automaton_p   The automaton.
+ * @param[in]      state         The state.
+ * @param[in/out]  stateTerms_p  The term of each state converted so far, NO_TERM for the others.
+ * @return Index of the term.
+ */
+static int term_of_utf8_state(DerivativeBuilderS* const builder_p,
+                              const Utf8AutomatonS* const automaton_p,
+                              const int state,
+                              int* const stateTerms_p);
+
+/**
+ * @brief Finds the DFA state of a tuple of terms, adding it if it does not exist yet.
+ * @param[in/out]  builder_p  The builder.
+ * @param[in/out]  dfa_p      The DFA.
+ * @param[in]      terms_p    One term per RegExp.
+ * @return Index of the DFA state, NO_STATE if it would be one more than the DFA may have.
+ */
+static int find_or_add_dfa_state(DerivativeBuilderS* const builder_p,
+                                 DfaS* const dfa_p,
+                                 const int* const terms_p);
+
+/*> Local Function Definitions ********************************************************************/
+static uint32_t hash_ints(uint32_t hash, const int* const ints_p, const int numInts)
+{
+  for (int i = 0; i < numInts; i++)
+  {
+    hash = (hash ^ (uint32_t) ints_p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static int* create_int_table(const int size, const int free)
+{
+  int* table_p = malloc(sizeof(int) * size);
+  assert(table_p != NULL);
+  for (int i = 0; i < size; i++)
+  {
+    table_p[i] = free;
+  }
+  return table_p;
+}
+
+static int intern_term(DerivativeBuilderS* const builder_p, TermS* const term_p)
+{
+  int fields[] = {term_p->type, term_p->left, term_p->right};
+  term_p->hash = hash_ints(2166136261u, fields, 3);
+  for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+  {
+    int halves[] = {(int) term_p->chars[i], (int) (term_p->chars[i] >> 32)};
+    term_p->hash = hash_ints(term_p->hash, halves, 2);
+  }
+
+  int tableIdx = term_p->hash & (builder_p->termTableSize - 1);
+  while (builder_p->termTable_p[tableIdx] != NO_TERM)
+  {
+    const TermS* other_p = &(builder_p->terms_p[builder_p->termTable_p[tableIdx]]);
+    if (other_p->hash == term_p->hash &&
+        other_p->type == term_p->type &&
+        other_p->left == term_p->left &&
+        other_p->right == term_p->right &&
+        memcmp(other_p->chars, term_p->chars, sizeof(term_p->chars)) == 0)
+    {
+      return builder_p->termTable_p[tableIdx];
+    }
+    tableIdx = (tableIdx + 1) & (builder_p->termTableSize - 1);
+  }
+
+  int newTerm = builder_p->numTerms;
+  if (builder_p->numTerms == builder_p->maxNumTerms)
+  {
+    builder_p->maxNumTerms = builder_p->maxNumTerms > 0 ?
+                             2 * builder_p->maxNumTerms :
+                             INITIAL_MAX_NUM_TERMS;
+    builder_p->terms_p = realloc(builder_p->terms_p, sizeof(TermS) * builder_p->maxNumTerms);
+    assert(builder_p->terms_p != NULL);
+  }
+  builder_p->terms_p[newTerm] = *term_p;
+  builder_p->numTerms++;
+  builder_p->termTable_p[tableIdx] = newTerm;
+
+  // Keep the table at most half full.
+  if (2 * builder_p->numTerms > builder_p->termTableSize)
+  {
+    free(builder_p->termTable_p);
+    builder_p->termTableSize *= 2;
+    builder_p->termTable_p = create_int_table(builder_p->termTableSize, NO_TERM);
+    for (int i = 0; i < builder_p->numTerms; i++)
+    {
+      tableIdx = builder_p->terms_p[i].hash & (builder_p->termTableSize - 1);
+      while (builder_p->termTable_p[tableIdx] != NO_TERM)
+      {
+        tableIdx = (tableIdx + 1) & (builder_p->termTableSize - 1);
+      }
+      builder_p->termTable_p[tableIdx] = i;
+    }
+  }
+
+  return newTerm;
+}
+
+static int make_chars(DerivativeBuilderS* const builder_p,
+                      const uint64_t chars[NUM_CHAR_CLASS_WORDS])
+{
+  TermS term = { .type = TERM_CHARS, .isNullable = false, .left = NO_TERM, .right = NO_TERM };
+  bool isEmpty = true;
+  for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+  {
+    term.chars[i] = chars[i];
+    isEmpty = isEmpty && chars[i] == 0;
+  }
+  return isEmpty ? EMPTY_TERM : intern_term(builder_p, &term);
+}
+
+static int make_concat(DerivativeBuilderS* const builder_p, const int first, const int second)
+{
+  if (first == EMPTY_TERM || second == EMPTY_TERM)
+  {
+    return EMPTY_TERM;
+  }
+  if (first == EPSILON_TERM)
+  {
+    return second;
+  }
+  if (second == EPSILON_TERM)
+  {
+    return first;
+  }
+
+  const TermS* first_p = &(builder_p->terms_p[first]);
+  if (first_p->type == TERM_CONCAT)
+  {
+    int firstLeft = first_p->left;
+    return make_concat(builder_p, firstLeft, make_concat(builder_p, first_p->right, second));
+  }
+
+  TermS term =
+  {
+    .type = TERM_CONCAT,
+    .isNullable = first_p->isNullable && builder_p->terms_p[second].isNullable,
+    .left = first,
+    .right = second,
+    .chars = {0}
+  };
+  return intern_term(builder_p, &term);
+}
+
+static void push_or_operand(DerivativeBuilderS* const builder_p,
+                            const int operand,
+                            int* const numOperands_p)
+{
+  if (*numOperands_p == builder_p->maxNumOperands)
+  {
+    builder_p->maxNumOperands = builder_p->maxNumOperands > 0 ?
+                                2 * builder_p->maxNumOperands :
+                                INITIAL_MAX_NUM_OPERANDS;
+    builder_p->operands_p = realloc(builder_p->operands_p,
+                                    sizeof(int) * builder_p->maxNumOperands);
+    assert(builder_p->operands_p != NULL);
+  }
+  builder_p->operands_p[(*numOperands_p)++] = operand;
+}
+
+static void add_or_operands(DerivativeBuilderS* const builder_p,
+                            const int term,
+                            int* const numOperands_p,
+                            uint64_t chars[NUM_CHAR_CLASS_WORDS])
+{
+  int rest = term;
+  while (rest != NO_TERM)
+  {
+    const TermS* rest_p = &(builder_p->terms_p[rest]);
+    int operand = (rest_p->type == TERM_OR) ? rest_p->left : rest;
+    rest = (rest_p->type == TERM_OR) ? rest_p->right : NO_TERM;
+
+    const TermS* operand_p = &(builder_p->terms_p[operand]);
+    if (operand_p->type == TERM_CHARS)
+    {
+      for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+      {
+        chars[i] |= operand_p->chars[i];
+      }
+      continue;
+    }
+
+    push_or_operand(builder_p, operand, numOperands_p);
+  }
+}
+
+static int compare_terms(const void* term1_p, const void* term2_p)
+{
+  return *((const int*) term1_p) - *((const int*) term2_p);
+}
+
+static int make_or(DerivativeBuilderS* const builder_p, const int term1, const int term2)
+{
+  if (term1 == term2 || term2 == EMPTY_TERM)
+  {
+    return term1;
+  }
+  if (term1 == EMPTY_TERM)
+  {
+    return term2;
+  }
+
+  // Flatten, join the sets of chars, sort and remove duplicates, so that equal Ors are one term.
+  int numOperands = 0;
+  uint64_t chars[NUM_CHAR_CLASS_WORDS] = {0};
+  add_or_operands(builder_p, term1, &numOperands, chars);
+  add_or_operands(builder_p, term2, &numOperands, chars);
+  int charsTerm = make_chars(builder_p, chars);
+  if (charsTerm != EMPTY_TERM)
+  {
+    push_or_operand(builder_p, charsTerm, &numOperands);
+  }
+
+  int* operands_p = builder_p->operands_p;
+  qsort(operands_p, numOperands, sizeof(int), compare_terms);
+  int numUniqueOperands = 0;
+  for (int i = 0; i < numOperands; i++)
+  {
+    if (i == 0 || operands_p[i] != operands_p[i - 1])
+    {
+      operands_p[numUniqueOperands++] = operands_p[i];
+    }
+  }
+
+  int result = operands_p[numUniqueOperands - 1];
+  for (int i = numUniqueOperands - 2; i >= 0; i--)
+  {
+    TermS term =
+    {
+      .type = TERM_OR,
+      .isNullable = builder_p->terms_p[operands_p[i]].isNullable ||
+                    builder_p->terms_p[result].isNullable,
+      .left = operands_p[i],
+      .right = result,
+      .chars = {0}
+    };
+    result = intern_term(builder_p, &term);
+  }
+  return result;
+}
+
+static int make_star(DerivativeBuilderS* const builder_p, const int term)
+{
+  if (term == EMPTY_TERM || term == EPSILON_TERM)
+  {
+    return EPSILON_TERM;
+  }
+  if (builder_p->terms_p[term].type == TERM_STAR)
+  {
+    return term;
+  }
+
+  TermS star = { .type = TERM_STAR, .isNullable = true, .left = term, .right = NO_TERM };
+  return intern_term(builder_p, &star);
+}
+
+static int derive(DerivativeBuilderS* const builder_p, const int term, const int character)
+{
+  const TermS* term_p = &(builder_p->terms_p[term]);
+  switch (term_p->type)
+  {
+  case TERM_EMPTY:
+  case TERM_EPSILON:
+    return EMPTY_TERM;
+  case TERM_CHARS:
+    return ((term_p->chars[character / 64] >> (character % 64)) & 1) ? EPSILON_TERM : EMPTY_TERM;
+  default:
+    break;
+  }
+
+  int key[] = {term, character};
+  int tableIdx = hash_ints(2166136261u, key, 2) & (builder_p->derivativeTableSize - 1);
+  while (builder_p->derivatives_p[tableIdx].term != NO_TERM)
+  {
+    const DerivativeS* derivative_p = &(builder_p->derivatives_p[tableIdx]);
+    if (derivative_p->term == term && derivative_p->character == character)
+    {
+      return derivative_p->derivative;
+    }
+    tableIdx = (tableIdx + 1) & (builder_p->derivativeTableSize - 1);
+  }
+
+  // The terms may move while deriving, so copy what is needed of the term first.
+  const TermTypeE type = term_p->type;
+  const int left = term_p->left;
+  const int right = term_p->right;
+  const bool isLeftNullable = builder_p->terms_p[left].isNullable;
+  int derivative;
+  switch (type)
+  {
+  case TERM_CONCAT:
+    derivative = make_concat(builder_p, derive(builder_p, left, character), right);
+    if (isLeftNullable)
+    {
+      derivative = make_or(builder_p, derivative, derive(builder_p, right, character));
+    }
+    break;
+  case TERM_OR:
+    derivative = make_or(builder_p,
+                         derive(builder_p, left, character),
+                         derive(builder_p, right, character));
+    break;
+  default:
+    derivative = make_concat(builder_p, derive(builder_p, left, character), term);
+    break;
+  }
+
+  // The table may have grown while deriving, so look for a free entry again.
+  tableIdx = hash_ints(2166136261u, key, 2) & (builder_p->derivativeTableSize - 1);
+  while (builder_p->derivatives_p[tableIdx].term != NO_TERM)
+  {
+    tableIdx = (tableIdx + 1) & (builder_p->derivativeTableSize - 1);
+  }
+  builder_p->derivatives_p[tableIdx].term = term;
+  builder_p->derivatives_p[tableIdx].character = character;
+  builder_p->derivatives_p[tableIdx].derivative = derivative;
+  builder_p->numDerivatives++;
+
+  if (2 * builder_p->numDerivatives > builder_p->derivativeTableSize)
+  {
+    DerivativeS* oldDerivatives_p = builder_p->derivatives_p;
+    int oldSize = builder_p->derivativeTableSize;
+    builder_p->derivativeTableSize *= 2;
+    builder_p->derivatives_p = malloc(sizeof(DerivativeS) * builder_p->derivativeTableSize);
+    assert(builder_p->derivatives_p != NULL);
+    for (int i = 0; i < builder_p->derivativeTableSize; i++)
+    {
+      builder_p->derivatives_p[i].term = NO_TERM;
+    }
+    for (int i = 0; i < oldSize; i++)
+    {
+      if (oldDerivatives_p[i].term == NO_TERM)
+      {
+        continue;
+      }
+      int oldKey[] = {oldDerivatives_p[i].term, oldDerivatives_p[i].character};
+      tableIdx = hash_ints(2166136261u, oldKey, 2) & (builder_p->derivativeTableSize - 1);
+      while (builder_p->derivatives_p[tableIdx].term != NO_TERM)
+      {
+        tableIdx = (tableIdx + 1) & (builder_p->derivativeTableSize - 1);
+      }
+      builder_p->derivatives_p[tableIdx] = oldDerivatives_p[i];
+    }
+    free(oldDerivatives_p);
+  }
+
+  return derivative;
+}
+
+static void split_char_classes(const DerivativeBuilderS* const builder_p,
+                               const int term,
+                               uint8_t* const classes_p,
+                               int* const numClasses_p)
+{
+  const TermS* term_p = &(builder_p->terms_p[term]);
+  switch (term_p->type)
+  {
+  case TERM_CHARS:
+  {
+    // Each class splits into its chars in the set and its chars outside of it.
+    int newClasses[NUM_CHARS][2];
+    int numNewClasses = 0;
+    memset(newClasses, NO_TERM, sizeof(newClasses[0]) * (*numClasses_p));
+    for (int i = 0; i < NUM_CHARS; i++)
+    {
+      int isInSet = (term_p->chars[i / 64] >> (i % 64)) & 1;
+      int* newClass_p = &(newClasses[classes_p[i]][isInSet]);
+      if (*newClass_p == NO_TERM)
+      {
+        *newClass_p = numNewClasses++;
+      }
+      classes_p[i] = *newClass_p;
+    }
+    *numClasses_p = numNewClasses;
+    break;
+  }
+  case TERM_CONCAT:
+    split_char_classes(builder_p, term_p->left, classes_p, numClasses_p);
+    if (builder_p->terms_p[term_p->left].isNullable)
+    {
+      split_char_classes(builder_p, term_p->right, classes_p, numClasses_p);
+    }
+    break;
+  case TERM_OR:
+    split_char_classes(builder_p, term_p->left, classes_p, numClasses_p);
+    split_char_classes(builder_p, term_p->right, classes_p, numClasses_p);
+    break;
+  case TERM_STAR:
+    split_char_classes(builder_p, term_p->left, classes_p, numClasses_p);
+    break;
+  default:
+    break;
+  }
+}
+
+static int term_of_regexp(DerivativeBuilderS* const builder_p, const RegExpS* const regExp_p)
+{
+  switch (regExp_p->type)
+  {
+  case REGEXP_SEQUENCE:
+  {
+    int term = EPSILON_TERM;
+    for (int i = regExp_p->numChildren - 1; i >= 0; i--)
+    {
+      term = make_concat(builder_p, term_of_regexp(builder_p, regExp_p->children[i]), term);
+    }
+    return term;
+  }
+  case REGEXP_OPTIONAL:
+    return make_or(builder_p, EPSILON_TERM, term_of_regexp(builder_p, regExp_p->child_p));
+  case REGEXP_ONE_OR_MORE:
+  {
+    int child = term_of_regexp(builder_p, regExp_p->child_p);
+    return make_concat(builder_p, child, make_star(builder_p, child));
+  }
+  case REGEXP_ZERO_OR_MORE:
+    return make_star(builder_p, term_of_regexp(builder_p, regExp_p->child_p));
+  case REGEXP_OR:
+    return make_or(builder_p,
+                   term_of_regexp(builder_p, regExp_p->left_p),
+                   term_of_regexp(builder_p, regExp_p->right_p));
+  case REGEXP_STRING:
+  {
+    int term = EPSILON_TERM;
+    for (int i = regExp_p->numChars - 1; i >= 0; i--)
+    {
+      unsigned char character = regExp_p->characters[i];
+      uint64_t chars[NUM_CHAR_CLASS_WORDS] = {0};
+      chars[character / 64] |= (uint64_t) 1 << (character % 64);
+      if (regExp_p->isCaseInsensitive)
+      {
+        unsigned char otherCase = other_char_case(character);
+        chars[otherCase / 64] |= (uint64_t) 1 << (otherCase % 64);
+      }
+      term = make_concat(builder_p, make_chars(builder_p, chars), term);
+    }
+    return term;
+  }
+  case REGEXP_CHAR_CLASS:
+  {
+    uint64_t chars[NUM_CHAR_CLASS_WORDS] = {0};
+    for (int i = 0; i < NUM_CHARS; i++)
+    {
+      if (is_char_in_class(regExp_p, i))
+      {
+        chars[i / 64] |= (uint64_t) 1 << (i % 64);
+      }
+    }
+    return make_chars(builder_p, chars);
+  }
+  case REGEXP_REPEAT:
+  {
+    // The optional copies nest, x{1,3} being x(x(x)?)?, so that they stay one term each.
+    int child = term_of_regexp(builder_p, regExp_p->child_p);
+    int term = EPSILON_TERM;
+    if (regExp_p->maxRepeats == UNBOUNDED_REPEATS)
+    {
+      term = make_star(builder_p, child);
+    }
+    else
+    {
+      for (int i = regExp_p->minRepeats; i < regExp_p->maxRepeats; i++)
+      {
+        term = make_or(builder_p, EPSILON_TERM, make_concat(builder_p, child, term));
+      }
+    }
+    for (int i = 0; i < regExp_p->minRepeats; i++)
+    {
+      term = make_concat(builder_p, child, term);
+    }
+    return term;
+  }
+  case REGEXP_CODE_POINT_SET:
+  {
+    Utf8AutomatonS automaton;
+    build_utf8_automaton(&(regExp_p->codePoints), regExp_p->isReversed, &automaton);
+    int* stateTerms_p = create_int_table(automaton.numStates, NO_TERM);
+    int term = term_of_utf8_state(builder_p, &automaton, automaton.startState, stateTerms_p);
+    free(stateTerms_p);
+    free_utf8_automaton(&automaton);
+    return term;
+  }
+  default:
+    return EMPTY_TERM;
+  }
+}
+
+static int term_of_utf8_state(DerivativeBuilderS* const builder_p,
+                              const Utf8AutomatonS* const automaton_p,
+                              const int state,
+                              int* const stateTerms_p)
+{
+  if (stateTerms_p[state] != NO_TERM)
+  {
+    return stateTerms_p[state];
+  }
+
+  // One alternative per next state, on all bytes leading to it.
+  const int* transitions_p = automaton_p->transitions_p[state];
+  bool isDone[NUM_BYTE_VALUES] = {false};
+  int term = EMPTY_TERM;
+  for (int i = 0; i < NUM_BYTE_VALUES; i++)
+  {
+    if (isDone[i] || transitions_p[i] == NO_UTF8_STATE)
+    {
+      continue;
+    }
+
+    uint64_t chars[NUM_CHAR_CLASS_WORDS] = {0};
+    for (int j = i; j < NUM_BYTE_VALUES; j++)
+    {
+      if (transitions_p[j] == transitions_p[i])
+      {
+        chars[j / 64] |= (uint64_t) 1 << (j % 64);
+        isDone[j] = true;
+      }
+    }
+    int next = (transitions_p[i] == UTF8_ACCEPT) ?
+               EPSILON_TERM :
+               term_of_utf8_state(builder_p, automaton_p, transitions_p[i], stateTerms_p);
+    term = make_or(builder_p, term, make_concat(builder_p, make_chars(builder_p, chars), next));
+  }
+
+  stateTerms_p[state] = term;
+  return term;
+}
+
+static int find_or_add_dfa_state(DerivativeBuilderS* const builder_p,
+                                 DfaS* const dfa_p,
+                                 const int* const terms_p)
+{
+  const int numRegExps = builder_p->numRegExps;
+  uint32_t hash = hash_ints(2166136261u, terms_p, numRegExps);
+  int tableIdx = hash & (builder_p->stateTableSize - 1);
+  while (builder_p->stateTable_p[tableIdx] != NO_STATE)
+  {
+    int stateIdx = builder_p->stateTable_p[tableIdx];
+    if (builder_p->stateHashes_p[stateIdx] == hash &&
+        memcmp(&(builder_p->stateTerms_p[stateIdx * numRegExps]),
+               terms_p,
+               sizeof(int) * numRegExps) == 0)
+    {
+      return stateIdx;
+    }
+    tableIdx = (tableIdx + 1) & (builder_p->stateTableSize - 1);
+  }
+
+  if (dfa_p->numStates >= builder_p->maxNumDfaStates)
+  {
+    return NO_STATE;
+  }
+
+  // The RegExps whose derivatives match the empty string have matched.
+  int rules[numRegExps];
+  int numRules = 0;
+  for (int i = 0; i < numRegExps; i++)
+  {
+    if (builder_p->terms_p[terms_p[i]].isNullable)
+    {
+      rules[numRules++] = i;
+    }
+  }
+  int newStateIdx = add_dfa_state_of_rules(dfa_p, rules, numRules);
+
+  if (dfa_p->numStates > builder_p->maxNumStates)
+  {
+    builder_p->maxNumStates = dfa_p->maxNumStates;
+    builder_p->stateTerms_p = realloc(builder_p->stateTerms_p,
+                                      sizeof(int) * numRegExps * builder_p->maxNumStates);
+    builder_p->stateHashes_p = realloc(builder_p->stateHashes_p,
+                                       sizeof(uint32_t) * builder_p->maxNumStates);
+    assert(builder_p->stateTerms_p != NULL && builder_p->stateHashes_p != NULL);
+  }
+  memcpy(&(builder_p->stateTerms_p[newStateIdx * numRegExps]), terms_p, sizeof(int) * numRegExps);
+  builder_p->stateHashes_p[newStateIdx] = hash;
+  builder_p->stateTable_p[tableIdx] = newStateIdx;
+
+  if (2 * dfa_p->numStates > builder_p->stateTableSize)
+  {
+    free(builder_p->stateTable_p);
+    builder_p->stateTableSize *= 2;
+    builder_p->stateTable_p = create_int_table(builder_p->stateTableSize, NO_STATE);
+    for (int i = 0; i < dfa_p->numStates; i++)
+    {
+      tableIdx = builder_p->stateHashes_p[i] & (builder_p->stateTableSize - 1);
+      while (builder_p->stateTable_p[tableIdx] != NO_STATE)
+      {
+        tableIdx = (tableIdx + 1) & (builder_p->stateTableSize - 1);
+      }
+      builder_p->stateTable_p[tableIdx] = i;
+    }
+  }
+
+  return newStateIdx;
+}
+
+/*> Global Function Definitions *******************************************************************/
+DfaS* generate_derivative_dfa(RegExpS** const regExps_pp,
+                              const int numRegExps,
+                              const int maxNumStates)
+{
+  assert(maxNumStates > 0 && maxNumStates < MAX_NUM_DFA_STATES);
+  DerivativeBuilderS builder =
+  {
+    .terms_p = NULL,
+    .numTerms = 0,
+    .maxNumTerms = 0,
+    .termTable_p = create_int_table(INITIAL_TABLE_SIZE, NO_TERM),
+    .termTableSize = INITIAL_TABLE_SIZE,
+    .derivatives_p = malloc(sizeof(DerivativeS) * INITIAL_TABLE_SIZE),
+    .numDerivatives = 0,
+    .derivativeTableSize = INITIAL_TABLE_SIZE,
+    .operands_p = NULL,
+    .maxNumOperands = 0,
+    .numRegExps = numRegExps,
+    .stateTerms_p = NULL,
+    .stateHashes_p = NULL,
+    .maxNumStates = 0,
+    .stateTable_p = create_int_table(INITIAL_TABLE_SIZE, NO_STATE),
+    .stateTableSize = INITIAL_TABLE_SIZE,
+    .maxNumDfaStates = maxNumStates
+  };
+  assert(builder.derivatives_p != NULL);
+  for (int i = 0; i < INITIAL_TABLE_SIZE; i++)
+  {
+    builder.derivatives_p[i].term = NO_TERM;
+  }
+
+  TermS emptyTerm = { .type = TERM_EMPTY, .isNullable = false, .left = NO_TERM, .right = NO_TERM };
+  TermS epsilonTerm = { .type = TERM_EPSILON, .isNullable = true, .left = NO_TERM,
+                        .right = NO_TERM };
+  intern_term(&builder, &emptyTerm);
+  intern_term(&builder, &epsilonTerm);
+
+  DfaS* dfa_p = create_dfa();
+  int terms[numRegExps];
+  for (int i = 0; i < numRegExps; i++)
+  {
+    terms[i] = term_of_regexp(&builder, regExps_pp[i]);
+  }
+  find_or_add_dfa_state(&builder, dfa_p, terms);
+
+  // States are created in order, so the states still without transitions are the ones after i.
+  bool fits = true;
+  for (int i = 0; i < dfa_p->numStates && fits; i++)
+  {
+    uint8_t classes[NUM_CHARS] = {0};
+    int numClasses = 1;
+    for (int j = 0; j < numRegExps; j++)
+    {
+      split_char_classes(&builder, builder.stateTerms_p[i * numRegExps + j], classes, &numClasses);
+    }
+
+    // All chars of a class lead to the same state, so one char per class is derived by.
+    int nextStates[NUM_CHARS];
+    for (int j = 0; j < numClasses; j++)
+    {
+      nextStates[j] = UNKNOWN_STATE;
+    }
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      int* nextState_p = &(nextStates[classes[j]]);
+      if (*nextState_p == UNKNOWN_STATE)
+      {
+        bool isDead = true;
+        for (int k = 0; k < numRegExps; k++)
+        {
+          terms[k] = derive(&builder, builder.stateTerms_p[i * numRegExps + k], j);
+          isDead = isDead && terms[k] == EMPTY_TERM;
+        }
+        *nextState_p = isDead ? (int) NO_STATE : find_or_add_dfa_state(&builder, dfa_p, terms);
+        if (!isDead && *nextState_p == NO_STATE)
+        {
+          fits = false;
+          break;
+        }
+      }
+      dfa_p->states[i].transitions[j] = *nextState_p;
+    }
+  }
+
+  free(builder.terms_p);
+  free(builder.termTable_p);
+  free(builder.derivatives_p);
+  free(builder.operands_p);
+  free(builder.stateTerms_p);
+  free(builder.stateHashes_p);
+  free(builder.stateTable_p);
+  if (!fits)
+  {
+    free_dfa(dfa_p);
+    return NULL;
+  }
+  find_dfa_byte_classes(dfa_p);
+  // Simplifying misses some equal states, e.g. a*a* and its derivative by 'a'.
+  optimize_dfa(dfa_p);
+  return dfa_p;
+}
@@ -0,0 +1,40 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Builds DFAs directly from RegExps with Brzozowski derivatives, without an NFA.
+ * @file derivative.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef DERIVATIVE_H
+#define DERIVATIVE_H
+
+/*> Includes **************************************************************************************/
+#include "dfa.h"
+#include "reg_exp.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Generates a DFA for an array of RegExps like convert_to_dfa() does for their combined NFA.
+ *        Each DFA state is the tuple of the derivatives of the RegExps by the chars read so far.
+ *        Derivatives are built with constructors that simplify them, so that equal derivatives
+ *        are found to be the same state; they are also memoized. The states they miss are joined
+ *        by optimize_dfa(), like those of a converted NFA.
+ * @param[in]  regExps_pp    The input RegExps.
+ * @param[in]  numRegExps    The number of RegExps.
+ * @param[in]  maxNumStates  The number of states the DFA may have, below MAX_NUM_DFA_STATES.
+ * @return Pointer to allocated DFA, NULL if it would have more than maxNumStates states.
+ */
+DfaS* generate_derivative_dfa(RegExpS** const regExps_pp,
+                              const int numRegExps,
+                              const int maxNumStates);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -6,6 +6,7 @@
 
 /*> Includes **************************************************************************************/
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -16,8 +17,67 @@
 #include "nfa.h"
 
 /*> Defines ***************************************************************************************/
+#define INITIAL_MAX_NUM_ACCEPTED_RULES 64
+#define INITIAL_MAX_NUM_DFA_STATES     16
+#define INITIAL_PRODUCT_TABLE_SIZE     256
+#define NO_BYTE_CLASS                  -1
 
 /*> Type Declarations *****************************************************************************/
+/**
+ * @brief The tuples of states of merged DFAs that form the states of their product.
+ * @param numDfas       The number of merged DFAs, i.e. the number of states in a tuple.
+ * @param tuples_p      The tuple of each product state, with NO_STATE for DFAs that got stuck.
+ * @param maxNumTuples  The number of tuples there is room for.
+ * @param table_p       Hash table of the indicies of the product states, NO_STATE where free.
+ * @param tableSize     The number of entries of the table, a power of 2.
+ */
+typedef struct ProductStatesS
+{
+  int numDfas;
+  int* tuples_p;
+  int maxNumTuples;
+  int* table_p;
+  int tableSize;
+} ProductStatesS;
+
+/**
+ * @brief The sets of NFA states that the threads of a parallel subset construction share. A set
+ *        never changes once it is added, so the threads read the sets handed to them without the
+ *        lock.
+ * @param nfa_p            The NFA.
+ * @param closures_p       The epsilon closure of each NFA state.
+ * @param byteClasses_p    The byte classes of the NFA.
+ * @param powerSets_p      The sets, in the order they were found.
+ * @param hashes_p         The hash of each set.
+ * @param transitions_p    The set each set goes to on each byte class, NO_STATE if there is none.
+ * @param numSets          The number of sets.
+ * @param maxNumSets       The number of sets there is room for.
+ * @param numExpandedSets  The number of sets handed to a thread to find the transitions of.
+ * @param numBusyThreads   The number of threads finding transitions, which may still add sets.
+ * @param isTooLarge       True if more sets were found than there is room for.
+ * @param table_p          Hash table of the indicies of the sets, NO_STATE where free.
+ * @param tableSize        The number of entries of the table, a power of 2.
+ * @param lock             The lock of everything that changes.
+ * @param hasChanged       Signalled when a set is added or a thread is done with a set.
+ */
+typedef struct SharedPowerSetsS
+{
+  const NfaS* nfa_p;
+  const LargeBitSetS* closures_p;
+  const ByteClassesS* byteClasses_p;
+  LargeBitSetS* powerSets_p;
+  uint32_t* hashes_p;
+  int* transitions_p;
+  int numSets;
+  int maxNumSets;
+  int numExpandedSets;
+  int numBusyThreads;
+  bool isTooLarge;
+  int* table_p;
+  int tableSize;
+  pthread_mutex_t lock;
+  pthread_cond_t hasChanged;
+} SharedPowerSetsS;
 
 /*> Global Constant Definitions *******************************************************************/
 
@@ -29,35 +89,97 @@
 
 /*> Local Function Declarations *******************************************************************/
 /**
- * @brief Creates DFA states recursively. DFA states are based on a power set of NFA states formed
- *        from by the input NFA state.
+ * @brief Adds a DFA state formed from a set of NFA states, without transitions. The state is an
+ *        end state of the output values of the NFA end states in the set.
+ * @param[in/out]  dfa_p          The DFA.
+ * @param[in/out]  powerSets_pp   The sets of NFA states that form the DFA states, grown with the
+ *                                states of the DFA.
+ * @param[in]      nfa_p          The NFA that contains the NFA states.
+ * @param[in]      nfaStates_p    The set of NFA states that will form the new DFA state.
+ * @return Index of the new DFA state.
+ */
+static int add_dfa_state(DfaS* const dfa_p,
+                         LargeBitSetS** const powerSets_pp,
+                         const NfaS* const nfa_p,
+                         const LargeBitSetS* const nfaStates_p);
+
+/**
+ * @brief Creates the transitions of a DFA state, adding the DFA states they lead to if they do not
+ *        exist yet. The DFA state reached on a char is formed from the epsilon closures of the NFA
+ *        states reached on that char; it is only formed for the first char of each byte class of
+ *        the DFA.
  * @param[in/out]  dfa_p          The DFA.
- * @param[in/out]  powerSets_p    The power sets of NFA states that forms DFA states.
- * @param[in/out]  nfaToDfaMap_p  Maps nfa indicies to dfa indicies.
- * @param[in]      nfa_p          The NFA to that contains the NFA states.
- * @param[in]      nfaStateIdx    The first NFA state in the power set that will form a new DFA 
- *                                state.
+ * @param[in/out]  powerSets_pp   The sets of NFA states that form the DFA states.
+ * @param[in]      closures_p     The epsilon closure of every NFA state.
+ * @param[in]      nfa_p          The NFA that contains the NFA states.
+ * @param[in]      stateIdx       The index of the DFA state.
+ * @param[in]      maxNumStates   The number of states the DFA may have.
+ * @param[out]     nextSets_p     Room for a set of NFA states per byte class.
+ * @return False if a DFA state had to be added beyond maxNumStates, true otherwise.
  */
-static void create_dfa_states(DfaS* const dfa_p,
-                              BitSetT* const powerSets_p,
-                              int* const nfaToDfaMap_p,
-                              const NfaS* const nfa_p,
-                              const int nfaStateIdx);
+static bool create_dfa_transitions(DfaS* const dfa_p,
+                                   LargeBitSetS** const powerSets_pp,
+                                   const LargeBitSetS* const closures_p,
+                                   const NfaS* const nfa_p,
+                                   const int stateIdx,
+                                   const int maxNumStates,
+                                   LargeBitSetS* const nextSets_p);
 
 /**
- * @brief Checks if two DFA states are equal.
- * @param[in]  dfaState1_p  The first DFA state.
- * @param[in]  dfaState2_p  The second DFA state.
- * @return true if the states are equal, false otherwise.
+ * @brief Finds the sets of NFA states a set of NFA states goes to on each byte class.
+ * @param[in]   nfa_p          The NFA.
+ * @param[in]   closures_p     The epsilon closure of each NFA state.
+ * @param[in]   byteClasses_p  The byte classes.
+ * @param[in]   nfaStates_p    The set of NFA states.
+ * @param[out]  nextSets_p     The set of NFA states of each byte class, empty if there is none.
  */
-static bool dfa_state_is_equal(const DfaStateS* const dfaState1_p,
-                               const DfaStateS* const dfaState2_p);
+static void find_next_power_sets(const NfaS* const nfa_p,
+                                 const LargeBitSetS* const closures_p,
+                                 const ByteClassesS* const byteClasses_p,
+                                 const LargeBitSetS* const nfaStates_p,
+                                 LargeBitSetS* const nextSets_p);
 
 /**
- * @brief Optimizes the DFA by removing unecessary states.
+ * @brief Stores a list of output values in the accepted rules of a DFA, reusing an equal list if
+ *        there is one.
+ * @param[in/out]  dfa_p     The DFA.
+ * @param[in]      rules_p   The output values, sorted and without duplicates.
+ * @param[in]      numRules  The number of output values.
+ * @return Index of the list in the accepted rules.
+ */
+static int add_accepted_rules(DfaS* const dfa_p, const int* const rules_p, const int numRules);
+
+/**
+ * @brief Finds the DFA state formed from a set of NFA states.
+ * @param[in]  dfa_p        The DFA.
+ * @param[in]  powerSets_p  The sets of NFA states that form the DFA states.
+ * @param[in]  nfaStates_p  The set of NFA states.
+ * @return Index of the DFA state, NO_STATE if there is none.
+ */
+static int find_dfa_state(const DfaS* const dfa_p,
+                          const LargeBitSetS* const powerSets_p,
+                          const LargeBitSetS* const nfaStates_p);
+
+/**
+ * @brief Numbers tuples of ints so that equal tuples get the same number, in the order in which
+ *        the first tuple of each number occurs.
+ * @param[in]   tuples_p    The tuples, one after the other.
+ * @param[in]   tupleSize   The number of ints in a tuple.
+ * @param[in]   numTuples   The number of tuples.
+ * @param[out]  numbers_p   The number of each tuple.
+ * @return The number of different tuples.
+ */
+static int number_equal_tuples(const int* const tuples_p,
+                               const int tupleSize,
+                               const int numTuples,
+                               int* const numbers_p);
+
+/**
+ * @brief Copies the transition on the first char of each byte class to the other chars of the
+ *        class, in every state of a DFA.
  * @param[in/out]  dfa_p  The DFA.
  */
-static void optimize_dfa(DfaS* const dfa_p);
+static void expand_byte_classes(DfaS* const dfa_p);
 
 /**
  * @brief Prints a DFA state with all its transitions.
@@ -67,136 +189,301 @@ static void optimize_dfa(DfaS* const dfa_p);
 static void print_dfa_state(const DfaS* const dfa_p, const int stateIdx);
 
 /**
- * @brief Joins two equal DFA states together.
- * @param[in/out]  dfa_p      The DFA that contains the states.
- * @param[in]      stateIdx1  The index of the first DFA state.
- * @param[in]      stateIdx2  The index of the second DFA state.
+ * @brief Hashes a tuple of states of merged DFAs, or of the blocks of a DFA being minimized.
+ * @param[in]  tuple_p  The tuple.
+ * @param[in]  numDfas  The number of states in the tuple.
+ * @return The hash.
+ */
+static uint32_t hash_state_tuple(const int* const tuple_p, const int numDfas);
+
+/**
+ * @brief Compares two output values for qsort().
+ * @param[in]  rule1_p  The first output value.
+ * @param[in]  rule2_p  The second output value.
+ * @return Negative, zero or positive if the first output value is lower, equal or higher.
+ */
+static int compare_rules(const void* rule1_p, const void* rule2_p);
+
+/**
+ * @brief Finds the state of a product DFA formed from a tuple of states of the merged DFAs, adding
+ *        it without transitions if it does not exist yet. The new state is an end state of the
+ *        output values of all states in the tuple, each shifted by the offset of its DFA.
+ * @param[in/out]  product_p        The product DFA.
+ * @param[in/out]  productStates_p  The tuples forming the states of the product DFA.
+ * @param[in]      dfas_pp          The merged DFAs.
+ * @param[in]      ruleOffsets_p    The offset added to the output values of each merged DFA.
+ * @param[in]      tuple_p          The tuple.
+ * @param[in]      maxNumStates     The number of states the product DFA may have.
+ * @param[out]     rules_p          Room for the output values of every merged DFA.
+ * @return Index of the product state, NO_STATE if it would not fit.
+ */
+static int find_or_add_product_state(DfaS* const product_p,
+                                     ProductStatesS* const productStates_p,
+                                     const DfaS* const* const dfas_pp,
+                                     const int* const ruleOffsets_p,
+                                     const int* const tuple_p,
+                                     const int maxNumStates,
+                                     int* const rules_p);
+
+/**
+ * @brief Hashes a set of NFA states.
+ * @param[in]  nfaStates_p  The set of NFA states.
+ * @return The hash.
+ */
+static uint32_t hash_power_set(const LargeBitSetS* const nfaStates_p);
+
+/**
+ * @brief Finds the index of a set of NFA states shared by subset construction threads, adding
+ *        the set if it is not there yet. Takes the lock.
+ * @param[in/out]  shared_p     The shared sets.
+ * @param[in]      nfaStates_p  The set of NFA states.
+ * @return Index of the set, NO_STATE if it would not fit.
  */
-static void join_equal_dfa_states(DfaS* const dfa_p,
-                              const int stateIdx1,
-                              const int stateIdx2);
+static int intern_power_set(SharedPowerSetsS* const shared_p,
+                            const LargeBitSetS* const nfaStates_p);
+
+/**
+ * @brief Runs a thread of a parallel subset construction: takes the next set without transitions
+ *        from the shared sets and finds its transitions, until every set has them or there are
+ *        too many sets.
+ * @param[in/out]  shared_p  The shared sets.
+ * @return NULL.
+ */
+static void* expand_power_sets(void* shared_p);
+
+/**
+ * @brief Creates the DFA of the sets of NFA states found by a parallel subset construction. The
+ *        states are numbered as the sequential construction numbers them, so the DFA does not
+ *        depend on the order the threads found the sets in.
+ * @param[in]  shared_p  The shared sets, all with transitions.
+ * @return Pointer to allocated DFA.
+ */
+static DfaS* create_dfa_of_power_sets(const SharedPowerSetsS* const shared_p);
 
 /*> Local Function Definitions ********************************************************************/
-static void create_dfa_states(DfaS* const dfa_p,
-                              BitSetT* const powerSets_p,
-                              int* const nfaToDfaMap_p,
-                              const NfaS* const nfa_p,
-                              const int nfaStateIdx)
+static int add_dfa_state(DfaS* const dfa_p,
+                         LargeBitSetS** const powerSets_pp,
+                         const NfaS* const nfa_p,
+                         const LargeBitSetS* const nfaStates_p)
 {
-  int newStateIdx = dfa_p->numStates;
-  dfa_p->numStates++;
-  assert(dfa_p->numStates < MAX_NUM_DFA_STATES);
-  
-  DfaStateS* newDfaState_p = &(dfa_p->states[newStateIdx]);
-  newDfaState_p->isEndState = false;
-  newDfaState_p->outputValue = 0;
-  memset(&(newDfaState_p->transitions), NO_STATE, sizeof(newDfaState_p->transitions));
-
-  powerSets_p[newStateIdx] = epsilon_closure(nfa_p, nfaStateIdx);
-  nfaToDfaMap_p[nfaStateIdx] = newStateIdx;
-  
-  for (int i = 0; i < MAX_NUM_NFA_STATES; i++)
+  // Collect the output values of the end states in sorted order without duplicates.
+  int rules[MAX_NUM_NFA_STATES];
+  int numRules = 0;
+  for (int i = 0; i < nfa_p->numStates; i++)
   {
-    if (is_in_bitset(&(powerSets_p[newStateIdx]), i))
+    const NfaStateS* nfaStateInPowerSet_p = &(nfa_p->states[i]);
+    if (is_in_large_bitset(nfaStates_p, i) && nfaStateInPowerSet_p->isEndState)
     {
-      const NfaStateS* nfaStateInPowerSet_p = &(nfa_p->states[i]);
-      if (nfaStateInPowerSet_p->isEndState)
+      int rule = nfaStateInPowerSet_p->outputValue;
+      int insertIdx = numRules;
+      while (insertIdx > 0 && rules[insertIdx - 1] > rule)
       {
-        // Assert that new state will not have several unique return values.
-        bool differentReturnValues =
-          newDfaState_p->isEndState && 
-          (newDfaState_p->outputValue != nfaStateInPowerSet_p->outputValue);
-        assert(!differentReturnValues);
-
-        newDfaState_p->isEndState = true;
-        newDfaState_p->outputValue = nfaStateInPowerSet_p->outputValue;
+        insertIdx--;
       }
-
-      for (int j = 0; j < NUM_CHARS; j++)
+      if (insertIdx > 0 && rules[insertIdx - 1] == rule)
       {
-        int currDfaTransition = newDfaState_p->transitions[j];
-        int nfaTransition = nfaStateInPowerSet_p->transitions[j];
-        int newDfaTransition;
+        continue;
+      }
+      memmove(&(rules[insertIdx + 1]), &(rules[insertIdx]), sizeof(int) * (numRules - insertIdx));
+      rules[insertIdx] = rule;
+      numRules++;
+    }
+  }
 
-        if (nfaTransition != NO_STATE)
-        {
-          if (nfaToDfaMap_p[nfaTransition] == NO_STATE)
-          {
-            create_dfa_states(dfa_p, powerSets_p, nfaToDfaMap_p, nfa_p, nfaTransition);
-          }
-          newDfaTransition = nfaToDfaMap_p[nfaTransition];
-        }
-        else
-        {
-          newDfaTransition = NO_STATE;
-        }
-        
-        // Assert that new state will not transition to several unique states. 
-        // This could be handeled in the future with supersets.
-        bool transitionsToDifferentStates = (currDfaTransition != NO_STATE) &&
-                                            (newDfaTransition != NO_STATE) &&
-                                            (currDfaTransition != newDfaTransition);
-        assert(!transitionsToDifferentStates);
-
-        if (newDfaTransition != NO_STATE)
+  int prevMaxNumStates = dfa_p->maxNumStates;
+  int newStateIdx = add_dfa_state_of_rules(dfa_p, rules, numRules);
+  if (dfa_p->maxNumStates != prevMaxNumStates)
+  {
+    *powerSets_pp = realloc(*powerSets_pp, sizeof(LargeBitSetS) * dfa_p->maxNumStates);
+    assert(*powerSets_pp != NULL);
+  }
+  (*powerSets_pp)[newStateIdx] = *nfaStates_p;
+
+  return newStateIdx;
+}
+
+static void find_next_power_sets(const NfaS* const nfa_p,
+                                 const LargeBitSetS* const closures_p,
+                                 const ByteClassesS* const byteClasses_p,
+                                 const LargeBitSetS* const nfaStates_p,
+                                 LargeBitSetS* const nextSets_p)
+{
+  memset(nextSets_p, 0, sizeof(LargeBitSetS) * byteClasses_p->numClasses);
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    BitSetT word = nfaStates_p->words[i];
+    while (word != 0)
+    {
+      const NfaStateS* nfaState_p = &(nfa_p->states[i * BITSET_SIZE + __builtin_ctzll(word)]);
+      for (int j = 0; j < byteClasses_p->numClasses; j++)
+      {
+        int nextNfaStateIdx = nfaState_p->transitions[byteClasses_p->firstChars[j]];
+        if (nextNfaStateIdx != NO_STATE)
         {
-          newDfaState_p->transitions[j] = newDfaTransition;
+          add_large_bitset(&(nextSets_p[j]), &(closures_p[nextNfaStateIdx]));
         }
       }
+      word &= word - 1;
     }
   }
 }
 
-static bool dfa_state_is_equal(const DfaStateS* const dfaState1_p, 
-                               const DfaStateS* const dfaState2_p)
+static bool create_dfa_transitions(DfaS* const dfa_p,
+                                   LargeBitSetS** const powerSets_pp,
+                                   const LargeBitSetS* const closures_p,
+                                   const NfaS* const nfa_p,
+                                   const int stateIdx,
+                                   const int maxNumStates,
+                                   LargeBitSetS* const nextSets_p)
 {
-  if (dfaState1_p->isEndState != dfaState2_p->isEndState ||
-      dfaState1_p->outputValue != dfaState2_p->outputValue)
+  const ByteClassesS* byteClasses_p = &(dfa_p->byteClasses);
+  const LargeBitSetS nfaStates = (*powerSets_pp)[stateIdx];
+  find_next_power_sets(nfa_p, closures_p, byteClasses_p, &nfaStates, nextSets_p);
+
+  int nextDfaStateIdicies[NUM_CHARS];
+  for (int j = 0; j < byteClasses_p->numClasses; j++)
+  {
+    int nextDfaStateIdx;
+    if (large_bitset_is_empty(&(nextSets_p[j])))
+    {
+      nextDfaStateIdx = NO_STATE;
+    }
+    else if (j > 0 && large_bitsets_are_equal(&(nextSets_p[j]), &(nextSets_p[j - 1])))
+    {
+      // Neighbouring classes often lead to the same state.
+      nextDfaStateIdx = nextDfaStateIdicies[j - 1];
+    }
+    else
+    {
+      nextDfaStateIdx = find_dfa_state(dfa_p, *powerSets_pp, &(nextSets_p[j]));
+      if (nextDfaStateIdx == NO_STATE)
+      {
+        if (dfa_p->numStates >= maxNumStates)
+        {
+          return false;
+        }
+        nextDfaStateIdx = add_dfa_state(dfa_p, powerSets_pp, nfa_p, &(nextSets_p[j]));
+      }
+    }
+    nextDfaStateIdicies[j] = nextDfaStateIdx;
+  }
+
+  for (int j = 0; j < NUM_CHARS; j++)
   {
-    return false;
+    dfa_p->states[stateIdx].transitions[j] = nextDfaStateIdicies[byteClasses_p->classes[j]];
   }
+  return true;
+}
 
-  for (int i = 0; i < NUM_CHARS; i++)
+static int add_accepted_rules(DfaS* const dfa_p, const int* const rules_p, const int numRules)
+{
+  for (int i = 0; i + numRules <= dfa_p->numAcceptedRules; i++)
   {
-    if (dfaState1_p->transitions[i] != dfaState2_p->transitions[i])
+    if (memcmp(&(dfa_p->acceptedRules_p[i]), rules_p, sizeof(int) * numRules) == 0)
     {
-      return false;
+      return i;
     }
   }
 
-  return true;
+  while (dfa_p->numAcceptedRules + numRules > dfa_p->maxNumAcceptedRules)
+  {
+    dfa_p->maxNumAcceptedRules = dfa_p->maxNumAcceptedRules > 0 ?
+                                 2 * dfa_p->maxNumAcceptedRules :
+                                 INITIAL_MAX_NUM_ACCEPTED_RULES;
+    dfa_p->acceptedRules_p = realloc(dfa_p->acceptedRules_p,
+                                     sizeof(int) * dfa_p->maxNumAcceptedRules);
+    assert(dfa_p->acceptedRules_p != NULL);
+  }
+
+  int rulesIdx = dfa_p->numAcceptedRules;
+  memcpy(&(dfa_p->acceptedRules_p[rulesIdx]), rules_p, sizeof(int) * numRules);
+  dfa_p->numAcceptedRules += numRules;
+  return rulesIdx;
 }
 
-static void optimize_dfa(DfaS* const dfa_p)
+static int find_dfa_state(const DfaS* const dfa_p,
+                          const LargeBitSetS* const powerSets_p,
+                          const LargeBitSetS* const nfaStates_p)
 {
-  bool hasChanged;
+  for (int i = 0; i < dfa_p->numStates; i++)
+  {
+    if (large_bitsets_are_equal(&(powerSets_p[i]), nfaStates_p))
+    {
+      return i;
+    }
+  }
+  return NO_STATE;
+}
 
-  do
+static int number_equal_tuples(const int* const tuples_p,
+                               const int tupleSize,
+                               const int numTuples,
+                               int* const numbers_p)
+{
+  int tableSize = 1;
+  while (tableSize < 2 * numTuples)
   {
-    hasChanged = false;
+    tableSize *= 2;
+  }
+  // Holds the first tuple of each number.
+  int* table_p = malloc(sizeof(int) * tableSize);
+  assert(table_p != NULL);
+  memset(table_p, NO_STATE, sizeof(int) * tableSize);
 
-    for (int i = 0; i < dfa_p->numStates; i++)
+  int numNumbers = 0;
+  for (int i = 0; i < numTuples; i++)
+  {
+    const int* tuple_p = &(tuples_p[i * tupleSize]);
+    int tableIdx = hash_state_tuple(tuple_p, tupleSize) & (tableSize - 1);
+    while (table_p[tableIdx] != NO_STATE &&
+           memcmp(&(tuples_p[table_p[tableIdx] * tupleSize]),
+                  tuple_p,
+                  sizeof(int) * tupleSize) != 0)
     {
-      for (int j = i + 1; j < dfa_p->numStates; j++)
-      {
-        if (dfa_state_is_equal(&dfa_p->states[i], &dfa_p->states[j]))
-        {
-          join_equal_dfa_states(dfa_p, i, j);
+      tableIdx = (tableIdx + 1) & (tableSize - 1);
+    }
+    if (table_p[tableIdx] == NO_STATE)
+    {
+      table_p[tableIdx] = i;
+      numbers_p[i] = numNumbers++;
+    }
+    else
+    {
+      numbers_p[i] = numbers_p[table_p[tableIdx]];
+    }
+  }
 
-          hasChanged = true;
-          // check if the replacement state is also the same
-          j--;
-        }
-      }
+  free(table_p);
+  return numNumbers;
+}
+
+static void expand_byte_classes(DfaS* const dfa_p)
+{
+  const ByteClassesS* byteClasses_p = &(dfa_p->byteClasses);
+  for (int i = 0; i < dfa_p->numStates; i++)
+  {
+    int* transitions_p = dfa_p->states[i].transitions;
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      transitions_p[j] = transitions_p[byteClasses_p->firstChars[byteClasses_p->classes[j]]];
     }
-  } while (hasChanged);
+  }
 }
 
 static void print_dfa_state(const DfaS* const dfa_p, const int stateIdx)
 {
   const DfaStateS* dfaState_p = &(dfa_p->states[stateIdx]);
 
-  if (dfaState_p->isEndState)
+  if (dfaState_p->isEndState && dfaState_p->numAcceptedRules > 1)
+  {
+    printf("-State Q%d | End state :", stateIdx);
+    for (int i = 0; i < dfaState_p->numAcceptedRules; i++)
+    {
+      printf(" %d", dfa_p->acceptedRules_p[dfaState_p->acceptedRulesIdx + i]);
+    }
+    printf("\n");
+  }
+  else if (dfaState_p->isEndState)
   {
     printf("-State Q%d | End state : %d\n", stateIdx, dfaState_p->outputValue);
   }
@@ -234,46 +521,668 @@ static void print_dfa_state(const DfaS* const dfa_p, const int stateIdx)
   }
 }
 
-static void join_equal_dfa_states(DfaS* const dfa_p,
-                                  const int stateIdx1,
-                                  const int stateIdx2)
+static uint32_t hash_state_tuple(const int* const tuple_p, const int numDfas)
+{
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < numDfas; i++)
+  {
+    hash = (hash ^ (uint32_t) tuple_p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static int compare_rules(const void* rule1_p, const void* rule2_p)
 {
-  int lastStateIdx = dfa_p->numStates - 1;
+  return *((const int*) rule1_p) - *((const int*) rule2_p);
+}
 
-  for (int i = 0; i < dfa_p->numStates; i++)
+static int find_or_add_product_state(DfaS* const product_p,
+                                     ProductStatesS* const productStates_p,
+                                     const DfaS* const* const dfas_pp,
+                                     const int* const ruleOffsets_p,
+                                     const int* const tuple_p,
+                                     const int maxNumStates,
+                                     int* const rules_p)
+{
+  const int numDfas = productStates_p->numDfas;
+  int tableIdx = hash_state_tuple(tuple_p, numDfas) & (productStates_p->tableSize - 1);
+  while (productStates_p->table_p[tableIdx] != NO_STATE)
   {
-    for (int j = 0; j < NUM_CHARS; j++)
+    int stateIdx = productStates_p->table_p[tableIdx];
+    if (memcmp(&(productStates_p->tuples_p[stateIdx * numDfas]),
+               tuple_p,
+               sizeof(int) * numDfas) == 0)
+    {
+      return stateIdx;
+    }
+    tableIdx = (tableIdx + 1) & (productStates_p->tableSize - 1);
+  }
+  if (product_p->numStates >= maxNumStates)
+  {
+    return NO_STATE;
+  }
+
+  int numRules = 0;
+  for (int i = 0; i < numDfas; i++)
+  {
+    if (tuple_p[i] == NO_STATE)
+    {
+      continue;
+    }
+    const DfaStateS* state_p = &(dfas_pp[i]->states[tuple_p[i]]);
+    for (int j = 0; j < state_p->numAcceptedRules; j++)
     {
-      if (dfa_p->states[i].transitions[j] == stateIdx2)
+      rules_p[numRules++] = dfas_pp[i]->acceptedRules_p[state_p->acceptedRulesIdx + j] +
+                            ruleOffsets_p[i];
+    }
+  }
+  qsort(rules_p, numRules, sizeof(int), compare_rules);
+  int numUniqueRules = 0;
+  for (int i = 0; i < numRules; i++)
+  {
+    if (i == 0 || rules_p[i] != rules_p[i - 1])
+    {
+      rules_p[numUniqueRules++] = rules_p[i];
+    }
+  }
+  int newStateIdx = add_dfa_state_of_rules(product_p, rules_p, numUniqueRules);
+
+  if (product_p->numStates > productStates_p->maxNumTuples)
+  {
+    productStates_p->maxNumTuples = product_p->maxNumStates;
+    productStates_p->tuples_p = realloc(productStates_p->tuples_p,
+                                        sizeof(int) * numDfas * productStates_p->maxNumTuples);
+    assert(productStates_p->tuples_p != NULL);
+  }
+  memcpy(&(productStates_p->tuples_p[newStateIdx * numDfas]), tuple_p, sizeof(int) * numDfas);
+  productStates_p->table_p[tableIdx] = newStateIdx;
+
+  // Keep the table at most half full.
+  if (2 * product_p->numStates > productStates_p->tableSize)
+  {
+    productStates_p->tableSize *= 2;
+    productStates_p->table_p = realloc(productStates_p->table_p,
+                                       sizeof(int) * productStates_p->tableSize);
+    assert(productStates_p->table_p != NULL);
+    memset(productStates_p->table_p, NO_STATE, sizeof(int) * productStates_p->tableSize);
+    for (int i = 0; i < product_p->numStates; i++)
+    {
+      tableIdx = hash_state_tuple(&(productStates_p->tuples_p[i * numDfas]), numDfas) &
+                 (productStates_p->tableSize - 1);
+      while (productStates_p->table_p[tableIdx] != NO_STATE)
       {
-        dfa_p->states[i].transitions[j] = stateIdx1;
+        tableIdx = (tableIdx + 1) & (productStates_p->tableSize - 1);
       }
-      else if (dfa_p->states[i].transitions[j] == lastStateIdx)
+      productStates_p->table_p[tableIdx] = i;
+    }
+  }
+
+  return newStateIdx;
+}
+
+static uint32_t hash_power_set(const LargeBitSetS* const nfaStates_p)
+{
+  uint64_t hash = 14695981039346656037u;
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    hash = (hash ^ nfaStates_p->words[i]) * 1099511628211u;
+  }
+  return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static int intern_power_set(SharedPowerSetsS* const shared_p,
+                            const LargeBitSetS* const nfaStates_p)
+{
+  // The set is hashed before taking the lock, so the threads only wait for the lookup.
+  const uint32_t hash = hash_power_set(nfaStates_p);
+  int setIdx = NO_STATE;
+
+  pthread_mutex_lock(&(shared_p->lock));
+  int tableIdx = hash & (shared_p->tableSize - 1);
+  while (shared_p->table_p[tableIdx] != NO_STATE)
+  {
+    const int otherSetIdx = shared_p->table_p[tableIdx];
+    if (shared_p->hashes_p[otherSetIdx] == hash &&
+        large_bitsets_are_equal(&(shared_p->powerSets_p[otherSetIdx]), nfaStates_p))
+    {
+      setIdx = otherSetIdx;
+      break;
+    }
+    tableIdx = (tableIdx + 1) & (shared_p->tableSize - 1);
+  }
+  if (setIdx == NO_STATE)
+  {
+    if (shared_p->numSets == shared_p->maxNumSets)
+    {
+      shared_p->isTooLarge = true;
+    }
+    else
+    {
+      setIdx = shared_p->numSets;
+      shared_p->powerSets_p[setIdx] = *nfaStates_p;
+      shared_p->hashes_p[setIdx] = hash;
+      shared_p->table_p[tableIdx] = setIdx;
+      shared_p->numSets++;
+    }
+    pthread_cond_broadcast(&(shared_p->hasChanged));
+  }
+  pthread_mutex_unlock(&(shared_p->lock));
+
+  return setIdx;
+}
+
+static void* expand_power_sets(void* shared_p)
+{
+  SharedPowerSetsS* sharedSets_p = shared_p;
+  const int numClasses = sharedSets_p->byteClasses_p->numClasses;
+  LargeBitSetS* nextSets_p = malloc(sizeof(LargeBitSetS) * numClasses);
+  assert(nextSets_p != NULL);
+
+  pthread_mutex_lock(&(sharedSets_p->lock));
+  for (;;)
+  {
+    // While another thread is busy it may still add sets, so there may be more work.
+    while (sharedSets_p->numExpandedSets == sharedSets_p->numSets &&
+           sharedSets_p->numBusyThreads > 0 &&
+           !sharedSets_p->isTooLarge)
+    {
+      pthread_cond_wait(&(sharedSets_p->hasChanged), &(sharedSets_p->lock));
+    }
+    if (sharedSets_p->numExpandedSets == sharedSets_p->numSets || sharedSets_p->isTooLarge)
+    {
+      break;
+    }
+    const int setIdx = sharedSets_p->numExpandedSets;
+    sharedSets_p->numExpandedSets++;
+    sharedSets_p->numBusyThreads++;
+    pthread_mutex_unlock(&(sharedSets_p->lock));
+
+    find_next_power_sets(sharedSets_p->nfa_p,
+                         sharedSets_p->closures_p,
+                         sharedSets_p->byteClasses_p,
+                         &(sharedSets_p->powerSets_p[setIdx]),
+                         nextSets_p);
+    // Only this thread writes the transitions of the set, so they need no lock.
+    int* transitions_p = &(sharedSets_p->transitions_p[setIdx * numClasses]);
+    for (int i = 0; i < numClasses; i++)
+    {
+      transitions_p[i] = large_bitset_is_empty(&(nextSets_p[i])) ?
+                         (int) NO_STATE :
+                         intern_power_set(sharedSets_p, &(nextSets_p[i]));
+    }
+
+    pthread_mutex_lock(&(sharedSets_p->lock));
+    sharedSets_p->numBusyThreads--;
+    pthread_cond_broadcast(&(sharedSets_p->hasChanged));
+  }
+  pthread_mutex_unlock(&(sharedSets_p->lock));
+
+  free(nextSets_p);
+  return NULL;
+}
+
+static DfaS* create_dfa_of_power_sets(const SharedPowerSetsS* const shared_p)
+{
+  const ByteClassesS* byteClasses_p = shared_p->byteClasses_p;
+  const int numSets = shared_p->numSets;
+  int* stateIdicies_p = malloc(sizeof(int) * numSets);
+  int* setIdicies_p = malloc(sizeof(int) * numSets);
+  assert(stateIdicies_p != NULL && setIdicies_p != NULL);
+
+  // The sequential construction numbers the states breadth first from the start state, in order
+  // of the byte classes. Every set was found as a transition, so every set is reached.
+  memset(stateIdicies_p, NO_STATE, sizeof(int) * numSets);
+  stateIdicies_p[0] = 0;
+  setIdicies_p[0] = 0;
+  int numStates = 1;
+  for (int i = 0; i < numStates; i++)
+  {
+    const int* transitions_p = &(shared_p->transitions_p[setIdicies_p[i] *
+                                                         byteClasses_p->numClasses]);
+    for (int j = 0; j < byteClasses_p->numClasses; j++)
+    {
+      if (transitions_p[j] != NO_STATE && stateIdicies_p[transitions_p[j]] == NO_STATE)
       {
-        dfa_p->states[i].transitions[j] = stateIdx2;
+        stateIdicies_p[transitions_p[j]] = numStates;
+        setIdicies_p[numStates] = transitions_p[j];
+        numStates++;
       }
     }
   }
+  assert(numStates == numSets);
+
+  DfaS* dfa_p = create_dfa();
+  dfa_p->byteClasses = *byteClasses_p;
+  LargeBitSetS* powerSets_p = NULL;
+  for (int i = 0; i < numStates; i++)
+  {
+    add_dfa_state(dfa_p, &powerSets_p, shared_p->nfa_p, &(shared_p->powerSets_p[setIdicies_p[i]]));
+    const int* transitions_p = &(shared_p->transitions_p[setIdicies_p[i] *
+                                                         byteClasses_p->numClasses]);
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      const int nextSetIdx = transitions_p[byteClasses_p->classes[j]];
+      dfa_p->states[i].transitions[j] = (nextSetIdx == NO_STATE) ?
+                                        (int) NO_STATE :
+                                        stateIdicies_p[nextSetIdx];
+    }
+  }
 
-  memcpy(&dfa_p->states[stateIdx2], &dfa_p->states[lastStateIdx], sizeof(DfaStateS));
-  dfa_p->numStates--;
+  free(powerSets_p);
+  free(stateIdicies_p);
+  free(setIdicies_p);
+  optimize_dfa(dfa_p);
+  return dfa_p;
 }
 
 /*> Global Function Definitions *******************************************************************/
-DfaS* convert_to_dfa(const NfaS* const nfa_p)
+void init_byte_classes(ByteClassesS* const byteClasses_p)
+{
+  memset(byteClasses_p->classes, 0, sizeof(byteClasses_p->classes));
+  byteClasses_p->firstChars[0] = 0;
+  byteClasses_p->numClasses = 1;
+}
+
+void refine_byte_classes(ByteClassesS* const byteClasses_p, const int* const transitions_p)
+{
+  if (byteClasses_p->numClasses == NUM_CHARS)
+  {
+    return;
+  }
+
+  // The new classes an old class is split into are chained, so a char is only compared with those.
+  int firstNewClasses[NUM_CHARS];
+  int nextNewClasses[NUM_CHARS];
+  uint8_t newFirstChars[NUM_CHARS];
+  int numNewClasses = 0;
+  for (int i = 0; i < byteClasses_p->numClasses; i++)
+  {
+    firstNewClasses[i] = NO_BYTE_CLASS;
+  }
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    const int oldClass = byteClasses_p->classes[i];
+    int newClass = firstNewClasses[oldClass];
+    while (newClass != NO_BYTE_CLASS && transitions_p[newFirstChars[newClass]] != transitions_p[i])
+    {
+      newClass = nextNewClasses[newClass];
+    }
+    if (newClass == NO_BYTE_CLASS)
+    {
+      newClass = numNewClasses++;
+      newFirstChars[newClass] = i;
+      nextNewClasses[newClass] = firstNewClasses[oldClass];
+      firstNewClasses[oldClass] = newClass;
+    }
+    byteClasses_p->classes[i] = newClass;
+  }
+
+  memcpy(byteClasses_p->firstChars, newFirstChars, sizeof(uint8_t) * numNewClasses);
+  byteClasses_p->numClasses = numNewClasses;
+}
+
+DfaS* create_dfa(void)
 {
   DfaS* dfa_p = malloc(sizeof(*dfa_p));
+  assert(dfa_p != NULL);
   dfa_p->numStates = 0;
-  BitSetT powerSets[MAX_NUM_DFA_STATES] = {0};
-  int nfaToDfaMap[MAX_NUM_NFA_STATES];
-  memset(nfaToDfaMap, NO_STATE, sizeof(nfaToDfaMap));
+  dfa_p->maxNumStates = 0;
+  dfa_p->states = NULL;
+  dfa_p->acceptedRules_p = NULL;
+  dfa_p->numAcceptedRules = 0;
+  dfa_p->maxNumAcceptedRules = 0;
+  dfa_p->hasRuleBitmaps = true;
+  init_byte_classes(&(dfa_p->byteClasses));
+  return dfa_p;
+}
+
+void find_dfa_byte_classes(DfaS* const dfa_p)
+{
+  init_byte_classes(&(dfa_p->byteClasses));
+  for (int i = 0; i < dfa_p->numStates; i++)
+  {
+    refine_byte_classes(&(dfa_p->byteClasses), dfa_p->states[i].transitions);
+  }
+}
+
+void optimize_dfa(DfaS* const dfa_p)
+{
+  const ByteClassesS* byteClasses_p = &(dfa_p->byteClasses);
+  const int numStates = dfa_p->numStates;
+  const int tupleSize = 1 + byteClasses_p->numClasses;
+  int* tuples_p = malloc(sizeof(int) * numStates * (tupleSize > 4 ? tupleSize : 4));
+  int* blocks_p = malloc(sizeof(int) * numStates);
+  int* newBlocks_p = malloc(sizeof(int) * numStates);
+  assert(tuples_p != NULL && blocks_p != NULL && newBlocks_p != NULL);
+
+  // Moore's algorithm: the states start out in blocks of equal outputs, and blocks are split
+  // until all states of a block go to the same blocks. Unlike joining states with equal
+  // transitions, this also joins equal states that only lead to each other.
+  // Equal lists of output values are shared, so comparing their indicies is enough.
+  for (int i = 0; i < numStates; i++)
+  {
+    const DfaStateS* state_p = &(dfa_p->states[i]);
+    tuples_p[4 * i] = state_p->isEndState;
+    tuples_p[4 * i + 1] = state_p->outputValue;
+    tuples_p[4 * i + 2] = state_p->acceptedRulesIdx;
+    tuples_p[4 * i + 3] = state_p->numAcceptedRules;
+  }
+  int numBlocks = number_equal_tuples(tuples_p, 4, numStates, blocks_p);
+  int numNewBlocks = numBlocks;
+  do
+  {
+    numBlocks = numNewBlocks;
+    for (int i = 0; i < numStates; i++)
+    {
+      int* tuple_p = &(tuples_p[i * tupleSize]);
+      tuple_p[0] = blocks_p[i];
+      for (int j = 0; j < byteClasses_p->numClasses; j++)
+      {
+        const int nextState = dfa_p->states[i].transitions[byteClasses_p->firstChars[j]];
+        tuple_p[1 + j] = (nextState == NO_STATE) ? (int) NO_STATE : blocks_p[nextState];
+      }
+    }
+    numNewBlocks = number_equal_tuples(tuples_p, tupleSize, numStates, newBlocks_p);
+    int* swap_p = blocks_p;
+    blocks_p = newBlocks_p;
+    newBlocks_p = swap_p;
+  } while (numNewBlocks != numBlocks);
+
+  // The first state of each block becomes the block's state. Blocks are numbered in the order of
+  // their first states, so the start state stays first and no state is overwritten before it is
+  // moved.
+  int numMovedStates = 0;
+  for (int i = 0; i < numStates; i++)
+  {
+    if (blocks_p[i] != numMovedStates)
+    {
+      continue;
+    }
+    DfaStateS* state_p = &(dfa_p->states[numMovedStates]);
+    memmove(state_p, &(dfa_p->states[i]), sizeof(DfaStateS));
+    for (int j = 0; j < byteClasses_p->numClasses; j++)
+    {
+      int* transition_p = &(state_p->transitions[byteClasses_p->firstChars[j]]);
+      *transition_p = (*transition_p == NO_STATE) ? (int) NO_STATE : blocks_p[*transition_p];
+    }
+    numMovedStates++;
+  }
+  dfa_p->numStates = numBlocks;
+
+  free(tuples_p);
+  free(blocks_p);
+  free(newBlocks_p);
+  expand_byte_classes(dfa_p);
+}
+
+int add_dfa_state_of_rules(DfaS* const dfa_p, const int* const rules_p, const int numRules)
+{
+  int newStateIdx = dfa_p->numStates;
+  dfa_p->numStates++;
+  assert(dfa_p->numStates < MAX_NUM_DFA_STATES);
+  if (dfa_p->numStates > dfa_p->maxNumStates)
+  {
+    dfa_p->maxNumStates = dfa_p->maxNumStates > 0 ?
+                          2 * dfa_p->maxNumStates :
+                          INITIAL_MAX_NUM_DFA_STATES;
+    dfa_p->states = realloc(dfa_p->states, sizeof(DfaStateS) * dfa_p->maxNumStates);
+    assert(dfa_p->states != NULL);
+  }
+
+  DfaStateS* newDfaState_p = &(dfa_p->states[newStateIdx]);
+  newDfaState_p->isEndState = false;
+  newDfaState_p->outputValue = 0;
+  newDfaState_p->acceptedRulesIdx = 0;
+  newDfaState_p->numAcceptedRules = 0;
+  newDfaState_p->acceptedRuleBitmap = 0;
+  memset(&(newDfaState_p->transitions), NO_STATE, sizeof(newDfaState_p->transitions));
+
+  if (numRules > 0)
+  {
+    newDfaState_p->isEndState = true;
+    // Like in lex, the earliest RegExp has priority, so the scanner never has to choose.
+    newDfaState_p->outputValue = rules_p[0];
+    newDfaState_p->acceptedRulesIdx = add_accepted_rules(dfa_p, rules_p, numRules);
+    newDfaState_p->numAcceptedRules = numRules;
+    for (int i = 0; i < numRules; i++)
+    {
+      if (rules_p[i] >= 0 && rules_p[i] < BITSET_SIZE)
+      {
+        add_to_bitset(&(newDfaState_p->acceptedRuleBitmap), rules_p[i]);
+      }
+      else
+      {
+        dfa_p->hasRuleBitmaps = false;
+      }
+    }
+  }
+
+  return newStateIdx;
+}
+
+DfaS* convert_to_dfa(const NfaS* const nfa_p)
+{
+  DfaS* dfa_p = try_convert_to_dfa(nfa_p, MAX_NUM_DFA_STATES - 1);
+  assert(dfa_p != NULL);
+  return dfa_p;
+}
 
-  create_dfa_states(dfa_p, powerSets, nfaToDfaMap, nfa_p, 0);
+DfaS* try_convert_to_dfa(const NfaS* const nfa_p, const int maxNumStates)
+{
+  assert(maxNumStates > 0 && maxNumStates < MAX_NUM_DFA_STATES);
+  DfaS* dfa_p = create_dfa();
+  LargeBitSetS* powerSets_p = NULL;
+  LargeBitSetS* closures_p = malloc(sizeof(LargeBitSetS) * nfa_p->numStates);
+  LargeBitSetS* nextSets_p = malloc(sizeof(LargeBitSetS) * NUM_CHARS);
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    closures_p[i] = epsilon_closure(nfa_p, i);
+    // Chars the NFA does not tell apart lead to the same DFA states.
+    refine_byte_classes(&(dfa_p->byteClasses), nfa_p->states[i].transitions);
+  }
+
+  // States are created in order, so the states still without transitions are the ones after i.
+  add_dfa_state(dfa_p, &powerSets_p, nfa_p, &(closures_p[0]));
+  bool fits = true;
+  for (int i = 0; i < dfa_p->numStates && fits; i++)
+  {
+    fits = create_dfa_transitions(dfa_p,
+                                  &powerSets_p,
+                                  closures_p,
+                                  nfa_p,
+                                  i,
+                                  maxNumStates,
+                                  nextSets_p);
+  }
+
+  free(powerSets_p);
+  free(closures_p);
+  free(nextSets_p);
+  if (!fits)
+  {
+    free_dfa(dfa_p);
+    return NULL;
+  }
   optimize_dfa(dfa_p);
+  return dfa_p;
+}
 
+DfaS* try_convert_to_dfa_in_parallel(const NfaS* const nfa_p,
+                                     const int maxNumStates,
+                                     int numThreads)
+{
+  assert(maxNumStates > 0 && maxNumStates < MAX_NUM_DFA_STATES);
+  if (numThreads < 1)
+  {
+    numThreads = 1;
+  }
+  ByteClassesS byteClasses;
+  init_byte_classes(&byteClasses);
+  LargeBitSetS* closures_p = malloc(sizeof(LargeBitSetS) * nfa_p->numStates);
+  assert(closures_p != NULL);
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    closures_p[i] = epsilon_closure(nfa_p, i);
+    refine_byte_classes(&byteClasses, nfa_p->states[i].transitions);
+  }
+
+  // Everything is allocated up front, so nothing moves while the threads read it.
+  SharedPowerSetsS shared =
+  {
+    .nfa_p = nfa_p,
+    .closures_p = closures_p,
+    .byteClasses_p = &byteClasses,
+    .powerSets_p = malloc(sizeof(LargeBitSetS) * maxNumStates),
+    .hashes_p = malloc(sizeof(uint32_t) * maxNumStates),
+    .transitions_p = malloc(sizeof(int) * maxNumStates * byteClasses.numClasses),
+    .numSets = 0,
+    .maxNumSets = maxNumStates,
+    .numExpandedSets = 0,
+    .numBusyThreads = 0,
+    .isTooLarge = false,
+    .tableSize = 1
+  };
+  while (shared.tableSize < 2 * maxNumStates)
+  {
+    shared.tableSize *= 2;
+  }
+  shared.table_p = malloc(sizeof(int) * shared.tableSize);
+  assert(shared.powerSets_p != NULL && shared.hashes_p != NULL && shared.transitions_p != NULL &&
+         shared.table_p != NULL);
+  memset(shared.table_p, NO_STATE, sizeof(int) * shared.tableSize);
+  pthread_mutex_init(&(shared.lock), NULL);
+  pthread_cond_init(&(shared.hasChanged), NULL);
+
+  intern_power_set(&shared, &(closures_p[0]));
+  pthread_t threads[numThreads];
+  for (int i = 1; i < numThreads; i++)
+  {
+    int error = pthread_create(&(threads[i]), NULL, expand_power_sets, &shared);
+    assert(error == 0);
+  }
+  expand_power_sets(&shared);
+  for (int i = 1; i < numThreads; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_mutex_destroy(&(shared.lock));
+  pthread_cond_destroy(&(shared.hasChanged));
+
+  DfaS* dfa_p = shared.isTooLarge ? NULL : create_dfa_of_power_sets(&shared);
+  free(closures_p);
+  free(shared.powerSets_p);
+  free(shared.hashes_p);
+  free(shared.transitions_p);
+  free(shared.table_p);
   return dfa_p;
 }
 
+DfaS* merge_dfas(const DfaS* const* const dfas_pp,
+                 const int* const ruleOffsets_p,
+                 const int numDfas,
+                 const int maxNumStates)
+{
+  assert(maxNumStates > 0 && maxNumStates < MAX_NUM_DFA_STATES);
+  DfaS* product_p = create_dfa();
+  ProductStatesS productStates =
+  {
+    .numDfas = numDfas,
+    .tuples_p = NULL,
+    .maxNumTuples = 0,
+    .table_p = malloc(sizeof(int) * INITIAL_PRODUCT_TABLE_SIZE),
+    .tableSize = INITIAL_PRODUCT_TABLE_SIZE
+  };
+  assert(productStates.table_p != NULL);
+  memset(productStates.table_p, NO_STATE, sizeof(int) * INITIAL_PRODUCT_TABLE_SIZE);
+
+  int maxNumRules = 0;
+  for (int i = 0; i < numDfas; i++)
+  {
+    maxNumRules += dfas_pp[i]->numAcceptedRules;
+  }
+  int* rules_p = malloc(sizeof(int) * (maxNumRules > 0 ? maxNumRules : 1));
+  int* tuple_p = malloc(sizeof(int) * numDfas);
+  assert(rules_p != NULL && tuple_p != NULL);
+
+  // Chars that every merged DFA puts in the same class lead to the same product states.
+  for (int i = 0; i < numDfas; i++)
+  {
+    int classes[NUM_CHARS];
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      classes[j] = dfas_pp[i]->byteClasses.classes[j];
+    }
+    refine_byte_classes(&(product_p->byteClasses), classes);
+  }
+  const ByteClassesS* byteClasses_p = &(product_p->byteClasses);
+
+  // Every DFA starts in its state 0, so the product does too.
+  memset(tuple_p, 0, sizeof(int) * numDfas);
+  find_or_add_product_state(product_p,
+                            &productStates,
+                            dfas_pp,
+                            ruleOffsets_p,
+                            tuple_p,
+                            maxNumStates,
+                            rules_p);
+
+  // States are created in order, so the states still without transitions are the ones after i.
+  bool isTooLarge = false;
+  for (int i = 0; i < product_p->numStates && !isTooLarge; i++)
+  {
+    for (int j = 0; j < byteClasses_p->numClasses; j++)
+    {
+      const int character = byteClasses_p->firstChars[j];
+      bool isStuck = true;
+      for (int k = 0; k < numDfas; k++)
+      {
+        int state = productStates.tuples_p[i * numDfas + k];
+        tuple_p[k] = (state == NO_STATE) ?
+                     (int) NO_STATE :
+                     dfas_pp[k]->states[state].transitions[character];
+        isStuck = isStuck && tuple_p[k] == NO_STATE;
+      }
+      product_p->states[i].transitions[character] = isStuck ?
+                                                    (int) NO_STATE :
+                                                    find_or_add_product_state(product_p,
+                                                                              &productStates,
+                                                                              dfas_pp,
+                                                                              ruleOffsets_p,
+                                                                              tuple_p,
+                                                                              maxNumStates,
+                                                                              rules_p);
+      isTooLarge = isTooLarge ||
+                   (!isStuck && product_p->states[i].transitions[character] == NO_STATE);
+    }
+  }
+
+  free(productStates.tuples_p);
+  free(productStates.table_p);
+  free(rules_p);
+  free(tuple_p);
+  if (isTooLarge)
+  {
+    free_dfa(product_p);
+    return NULL;
+  }
+  optimize_dfa(product_p);
+  return product_p;
+}
+
+size_t get_dfa_size(const DfaS* const dfa_p)
+{
+  return sizeof(DfaS) +
+         sizeof(DfaStateS) * dfa_p->numStates +
+         sizeof(int) * dfa_p->numAcceptedRules;
+}
+
+void free_dfa(DfaS* const dfa_p)
+{
+  free(dfa_p->states);
+  free(dfa_p->acceptedRules_p);
+  free(dfa_p);
+}
+
 void print_dfa(const DfaS* const dfa_p)
 {
   printf("DFA has %d states:\n", dfa_p->numStates);
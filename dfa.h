@@ -9,37 +9,77 @@
 #define DFA_H
 
 /*> Includes **************************************************************************************/
+#include "bitset.h"
 #include "nfa.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*> Defines ***************************************************************************************/
 #define NUM_CHARS 256
-#define MAX_NUM_DFA_STATES 64
+#define MAX_NUM_DFA_STATES 4096
 
 /*> Type Declarations *****************************************************************************/
+/**
+ * @brief A partition of the chars into classes, such that all chars of a class have the same
+ *        transitions in every state of an automaton. Automata are built over one char per class
+ *        and the transitions of the other chars are copied from it.
+ * @param classes     The class of each char.
+ * @param firstChars  The lowest char of each class.
+ * @param numClasses  The number of classes.
+ */
+typedef struct ByteClassesS
+{
+  uint8_t classes[NUM_CHARS];
+  uint8_t firstChars[NUM_CHARS];
+  int numClasses;
+} ByteClassesS;
+
 /**
  * @brief A state in an DFA.
- * @param  isEndState   True if the state is an end state, false otherwise.
- * @param  outputValue  The value this state returns if it is an end state.
- * @param  transitions  The transitions to other states based on chars.
+ * @param  isEndState          True if the state is an end state, false otherwise.
+ * @param  outputValue         The value this state returns if it is an end state. If it is an end
+ *                             state of several output values the lowest one, i.e. the earliest
+ *                             RegExp, wins.
+ * @param  acceptedRulesIdx    The index in the accepted rules of the DFA where the output values of
+ *                             the state are listed.
+ * @param  numAcceptedRules    The number of output values of the state.
+ * @param  acceptedRuleBitmap  The output values of the state as a bit set, if hasRuleBitmaps.
+ * @param  transitions         The transitions to other states based on chars.
  */
 typedef struct DfaStateS
 {
   bool isEndState;
   int outputValue;
+  int acceptedRulesIdx;
+  int numAcceptedRules;
+  BitSetT acceptedRuleBitmap;
   int transitions[NUM_CHARS];
 } DfaStateS;
 
 /**
  * @brief An DFA (deterministic finite automaton).
- * @param numStates The number of states of the DFA.
- * @param states The states of the DFA.
+ * @param numStates            The number of states of the DFA.
+ * @param maxNumStates         The number of states there is room for.
+ * @param states               The states of the DFA.
+ * @param acceptedRules_p      The sorted output values of the end states; states with the same
+ *                             output values share a list.
+ * @param numAcceptedRules     The number of entries in acceptedRules_p.
+ * @param maxNumAcceptedRules  The number of entries there is room for in acceptedRules_p.
+ * @param hasRuleBitmaps       True if every output value is small enough for acceptedRuleBitmap.
+ * @param byteClasses          The classes of chars with the same transitions in every state.
  */
 typedef struct DfaS
 {
   int numStates;
-  DfaStateS states[MAX_NUM_DFA_STATES];
+  int maxNumStates;
+  DfaStateS* states;
+  int* acceptedRules_p;
+  int numAcceptedRules;
+  int maxNumAcceptedRules;
+  bool hasRuleBitmaps;
+  ByteClassesS byteClasses;
 } DfaS;
 
 /*> Constant Declarations *************************************************************************/
@@ -47,6 +87,51 @@ typedef struct DfaS
 /*> Variable Declarations *************************************************************************/
 
 /*> Function Declarations *************************************************************************/
+/**
+ * @brief Puts all chars in one class.
+ * @param[out]  byteClasses_p  The byte classes.
+ */
+void init_byte_classes(ByteClassesS* const byteClasses_p);
+
+/**
+ * @brief Splits byte classes so that the chars of each class also have the same transition in one
+ *        more state.
+ * @param[in/out]  byteClasses_p  The byte classes.
+ * @param[in]      transitions_p  The transitions of the state, one per char.
+ */
+void refine_byte_classes(ByteClassesS* const byteClasses_p, const int* const transitions_p);
+
+/**
+ * @brief Creates a DFA without states. Its chars are all in one class, so whoever adds the
+ *        transitions has to set the byte classes.
+ * @return Pointer to allocated DFA.
+ */
+DfaS* create_dfa(void);
+
+/**
+ * @brief Sets the byte classes of a DFA from the transitions of its states.
+ * @param[in/out]  dfa_p  The DFA.
+ */
+void find_dfa_byte_classes(DfaS* const dfa_p);
+
+/**
+ * @brief Minimizes a DFA by joining all states that read the same tokens from every input, so
+ *        that equal DFAs have the same states however they were built. Only the transitions on the
+ *        first char of each byte class are compared; the others are copied from them at the end.
+ * @param[in/out]  dfa_p  The DFA, whose byte classes must be set.
+ */
+void optimize_dfa(DfaS* const dfa_p);
+
+/**
+ * @brief Adds a state without transitions to a DFA.
+ * @param[in/out]  dfa_p     The DFA.
+ * @param[in]      rules_p   The output values the state is an end state of, sorted and without
+ *                           duplicates.
+ * @param[in]      numRules  The number of output values, 0 if the state is not an end state.
+ * @return Index of the new state.
+ */
+int add_dfa_state_of_rules(DfaS* const dfa_p, const int* const rules_p, const int numRules);
+
 /**
  * @brief Converts the input NFA to an DFA.
  * @param[in]  nfa_p  The input NFA.
@@ -54,6 +139,61 @@ typedef struct DfaS
  */
 DfaS* convert_to_dfa(const NfaS* const nfa_p);
 
+/**
+ * @brief Converts the input NFA to an DFA unless the DFA gets too large. States are counted as
+ *        they are created, before equal states are joined.
+ * @param[in]  nfa_p         The input NFA.
+ * @param[in]  maxNumStates  The number of states the DFA may have, below MAX_NUM_DFA_STATES.
+ * @return Pointer to allocated DFA, NULL if it would have more than maxNumStates states.
+ */
+DfaS* try_convert_to_dfa(const NfaS* const nfa_p, const int maxNumStates);
+
+/**
+ * @brief Converts the input NFA to an DFA like try_convert_to_dfa(), on several threads. The
+ *        threads take the sets of NFA states that have no transitions yet from a shared frontier,
+ *        find the sets they go to on each byte class and look them up in a shared hash table,
+ *        which adds the new ones. The states are then numbered as try_convert_to_dfa() numbers
+ *        them, so both give the same DFA.
+ * @param[in]  nfa_p         The input NFA.
+ * @param[in]  maxNumStates  The number of states the DFA may have, below MAX_NUM_DFA_STATES.
+ * @param[in]  numThreads    The number of threads, including the calling thread.
+ * @return Pointer to allocated DFA, NULL if it would have more than maxNumStates states.
+ */
+DfaS* try_convert_to_dfa_in_parallel(const NfaS* const nfa_p,
+                                     const int maxNumStates,
+                                     int numThreads);
+
+/**
+ * @brief Merges DFAs into one DFA that runs them all in lockstep, by product construction, and
+ *        optimizes it. An end state of the merged DFA has the output values of all merged DFAs
+ *        that are in an end state, each shifted by the offset of its DFA. With offsets that keep
+ *        the output values of a DFA above those of the DFAs before it, the earlier DFAs have
+ *        priority, as if their RegExps came first.
+ * @param[in]  dfas_pp        The DFAs to merge.
+ * @param[in]  ruleOffsets_p  The offset added to the output values of each DFA.
+ * @param[in]  numDfas        The number of DFAs.
+ * @param[in]  maxNumStates   The number of states the merged DFA may have, below
+ *                            MAX_NUM_DFA_STATES. States are counted before they are optimized.
+ * @return Pointer to allocated DFA, NULL if it would have more than maxNumStates states.
+ */
+DfaS* merge_dfas(const DfaS* const* const dfas_pp,
+                 const int* const ruleOffsets_p,
+                 const int numDfas,
+                 const int maxNumStates);
+
+/**
+ * @brief Gets the number of bytes the tables of a DFA take.
+ * @param[in]  dfa_p  The DFA.
+ * @return The number of bytes.
+ */
+size_t get_dfa_size(const DfaS* const dfa_p);
+
+/**
+ * @brief Frees a DFA.
+ * @param[in]  dfa_p  The DFA.
+ */
+void free_dfa(DfaS* const dfa_p);
+
 /**
  * @brief Prints the DFA with all its states and transitions.
  * @param[in]  dfa_p  The DFA to print.
@@ -0,0 +1,182 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Re-reads only the tokens affected by an edit of previously read input.
+* @file incremental_lexer.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "incremental_lexer.h"
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Finds the first token that examined the char at the provided index.
+ * @param[in]  tokenArray_p  The tokens.
+ * @param[in]  charIdx       The index of the char.
+ * @return Index of the first affected token, numTokens if no token examined the char.
+ */
+static int find_first_affected_token(const TokenArrayS* const tokenArray_p, const size_t charIdx);
+
+/*> Local Function Definitions ********************************************************************/
+static int find_first_affected_token(const TokenArrayS* const tokenArray_p, const size_t charIdx)
+{
+  const TokenS* tokens_p = tokenArray_p->tokens_p;
+
+  // Binary search for the number of tokens starting at or before charIdx.
+  int low = 0;
+  int high = tokenArray_p->numTokens;
+  while (low < high)
+  {
+    int middle = low + (high - low) / 2;
+    if (tokens_p[middle].startIdx <= charIdx)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  // Tokens starting before charIdx may have looked past it. No token looks further ahead than
+  // maxNumCharsExamined, which bounds how far back we need to check.
+  int firstAffectedIdx = tokenArray_p->numTokens;
+  for (int i = low - 1; i >= 0; i--)
+  {
+    if (tokens_p[i].startIdx + tokenArray_p->maxNumCharsExamined <= charIdx)
+    {
+      break;
+    }
+    if (tokens_p[i].startIdx + tokens_p[i].numCharsExamined > charIdx)
+    {
+      firstAffectedIdx = i;
+    }
+  }
+
+  return firstAffectedIdx;
+}
+
+/*> Global Function Definitions *******************************************************************/
+TokenChangeS relex_edit(LexerS* const lexer_p,
+                        const TokenArrayS* const oldTokens_p,
+                        const char* const newInput_p,
+                        const size_t newInputLength,
+                        const EditS* const edit_p)
+{
+  const TokenS* oldTokens = oldTokens_p->tokens_p;
+  const int numOldTokens = oldTokens_p->numTokens;
+  TokenChangeS change =
+  {
+    .firstTokenIdx = find_first_affected_token(oldTokens_p, edit_p->offset),
+    .numRemovedTokens = 0,
+    .newTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 }
+  };
+
+  start_reading_buffer(lexer_p, newInput_p, newInputLength);
+  if (change.firstTokenIdx < numOldTokens)
+  {
+    const TokenS* firstToken_p = &(oldTokens[change.firstTokenIdx]);
+    resume_reading(lexer_p, firstToken_p->startIdx, firstToken_p->startState);
+  }
+  else if (numOldTokens > 0)
+  {
+    // No old token examined the edit, so it lies after the last token.
+    const TokenS* lastToken_p = &(oldTokens[numOldTokens - 1]);
+    resume_reading(lexer_p, lastToken_p->startIdx + lastToken_p->length, lexer_p->currState);
+  }
+
+  const size_t insertedEndIdx = edit_p->offset + edit_p->insertedLength;
+  int oldTokenIdx = change.firstTokenIdx;
+  while (true)
+  {
+    // Past the edit the new input equals the old input moved by the edit, so once a new token
+    // starts where an old one did, in the same state, the rest of the tokens are unchanged.
+    if (lexer_p->currCharIdx >= insertedEndIdx)
+    {
+      size_t oldCharIdx = lexer_p->currCharIdx - edit_p->insertedLength + edit_p->removedLength;
+      while (oldTokenIdx < numOldTokens && oldTokens[oldTokenIdx].startIdx < oldCharIdx)
+      {
+        oldTokenIdx++;
+      }
+      if (oldTokenIdx < numOldTokens &&
+          oldTokens[oldTokenIdx].startIdx == oldCharIdx &&
+          oldTokens[oldTokenIdx].startState == lexer_p->currState)
+      {
+        break;
+      }
+    }
+
+    TokenS token = get_next_token(lexer_p);
+    if (token.type == TOKEN_TYPE_END)
+    {
+      oldTokenIdx = numOldTokens;
+      break;
+    }
+    add_token(&(change.newTokens), &token);
+  }
+
+  change.numRemovedTokens = oldTokenIdx - change.firstTokenIdx;
+  return change;
+}
+
+void apply_token_change(TokenArrayS* const tokenArray_p,
+                        const TokenChangeS* const change_p,
+                        const EditS* const edit_p)
+{
+  const int numKeptAfter = tokenArray_p->numTokens -
+                           change_p->firstTokenIdx -
+                           change_p->numRemovedTokens;
+  const int newNumTokens = tokenArray_p->numTokens -
+                           change_p->numRemovedTokens +
+                           change_p->newTokens.numTokens;
+
+  if (newNumTokens > tokenArray_p->maxNumTokens)
+  {
+    tokenArray_p->tokens_p = realloc(tokenArray_p->tokens_p, sizeof(TokenS) * newNumTokens);
+    assert(tokenArray_p->tokens_p != NULL);
+    tokenArray_p->maxNumTokens = newNumTokens;
+  }
+
+  if (numKeptAfter > 0)
+  {
+    TokenS* keptAfter_p = &(tokenArray_p->tokens_p[change_p->firstTokenIdx +
+                                                   change_p->newTokens.numTokens]);
+    memmove(keptAfter_p,
+            &(tokenArray_p->tokens_p[change_p->firstTokenIdx + change_p->numRemovedTokens]),
+            sizeof(TokenS) * numKeptAfter);
+    for (int i = 0; i < numKeptAfter; i++)
+    {
+      keptAfter_p[i].startIdx = keptAfter_p[i].startIdx + edit_p->insertedLength -
+                                edit_p->removedLength;
+    }
+  }
+
+  if (change_p->newTokens.numTokens > 0)
+  {
+    memcpy(&(tokenArray_p->tokens_p[change_p->firstTokenIdx]),
+           change_p->newTokens.tokens_p,
+           sizeof(TokenS) * change_p->newTokens.numTokens);
+  }
+
+  tokenArray_p->numTokens = newNumTokens;
+  if (change_p->newTokens.maxNumCharsExamined > tokenArray_p->maxNumCharsExamined)
+  {
+    tokenArray_p->maxNumCharsExamined = change_p->newTokens.maxNumCharsExamined;
+  }
+}
@@ -0,0 +1,82 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Re-reads only the tokens affected by an edit of previously read input.
+ * @file incremental_lexer.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef INCREMENTAL_LEXER_H
+#define INCREMENTAL_LEXER_H
+
+/*> Includes **************************************************************************************/
+#include <stddef.h>
+
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief An edit of an input; removedLength chars at offset were replaced by insertedLength chars.
+ * @param offset          The index of the first edited char.
+ * @param removedLength   The number of chars removed from the old input.
+ * @param insertedLength  The number of chars inserted in the new input.
+ */
+typedef struct EditS
+{
+  size_t offset;
+  size_t removedLength;
+  size_t insertedLength;
+} EditS;
+
+/**
+ * @brief The tokens that changed due to an edit. The old tokens
+ *        [firstTokenIdx, firstTokenIdx + numRemovedTokens) are replaced by newTokens; all old
+ *        tokens after them are unchanged except for being moved by the length difference of the
+ *        edit.
+ * @param firstTokenIdx     The index of the first changed token in the old token array.
+ * @param numRemovedTokens  The number of old tokens that are replaced.
+ * @param newTokens         The tokens replacing the removed ones, with indicies in the new input.
+ */
+typedef struct TokenChangeS
+{
+  int firstTokenIdx;
+  int numRemovedTokens;
+  TokenArrayS newTokens;
+} TokenChangeS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Re-reads the tokens affected by an edit. Reading resumes at the last token that did not
+ *        examine any edited char and stops once a new token starts at the same (moved) index and
+ *        DFA state as an old token after the edit.
+ * @param[in/out]  lexer_p         The lexer; it is left reading the new input.
+ * @param[in]      oldTokens_p     All tokens of the old input, as read by read_all_tokens().
+ * @param[in]      newInput_p      The input after the edit.
+ * @param[in]      newInputLength  The number of chars in the new input.
+ * @param[in]      edit_p          The edit that turned the old input into the new input.
+ * @return The changed token range. Its newTokens must be freed with free_token_array().
+ */
+TokenChangeS relex_edit(LexerS* const lexer_p,
+                        const TokenArrayS* const oldTokens_p,
+                        const char* const newInput_p,
+                        const size_t newInputLength,
+                        const EditS* const edit_p);
+
+/**
+ * @brief Applies a token change to the old token array, turning it into the tokens of the new
+ *        input.
+ * @param[in/out]  tokenArray_p  The old token array.
+ * @param[in]      change_p      The change returned by relex_edit() for the edit.
+ * @param[in]      edit_p        The edit.
+ */
+void apply_token_change(TokenArrayS* const tokenArray_p,
+                        const TokenChangeS* const change_p,
+                        const EditS* const edit_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -8,13 +8,20 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "comb_vector.h"
+#include "derivative.h"
 #include "dfa.h"
 #include "lexer_generator.h"
 #include "nfa.h"
 #include "reg_exp.h"
+#include "simd_scan.h"
 
 /*> Defines ***************************************************************************************/
+#define INITIAL_MAX_NUM_TOKENS     64
+#define INITIAL_MAX_NUM_MATCHES    16
+#define UTF8_VALIDATION_BLOCK_SIZE 4096
 
 /*> Type Declarations *****************************************************************************/
 
@@ -27,33 +34,788 @@
 /*> Local Variable Definitions ********************************************************************/
 
 /*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Records a match of a RegExp, or extends the earlier match of it when only the longest
+ *        match is kept.
+ * @param[in/out]  matches_p     The match array.
+ * @param[in]      firstIdx      The index of the first match of the current start index.
+ * @param[in]      rule          The output value of the RegExp.
+ * @param[in]      endIdx        The end of the match.
+ * @param[in]      longestOnly   True if only the longest match of each RegExp is kept.
+ */
+static void add_rule_match(RuleMatchArrayS* const matches_p,
+                           const int firstIdx,
+                           const int rule,
+                           const size_t endIdx,
+                           const bool longestOnly);
+
+/**
+ * @brief Validates the next block of the input as UTF-8, so that it is in cache when the DFA reads
+ *        it. Nothing is validated past an invalid sequence until it has been read.
+ * @param[in/out]  lexer_p  The lexer.
+ * @return True if the block was validated, false if there is nothing to validate.
+ */
+static bool validate_next_utf8_block(LexerS* const lexer_p);
+
+/**
+ * @brief Generates the DFA of some RegExps unless it gets too large. RegExps whose NFA would not
+ *        fit MAX_NUM_NFA_STATES, such as long bounded repeats, are built with derivatives.
+ * @param[in]  regExps_pp       The RegExps.
+ * @param[in]  numRegExps       The number of RegExps.
+ * @param[in]  usesDerivatives  True if the DFA is built with derivatives.
+ * @param[in]  maxNumStates     The number of states the DFA may have.
+ * @param[in]  numThreads       The number of threads subset construction runs on.
+ * @return The DFA, NULL if it does not fit.
+ */
+static DfaS* try_generate_dfa(RegExpS** const regExps_pp,
+                              const int numRegExps,
+                              const bool usesDerivatives,
+                              const int maxNumStates,
+                              const int numThreads);
+
+/**
+ * @brief Generates the DFAs of groups of consecutive RegExps that each fit one DFA, halving the
+ *        RegExps until they do.
+ * @param[in]      regExps_pp       All RegExps.
+ * @param[in]      firstRule        The index of the first RegExp to generate DFAs of.
+ * @param[in]      numRules         The number of RegExps to generate DFAs of.
+ * @param[in]      usesDerivatives  True if the DFAs are built with derivatives.
+ * @param[in]      maxNumStates     The number of states a DFA may have.
+ * @param[in]      numThreads       The number of threads subset construction runs on.
+ * @param[out]     dfas_pp          The DFA of each group.
+ * @param[out]     ruleOffsets_p    The first RegExp of each group.
+ * @param[in/out]  numDfas_p        The number of groups.
+ * @return False if a RegExp does not fit a DFA of MAX_NUM_DFA_STATES - 1 states on its own.
+ */
+static bool generate_group_dfas(RegExpS** const regExps_pp,
+                                const int firstRule,
+                                const int numRules,
+                                const bool usesDerivatives,
+                                const int maxNumStates,
+                                const int numThreads,
+                                DfaS** const dfas_pp,
+                                int* const ruleOffsets_p,
+                                int* const numDfas_p);
+
+/**
+ * @brief Prints how many bytes the transition tables of a DFA take dense and packed into a comb
+ *        vector, to choose a table format by.
+ * @param[in]  dfa_p  The DFA.
+ */
+static void print_table_sizes(const DfaS* const dfa_p);
+
+/**
+ * @brief Creates a lexer reading with the DFAs of groups of RegExps.
+ * @param[in]  dfas_pp        The DFAs, which the lexer takes ownership of.
+ * @param[in]  ruleOffsets_p  The first RegExp of each group.
+ * @param[in]  numDfas        The number of groups.
+ * @param[in]  numRules       The number of RegExps the DFAs were generated from.
+ * @param[in]  validatesUtf8  True if the lexer validates its input as UTF-8.
+ * @return The lexer.
+ */
+static LexerS* create_lexer(DfaS* const* const dfas_pp,
+                            const int* const ruleOffsets_p,
+                            const int numDfas,
+                            const int numRules,
+                            const bool validatesUtf8);
+
+/**
+ * @brief Scans the longest token from a start index with the DFA of a lexer with one group.
+ * @param[in/out]  lexer_p        The lexer.
+ * @param[in]      startIdx       The index of the first char of the token.
+ * @param[in/out]  scanEndIdx_p   The end of the input that may be read, moved on as more of the
+ *                                input is validated.
+ * @param[in/out]  token_p        The token, whose type and length are set if a RegExp matched.
+ * @return The index of the char that stopped the scan.
+ */
+static size_t scan_token(LexerS* const lexer_p,
+                         const size_t startIdx,
+                         size_t* const scanEndIdx_p,
+                         TokenS* const token_p);
+
+/**
+ * @brief Scans the longest token from a start index with the DFAs of all groups of a lexer in
+ *        lockstep, until all of them are stuck.
+ * @param[in/out]  lexer_p        The lexer.
+ * @param[in]      startIdx       The index of the first char of the token.
+ * @param[in/out]  scanEndIdx_p   The end of the input that may be read, moved on as more of the
+ *                                input is validated.
+ * @param[in/out]  token_p        The token, whose type and length are set if a RegExp matched.
+ * @return The index of the char that stopped the scan.
+ */
+static size_t scan_token_with_groups(LexerS* const lexer_p,
+                                     const size_t startIdx,
+                                     size_t* const scanEndIdx_p,
+                                     TokenS* const token_p);
+
+/**
+ * @brief Records the matches of the RegExps a DFA state is an end state of.
+ * @param[in/out]  matches_p    The match array.
+ * @param[in]      firstIdx     The index of the first match of the current start index.
+ * @param[in]      dfa_p        The DFA.
+ * @param[in]      state        The end state.
+ * @param[in]      ruleOffset   The first RegExp of the group of the DFA.
+ * @param[in]      endIdx       The end of the matches.
+ * @param[in]      longestOnly  True if only the longest match of each RegExp is kept.
+ */
+static void add_state_rule_matches(RuleMatchArrayS* const matches_p,
+                                   const int firstIdx,
+                                   const DfaS* const dfa_p,
+                                   const int state,
+                                   const int ruleOffset,
+                                   const size_t endIdx,
+                                   const bool longestOnly);
 
 /*> Local Function Definitions ********************************************************************/
+static void add_rule_match(RuleMatchArrayS* const matches_p,
+                           const int firstIdx,
+                           const int rule,
+                           const size_t endIdx,
+                           const bool longestOnly)
+{
+  if (longestOnly)
+  {
+    for (int i = firstIdx; i < matches_p->numMatches; i++)
+    {
+      if (matches_p->matches_p[i].rule == rule)
+      {
+        matches_p->matches_p[i].endIdx = endIdx;
+        return;
+      }
+    }
+  }
+
+  if (matches_p->numMatches == matches_p->maxNumMatches)
+  {
+    matches_p->maxNumMatches = matches_p->maxNumMatches > 0 ?
+                               2 * matches_p->maxNumMatches :
+                               INITIAL_MAX_NUM_MATCHES;
+    matches_p->matches_p = realloc(matches_p->matches_p,
+                                   sizeof(RuleMatchS) * matches_p->maxNumMatches);
+    assert(matches_p->matches_p != NULL);
+  }
+  matches_p->matches_p[matches_p->numMatches].rule = rule;
+  matches_p->matches_p[matches_p->numMatches].endIdx = endIdx;
+  matches_p->numMatches++;
+}
+
+static bool validate_next_utf8_block(LexerS* const lexer_p)
+{
+  if (!lexer_p->validatesUtf8 ||
+      lexer_p->invalidUtf8Length > 0 ||
+      lexer_p->validatedEndIdx == lexer_p->inputLength)
+  {
+    return false;
+  }
+
+  size_t blockEndIdx = lexer_p->validatedEndIdx + UTF8_VALIDATION_BLOCK_SIZE;
+  if (blockEndIdx > lexer_p->inputLength)
+  {
+    blockEndIdx = lexer_p->inputLength;
+  }
+  // A code point cut off at the end of the block is validated with the next block.
+  lexer_p->validatedEndIdx = find_invalid_utf8(lexer_p->input_p,
+                                               lexer_p->validatedEndIdx,
+                                               blockEndIdx,
+                                               blockEndIdx == lexer_p->inputLength,
+                                               &(lexer_p->invalidUtf8Length));
+  return true;
+}
+
+static DfaS* try_generate_dfa(RegExpS** const regExps_pp,
+                              const int numRegExps,
+                              const bool usesDerivatives,
+                              const int maxNumStates,
+                              const int numThreads)
+{
+  NfaS* nfa_p = usesDerivatives ? NULL : generate_combined_nfa(regExps_pp, numRegExps);
+  if (nfa_p == NULL)
+  {
+    return generate_derivative_dfa(regExps_pp, numRegExps, maxNumStates);
+  }
+  DfaS* dfa_p = (numThreads > 1) ?
+                try_convert_to_dfa_in_parallel(nfa_p, maxNumStates, numThreads) :
+                try_convert_to_dfa(nfa_p, maxNumStates);
+  free(nfa_p);
+  return dfa_p;
+}
+
+static bool generate_group_dfas(RegExpS** const regExps_pp,
+                                const int firstRule,
+                                const int numRules,
+                                const bool usesDerivatives,
+                                const int maxNumStates,
+                                const int numThreads,
+                                DfaS** const dfas_pp,
+                                int* const ruleOffsets_p,
+                                int* const numDfas_p)
+{
+  DfaS* dfa_p = try_generate_dfa(&(regExps_pp[firstRule]),
+                                 numRules,
+                                 usesDerivatives,
+                                 maxNumStates,
+                                 numThreads);
+  if (dfa_p == NULL && numRules == 1)
+  {
+    // A RegExp that does not fit on its own cannot be split further, so it gets all there is.
+    dfa_p = try_generate_dfa(&(regExps_pp[firstRule]),
+                             1,
+                             usesDerivatives,
+                             MAX_NUM_DFA_STATES - 1,
+                             numThreads);
+    if (dfa_p == NULL)
+    {
+      return false;
+    }
+  }
+  if (dfa_p != NULL)
+  {
+    dfas_pp[*numDfas_p] = dfa_p;
+    ruleOffsets_p[*numDfas_p] = firstRule;
+    (*numDfas_p)++;
+    return true;
+  }
+
+  const int numFirstRules = numRules / 2;
+  return generate_group_dfas(regExps_pp,
+                             firstRule,
+                             numFirstRules,
+                             usesDerivatives,
+                             maxNumStates,
+                             numThreads,
+                             dfas_pp,
+                             ruleOffsets_p,
+                             numDfas_p) &&
+         generate_group_dfas(regExps_pp,
+                             firstRule + numFirstRules,
+                             numRules - numFirstRules,
+                             usesDerivatives,
+                             maxNumStates,
+                             numThreads,
+                             dfas_pp,
+                             ruleOffsets_p,
+                             numDfas_p);
+}
+
+static void print_table_sizes(const DfaS* const dfa_p)
+{
+  CombVectorS* combVector_p = pack_comb_vector(dfa_p);
+  printf("DFA tables take %zu bytes dense, %zu bytes in a comb vector of %d entries\n",
+         get_dfa_size(dfa_p),
+         get_comb_vector_size(combVector_p),
+         combVector_p->numEntries);
+  free_comb_vector(combVector_p);
+}
+
+static LexerS* create_lexer(DfaS* const* const dfas_pp,
+                            const int* const ruleOffsets_p,
+                            const int numDfas,
+                            const int numRules,
+                            const bool validatesUtf8)
+{
+  LexerS* lexer_p = malloc(sizeof(*lexer_p));
+  assert(lexer_p != NULL);
+  lexer_p->dfas_pp = malloc(sizeof(DfaS*) * numDfas);
+  lexer_p->ruleOffsets_p = malloc(sizeof(int) * numDfas);
+  assert(lexer_p->dfas_pp != NULL && lexer_p->ruleOffsets_p != NULL);
+  memcpy(lexer_p->dfas_pp, dfas_pp, sizeof(DfaS*) * numDfas);
+  memcpy(lexer_p->ruleOffsets_p, ruleOffsets_p, sizeof(int) * numDfas);
+  lexer_p->numDfas = numDfas;
+  lexer_p->dfa_p = dfas_pp[0];
+  lexer_p->numRules = numRules;
+  init_byte_set(&(lexer_p->startChars));
+  for (int i = 0; i < numDfas; i++)
+  {
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      if (dfas_pp[i]->states[0].transitions[j] != NO_STATE)
+      {
+        add_byte_to_set(&(lexer_p->startChars), j);
+      }
+    }
+  }
+  lexer_p->validatesUtf8 = validatesUtf8;
+  start_reading_buffer(lexer_p, NULL, 0);
+  return lexer_p;
+}
+
+static size_t scan_token(LexerS* const lexer_p,
+                         const size_t startIdx,
+                         size_t* const scanEndIdx_p,
+                         TokenS* const token_p)
+{
+  const DfaS* dfa_p = lexer_p->dfa_p;
+  const unsigned char* input_p = (const unsigned char*) lexer_p->input_p;
+
+  // The transitions of the first state dispatch on the first char; a char that cannot start a token
+  // goes straight to the error handling.
+  int state = dfa_p->states[lexer_p->currState].transitions[input_p[startIdx]];
+  size_t charIdx = startIdx;
+  if (state != NO_STATE)
+  {
+    charIdx++;
+    if (dfa_p->states[state].isEndState)
+    {
+      token_p->type = dfa_p->states[state].outputValue;
+      token_p->length = 1;
+    }
+  }
+
+  for (;;)
+  {
+    while (state != NO_STATE && charIdx < *scanEndIdx_p)
+    {
+      int nextState = dfa_p->states[state].transitions[input_p[charIdx]];
+      if (nextState == NO_STATE)
+      {
+        break;
+      }
+
+      state = nextState;
+      charIdx++;
+      if (dfa_p->states[state].isEndState)
+      {
+        token_p->type = dfa_p->states[state].outputValue;
+        token_p->length = charIdx - startIdx;
+      }
+    }
+
+    // Only a scan that ran into the end of the validated input goes on with the next block.
+    if (state == NO_STATE || charIdx < *scanEndIdx_p || !validate_next_utf8_block(lexer_p))
+    {
+      break;
+    }
+    *scanEndIdx_p = lexer_p->validatedEndIdx;
+  }
+
+  return charIdx;
+}
+
+static size_t scan_token_with_groups(LexerS* const lexer_p,
+                                     const size_t startIdx,
+                                     size_t* const scanEndIdx_p,
+                                     TokenS* const token_p)
+{
+  const unsigned char* input_p = (const unsigned char*) lexer_p->input_p;
+  const int numDfas = lexer_p->numDfas;
+  int states[numDfas];
+  for (int i = 0; i < numDfas; i++)
+  {
+    states[i] = 0;
+  }
+  assert(lexer_p->currState == 0);
+
+  size_t charIdx = startIdx;
+  int numLiveDfas = numDfas;
+  for (;;)
+  {
+    while (numLiveDfas > 0 && charIdx < *scanEndIdx_p)
+    {
+      // The steps of the groups do not depend on each other. The earliest group in an end state
+      // has the earliest RegExp.
+      const unsigned char character = input_p[charIdx];
+      int type = TOKEN_TYPE_END;
+      int numNextLiveDfas = 0;
+      for (int i = 0; i < numDfas; i++)
+      {
+        if (states[i] == NO_STATE)
+        {
+          continue;
+        }
+        const DfaStateS* states_p = lexer_p->dfas_pp[i]->states;
+        states[i] = states_p[states[i]].transitions[character];
+        if (states[i] == NO_STATE)
+        {
+          continue;
+        }
+        numNextLiveDfas++;
+        if (type == TOKEN_TYPE_END && states_p[states[i]].isEndState)
+        {
+          type = states_p[states[i]].outputValue + lexer_p->ruleOffsets_p[i];
+        }
+      }
+      if (numNextLiveDfas == 0)
+      {
+        break;
+      }
+
+      numLiveDfas = numNextLiveDfas;
+      charIdx++;
+      if (type != TOKEN_TYPE_END)
+      {
+        token_p->type = type;
+        token_p->length = charIdx - startIdx;
+      }
+    }
+
+    // Only a scan that ran into the end of the validated input goes on with the next block.
+    if (charIdx < *scanEndIdx_p || !validate_next_utf8_block(lexer_p))
+    {
+      break;
+    }
+    *scanEndIdx_p = lexer_p->validatedEndIdx;
+  }
+
+  return charIdx;
+}
+
+static void add_state_rule_matches(RuleMatchArrayS* const matches_p,
+                                   const int firstIdx,
+                                   const DfaS* const dfa_p,
+                                   const int state,
+                                   const int ruleOffset,
+                                   const size_t endIdx,
+                                   const bool longestOnly)
+{
+  const DfaStateS* dfaState_p = &(dfa_p->states[state]);
+  if (dfa_p->hasRuleBitmaps)
+  {
+    BitSetT rules = dfaState_p->acceptedRuleBitmap;
+    while (rules != 0)
+    {
+      add_rule_match(matches_p, firstIdx, ruleOffset + __builtin_ctzll(rules), endIdx, longestOnly);
+      rules &= rules - 1;
+    }
+  }
+  else
+  {
+    for (int i = 0; i < dfaState_p->numAcceptedRules; i++)
+    {
+      add_rule_match(matches_p,
+                     firstIdx,
+                     ruleOffset + dfa_p->acceptedRules_p[dfaState_p->acceptedRulesIdx + i],
+                     endIdx,
+                     longestOnly);
+    }
+  }
+}
 
 /*> Global Function Definitions *******************************************************************/
 LexerS* generate_lexer(const char** const regExpStrs_pp, const int numRegExps)
 {
-  LexerS* lexer_p = malloc(sizeof(*lexer_p));
+  LexerOptionsS options =
+  {
+    .isCaseInsensitive = false,
+    .validatesUtf8 = false,
+    .usesDerivatives = false,
+    .maxNumDfaStates = 0,
+    .numThreads = 0
+  };
+  return generate_lexer_with_options(regExpStrs_pp, numRegExps, &options);
+}
+
+LexerS* generate_lexer_with_options(const char** const regExpStrs_pp,
+                                    const int numRegExps,
+                                    const LexerOptionsS* const options_p)
+{
   RegExpS* regExps[numRegExps];
 
+  // Equal subtrees of the rules are shared, so each is only stored and converted once.
+  RegExpTableS regExpTable;
+  init_regexp_table(&regExpTable);
   for (int i = 0; i < numRegExps; i++)
   {
     regExps[i] = parse_regexp(regExpStrs_pp[i]);
+    if (options_p->isCaseInsensitive)
+    {
+      fold_regexp_case(regExps[i]);
+    }
+    regExps[i] = share_regexp(&regExpTable, regExps[i]);
   }
+  free_regexp_table(&regExpTable);
 
-  NfaS* nfa_p = generate_combined_nfa(regExps, numRegExps);
-  DfaS* dfa_p = convert_to_dfa(nfa_p);
-  print_dfa(dfa_p);
-
+  const int maxNumStates = options_p->maxNumDfaStates > 0 ?
+                           options_p->maxNumDfaStates :
+                           MAX_NUM_DFA_STATES - 1;
+  // There is at most one group per RegExp.
+  DfaS* dfas[numRegExps];
+  int ruleOffsets[numRegExps];
+  int numDfas = 0;
+  bool isGenerated = generate_group_dfas(regExps,
+                                         0,
+                                         numRegExps,
+                                         options_p->usesDerivatives,
+                                         maxNumStates,
+                                         options_p->numThreads,
+                                         dfas,
+                                         ruleOffsets,
+                                         &numDfas);
   free_regexps(regExps, numRegExps);
-  free(nfa_p);
-  free(dfa_p);
+  if (!isGenerated)
+  {
+    for (int i = 0; i < numDfas; i++)
+    {
+      free_dfa(dfas[i]);
+    }
+    return NULL;
+  }
 
-  return lexer_p;
+  for (int i = 0; i < numDfas; i++)
+  {
+    print_dfa(dfas[i]);
+    print_table_sizes(dfas[i]);
+  }
+
+  return create_lexer(dfas, ruleOffsets, numDfas, numRegExps, options_p->validatesUtf8);
+}
+
+LexerS* merge_lexers(const LexerS* const* const lexers_pp, const int numLexers)
+{
+  int numGroups = 0;
+  for (int i = 0; i < numLexers; i++)
+  {
+    numGroups += lexers_pp[i]->numDfas;
+  }
+
+  const DfaS* dfas[numGroups];
+  int ruleOffsets[numGroups];
+  int numRules = 0;
+  bool validatesUtf8 = false;
+  numGroups = 0;
+  for (int i = 0; i < numLexers; i++)
+  {
+    for (int j = 0; j < lexers_pp[i]->numDfas; j++)
+    {
+      dfas[numGroups] = lexers_pp[i]->dfas_pp[j];
+      ruleOffsets[numGroups] = numRules + lexers_pp[i]->ruleOffsets_p[j];
+      numGroups++;
+    }
+    numRules += lexers_pp[i]->numRules;
+    validatesUtf8 = validatesUtf8 || lexers_pp[i]->validatesUtf8;
+  }
+
+  // The product of groups would not fit one DFA either, so then, or if the product of the lexers
+  // does not fit, each group is copied on its own and the groups are scanned in lockstep.
+  DfaS* mergedDfas[numGroups];
+  int mergedRuleOffsets[numGroups];
+  int numMergedDfas = 0;
+  mergedDfas[0] = (numGroups == numLexers) ?
+                  merge_dfas(dfas, ruleOffsets, numLexers, MAX_NUM_DFA_STATES - 1) :
+                  NULL;
+  if (mergedDfas[0] != NULL)
+  {
+    mergedRuleOffsets[0] = 0;
+    numMergedDfas = 1;
+  }
+  else
+  {
+    const int noOffset = 0;
+    for (int i = 0; i < numGroups; i++)
+    {
+      mergedDfas[i] = merge_dfas(&(dfas[i]), &noOffset, 1, MAX_NUM_DFA_STATES - 1);
+      assert(mergedDfas[i] != NULL);
+      mergedRuleOffsets[i] = ruleOffsets[i];
+    }
+    numMergedDfas = numGroups;
+  }
+
+  return create_lexer(mergedDfas, mergedRuleOffsets, numMergedDfas, numRules, validatesUtf8);
+}
+
+void free_lexer(LexerS* const lexer_p)
+{
+  for (int i = 0; i < lexer_p->numDfas; i++)
+  {
+    free_dfa(lexer_p->dfas_pp[i]);
+  }
+  free(lexer_p->dfas_pp);
+  free(lexer_p->ruleOffsets_p);
+  free(lexer_p);
 }
 
 void start_reading(LexerS* const lexer_p, char* const input_p)
+{
+  start_reading_buffer(lexer_p, input_p, strlen(input_p));
+}
+
+void start_reading_buffer(LexerS* const lexer_p, const char* const input_p, const size_t inputLength)
 {
   lexer_p->input_p = input_p;
-  lexer_p->currCharIdx = 0;
+  lexer_p->inputLength = inputLength;
+  resume_reading(lexer_p, 0, 0);
+}
+
+void resume_reading(LexerS* const lexer_p, const size_t charIdx, const int state)
+{
+  assert(charIdx <= lexer_p->inputLength);
+  lexer_p->currCharIdx = charIdx;
+  lexer_p->currState = state;
+  lexer_p->validatedEndIdx = charIdx;
+  lexer_p->invalidUtf8Length = 0;
+}
+
+TokenS get_next_token(LexerS* const lexer_p)
+{
+  const size_t inputLength = lexer_p->inputLength;
+  const size_t startIdx = lexer_p->currCharIdx;
+
+  TokenS token =
+  {
+    .type = TOKEN_TYPE_END,
+    .startIdx = startIdx,
+    .length = 0,
+    .startState = lexer_p->currState,
+    .numCharsExamined = 1
+  };
+
+  if (startIdx >= inputLength)
+  {
+    return token;
+  }
+
+  size_t scanEndIdx = inputLength;
+  if (lexer_p->validatesUtf8)
+  {
+    if (startIdx == lexer_p->validatedEndIdx)
+    {
+      validate_next_utf8_block(lexer_p);
+    }
+    if (startIdx == lexer_p->validatedEndIdx && lexer_p->invalidUtf8Length > 0)
+    {
+      token.type = TOKEN_TYPE_ERROR;
+      token.length = lexer_p->invalidUtf8Length;
+      token.numCharsExamined = token.length + 1;
+      lexer_p->validatedEndIdx += token.length;
+      lexer_p->invalidUtf8Length = 0;
+      lexer_p->currCharIdx = startIdx + token.length;
+      return token;
+    }
+    scanEndIdx = lexer_p->validatedEndIdx;
+  }
+
+  size_t charIdx = lexer_p->numDfas > 1 ?
+                   scan_token_with_groups(lexer_p, startIdx, &scanEndIdx, &token) :
+                   scan_token(lexer_p, startIdx, &scanEndIdx, &token);
+
+  // The char that stopped the scan (or the end of the input) was also examined. A scan stopped by
+  // an invalid sequence examined all of it.
+  token.numCharsExamined = charIdx - startIdx + 1;
+  if (charIdx == scanEndIdx && lexer_p->invalidUtf8Length > 0)
+  {
+    token.numCharsExamined += lexer_p->invalidUtf8Length;
+  }
+
+  // Skip to the next char that can start a token, so that a run of invalid input is one token.
+  if (token.type == TOKEN_TYPE_END)
+  {
+    token.type = TOKEN_TYPE_ERROR;
+    token.length = 1;
+    if (lexer_p->currState == 0)
+    {
+      size_t errorEndIdx = find_byte_in_set(&(lexer_p->startChars),
+                                            lexer_p->input_p,
+                                            startIdx + 1,
+                                            scanEndIdx);
+      while (errorEndIdx == scanEndIdx && validate_next_utf8_block(lexer_p))
+      {
+        scanEndIdx = lexer_p->validatedEndIdx;
+        errorEndIdx = find_byte_in_set(&(lexer_p->startChars),
+                                       lexer_p->input_p,
+                                       errorEndIdx,
+                                       scanEndIdx);
+      }
+      token.length = errorEndIdx - startIdx;
+      if (token.length + 1 > token.numCharsExamined)
+      {
+        token.numCharsExamined = token.length + 1;
+      }
+    }
+  }
+
+  lexer_p->currCharIdx = startIdx + token.length;
+  return token;
+}
+
+void read_rule_matches(const LexerS* const lexer_p,
+                       const size_t startIdx,
+                       const bool longestOnly,
+                       RuleMatchArrayS* const matches_p)
+{
+  const unsigned char* input_p = (const unsigned char*) lexer_p->input_p;
+  const int firstIdx = matches_p->numMatches;
+  const int numDfas = lexer_p->numDfas;
+  int states[numDfas];
+  for (int i = 0; i < numDfas; i++)
+  {
+    states[i] = 0;
+  }
+
+  // All groups are run in lockstep, in order, so matches with the same end stay in rule order.
+  int numLiveDfas = numDfas;
+  for (size_t charIdx = startIdx; charIdx < lexer_p->inputLength && numLiveDfas > 0; charIdx++)
+  {
+    numLiveDfas = 0;
+    for (int i = 0; i < numDfas; i++)
+    {
+      if (states[i] == NO_STATE)
+      {
+        continue;
+      }
+      const DfaS* dfa_p = lexer_p->dfas_pp[i];
+      states[i] = dfa_p->states[states[i]].transitions[input_p[charIdx]];
+      if (states[i] == NO_STATE)
+      {
+        continue;
+      }
+      numLiveDfas++;
+      if (dfa_p->states[states[i]].isEndState)
+      {
+        add_state_rule_matches(matches_p,
+                               firstIdx,
+                               dfa_p,
+                               states[i],
+                               lexer_p->ruleOffsets_p[i],
+                               charIdx + 1,
+                               longestOnly);
+      }
+    }
+  }
+}
+
+void free_rule_match_array(RuleMatchArrayS* const matches_p)
+{
+  free(matches_p->matches_p);
+  matches_p->matches_p = NULL;
+  matches_p->numMatches = 0;
+  matches_p->maxNumMatches = 0;
+}
+
+void read_all_tokens(LexerS* const lexer_p, TokenArrayS* const tokenArray_p)
+{
+  TokenS token = get_next_token(lexer_p);
+  while (token.type != TOKEN_TYPE_END)
+  {
+    add_token(tokenArray_p, &token);
+    token = get_next_token(lexer_p);
+  }
+}
+
+void add_token(TokenArrayS* const tokenArray_p, const TokenS* const token_p)
+{
+  if (tokenArray_p->numTokens == tokenArray_p->maxNumTokens)
+  {
+    int newMaxNumTokens = tokenArray_p->maxNumTokens > 0 ?
+                          2 * tokenArray_p->maxNumTokens :
+                          INITIAL_MAX_NUM_TOKENS;
+    tokenArray_p->tokens_p = realloc(tokenArray_p->tokens_p,
+                                     sizeof(TokenS) * newMaxNumTokens);
+    assert(tokenArray_p->tokens_p != NULL);
+    tokenArray_p->maxNumTokens = newMaxNumTokens;
+  }
+
+  tokenArray_p->tokens_p[tokenArray_p->numTokens] = *token_p;
+  tokenArray_p->numTokens++;
+  if (token_p->numCharsExamined > tokenArray_p->maxNumCharsExamined)
+  {
+    tokenArray_p->maxNumCharsExamined = token_p->numCharsExamined;
+  }
+}
+
+void free_token_array(TokenArrayS* const tokenArray_p)
+{
+  free(tokenArray_p->tokens_p);
+  tokenArray_p->tokens_p = NULL;
+  tokenArray_p->numTokens = 0;
+  tokenArray_p->maxNumTokens = 0;
+  tokenArray_p->maxNumCharsExamined = 0;
 }
@@ -9,22 +9,152 @@
 #define LEXER_GENERATOR_H
 
 /*> Includes *********************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dfa.h"
+#include "simd_scan.h"
 
 /*> Defines **********************************************************************************************************/
+#define TOKEN_TYPE_ERROR -1
+#define TOKEN_TYPE_END   -2
 
 /*> Type Declarations ************************************************************************************************/
 /**
  * @brief A lexer; reads strings and returns tokens.
  *
- * @param input_p     Pointer to the input string.
- * @param currChar    The current char in the input string.
+ * @param dfa_p        The DFA used to recognize tokens, the DFA of the first group if there are
+ *                     several.
+ * @param dfas_pp      The DFA of each group of RegExps. The RegExps are split into groups when
+ *                     they do not fit one DFA, and the group DFAs are run over the input in
+ *                     lockstep.
+ * @param ruleOffsets_p  The first RegExp of each group; the output values of a group DFA are
+ *                       relative to it.
+ * @param numDfas      The number of groups.
+ * @param numRules     The number of RegExps of the lexer; token types are below it.
+ * @param input_p      Pointer to the input string.
+ * @param inputLength  The number of chars in the input string.
+ * @param currCharIdx  The index of the current char in the input string.
+ * @param currState    The DFA state the next token is scanned from, always 0 if there are
+ *                     several groups.
+ * @param startChars   The chars the start state of the DFA has a transition on, i.e. the chars
+ *                     that can start a token.
+ * @param validatesUtf8       True if the input is validated as UTF-8 while it is read.
+ * @param validatedEndIdx     The index up to which the input has been validated, at the start of
+ *                            a code point.
+ * @param invalidUtf8Length   The number of chars of the invalid sequence at validatedEndIdx, 0 if
+ *                            there is none.
  */
 typedef struct LexerS
 {
-  char* input_p;
-  int currCharIdx;
+  DfaS* dfa_p;
+  DfaS** dfas_pp;
+  int* ruleOffsets_p;
+  int numDfas;
+  int numRules;
+  const char* input_p;
+  size_t inputLength;
+  size_t currCharIdx;
+  int currState;
+  ByteSetS startChars;
+  bool validatesUtf8;
+  size_t validatedEndIdx;
+  int invalidUtf8Length;
 } LexerS;
 
+/**
+ * @brief A token read by a lexer.
+ *
+ * @param type              The output value of the matched RegExp, TOKEN_TYPE_ERROR if no RegExp
+ *                          matched or TOKEN_TYPE_END at the end of the input.
+ * @param startIdx          The index of the first char of the token in the input.
+ * @param length            The number of chars in the token.
+ * @param startState        The DFA state the token was scanned from. Together with startIdx this is
+ *                          the state needed to resume reading at this token.
+ * @param numCharsExamined  The number of chars the lexer looked at to decide the token, including
+ *                          the char (or end of input) that stopped the scan. The token only depends
+ *                          on the input in [startIdx, startIdx + numCharsExamined).
+ */
+typedef struct TokenS
+{
+  int type;
+  size_t startIdx;
+  size_t length;
+  int startState;
+  size_t numCharsExamined;
+} TokenS;
+
+/**
+ * @brief A growable array of tokens.
+ *
+ * @param tokens_p             The tokens.
+ * @param numTokens            The number of tokens in the array.
+ * @param maxNumTokens         The number of tokens the array has room for.
+ * @param maxNumCharsExamined  Upper bound of numCharsExamined of the tokens in the array.
+ */
+typedef struct TokenArrayS
+{
+  TokenS* tokens_p;
+  int numTokens;
+  int maxNumTokens;
+  size_t maxNumCharsExamined;
+} TokenArrayS;
+
+/**
+ * @brief A match of one RegExp from a given start index.
+ *
+ * @param rule    The output value of the matched RegExp.
+ * @param endIdx  The index after the last char of the match.
+ */
+typedef struct RuleMatchS
+{
+  int rule;
+  size_t endIdx;
+} RuleMatchS;
+
+/**
+ * @brief Options for generating a lexer.
+ *
+ * @param isCaseInsensitive  True if every RegExp matches letters in both cases, as if it started
+ *                           with CASE_INSENSITIVE_PREFIX.
+ * @param validatesUtf8      True if the input is validated as UTF-8 block by block, just before
+ *                           the DFA reads the block. Each invalid sequence is read as a token of
+ *                           type TOKEN_TYPE_ERROR.
+ * @param usesDerivatives    True if the DFA is built directly from the RegExps with derivatives
+ *                           instead of by subset construction from their combined NFA.
+ * @param maxNumDfaStates    The number of states a DFA may have, 0 for as many as there is room
+ *                           for. RegExps that do not fit one DFA are split into groups of
+ *                           consecutive RegExps that do, by halving the groups that do not;
+ *                           RegExps that do not fit one NFA are built with derivatives. A RegExp
+ *                           that does not fit on its own gets a DFA of its own, of up to
+ *                           MAX_NUM_DFA_STATES - 1 states.
+ * @param numThreads         The number of threads subset construction runs on, 0 or 1 for the
+ *                           calling thread only. It does not change the DFAs, only how fast they
+ *                           are built for large sets of RegExps.
+ */
+typedef struct LexerOptionsS
+{
+  bool isCaseInsensitive;
+  bool validatesUtf8;
+  bool usesDerivatives;
+  int maxNumDfaStates;
+  int numThreads;
+} LexerOptionsS;
+
+/**
+ * @brief A growable array of RegExp matches.
+ *
+ * @param matches_p      The matches.
+ * @param numMatches     The number of matches in the array.
+ * @param maxNumMatches  The number of matches the array has room for.
+ */
+typedef struct RuleMatchArrayS
+{
+  RuleMatchS* matches_p;
+  int numMatches;
+  int maxNumMatches;
+} RuleMatchArrayS;
+
 /*> Constant Declarations ********************************************************************************************/
 
 /*> Variable Declarations ********************************************************************************************/
@@ -34,16 +164,117 @@ typedef struct LexerS
  * @brief Generates a lexer based on the input regular expressions.
  * @param[in] regExpStrs_pp  Array of regular expressions as strings.
  * @param[in] numRegExps     The number of regular expressions.
- * @return The generated lexer.
+ * @return The generated lexer, NULL if a regular expression does not fit a DFA on its own.
  */
 LexerS* generate_lexer(const char** const regExpStrs_pp, const int numRegExps);
 
+/**
+ * @brief Generates a lexer based on the input regular expressions and options.
+ * @param[in] regExpStrs_pp  Array of regular expressions as strings.
+ * @param[in] numRegExps     The number of regular expressions.
+ * @param[in] options_p      The options.
+ * @return The generated lexer, NULL if a regular expression does not fit a DFA of
+ *         MAX_NUM_DFA_STATES - 1 states on its own.
+ */
+LexerS* generate_lexer_with_options(const char** const regExpStrs_pp,
+                                    const int numRegExps,
+                                    const LexerOptionsS* const options_p);
+
+/**
+ * @brief Merges lexers into one lexer without parsing their RegExps again, by merging their DFAs
+ *        with merge_dfas(). The merged lexer reads tokens as if it had been generated from the
+ *        RegExps of all the lexers in order: the token types of each lexer are shifted by the
+ *        number of RegExps of the lexers before it, which win when several match. It validates
+ *        UTF-8 if any of the lexers does. If any lexer has several groups, or the merged DFA
+ *        would have more than MAX_NUM_DFA_STATES - 1 states, the groups of all lexers are kept
+ *        side by side instead of merged.
+ * @param[in]  lexers_pp  The lexers, which are not changed.
+ * @param[in]  numLexers  The number of lexers.
+ * @return The merged lexer.
+ */
+LexerS* merge_lexers(const LexerS* const* const lexers_pp, const int numLexers);
+
+/**
+ * @brief Frees a lexer.
+ * @param[in]  lexer_p  The lexer.
+ */
+void free_lexer(LexerS* const lexer_p);
+
 /**
  * @brief Starts reading the provided input string.
  * @param[in/out]      Pointer to the lexer.
- * @param[in] input_p  Pointer to the string to read.
+ * @param[in] input_p  Pointer to the null terminated string to read.
  */
 void start_reading(LexerS* const lexer_p, char* const input_p);
 
+/**
+ * @brief Starts reading the provided input buffer, which may contain null chars.
+ * @param[in/out]  lexer_p      Pointer to the lexer.
+ * @param[in]      input_p      Pointer to the buffer to read.
+ * @param[in]      inputLength  The number of chars in the buffer.
+ */
+void start_reading_buffer(LexerS* const lexer_p, const char* const input_p, const size_t inputLength);
+
+/**
+ * @brief Continues reading the current input from a token boundary, e.g. the startIdx and
+ *        startState of a previously read token.
+ * @param[in/out]  lexer_p  Pointer to the lexer.
+ * @param[in]      charIdx  The index of the char to continue reading from.
+ * @param[in]      state    The DFA state to continue reading from.
+ */
+void resume_reading(LexerS* const lexer_p, const size_t charIdx, const int state);
+
+/**
+ * @brief Reads the next token from the input using maximal munch. When no token matches, a token of
+ *        type TOKEN_TYPE_ERROR is returned that covers the chars up to the next char that can start
+ *        a token. If several RegExps match the longest match, the earliest one wins. When the lexer
+ *        validates UTF-8, tokens end before invalid sequences, which are error tokens of their own.
+ *        A lexer with several groups steps all group DFAs on each char until they are all stuck;
+ *        the first group in an end state gives the type, so tokens are the same as with one DFA.
+ * @param[in/out]  lexer_p  Pointer to the lexer.
+ * @return The token, of type TOKEN_TYPE_END once the whole input has been read.
+ */
+TokenS get_next_token(LexerS* const lexer_p);
+
+/**
+ * @brief Finds every RegExp that matches the input from a start index, in one pass over the input.
+ *        Unlike get_next_token(), overlapping RegExps are all reported.
+ * @param[in]   lexer_p      Pointer to the lexer.
+ * @param[in]   startIdx     The index the matches start at.
+ * @param[in]   longestOnly  If true only the longest match of each RegExp is reported, otherwise
+ *                           every (RegExp, end) pair is reported in order of the end.
+ * @param[out]  matches_p    The match array to append the matches to.
+ */
+void read_rule_matches(const LexerS* const lexer_p,
+                       const size_t startIdx,
+                       const bool longestOnly,
+                       RuleMatchArrayS* const matches_p);
+
+/**
+ * @brief Frees the matches of a match array and empties it.
+ * @param[in/out]  matches_p  The match array.
+ */
+void free_rule_match_array(RuleMatchArrayS* const matches_p);
+
+/**
+ * @brief Reads all remaining tokens of the input into a token array. The end token is not added.
+ * @param[in/out]  lexer_p       Pointer to the lexer.
+ * @param[out]     tokenArray_p  The token array to append the tokens to.
+ */
+void read_all_tokens(LexerS* const lexer_p, TokenArrayS* const tokenArray_p);
+
+/**
+ * @brief Appends a token to a token array, growing the array if needed.
+ * @param[in/out]  tokenArray_p  The token array.
+ * @param[in]      token_p       The token to append.
+ */
+void add_token(TokenArrayS* const tokenArray_p, const TokenS* const token_p);
+
+/**
+ * @brief Frees the tokens of a token array and empties it.
+ * @param[in/out]  tokenArray_p  The token array.
+ */
+void free_token_array(TokenArrayS* const tokenArray_p);
+
 /*> End of Multiple Inclusion Protection *****************************************************************************/
 #endif
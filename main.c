@@ -33,7 +33,14 @@ int main()
   LexerS* lexer_p = generate_lexer(regExps, 4);
   start_reading(lexer_p, testString);
 
-  free(lexer_p);
+  TokenS token = get_next_token(lexer_p);
+  while (token.type != TOKEN_TYPE_END)
+  {
+    printf("Token %d: \"%.*s\"\n", token.type, (int) token.length, &testString[token.startIdx]);
+    token = get_next_token(lexer_p);
+  }
+
+  free_lexer(lexer_p);
 
   printf("Finished\n");
   return 0;
@@ -6,6 +6,7 @@
 
 /*> Includes **************************************************************************************/
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,6 +15,10 @@
 #include "nfa.h"
 
 /*> Defines ***************************************************************************************/
+#define STATE_TABLE_SIZE              (2 * MAX_NUM_NFA_STATES)
+#define NO_BLOCK                      -1
+#define INITIAL_MAX_NUM_CONVERTED     16
+#define INITIAL_MAX_NUM_FRAMES        16
 
 /*> Type Declarations *****************************************************************************/
 /**
@@ -27,6 +32,67 @@ typedef struct StartAndEndStatesS
   int endIdx;
 } StartAndEndStateS;
 
+/**
+ * @brief A shared RegExp that has been converted, whose states can be copied for its other uses.
+ * @param regExp_p       The RegExp.
+ * @param firstStateIdx  The index of the first state of the conversion. Its states are consecutive.
+ * @param numStates      The number of states of the conversion.
+ * @param startAndEnd    The start and end states of the conversion.
+ */
+typedef struct ConvertedRegExpS
+{
+  const RegExpS* regExp_p;
+  int firstStateIdx;
+  int numStates;
+  StartAndEndStateS startAndEnd;
+} ConvertedRegExpS;
+
+/**
+ * @brief The shared RegExps converted so far while generating an NFA.
+ * @param regExps_p      The converted RegExps.
+ * @param numRegExps     The number of converted RegExps.
+ * @param maxNumRegExps  The number of converted RegExps there is room for.
+ */
+typedef struct ConvertedRegExpArrayS
+{
+  ConvertedRegExpS* regExps_p;
+  int numRegExps;
+  int maxNumRegExps;
+} ConvertedRegExpArrayS;
+
+/**
+ * @brief A RegExp on the work stack of convert(), which is done once its children are.
+ * @param regExp_p              The RegExp.
+ * @param firstStateIdx         The index of the first state of the conversion.
+ * @param childFirstStateIdx    The index of the first state of the child being converted.
+ * @param numConvertedChildren  The number of children converted so far.
+ * @param isCopied              True if the RegExp is shared and a copy of its earlier conversion.
+ * @param startAndEnd           The start and end states of the conversion so far.
+ */
+typedef struct ConvertFrameS
+{
+  const RegExpS* regExp_p;
+  int firstStateIdx;
+  int childFirstStateIdx;
+  int numConvertedChildren;
+  bool isCopied;
+  StartAndEndStateS startAndEnd;
+} ConvertFrameS;
+
+/**
+ * @brief The work stack of convert(), which holds the RegExps from the one being converted up to
+ *        the root.
+ * @param frames_p      The RegExps, the root first.
+ * @param numFrames     The number of RegExps.
+ * @param maxNumFrames  The number of RegExps there is room for.
+ */
+typedef struct ConvertStackS
+{
+  ConvertFrameS* frames_p;
+  int numFrames;
+  int maxNumFrames;
+} ConvertStackS;
+
 /*> Global Constant Definitions *******************************************************************/
 
 /*> Global Variable Definitions *******************************************************************/
@@ -38,52 +104,58 @@ typedef struct StartAndEndStatesS
 /*> Local Function Declarations *******************************************************************/
 /**
  * @brief Converts the RegExp and adds any generated states to the provided NFA. Based on Thompson's
- *        construction.
- * @param[in/out]  nfa_p     The NFA. 
- * @param[in]      regExp_p  The RegExp to convert.
- * @return Struct with the start and end states generated part of the nfa.
- */
-static StartAndEndStateS convert(NfaS* const nfa_p, const RegExpS* const regExp_p);
-
-/**
- * @brief Converts the RegExp Sequence and adds any generated states to the provided NFA.
- * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp Sequence to convert.
+ *        construction. A RegExp shared by share_regexp() that was converted before is copied
+ *        instead of converted again. The RegExps being converted are kept on a work stack instead
+ *        of the call stack, so deep RegExps cannot overflow the call stack of small threads.
+ * @param[in/out]  nfa_p        The NFA.
+ * @param[in]      regExp_p     The RegExp to convert.
+ * @param[in/out]  converted_p  The shared RegExps converted so far.
  * @return Struct with the start and end states generated part of the nfa.
  */
-static StartAndEndStateS convert_sequence(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static StartAndEndStateS convert(NfaS* const nfa_p,
+                                 const RegExpS* const regExp_p,
+                                 ConvertedRegExpArrayS* const converted_p);
 
 /**
- * @brief Converts the RegExp Optional and adds any generated states to the provided NFA.
- * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp Optional to convert.
- * @return Struct with the start and end states generated part of the nfa.
+ * @brief Pushes a RegExp on the work stack of convert() and starts its conversion: adds its own
+ *        states, or all of them if it has no children to convert, or a copy if it is shared and
+ *        was converted before.
+ * @param[in/out]  nfa_p        The NFA.
+ * @param[in/out]  stack_p      The work stack.
+ * @param[in]      regExp_p     The RegExp.
+ * @param[in]      converted_p  The shared RegExps converted so far.
  */
-static StartAndEndStateS convert_optional(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static void push_convert_frame(NfaS* const nfa_p,
+                               ConvertStackS* const stack_p,
+                               const RegExpS* const regExp_p,
+                               const ConvertedRegExpArrayS* const converted_p);
 
 /**
- * @brief Converts the RegExp OneOrMore and adds any generated states to the provided NFA.
- * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp OneOrMore to convert.
- * @return Struct with the start and end states generated part of the nfa.
+ * @brief Finds the next child of a RegExp on the work stack of convert() to convert.
+ * @param[in]  frame_p  The RegExp on the work stack.
+ * @return The child, NULL if all children are converted.
  */
-static StartAndEndStateS convert_one_or_more(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static const RegExpS* get_unconverted_child(const ConvertFrameS* const frame_p);
 
 /**
- * @brief Converts the RegExp ZeroOrMore and adds any generated states to the provided NFA.
- * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp ZeroOrMore to convert.
- * @return Struct with the start and end states generated part of the nfa.
+ * @brief Connects a converted child to the states of a RegExp on the work stack of convert().
+ * @param[in/out]  nfa_p             The NFA.
+ * @param[in/out]  frame_p           The RegExp on the work stack.
+ * @param[in]      childStartAndEnd  The start and end states of the child.
  */
-static StartAndEndStateS convert_zero_or_more(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static void add_converted_child(NfaS* const nfa_p,
+                                ConvertFrameS* const frame_p,
+                                const StartAndEndStateS childStartAndEnd);
 
 /**
- * @brief Converts the RegExp Or and adds any generated states to the provided NFA.
- * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp Or to convert.
- * @return Struct with the start and end states generated part of the nfa.
+ * @brief Remembers the conversion of a shared RegExp, so that its other uses are copied from it.
+ * @param[in/out]  converted_p  The shared RegExps converted so far.
+ * @param[in]      frame_p      The converted RegExp on the work stack of convert().
+ * @param[in]      numStates    The number of states of the NFA after the conversion.
  */
-static StartAndEndStateS convert_or(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static void add_converted_regexp(ConvertedRegExpArrayS* const converted_p,
+                                 const ConvertFrameS* const frame_p,
+                                 const int numStates);
 
 /**
  * @brief Converts the RegExp String and adds any generated states to the provided NFA.
@@ -94,20 +166,71 @@ static StartAndEndStateS convert_or(NfaS* const nfa_p, const RegExpS* const regE
 static StartAndEndStateS convert_string(NfaS* const nfa_p, const RegExpS* const regExp_p);
 
 /**
- * @brief Converts the RegExp OneOf and adds any generated states to the provided NFA.
+ * @brief Converts the RegExp CharClass and adds any generated states to the provided NFA. The
+ *        whole class is one transition from the start state per member char, so no epsilon
+ *        transitions are needed however many chars it has.
  * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp String to convert.
+ * @param[in]  regExp_p  The RegExp CharClass to convert.
  * @return Struct with the start and end states generated part of the nfa.
  */
-static StartAndEndStateS convert_one_of(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static StartAndEndStateS convert_char_class(NfaS* const nfa_p, const RegExpS* const regExp_p);
 
 /**
- * @brief Converts the RegExp Range and adds any generated states to the provided NFA.
+ * @brief Converts the RegExp CodePointSet and adds any generated states to the provided NFA. The
+ *        states are those of the minimal automaton matching the UTF-8 encodings of the code
+ *        points, so the NFA stays byte-level.
  * @param[out] nfa_p     The NFA. 
- * @param[in]  regExp_p  The RegExp Range to convert.
+ * @param[in]  regExp_p  The RegExp CodePointSet to convert.
  * @return Struct with the start and end states generated part of the nfa.
  */
-static StartAndEndStateS convert_range(NfaS* const nfa_p, const RegExpS* const regExp_p);
+static StartAndEndStateS convert_code_point_set(NfaS* const nfa_p, const RegExpS* const regExp_p);
+
+/**
+ * @brief Counts the copies of its child a RegExp Repeat is unrolled into.
+ * @param[in]  regExp_p  The RegExp Repeat.
+ * @return The number of copies.
+ */
+static int count_repeat_copies(const RegExpS* const regExp_p);
+
+/**
+ * @brief Completes the conversion of a RegExp Repeat from the conversion of its child. The child
+ *        is unrolled into a chain of copies; the optional copies after the minimum all share one
+ *        exit state instead of each being wrapped like an Optional, and an unbounded repetition
+ *        loops on its last copy.
+ * @param[in/out]  nfa_p              The NFA.
+ * @param[in]      regExp_p           The RegExp Repeat.
+ * @param[in]      startAndEnd        The start and end states of the RegExp Repeat.
+ * @param[in]      firstCopy          The start and end states of the converted child.
+ * @param[in]      firstCopyStateIdx  The index of the first state of the converted child, after
+ *                                    which the NFA only has its states.
+ */
+static void add_repeat_copies(NfaS* const nfa_p,
+                              const RegExpS* const regExp_p,
+                              const StartAndEndStateS startAndEnd,
+                              const StartAndEndStateS firstCopy,
+                              const int firstCopyStateIdx);
+
+/**
+ * @brief Adds a copy of a converted RegExp to the NFA. The states of a conversion only have
+ *        transitions among themselves, apart from the ones added to its end state afterwards, which
+ *        are left out.
+ * @param[in/out]  nfa_p          The NFA.
+ * @param[in]      firstStateIdx  The index of the first state of the conversion.
+ * @param[in]      numStates      The number of states of the conversion.
+ * @param[in]      startAndEnd    The start and end states of the conversion.
+ * @return Struct with the start and end states of the copy.
+ */
+static StartAndEndStateS copy_converted(NfaS* const nfa_p,
+                                        const int firstStateIdx,
+                                        const int numStates,
+                                        const StartAndEndStateS startAndEnd);
+
+/**
+ * @brief Counts the states convert() adds for a RegExp.
+ * @param[in]  regExp_p  The RegExp.
+ * @return The number of states, or MAX_NUM_NFA_STATES if there are at least that many.
+ */
+static int count_converted_states(const RegExpS* const regExp_p);
 
 /**
  * @brief Adds a new state to NFA and returns the index of it.
@@ -132,6 +255,97 @@ static int add_end_state(NfaS* const nfa_p, const int outputValue);
  */
 static void add_epsilon_transition(NfaS* const nfa_p, const int startIdx, const int endIdx);
 
+/**
+ * @brief Replaces the epsilon transitions of the states with transitions on chars, of the end
+ *        states and of the start state by direct epsilon transitions to the states of these kinds
+ *        in their epsilon closures. Other states become unreachable. A state entered on chars that
+ *        passes on to a single state is then replaced by that state.
+ * @param[in/out]  nfa_p  The NFA.
+ */
+static void eliminate_epsilon_transitions(NfaS* const nfa_p);
+
+/**
+ * @brief Finds the states of an NFA that are reachable from the start state and from which an end
+ *        state can be reached. The start state always counts as useful.
+ * @param[in]   nfa_p           The NFA.
+ * @param[out]  usefulStates_p  The useful states.
+ */
+static void find_useful_states(const NfaS* const nfa_p, LargeBitSetS* const usefulStates_p);
+
+/**
+ * @brief Gets the blocks the epsilon transitions of an NFA state lead to.
+ * @param[in]   nfa_p           The NFA.
+ * @param[in]   usefulStates_p  The useful states; transitions to others are ignored.
+ * @param[in]   blocks_p        The block of each useful state.
+ * @param[in]   stateIdx        The index of the state.
+ * @param[out]  epsilonBlocks_p The blocks.
+ */
+static void get_epsilon_blocks(const NfaS* const nfa_p,
+                               const LargeBitSetS* const usefulStates_p,
+                               const int* const blocks_p,
+                               const int stateIdx,
+                               LargeBitSetS* const epsilonBlocks_p);
+
+/**
+ * @brief Gets the block of the state a transition leads to.
+ * @param[in]  usefulStates_p  The useful states.
+ * @param[in]  blocks_p        The block of each useful state.
+ * @param[in]  transition      The state the transition leads to, NO_STATE if there is none.
+ * @return The block, NO_BLOCK if there is no transition or it leads to a state that is not useful.
+ */
+static int block_of_transition(const LargeBitSetS* const usefulStates_p,
+                               const int* const blocks_p,
+                               const int transition);
+
+/**
+ * @brief Hashes what an NFA state does in terms of blocks of states: its own block, its output
+ *        and the blocks its transitions lead to.
+ * @param[in]  nfa_p           The NFA.
+ * @param[in]  usefulStates_p  The useful states.
+ * @param[in]  blocks_p        The block of each useful state.
+ * @param[in]  stateIdx        The index of the state.
+ * @return The hash.
+ */
+static uint32_t hash_state_in_blocks(const NfaS* const nfa_p,
+                                     const LargeBitSetS* const usefulStates_p,
+                                     const int* const blocks_p,
+                                     const int stateIdx);
+
+/**
+ * @brief Checks if two NFA states do the same in terms of blocks of states, see
+ *        hash_state_in_blocks().
+ * @param[in]  nfa_p           The NFA.
+ * @param[in]  usefulStates_p  The useful states.
+ * @param[in]  blocks_p        The block of each useful state.
+ * @param[in]  stateIdx1       The index of the first state.
+ * @param[in]  stateIdx2       The index of the second state.
+ * @return True if the states do the same.
+ */
+static bool states_are_equal_in_blocks(const NfaS* const nfa_p,
+                                       const LargeBitSetS* const usefulStates_p,
+                                       const int* const blocks_p,
+                                       const int stateIdx1,
+                                       const int stateIdx2);
+
+/**
+ * @brief Partitions the useful states of an NFA into blocks of bisimilar states, by splitting
+ *        blocks until the states of each block have the same output and their transitions on each
+ *        char, and their epsilon transitions, lead to the same blocks.
+ * @param[in]   nfa_p           The NFA.
+ * @param[in]   usefulStates_p  The useful states.
+ * @param[out]  blocks_p        The block of each useful state.
+ */
+static void find_bisimilar_states(const NfaS* const nfa_p,
+                                  const LargeBitSetS* const usefulStates_p,
+                                  int* const blocks_p);
+
+/**
+ * @brief Frees the room an NFA has for states beyond its last one.
+ * @param[in]  nfa_p  The NFA.
+ * @return The NFA, which may have moved.
+ */
+static NfaS* shrink_nfa(NfaS* const nfa_p);
+
 /**
  * @brief Prints an NFA state with all its transitions.
  * @param[in]  nfa_p     The NFA.
@@ -140,95 +354,191 @@ static void add_epsilon_transition(NfaS* const nfa_p, const int startIdx, const
 static void print_nfa_state(const NfaS* const nfa_p, const int stateIdx);
 
 /*> Local Function Definitions ********************************************************************/
-static StartAndEndStateS convert(NfaS* const nfa_p, const RegExpS* const regExp_p)
+static StartAndEndStateS convert(NfaS* const nfa_p,
+                                 const RegExpS* const regExp_p,
+                                 ConvertedRegExpArrayS* const converted_p)
 {
+  ConvertStackS stack = { .frames_p = NULL, .numFrames = 0, .maxNumFrames = 0 };
+  push_convert_frame(nfa_p, &stack, regExp_p, converted_p);
+
+  StartAndEndStateS startAndEnd = {NO_STATE, NO_STATE};
+  while (stack.numFrames > 0)
+  {
+    ConvertFrameS* frame_p = &(stack.frames_p[stack.numFrames - 1]);
+    const RegExpS* child_p = get_unconverted_child(frame_p);
+    if (child_p != NULL)
+    {
+      frame_p->childFirstStateIdx = nfa_p->numStates;
+      push_convert_frame(nfa_p, &stack, child_p, converted_p);
+      continue;
+    }
+
+    // All children are converted, so the RegExp is done and is connected to its parent.
+    startAndEnd = frame_p->startAndEnd;
+    if (frame_p->regExp_p->numRefs > 1 && !frame_p->isCopied)
+    {
+      add_converted_regexp(converted_p, frame_p, nfa_p->numStates);
+    }
+    stack.numFrames--;
+    if (stack.numFrames > 0)
+    {
+      ConvertFrameS* parent_p = &(stack.frames_p[stack.numFrames - 1]);
+      add_converted_child(nfa_p, parent_p, startAndEnd);
+      parent_p->numConvertedChildren++;
+    }
+  }
+
+  free(stack.frames_p);
+  return startAndEnd;
+}
+
+static void push_convert_frame(NfaS* const nfa_p,
+                               ConvertStackS* const stack_p,
+                               const RegExpS* const regExp_p,
+                               const ConvertedRegExpArrayS* const converted_p)
+{
+  if (stack_p->numFrames == stack_p->maxNumFrames)
+  {
+    stack_p->maxNumFrames = stack_p->maxNumFrames > 0 ?
+                            2 * stack_p->maxNumFrames :
+                            INITIAL_MAX_NUM_FRAMES;
+    stack_p->frames_p = realloc(stack_p->frames_p, sizeof(ConvertFrameS) * stack_p->maxNumFrames);
+    assert(stack_p->frames_p != NULL);
+  }
+  ConvertFrameS* frame_p = &(stack_p->frames_p[stack_p->numFrames++]);
+  frame_p->regExp_p = regExp_p;
+  frame_p->firstStateIdx = nfa_p->numStates;
+  frame_p->childFirstStateIdx = nfa_p->numStates;
+  frame_p->numConvertedChildren = 0;
+  frame_p->isCopied = false;
+
+  if (regExp_p->numRefs > 1)
+  {
+    for (int i = 0; i < converted_p->numRegExps; i++)
+    {
+      const ConvertedRegExpS* convertedRegExp_p = &(converted_p->regExps_p[i]);
+      if (convertedRegExp_p->regExp_p == regExp_p)
+      {
+        frame_p->isCopied = true;
+        frame_p->startAndEnd = copy_converted(nfa_p,
+                                              convertedRegExp_p->firstStateIdx,
+                                              convertedRegExp_p->numStates,
+                                              convertedRegExp_p->startAndEnd);
+        return;
+      }
+    }
+  }
+
+  StartAndEndStateS startAndEnd = {NO_STATE, NO_STATE};
   switch (regExp_p->type)
   {
-  case REGEXP_SEQUENCE:
-    return convert_sequence(nfa_p, regExp_p);
   case REGEXP_OPTIONAL:
-    return convert_optional(nfa_p, regExp_p);
-  case REGEXP_ONE_OR_MORE:
-    return convert_one_or_more(nfa_p, regExp_p);
   case REGEXP_ZERO_OR_MORE:
-    return convert_zero_or_more(nfa_p, regExp_p);
+    startAndEnd.startIdx = add_new_state(nfa_p);
+    startAndEnd.endIdx = add_new_state(nfa_p);
+    add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEnd.endIdx);
+    break;
+  case REGEXP_ONE_OR_MORE:
   case REGEXP_OR:
-    return convert_or(nfa_p, regExp_p);
+    startAndEnd.startIdx = add_new_state(nfa_p);
+    startAndEnd.endIdx = add_new_state(nfa_p);
+    break;
+  case REGEXP_REPEAT:
+    startAndEnd.startIdx = add_new_state(nfa_p);
+    startAndEnd.endIdx = add_new_state(nfa_p);
+    if (count_repeat_copies(regExp_p) == 0)
+    {
+      add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEnd.endIdx);
+    }
+    break;
   case REGEXP_STRING:
-    return convert_string(nfa_p, regExp_p);
-  case REGEXP_ONE_OF:
-    return convert_one_of(nfa_p, regExp_p);
-  case REGEXP_RANGE:
-    return convert_range(nfa_p, regExp_p);
+    startAndEnd = convert_string(nfa_p, regExp_p);
+    break;
+  case REGEXP_CHAR_CLASS:
+    startAndEnd = convert_char_class(nfa_p, regExp_p);
+    break;
+  case REGEXP_CODE_POINT_SET:
+    startAndEnd = convert_code_point_set(nfa_p, regExp_p);
+    break;
   default:
+    break;
+  }
+  frame_p->startAndEnd = startAndEnd;
+}
+
+static const RegExpS* get_unconverted_child(const ConvertFrameS* const frame_p)
+{
+  const RegExpS* regExp_p = frame_p->regExp_p;
+  if (frame_p->isCopied || frame_p->numConvertedChildren >= regExp_p->numChildren)
   {
-    StartAndEndStateS noStates = {NO_STATE, NO_STATE};
-    return noStates;
+    return NULL;
   }
+  if (regExp_p->type == REGEXP_REPEAT && count_repeat_copies(regExp_p) == 0)
+  {
+    return NULL;
   }
+  return regExp_p->children[frame_p->numConvertedChildren];
 }
 
-static StartAndEndStateS convert_sequence(NfaS* const nfa_p, const RegExpS* const regExp_p)
+static void add_converted_child(NfaS* const nfa_p,
+                                ConvertFrameS* const frame_p,
+                                const StartAndEndStateS childStartAndEnd)
 {
-  StartAndEndStateS startAndEnd = {NO_STATE, NO_STATE};
-  for (int i = 0; i < regExp_p->numChildren; i++)
+  StartAndEndStateS* startAndEnd_p = &(frame_p->startAndEnd);
+  switch (frame_p->regExp_p->type)
   {
-    StartAndEndStateS startAndEndOfNewConvert = convert(nfa_p, regExp_p->children[i]);
-    if (i == 0)
+  case REGEXP_SEQUENCE:
+    if (frame_p->numConvertedChildren == 0)
     {
-      startAndEnd.startIdx = startAndEndOfNewConvert.startIdx;
-      startAndEnd.endIdx = startAndEndOfNewConvert.endIdx;
+      startAndEnd_p->startIdx = childStartAndEnd.startIdx;
     }
     else
     {
-      add_epsilon_transition(nfa_p, startAndEnd.endIdx, startAndEndOfNewConvert.startIdx);
-      startAndEnd.endIdx = startAndEndOfNewConvert.endIdx;
+      add_epsilon_transition(nfa_p, startAndEnd_p->endIdx, childStartAndEnd.startIdx);
     }
+    startAndEnd_p->endIdx = childStartAndEnd.endIdx;
+    break;
+  case REGEXP_OPTIONAL:
+  case REGEXP_OR:
+    add_epsilon_transition(nfa_p, startAndEnd_p->startIdx, childStartAndEnd.startIdx);
+    add_epsilon_transition(nfa_p, childStartAndEnd.endIdx, startAndEnd_p->endIdx);
+    break;
+  case REGEXP_ONE_OR_MORE:
+  case REGEXP_ZERO_OR_MORE:
+    add_epsilon_transition(nfa_p, startAndEnd_p->startIdx, childStartAndEnd.startIdx);
+    add_epsilon_transition(nfa_p, childStartAndEnd.endIdx, startAndEnd_p->endIdx);
+    add_epsilon_transition(nfa_p, childStartAndEnd.endIdx, childStartAndEnd.startIdx);
+    break;
+  case REGEXP_REPEAT:
+    add_repeat_copies(nfa_p,
+                      frame_p->regExp_p,
+                      *startAndEnd_p,
+                      childStartAndEnd,
+                      frame_p->childFirstStateIdx);
+    break;
+  default:
+    break;
   }
-  return startAndEnd;
-}
-
-static StartAndEndStateS convert_optional(NfaS* const nfa_p, const RegExpS* const regExp_p)
-{
-  StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEnd.endIdx);
-  StartAndEndStateS startAndEndOfNewConvert = convert(nfa_p, regExp_p->child_p);
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfNewConvert.startIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEnd.endIdx);
-  return startAndEnd;
-}
-
-static StartAndEndStateS convert_zero_or_more(NfaS* const nfa_p, const RegExpS* const regExp_p)
-{
-  StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEnd.endIdx);
-  StartAndEndStateS startAndEndOfNewConvert = convert(nfa_p, regExp_p->child_p);
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfNewConvert.startIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEnd.endIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEndOfNewConvert.startIdx);
-  return startAndEnd;
-}
-
-static StartAndEndStateS convert_one_or_more(NfaS* const nfa_p, const RegExpS* const regExp_p)
-{
-  StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  StartAndEndStateS startAndEndOfNewConvert = convert(nfa_p, regExp_p->child_p);
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfNewConvert.startIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEnd.endIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEndOfNewConvert.startIdx);
-  return startAndEnd;
 }
 
-static StartAndEndStateS convert_or(NfaS* const nfa_p, const RegExpS* const regExp_p)
+static void add_converted_regexp(ConvertedRegExpArrayS* const converted_p,
+                                 const ConvertFrameS* const frame_p,
+                                 const int numStates)
 {
-  StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  StartAndEndStateS startAndEndOfLeft = convert(nfa_p, regExp_p->left_p);
-  StartAndEndStateS startAndEndOfRight = convert(nfa_p, regExp_p->right_p);
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfLeft.startIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfLeft.endIdx, startAndEnd.endIdx);
-  add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfRight.startIdx);
-  add_epsilon_transition(nfa_p, startAndEndOfRight.endIdx, startAndEnd.endIdx);
-  return startAndEnd;
+  if (converted_p->numRegExps == converted_p->maxNumRegExps)
+  {
+    converted_p->maxNumRegExps = converted_p->maxNumRegExps > 0 ?
+                                 2 * converted_p->maxNumRegExps :
+                                 INITIAL_MAX_NUM_CONVERTED;
+    converted_p->regExps_p = realloc(converted_p->regExps_p,
+                                     sizeof(ConvertedRegExpS) * converted_p->maxNumRegExps);
+    assert(converted_p->regExps_p != NULL);
+  }
+  ConvertedRegExpS* convertedRegExp_p = &(converted_p->regExps_p[converted_p->numRegExps++]);
+  convertedRegExp_p->regExp_p = frame_p->regExp_p;
+  convertedRegExp_p->firstStateIdx = frame_p->firstStateIdx;
+  convertedRegExp_p->numStates = numStates - frame_p->firstStateIdx;
+  convertedRegExp_p->startAndEnd = frame_p->startAndEnd;
 }
 
 static StartAndEndStateS convert_string(NfaS* const nfa_p, const RegExpS* const regExp_p)
@@ -236,7 +546,7 @@ static StartAndEndStateS convert_string(NfaS* const nfa_p, const RegExpS* const
   StartAndEndStateS startAndEnd = {add_new_state(nfa_p), NO_STATE};
   for (int i = 0; i < regExp_p->numChars; i++)
   {
-    char transition = regExp_p->characters[i];
+    unsigned char transition = regExp_p->characters[i];
     int newStateIdx = add_new_state(nfa_p);
     if (i == 0)
     {
@@ -248,36 +558,197 @@ static StartAndEndStateS convert_string(NfaS* const nfa_p, const RegExpS* const
       NfaStateS* endState_p = &(nfa_p->states[startAndEnd.endIdx]);
       endState_p->transitions[transition] = newStateIdx;
     }
+    if (regExp_p->isCaseInsensitive)
+    {
+      int fromStateIdx = (i == 0) ? startAndEnd.startIdx : startAndEnd.endIdx;
+      nfa_p->states[fromStateIdx].transitions[other_char_case(transition)] = newStateIdx;
+    }
     startAndEnd.endIdx = newStateIdx;
   }
   return startAndEnd;
 }
 
-static StartAndEndStateS convert_one_of(NfaS* const nfa_p, const RegExpS* const regExp_p)
+static StartAndEndStateS convert_char_class(NfaS* const nfa_p, const RegExpS* const regExp_p)
 {
   StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  for (int i = 0; i < regExp_p->numChildren; i++)
+  NfaStateS* startState_p = &(nfa_p->states[startAndEnd.startIdx]);
+  for (int i = 0; i < NUM_CHARS; i++)
   {
-    StartAndEndStateS startAndEndOfNewConvert = convert(nfa_p, regExp_p->children[i]);
-    add_epsilon_transition(nfa_p, startAndEnd.startIdx, startAndEndOfNewConvert.startIdx);
-    add_epsilon_transition(nfa_p, startAndEndOfNewConvert.endIdx, startAndEnd.endIdx);
+    if (is_char_in_class(regExp_p, i))
+    {
+      startState_p->transitions[i] = startAndEnd.endIdx;
+    }
   }
   return startAndEnd;
 }
 
-static StartAndEndStateS convert_range(NfaS* const nfa_p, const RegExpS* const regExp_p)
+static StartAndEndStateS convert_code_point_set(NfaS* const nfa_p, const RegExpS* const regExp_p)
 {
-  StartAndEndStateS startAndEnd = {add_new_state(nfa_p), add_new_state(nfa_p)};
-  char leftChar = regExp_p->left_p->characters[0];
-  char rightChar = regExp_p->right_p->characters[0];
-  for (char i = leftChar; i <= rightChar; i++)
+  Utf8AutomatonS automaton;
+  build_utf8_automaton(&(regExp_p->codePoints), regExp_p->isReversed, &automaton);
+
+  int firstStateIdx = nfa_p->numStates;
+  for (int i = 0; i < automaton.numStates; i++)
   {
-    NfaStateS* startState_p = &(nfa_p->states[startAndEnd.startIdx]);
-    startState_p->transitions[i] = startAndEnd.endIdx;
+    add_new_state(nfa_p);
   }
+  StartAndEndStateS startAndEnd = {firstStateIdx + automaton.startState, add_new_state(nfa_p)};
+
+  for (int i = 0; i < automaton.numStates; i++)
+  {
+    NfaStateS* state_p = &(nfa_p->states[firstStateIdx + i]);
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      int transition = automaton.transitions_p[i][j];
+      if (transition == UTF8_ACCEPT)
+      {
+        state_p->transitions[j] = startAndEnd.endIdx;
+      }
+      else if (transition != NO_UTF8_STATE)
+      {
+        state_p->transitions[j] = firstStateIdx + transition;
+      }
+    }
+  }
+
+  free_utf8_automaton(&automaton);
   return startAndEnd;
 }
 
+static int count_repeat_copies(const RegExpS* const regExp_p)
+{
+  if (regExp_p->maxRepeats == UNBOUNDED_REPEATS)
+  {
+    return (regExp_p->minRepeats > 0) ? regExp_p->minRepeats : 1;
+  }
+  return regExp_p->maxRepeats;
+}
+
+static void add_repeat_copies(NfaS* const nfa_p,
+                              const RegExpS* const regExp_p,
+                              const StartAndEndStateS startAndEnd,
+                              const StartAndEndStateS firstCopy,
+                              const int firstCopyStateIdx)
+{
+  bool isUnbounded = regExp_p->maxRepeats == UNBOUNDED_REPEATS;
+  int numCopies = count_repeat_copies(regExp_p);
+  // Every copy has as many states as the first. The NFAs are only generated once
+  // count_converted_states() found that all copies fit.
+  int numStatesPerCopy = nfa_p->numStates - firstCopyStateIdx;
+  assert(nfa_p->numStates + (numCopies - 1) * numStatesPerCopy < MAX_NUM_NFA_STATES);
+
+  int chainEndIdx = startAndEnd.startIdx;
+  for (int i = 0; i < numCopies; i++)
+  {
+    if (i >= regExp_p->minRepeats)
+    {
+      add_epsilon_transition(nfa_p, chainEndIdx, startAndEnd.endIdx);
+    }
+
+    // The child is converted once, the other copies are copied from the first.
+    StartAndEndStateS copy = firstCopy;
+    if (i > 0)
+    {
+      copy = copy_converted(nfa_p, firstCopyStateIdx, numStatesPerCopy, firstCopy);
+    }
+    add_epsilon_transition(nfa_p, chainEndIdx, copy.startIdx);
+    chainEndIdx = copy.endIdx;
+
+    if (isUnbounded && i == numCopies - 1)
+    {
+      add_epsilon_transition(nfa_p, copy.endIdx, copy.startIdx);
+    }
+  }
+  add_epsilon_transition(nfa_p, chainEndIdx, startAndEnd.endIdx);
+}
+
+static StartAndEndStateS copy_converted(NfaS* const nfa_p,
+                                        const int firstStateIdx,
+                                        const int numStates,
+                                        const StartAndEndStateS startAndEnd)
+{
+  int offset = nfa_p->numStates - firstStateIdx;
+  for (int i = firstStateIdx; i < firstStateIdx + numStates; i++)
+  {
+    int copyIdx = add_new_state(nfa_p);
+    if (i == startAndEnd.endIdx)
+    {
+      continue;
+    }
+
+    const NfaStateS* state_p = &(nfa_p->states[i]);
+    NfaStateS* copy_p = &(nfa_p->states[copyIdx]);
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      if (state_p->transitions[j] != NO_STATE)
+      {
+        assert(state_p->transitions[j] >= firstStateIdx &&
+               state_p->transitions[j] < firstStateIdx + numStates);
+        copy_p->transitions[j] = state_p->transitions[j] + offset;
+      }
+    }
+    for (int j = 0; j < NUM_LARGE_BITSET_WORDS; j++)
+    {
+      BitSetT word = state_p->epsilonTransitions.words[j];
+      while (word != 0)
+      {
+        int nextStateIdx = j * BITSET_SIZE + __builtin_ctzll(word);
+        assert(nextStateIdx >= firstStateIdx && nextStateIdx < firstStateIdx + numStates);
+        add_epsilon_transition(nfa_p, copyIdx, nextStateIdx + offset);
+        word &= word - 1;
+      }
+    }
+  }
+
+  StartAndEndStateS startAndEndOfCopy = {startAndEnd.startIdx + offset,
+                                         startAndEnd.endIdx + offset};
+  return startAndEndOfCopy;
+}
+
+static int count_converted_states(const RegExpS* const regExp_p)
+{
+  long numStates = 0;
+  switch (regExp_p->type)
+  {
+  case REGEXP_SEQUENCE:
+    for (int i = 0; i < regExp_p->numChildren; i++)
+    {
+      numStates += count_converted_states(regExp_p->children[i]);
+    }
+    break;
+  case REGEXP_OPTIONAL:
+  case REGEXP_ONE_OR_MORE:
+  case REGEXP_ZERO_OR_MORE:
+    numStates = 2 + count_converted_states(regExp_p->child_p);
+    break;
+  case REGEXP_OR:
+    numStates = 2 + count_converted_states(regExp_p->left_p) +
+                count_converted_states(regExp_p->right_p);
+    break;
+  case REGEXP_STRING:
+    numStates = 1 + regExp_p->numChars;
+    break;
+  case REGEXP_CHAR_CLASS:
+    numStates = 2;
+    break;
+  case REGEXP_REPEAT:
+    numStates = 2 + (long) count_repeat_copies(regExp_p) *
+                    count_converted_states(regExp_p->child_p);
+    break;
+  case REGEXP_CODE_POINT_SET:
+  {
+    Utf8AutomatonS automaton;
+    build_utf8_automaton(&(regExp_p->codePoints), regExp_p->isReversed, &automaton);
+    numStates = automaton.numStates + 1;
+    free_utf8_automaton(&automaton);
+    break;
+  }
+  default:
+    break;
+  }
+  return (numStates < MAX_NUM_NFA_STATES) ? (int) numStates : MAX_NUM_NFA_STATES;
+}
+
 static int add_new_state(NfaS* const nfa_p)
 {
   int newStateIdx = nfa_p->numStates;
@@ -285,7 +756,7 @@ static int add_new_state(NfaS* const nfa_p)
   assert(nfa_p->numStates < MAX_NUM_NFA_STATES);
 
   NfaStateS* newState_p = &(nfa_p->states[newStateIdx]);
-  newState_p->epsilonTransitions = 0;
+  memset(&(newState_p->epsilonTransitions), 0, sizeof(newState_p->epsilonTransitions));
   newState_p->isEndState = false;
   memset(newState_p->transitions, NO_STATE, sizeof(newState_p->transitions[0]) * NUM_CHARS);
 
@@ -304,7 +775,7 @@ static int add_end_state(NfaS* const nfa_p, const int outputValue)
 static void add_epsilon_transition(NfaS* const nfa_p, const int startIdx, const int endIdx)
 {
   NfaStateS* start_p = &(nfa_p->states[startIdx]);
-  add_to_bitset(&(start_p->epsilonTransitions), endIdx);
+  add_to_large_bitset(&(start_p->epsilonTransitions), endIdx);
 }
 
 static void print_nfa_state(const NfaS* const nfa_p, const int stateIdx)
@@ -350,73 +821,511 @@ static void print_nfa_state(const NfaS* const nfa_p, const int stateIdx)
 
   for (int i = 0; i < nfa_p->numStates; i++)
   {
-    if (is_in_bitset(&(nfaState_p->epsilonTransitions), i))
+    if (is_in_large_bitset(&(nfaState_p->epsilonTransitions), i))
     {
       printf(" *Transition eps -> Q%d\n", i);
     }
   }
 }
 
-/*> Global Function Definitions *******************************************************************/
-BitSetT epsilon_closure(const NfaS* const nfa_p, const int stateIdx)
+static void eliminate_epsilon_transitions(NfaS* const nfa_p)
 {
-  const NfaStateS* currState_p = &(nfa_p->states[stateIdx]);
-  BitSetT statesInEpslionClosure = currState_p->epsilonTransitions;
-  add_to_bitset(&statesInEpslionClosure, stateIdx);
+  LargeBitSetS* closures_p = malloc(sizeof(LargeBitSetS) * nfa_p->numStates);
+  LargeBitSetS keptStates = { .words = {0} };
+  assert(closures_p != NULL);
+
+  add_to_large_bitset(&keptStates, 0);
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    const NfaStateS* state_p = &(nfa_p->states[i]);
+    closures_p[i] = epsilon_closure(nfa_p, i);
+    if (state_p->isEndState)
+    {
+      add_to_large_bitset(&keptStates, i);
+    }
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      if (state_p->transitions[j] != NO_STATE)
+      {
+        add_to_large_bitset(&keptStates, i);
+        add_to_large_bitset(&keptStates, state_p->transitions[j]);
+      }
+    }
+  }
+
+  // The other states have neither transitions on chars nor an output, so leaving them out of the
+  // closures does not change which chars the closures continue on or what they match.
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    LargeBitSetS* epsilonTransitions_p = &(nfa_p->states[i].epsilonTransitions);
+    for (int j = 0; j < NUM_LARGE_BITSET_WORDS; j++)
+    {
+      epsilonTransitions_p->words[j] = is_in_large_bitset(&keptStates, i) ?
+                                       closures_p[i].words[j] & keptStates.words[j] :
+                                       0;
+    }
+    epsilonTransitions_p->words[i / BITSET_SIZE] &= ~((BitSetT) 1 << (i % BITSET_SIZE));
+  }
+  free(closures_p);
+
+  // E.g. the end of a String followed by another part of a Sequence.
+  int replacements[MAX_NUM_NFA_STATES];
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    const NfaStateS* state_p = &(nfa_p->states[i]);
+    replacements[i] = i;
+    int numNextStates = 0;
+    int nextStateIdx = NO_STATE;
+    for (int j = 0; j < NUM_LARGE_BITSET_WORDS; j++)
+    {
+      BitSetT word = state_p->epsilonTransitions.words[j];
+      numNextStates += __builtin_popcountll(word);
+      if (word != 0)
+      {
+        nextStateIdx = j * BITSET_SIZE + __builtin_ctzll(word);
+      }
+    }
 
-  bool hasChanged;
-  do
+    bool hasCharTransitions = false;
+    for (int j = 0; j < NUM_CHARS && !hasCharTransitions; j++)
+    {
+      hasCharTransitions = state_p->transitions[j] != NO_STATE;
+    }
+    if (i != 0 && !state_p->isEndState && !hasCharTransitions && numNextStates == 1)
+    {
+      replacements[i] = nextStateIdx;
+    }
+  }
+  // Follow chains of replacements; a cycle of them cannot reach an end state and is left alone.
+  for (int i = 0; i < nfa_p->numStates; i++)
   {
-    hasChanged = false;
+    int replacement = i;
+    int numSteps = 0;
+    while (replacements[replacement] != replacement && numSteps < nfa_p->numStates)
+    {
+      replacement = replacements[replacement];
+      numSteps++;
+    }
+    replacements[i] = (numSteps < nfa_p->numStates) ? replacement : i;
+  }
 
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    NfaStateS* state_p = &(nfa_p->states[i]);
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      if (state_p->transitions[j] != NO_STATE)
+      {
+        state_p->transitions[j] = replacements[state_p->transitions[j]];
+      }
+    }
+
+    LargeBitSetS nextStates = { .words = {0} };
+    for (int j = 0; j < NUM_LARGE_BITSET_WORDS; j++)
+    {
+      BitSetT word = state_p->epsilonTransitions.words[j];
+      while (word != 0)
+      {
+        add_to_large_bitset(&nextStates, replacements[j * BITSET_SIZE + __builtin_ctzll(word)]);
+        word &= word - 1;
+      }
+    }
+    state_p->epsilonTransitions = nextStates;
+  }
+}
+
+static void find_useful_states(const NfaS* const nfa_p, LargeBitSetS* const usefulStates_p)
+{
+  LargeBitSetS* nextStates_p = malloc(sizeof(LargeBitSetS) * nfa_p->numStates);
+  LargeBitSetS reachableStates = { .words = {0} };
+  LargeBitSetS liveStates = { .words = {0} };
+  int statesToVisit[MAX_NUM_NFA_STATES];
+  int numStatesToVisit = 0;
+  assert(nextStates_p != NULL);
+
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    const NfaStateS* state_p = &(nfa_p->states[i]);
+    nextStates_p[i] = state_p->epsilonTransitions;
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      if (state_p->transitions[j] != NO_STATE)
+      {
+        add_to_large_bitset(&(nextStates_p[i]), state_p->transitions[j]);
+      }
+    }
+  }
+
+  add_to_large_bitset(&reachableStates, 0);
+  statesToVisit[numStatesToVisit++] = 0;
+  while (numStatesToVisit > 0)
+  {
+    const LargeBitSetS* next_p = &(nextStates_p[statesToVisit[--numStatesToVisit]]);
+    for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+    {
+      BitSetT newStates = next_p->words[i] & ~reachableStates.words[i];
+      reachableStates.words[i] |= newStates;
+      while (newStates != 0)
+      {
+        statesToVisit[numStatesToVisit++] = i * BITSET_SIZE + __builtin_ctzll(newStates);
+        newStates &= newStates - 1;
+      }
+    }
+  }
+
+  // Walk the transitions backwards from the end states.
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    if (nfa_p->states[i].isEndState)
+    {
+      add_to_large_bitset(&liveStates, i);
+      statesToVisit[numStatesToVisit++] = i;
+    }
+  }
+  while (numStatesToVisit > 0)
+  {
+    int stateIdx = statesToVisit[--numStatesToVisit];
     for (int i = 0; i < nfa_p->numStates; i++)
     {
-      if (is_in_bitset(&(statesInEpslionClosure), i))
+      if (!is_in_large_bitset(&liveStates, i) && is_in_large_bitset(&(nextStates_p[i]), stateIdx))
       {
-        const NfaStateS* stateInClosure_p = &(nfa_p->states[i]);
-        BitSetT newStatesInClosure = statesInEpslionClosure | stateInClosure_p->epsilonTransitions;
-        if (newStatesInClosure != statesInEpslionClosure)
-        {
-          hasChanged = true;
-        }
-        statesInEpslionClosure = newStatesInClosure;
+        add_to_large_bitset(&liveStates, i);
+        statesToVisit[numStatesToVisit++] = i;
+      }
+    }
+  }
+  free(nextStates_p);
+
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    usefulStates_p->words[i] = reachableStates.words[i] & liveStates.words[i];
+  }
+  add_to_large_bitset(usefulStates_p, 0);
+}
+
+static void get_epsilon_blocks(const NfaS* const nfa_p,
+                               const LargeBitSetS* const usefulStates_p,
+                               const int* const blocks_p,
+                               const int stateIdx,
+                               LargeBitSetS* const epsilonBlocks_p)
+{
+  const LargeBitSetS* epsilonTransitions_p = &(nfa_p->states[stateIdx].epsilonTransitions);
+  memset(epsilonBlocks_p, 0, sizeof(*epsilonBlocks_p));
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    BitSetT word = epsilonTransitions_p->words[i] & usefulStates_p->words[i];
+    while (word != 0)
+    {
+      add_to_large_bitset(epsilonBlocks_p, blocks_p[i * BITSET_SIZE + __builtin_ctzll(word)]);
+      word &= word - 1;
+    }
+  }
+}
+
+static int block_of_transition(const LargeBitSetS* const usefulStates_p,
+                               const int* const blocks_p,
+                               const int transition)
+{
+  if (transition == NO_STATE || !is_in_large_bitset(usefulStates_p, transition))
+  {
+    return NO_BLOCK;
+  }
+  return blocks_p[transition];
+}
+
+static uint32_t hash_state_in_blocks(const NfaS* const nfa_p,
+                                     const LargeBitSetS* const usefulStates_p,
+                                     const int* const blocks_p,
+                                     const int stateIdx)
+{
+  const NfaStateS* state_p = &(nfa_p->states[stateIdx]);
+  LargeBitSetS epsilonBlocks;
+  get_epsilon_blocks(nfa_p, usefulStates_p, blocks_p, stateIdx, &epsilonBlocks);
+
+  // FNV-1a over the blocks.
+  uint32_t hash = 2166136261u;
+  hash = (hash ^ (uint32_t) blocks_p[stateIdx]) * 16777619u;
+  hash = (hash ^ (uint32_t) (state_p->isEndState ? state_p->outputValue : NO_BLOCK)) * 16777619u;
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    int block = block_of_transition(usefulStates_p, blocks_p, state_p->transitions[i]);
+    hash = (hash ^ (uint32_t) block) * 16777619u;
+  }
+  for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+  {
+    hash = (hash ^ (uint32_t) (epsilonBlocks.words[i] ^ (epsilonBlocks.words[i] >> 32))) *
+           16777619u;
+  }
+  return hash;
+}
+
+static bool states_are_equal_in_blocks(const NfaS* const nfa_p,
+                                       const LargeBitSetS* const usefulStates_p,
+                                       const int* const blocks_p,
+                                       const int stateIdx1,
+                                       const int stateIdx2)
+{
+  const NfaStateS* state1_p = &(nfa_p->states[stateIdx1]);
+  const NfaStateS* state2_p = &(nfa_p->states[stateIdx2]);
+  if (blocks_p[stateIdx1] != blocks_p[stateIdx2] ||
+      state1_p->isEndState != state2_p->isEndState ||
+      (state1_p->isEndState && state1_p->outputValue != state2_p->outputValue))
+  {
+    return false;
+  }
+
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    if (block_of_transition(usefulStates_p, blocks_p, state1_p->transitions[i]) !=
+        block_of_transition(usefulStates_p, blocks_p, state2_p->transitions[i]))
+    {
+      return false;
+    }
+  }
+
+  LargeBitSetS epsilonBlocks1;
+  LargeBitSetS epsilonBlocks2;
+  get_epsilon_blocks(nfa_p, usefulStates_p, blocks_p, stateIdx1, &epsilonBlocks1);
+  get_epsilon_blocks(nfa_p, usefulStates_p, blocks_p, stateIdx2, &epsilonBlocks2);
+  return large_bitsets_are_equal(&epsilonBlocks1, &epsilonBlocks2);
+}
+
+static void find_bisimilar_states(const NfaS* const nfa_p,
+                                  const LargeBitSetS* const usefulStates_p,
+                                  int* const blocks_p)
+{
+  int newBlocks[MAX_NUM_NFA_STATES];
+  int stateTable[STATE_TABLE_SIZE];
+  int numBlocks = 1;
+
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    blocks_p[i] = 0;
+  }
+
+  // Each round splits the blocks by what their states do in terms of the blocks of the last
+  // round, until no block is split.
+  for (;;)
+  {
+    int numNewBlocks = 0;
+    memset(stateTable, NO_BLOCK, sizeof(stateTable));
+    for (int i = 0; i < nfa_p->numStates; i++)
+    {
+      if (!is_in_large_bitset(usefulStates_p, i))
+      {
+        continue;
+      }
+
+      uint32_t tableIdx = hash_state_in_blocks(nfa_p, usefulStates_p, blocks_p, i) %
+                          STATE_TABLE_SIZE;
+      while (stateTable[tableIdx] != NO_BLOCK &&
+             !states_are_equal_in_blocks(nfa_p, usefulStates_p, blocks_p, stateTable[tableIdx], i))
+      {
+        tableIdx = (tableIdx + 1) % STATE_TABLE_SIZE;
+      }
+      if (stateTable[tableIdx] == NO_BLOCK)
+      {
+        stateTable[tableIdx] = i;
+        newBlocks[i] = numNewBlocks++;
+      }
+      else
+      {
+        newBlocks[i] = newBlocks[stateTable[tableIdx]];
       }
     }
 
-  } while (hasChanged);
+    bool isStable = numNewBlocks == numBlocks;
+    memcpy(blocks_p, newBlocks, sizeof(int) * nfa_p->numStates);
+    numBlocks = numNewBlocks;
+    if (isStable)
+    {
+      break;
+    }
+  }
+}
+
+static NfaS* shrink_nfa(NfaS* const nfa_p)
+{
+  NfaS* shrunkNfa_p = realloc(nfa_p, offsetof(NfaS, states) + sizeof(NfaStateS) * nfa_p->numStates);
+  assert(shrunkNfa_p != NULL);
+  return shrunkNfa_p;
+}
+
+/*> Global Function Definitions *******************************************************************/
+LargeBitSetS epsilon_closure(const NfaS* const nfa_p, const int stateIdx)
+{
+  LargeBitSetS statesInEpslionClosure = { .words = {0} };
+  add_to_large_bitset(&statesInEpslionClosure, stateIdx);
+
+  // Every state is pushed once, when it is added to the closure.
+  int statesToVisit[MAX_NUM_NFA_STATES];
+  int numStatesToVisit = 0;
+  statesToVisit[numStatesToVisit++] = stateIdx;
+  while (numStatesToVisit > 0)
+  {
+    const NfaStateS* stateInClosure_p = &(nfa_p->states[statesToVisit[--numStatesToVisit]]);
+    for (int i = 0; i < NUM_LARGE_BITSET_WORDS; i++)
+    {
+      BitSetT newStates = stateInClosure_p->epsilonTransitions.words[i] &
+                          ~statesInEpslionClosure.words[i];
+      statesInEpslionClosure.words[i] |= newStates;
+      while (newStates != 0)
+      {
+        statesToVisit[numStatesToVisit++] = i * BITSET_SIZE + __builtin_ctzll(newStates);
+        newStates &= newStates - 1;
+      }
+    }
+  }
 
   return statesInEpslionClosure;
 }
 
+void reduce_nfa(NfaS* const nfa_p)
+{
+  LargeBitSetS usefulStates;
+  int blocks[MAX_NUM_NFA_STATES];
+  int newStateIdxOfBlock[MAX_NUM_NFA_STATES];
+  int firstStateOfNewState[MAX_NUM_NFA_STATES];
+  int numNewStates = 0;
+
+  eliminate_epsilon_transitions(nfa_p);
+  find_useful_states(nfa_p, &usefulStates);
+  find_bisimilar_states(nfa_p, &usefulStates, blocks);
+
+  // Numbering the blocks in order of their first state keeps state 0 first.
+  memset(newStateIdxOfBlock, NO_BLOCK, sizeof(newStateIdxOfBlock));
+  for (int i = 0; i < nfa_p->numStates; i++)
+  {
+    if (is_in_large_bitset(&usefulStates, i) && newStateIdxOfBlock[blocks[i]] == NO_BLOCK)
+    {
+      newStateIdxOfBlock[blocks[i]] = numNewStates;
+      firstStateOfNewState[numNewStates] = i;
+      numNewStates++;
+    }
+  }
+
+  // A new state is never after the first state of its block, so that state is not overwritten yet.
+  for (int i = 0; i < numNewStates; i++)
+  {
+    NfaStateS state = nfa_p->states[firstStateOfNewState[i]];
+    for (int j = 0; j < NUM_CHARS; j++)
+    {
+      int block = block_of_transition(&usefulStates, blocks, state.transitions[j]);
+      state.transitions[j] = (block == NO_BLOCK) ? (int) NO_STATE : newStateIdxOfBlock[block];
+    }
+
+    LargeBitSetS epsilonBlocks;
+    get_epsilon_blocks(nfa_p, &usefulStates, blocks, firstStateOfNewState[i], &epsilonBlocks);
+    memset(&(state.epsilonTransitions), 0, sizeof(state.epsilonTransitions));
+    for (int j = 0; j < NUM_LARGE_BITSET_WORDS; j++)
+    {
+      BitSetT word = epsilonBlocks.words[j];
+      while (word != 0)
+      {
+        int nextStateIdx = newStateIdxOfBlock[j * BITSET_SIZE + __builtin_ctzll(word)];
+        if (nextStateIdx != i)
+        {
+          add_to_large_bitset(&(state.epsilonTransitions), nextStateIdx);
+        }
+        word &= word - 1;
+      }
+    }
+    nfa_p->states[i] = state;
+  }
+  nfa_p->numStates = numNewStates;
+}
+
 NfaS* generate_combined_nfa(RegExpS** const regExps_pp, const int numRegExps)
 {
+  if (count_combined_nfa_states(regExps_pp, numRegExps) >= MAX_NUM_NFA_STATES)
+  {
+    return NULL;
+  }
+
   NfaS* nfa_p = malloc(sizeof(*nfa_p));
   memset(nfa_p, 0, sizeof(*nfa_p));
 
+  ConvertedRegExpArrayS converted = { .regExps_p = NULL, .numRegExps = 0, .maxNumRegExps = 0 };
   int startIdx = add_new_state(nfa_p);
   for (int i = 0; i < numRegExps; i++)
   {
     int regExpStartIdx = add_new_state(nfa_p);
     int endIdx = add_end_state(nfa_p, i);
-    StartAndEndStateS startAndEndOfConverted = convert(nfa_p, regExps_pp[i]);
+    StartAndEndStateS startAndEndOfConverted = convert(nfa_p, regExps_pp[i], &converted);
     add_epsilon_transition(nfa_p, startIdx, regExpStartIdx);
     add_epsilon_transition(nfa_p, regExpStartIdx, startAndEndOfConverted.startIdx);
     add_epsilon_transition(nfa_p, startAndEndOfConverted.endIdx, endIdx);
   }
+  free(converted.regExps_p);
+
+  reduce_nfa(nfa_p);
+  return shrink_nfa(nfa_p);
+}
+
+NfaS* generate_unanchored_combined_nfa(RegExpS** const regExps_pp, const int numRegExps)
+{
+  NfaS* nfa_p = generate_combined_nfa(regExps_pp, numRegExps);
+  if (nfa_p == NULL)
+  {
+    return NULL;
+  }
+
+  NfaStateS* startState_p = &(nfa_p->states[0]);
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    startState_p->transitions[i] = 0;
+  }
 
   return nfa_p;
 }
 
+int count_combined_nfa_states(RegExpS** const regExps_pp, const int numRegExps)
+{
+  // The start state, and a start and an end state per RegExp.
+  long numStates = 1;
+  for (int i = 0; i < numRegExps && numStates < MAX_NUM_NFA_STATES; i++)
+  {
+    numStates += 2 + count_converted_states(regExps_pp[i]);
+  }
+  return (numStates < MAX_NUM_NFA_STATES) ? (int) numStates : MAX_NUM_NFA_STATES;
+}
+
 NfaS* generate_nfa(const RegExpS* const regExp_p, const int outputValue)
 {
+  // The start and end state, and the states of the RegExp.
+  if (2 + count_converted_states(regExp_p) >= MAX_NUM_NFA_STATES)
+  {
+    return NULL;
+  }
+
   NfaS* nfa_p = malloc(sizeof(*nfa_p));
   nfa_p->numStates = 0;
 
+  ConvertedRegExpArrayS converted = { .regExps_p = NULL, .numRegExps = 0, .maxNumRegExps = 0 };
   int startIdx = add_new_state(nfa_p);
   int endIdx = add_end_state(nfa_p, outputValue);
-  StartAndEndStateS startAndEndOfConverted = convert(nfa_p, regExp_p);
+  StartAndEndStateS startAndEndOfConverted = convert(nfa_p, regExp_p, &converted);
   add_epsilon_transition(nfa_p, startIdx, startAndEndOfConverted.startIdx);
   add_epsilon_transition(nfa_p, startAndEndOfConverted.endIdx, endIdx);
+  free(converted.regExps_p);
+
+  reduce_nfa(nfa_p);
+  return shrink_nfa(nfa_p);
+}
+
+NfaS* generate_unanchored_nfa(const RegExpS* const regExp_p, const int outputValue)
+{
+  NfaS* nfa_p = generate_nfa(regExp_p, outputValue);
+  if (nfa_p == NULL)
+  {
+    return NULL;
+  }
+
+  NfaStateS* startState_p = &(nfa_p->states[0]);
+  for (int i = 0; i < NUM_CHARS; i++)
+  {
+    startState_p->transitions[i] = 0;
+  }
 
   return nfa_p;
 }
@@ -16,7 +16,7 @@
 #include "reg_exp.h"
 
 /*> Defines ***************************************************************************************/
-#define MAX_NUM_NFA_STATES            64
+#define MAX_NUM_NFA_STATES            LARGE_BITSET_SIZE
 #define NO_STATE                      UINT_MAX
 #define NUM_CHARS                     256
 
@@ -35,7 +35,7 @@ typedef struct NfaStateS
   bool isEndState;
   int outputValue;
   int transitions[NUM_CHARS];
-  BitSetT epsilonTransitions;
+  LargeBitSetS epsilonTransitions;
 } NfaStateS;
 
 /**
@@ -60,24 +60,63 @@ typedef struct NfaS
  * @param[in]  stateIdx  The index of the state.
  * @return Bit set containing the states in the epsilon closure.
  */
-BitSetT epsilon_closure(const NfaS* const nfa_p, const int stateIdx);
+LargeBitSetS epsilon_closure(const NfaS* const nfa_p, const int stateIdx);
 
 /**
- * @brief Generates a combined NFA based on an array of RegExps.
+ * @brief Shrinks an NFA without changing what its end states match. Epsilon transitions are
+ *        replaced by direct ones to the states with transitions on chars, which removes the states
+ *        that only pass epsilon transitions on; states that are unreachable or cannot reach an end
+ *        state are deleted, and bisimilar states are merged. State 0 stays the start state.
+ * @param[in/out]  nfa_p  The NFA.
+ */
+void reduce_nfa(NfaS* const nfa_p);
+
+/**
+ * @brief Generates a combined NFA based on an array of RegExps. The NFA is reduced and only has
+ *        room for its states.
  * @param[in]  regExps_pp   The input RegExps.
  * @param[in]  numRegExps   The number of RegExps.
- * @return Pointer to allocated NFA.
+ * @return Pointer to allocated NFA, NULL if it would have MAX_NUM_NFA_STATES states or more before
+ *         it is reduced.
  */
 NfaS* generate_combined_nfa(RegExpS** const regExps_pp, const int numRegExps);
 
 /**
- * @brief Converts the input RegExp to an NFA.
+ * @brief Generates a combined NFA like generate_combined_nfa() that matches the RegExps anywhere in
+ *        the input, by letting its start state loop on every char.
+ * @param[in]  regExps_pp   The input RegExps.
+ * @param[in]  numRegExps   The number of RegExps.
+ * @return Pointer to allocated NFA, NULL if generate_combined_nfa() returns NULL.
+ */
+NfaS* generate_unanchored_combined_nfa(RegExpS** const regExps_pp, const int numRegExps);
+
+/**
+ * @brief Counts the states generate_combined_nfa() adds for an array of RegExps before reducing the
+ *        NFA, so that it can be checked against MAX_NUM_NFA_STATES first.
+ * @param[in]  regExps_pp   The input RegExps.
+ * @param[in]  numRegExps   The number of RegExps.
+ * @return The number of states, or MAX_NUM_NFA_STATES if there are at least that many.
+ */
+int count_combined_nfa_states(RegExpS** const regExps_pp, const int numRegExps);
+
+/**
+ * @brief Converts the input RegExp to an NFA. The NFA is reduced and only has room for its states.
  * @param[in]  regExp_p     The input RegExp.
  * @param[in]  outputValue  The value returned once the NFA reaches its end state.
- * @return Pointer to allocated NFA.
+ * @return Pointer to allocated NFA, NULL if it would have MAX_NUM_NFA_STATES states or more before
+ *         it is reduced.
  */
 NfaS* generate_nfa(const RegExpS* const regExp_p, const int outputValue);
 
+/**
+ * @brief Converts the input RegExp to an NFA that matches the RegExp anywhere in the input, by
+ *        letting its start state loop on every char (like the RegExp ".*" in front of it).
+ * @param[in]  regExp_p     The input RegExp.
+ * @param[in]  outputValue  The value returned once the NFA reaches its end state.
+ * @return Pointer to allocated NFA, NULL if generate_nfa() returns NULL.
+ */
+NfaS* generate_unanchored_nfa(const RegExpS* const regExp_p, const int outputValue);
+
 /**
  * @brief Prints the NFA with all its states and transitions.
  * @param[in]  nfa_p  The NFA to print.
@@ -0,0 +1,325 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Compact in-memory storage of read tokens.
+* @file packed_tokens.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer_generator.h"
+#include "packed_tokens.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_ROWS (PACKED_TOKENS_BLOCK_SIZE / PACKED_TOKENS_NUM_LANES)
+#define INITIAL_MAX_NUM_BLOCKS 16
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Calculates the number of bits needed to store all values.
+ * @param[in]  values  The values.
+ * @return The bit width.
+ */
+static int get_bit_width(const uint32_t values[PACKED_TOKENS_BLOCK_SIZE]);
+
+/**
+ * @brief Packs a block of values with the provided bit width. Uses
+ *        bitWidth * PACKED_TOKENS_NUM_LANES words.
+ * @param[in]   values    The values.
+ * @param[in]   bitWidth  The bit width.
+ * @param[out]  words_p   The words to pack the values into.
+ */
+static void pack_values(const uint32_t values[PACKED_TOKENS_BLOCK_SIZE],
+                        const int bitWidth,
+                        uint32_t* const words_p);
+
+/**
+ * @brief Unpacks a block of values packed by pack_values().
+ * @param[in]   words_p   The packed words.
+ * @param[in]   bitWidth  The bit width.
+ * @param[out]  values    The values.
+ */
+static void unpack_values(const uint32_t* const words_p,
+                          const int bitWidth,
+                          uint32_t values[PACKED_TOKENS_BLOCK_SIZE]);
+
+/**
+ * @brief Packs the tail tokens into a new block.
+ * @param[in/out]  packedTokens_p  The packed tokens.
+ */
+static void pack_tail_tokens(PackedTokensS* const packedTokens_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int get_bit_width(const uint32_t values[PACKED_TOKENS_BLOCK_SIZE])
+{
+  uint32_t allBits = 0;
+  for (int i = 0; i < PACKED_TOKENS_BLOCK_SIZE; i++)
+  {
+    allBits |= values[i];
+  }
+
+  int bitWidth = 0;
+  while (bitWidth < 32 && (allBits >> bitWidth) != 0)
+  {
+    bitWidth++;
+  }
+  return bitWidth;
+}
+
+static void pack_values(const uint32_t values[PACKED_TOKENS_BLOCK_SIZE],
+                        const int bitWidth,
+                        uint32_t* const words_p)
+{
+  memset(words_p, 0, sizeof(uint32_t) * bitWidth * PACKED_TOKENS_NUM_LANES);
+  if (bitWidth == 0)
+  {
+    return;
+  }
+
+  // Row r holds values [r * NUM_LANES, (r + 1) * NUM_LANES), one per lane, so the inner loop works
+  // on NUM_LANES independent words at the same bit position.
+  for (int row = 0; row < NUM_ROWS; row++)
+  {
+    int bitIdx = row * bitWidth;
+    int wordIdx = (bitIdx / 32) * PACKED_TOKENS_NUM_LANES;
+    int shift = bitIdx % 32;
+    const uint32_t* rowValues_p = &(values[row * PACKED_TOKENS_NUM_LANES]);
+
+    for (int lane = 0; lane < PACKED_TOKENS_NUM_LANES; lane++)
+    {
+      words_p[wordIdx + lane] |= rowValues_p[lane] << shift;
+    }
+    if (shift + bitWidth > 32)
+    {
+      for (int lane = 0; lane < PACKED_TOKENS_NUM_LANES; lane++)
+      {
+        words_p[wordIdx + PACKED_TOKENS_NUM_LANES + lane] |= rowValues_p[lane] >> (32 - shift);
+      }
+    }
+  }
+}
+
+static void unpack_values(const uint32_t* const words_p,
+                          const int bitWidth,
+                          uint32_t values[PACKED_TOKENS_BLOCK_SIZE])
+{
+  if (bitWidth == 0)
+  {
+    memset(values, 0, sizeof(uint32_t) * PACKED_TOKENS_BLOCK_SIZE);
+    return;
+  }
+
+  const uint32_t mask = (bitWidth == 32) ? UINT32_MAX : (((uint32_t) 1 << bitWidth) - 1);
+  for (int row = 0; row < NUM_ROWS; row++)
+  {
+    int bitIdx = row * bitWidth;
+    int wordIdx = (bitIdx / 32) * PACKED_TOKENS_NUM_LANES;
+    int shift = bitIdx % 32;
+    uint32_t* rowValues_p = &(values[row * PACKED_TOKENS_NUM_LANES]);
+
+    for (int lane = 0; lane < PACKED_TOKENS_NUM_LANES; lane++)
+    {
+      rowValues_p[lane] = words_p[wordIdx + lane] >> shift;
+    }
+    if (shift + bitWidth > 32)
+    {
+      for (int lane = 0; lane < PACKED_TOKENS_NUM_LANES; lane++)
+      {
+        rowValues_p[lane] |= words_p[wordIdx + PACKED_TOKENS_NUM_LANES + lane] << (32 - shift);
+      }
+    }
+    for (int lane = 0; lane < PACKED_TOKENS_NUM_LANES; lane++)
+    {
+      rowValues_p[lane] &= mask;
+    }
+  }
+}
+
+static void pack_tail_tokens(PackedTokensS* const packedTokens_p)
+{
+  uint32_t types[PACKED_TOKENS_BLOCK_SIZE];
+  uint32_t distances[PACKED_TOKENS_BLOCK_SIZE];
+  uint32_t lengths[PACKED_TOKENS_BLOCK_SIZE];
+  const TokenS* tokens_p = packedTokens_p->tailTokens;
+
+  size_t prevEndIdx = tokens_p[0].startIdx;
+  for (int i = 0; i < PACKED_TOKENS_BLOCK_SIZE; i++)
+  {
+    types[i] = tokens_p[i].type + 1;
+    distances[i] = tokens_p[i].startIdx - prevEndIdx;
+    lengths[i] = tokens_p[i].length;
+    prevEndIdx = tokens_p[i].startIdx + tokens_p[i].length;
+  }
+
+  if (packedTokens_p->numBlocks == packedTokens_p->maxNumBlocks)
+  {
+    packedTokens_p->maxNumBlocks = packedTokens_p->maxNumBlocks > 0 ?
+                                   2 * packedTokens_p->maxNumBlocks :
+                                   INITIAL_MAX_NUM_BLOCKS;
+    packedTokens_p->blocks_p = realloc(packedTokens_p->blocks_p,
+                                       sizeof(PackedTokenBlockS) * packedTokens_p->maxNumBlocks);
+    assert(packedTokens_p->blocks_p != NULL);
+  }
+
+  PackedTokenBlockS* block_p = &(packedTokens_p->blocks_p[packedTokens_p->numBlocks]);
+  block_p->firstStartIdx = tokens_p[0].startIdx;
+  block_p->wordIdx = packedTokens_p->numWords;
+  block_p->typeBits = get_bit_width(types);
+  block_p->distanceBits = get_bit_width(distances);
+  block_p->lengthBits = get_bit_width(lengths);
+  assert(packedTokens_p->numWords <= UINT32_MAX);
+
+  size_t numBlockWords = (size_t) PACKED_TOKENS_NUM_LANES *
+                         (block_p->typeBits + block_p->distanceBits + block_p->lengthBits);
+  if (packedTokens_p->numWords + numBlockWords > packedTokens_p->maxNumWords)
+  {
+    packedTokens_p->maxNumWords = 2 * (packedTokens_p->numWords + numBlockWords);
+    packedTokens_p->words_p = realloc(packedTokens_p->words_p,
+                                      sizeof(uint32_t) * packedTokens_p->maxNumWords);
+    assert(packedTokens_p->words_p != NULL);
+  }
+
+  uint32_t* words_p = &(packedTokens_p->words_p[packedTokens_p->numWords]);
+  pack_values(types, block_p->typeBits, words_p);
+  words_p += PACKED_TOKENS_NUM_LANES * block_p->typeBits;
+  pack_values(distances, block_p->distanceBits, words_p);
+  words_p += PACKED_TOKENS_NUM_LANES * block_p->distanceBits;
+  pack_values(lengths, block_p->lengthBits, words_p);
+
+  packedTokens_p->numWords += numBlockWords;
+  packedTokens_p->numBlocks++;
+  packedTokens_p->numTailTokens = 0;
+}
+
+/*> Global Function Definitions *******************************************************************/
+void init_packed_tokens(PackedTokensS* const packedTokens_p)
+{
+  memset(packedTokens_p, 0, sizeof(*packedTokens_p));
+}
+
+void add_packed_token(PackedTokensS* const packedTokens_p, const TokenS* const token_p)
+{
+  assert(token_p->type + 1 >= 0);
+  assert(token_p->length <= UINT32_MAX);
+  if (packedTokens_p->numTailTokens > 0)
+  {
+    const TokenS* prevToken_p = &(packedTokens_p->tailTokens[packedTokens_p->numTailTokens - 1]);
+    assert(token_p->startIdx >= prevToken_p->startIdx + prevToken_p->length);
+    assert(token_p->startIdx - (prevToken_p->startIdx + prevToken_p->length) <= UINT32_MAX);
+  }
+
+  packedTokens_p->tailTokens[packedTokens_p->numTailTokens] = *token_p;
+  packedTokens_p->numTailTokens++;
+  packedTokens_p->numTokens++;
+
+  if (packedTokens_p->numTailTokens == PACKED_TOKENS_BLOCK_SIZE)
+  {
+    pack_tail_tokens(packedTokens_p);
+  }
+}
+
+void add_packed_token_array(PackedTokensS* const packedTokens_p,
+                            const TokenArrayS* const tokenArray_p)
+{
+  for (int i = 0; i < tokenArray_p->numTokens; i++)
+  {
+    add_packed_token(packedTokens_p, &(tokenArray_p->tokens_p[i]));
+  }
+}
+
+int unpack_tokens_block(const PackedTokensS* const packedTokens_p,
+                        const int blockIdx,
+                        TokenS tokens[PACKED_TOKENS_BLOCK_SIZE])
+{
+  assert(blockIdx >= 0 && blockIdx <= packedTokens_p->numBlocks);
+  if (blockIdx == packedTokens_p->numBlocks)
+  {
+    memcpy(tokens, packedTokens_p->tailTokens, sizeof(TokenS) * packedTokens_p->numTailTokens);
+    for (int i = 0; i < packedTokens_p->numTailTokens; i++)
+    {
+      tokens[i].startState = 0;
+      tokens[i].numCharsExamined = tokens[i].length + 1;
+    }
+    return packedTokens_p->numTailTokens;
+  }
+
+  uint32_t types[PACKED_TOKENS_BLOCK_SIZE];
+  uint32_t distances[PACKED_TOKENS_BLOCK_SIZE];
+  uint32_t lengths[PACKED_TOKENS_BLOCK_SIZE];
+  const PackedTokenBlockS* block_p = &(packedTokens_p->blocks_p[blockIdx]);
+  const uint32_t* words_p = &(packedTokens_p->words_p[block_p->wordIdx]);
+
+  unpack_values(words_p, block_p->typeBits, types);
+  words_p += PACKED_TOKENS_NUM_LANES * block_p->typeBits;
+  unpack_values(words_p, block_p->distanceBits, distances);
+  words_p += PACKED_TOKENS_NUM_LANES * block_p->distanceBits;
+  unpack_values(words_p, block_p->lengthBits, lengths);
+
+  size_t prevEndIdx = block_p->firstStartIdx;
+  for (int i = 0; i < PACKED_TOKENS_BLOCK_SIZE; i++)
+  {
+    tokens[i].type = (int) types[i] - 1;
+    tokens[i].startIdx = prevEndIdx + distances[i];
+    tokens[i].length = lengths[i];
+    tokens[i].startState = 0;
+    tokens[i].numCharsExamined = lengths[i] + 1;
+    prevEndIdx = tokens[i].startIdx + lengths[i];
+  }
+  return PACKED_TOKENS_BLOCK_SIZE;
+}
+
+void seek_packed_tokens_block(PackedTokenIteratorS* const iterator_p,
+                              const PackedTokensS* const packedTokens_p,
+                              const int blockIdx)
+{
+  iterator_p->packedTokens_p = packedTokens_p;
+  iterator_p->blockIdx = blockIdx;
+  iterator_p->tokenIdx = 0;
+  iterator_p->numTokens = unpack_tokens_block(packedTokens_p, blockIdx, iterator_p->tokens);
+}
+
+bool next_packed_token(PackedTokenIteratorS* const iterator_p, TokenS* const token_p)
+{
+  if (iterator_p->tokenIdx == iterator_p->numTokens)
+  {
+    if (iterator_p->blockIdx >= iterator_p->packedTokens_p->numBlocks)
+    {
+      return false;
+    }
+    seek_packed_tokens_block(iterator_p, iterator_p->packedTokens_p, iterator_p->blockIdx + 1);
+    if (iterator_p->numTokens == 0)
+    {
+      return false;
+    }
+  }
+
+  *token_p = iterator_p->tokens[iterator_p->tokenIdx];
+  iterator_p->tokenIdx++;
+  return true;
+}
+
+size_t packed_tokens_size(const PackedTokensS* const packedTokens_p)
+{
+  return sizeof(PackedTokenBlockS) * packedTokens_p->numBlocks +
+         sizeof(uint32_t) * packedTokens_p->numWords +
+         sizeof(TokenS) * packedTokens_p->numTailTokens;
+}
+
+void free_packed_tokens(PackedTokensS* const packedTokens_p)
+{
+  free(packedTokens_p->blocks_p);
+  free(packedTokens_p->words_p);
+  init_packed_tokens(packedTokens_p);
+}
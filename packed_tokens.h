@@ -0,0 +1,161 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Compact in-memory storage of read tokens.
+ * @file packed_tokens.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef PACKED_TOKENS_H
+#define PACKED_TOKENS_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+#define PACKED_TOKENS_BLOCK_SIZE 128
+#define PACKED_TOKENS_NUM_LANES  4
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A block of PACKED_TOKENS_BLOCK_SIZE packed tokens.
+ *
+ * The token types (plus one, so that TOKEN_TYPE_ERROR becomes 0), the distances from the end of the
+ * previous token to the start of each token and the token lengths are stored as three bit packed
+ * columns, each using the smallest bit width that fits all its values in the block. Value i of a
+ * column is stored in lane i % PACKED_TOKENS_NUM_LANES, so that a column is packed and unpacked
+ * four values at a time.
+ *
+ * @param firstStartIdx  The start index of the first token of the block.
+ * @param wordIdx        The index of the first word of the block in the word array.
+ * @param typeBits       The bit width of the type column.
+ * @param distanceBits   The bit width of the distance column.
+ * @param lengthBits     The bit width of the length column.
+ */
+typedef struct PackedTokenBlockS
+{
+  uint64_t firstStartIdx;
+  uint32_t wordIdx;
+  uint8_t typeBits;
+  uint8_t distanceBits;
+  uint8_t lengthBits;
+} PackedTokenBlockS;
+
+/**
+ * @brief Tokens packed in blocks. Tokens of the last, incomplete block are kept unpacked until the
+ *        block is full.
+ * @param blocks_p        The full blocks.
+ * @param numBlocks       The number of full blocks.
+ * @param maxNumBlocks    The number of blocks there is room for.
+ * @param words_p         The packed columns of all blocks.
+ * @param numWords        The number of used words.
+ * @param maxNumWords     The number of words there is room for.
+ * @param numTokens       The total number of tokens.
+ * @param tailTokens      The tokens of the incomplete last block.
+ * @param numTailTokens   The number of tokens in the incomplete last block.
+ */
+typedef struct PackedTokensS
+{
+  PackedTokenBlockS* blocks_p;
+  int numBlocks;
+  int maxNumBlocks;
+  uint32_t* words_p;
+  size_t numWords;
+  size_t maxNumWords;
+  int numTokens;
+  TokenS tailTokens[PACKED_TOKENS_BLOCK_SIZE];
+  int numTailTokens;
+} PackedTokensS;
+
+/**
+ * @brief Iterates over packed tokens, unpacking one block at a time.
+ * @param packedTokens_p  The packed tokens.
+ * @param blockIdx        The index of the current block, numBlocks for the tail tokens.
+ * @param numTokens       The number of tokens in the current block.
+ * @param tokenIdx        The index of the next token in the current block.
+ * @param tokens          The unpacked tokens of the current block.
+ */
+typedef struct PackedTokenIteratorS
+{
+  const PackedTokensS* packedTokens_p;
+  int blockIdx;
+  int numTokens;
+  int tokenIdx;
+  TokenS tokens[PACKED_TOKENS_BLOCK_SIZE];
+} PackedTokenIteratorS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Initializes an empty packed token container.
+ * @param[out]  packedTokens_p  The packed tokens.
+ */
+void init_packed_tokens(PackedTokensS* const packedTokens_p);
+
+/**
+ * @brief Appends a token. Only the type, start index and length of the token are stored, and the
+ *        token must not start before the end of the previous token.
+ * @param[in/out]  packedTokens_p  The packed tokens.
+ * @param[in]      token_p         The token.
+ */
+void add_packed_token(PackedTokensS* const packedTokens_p, const TokenS* const token_p);
+
+/**
+ * @brief Appends all tokens of a token array.
+ * @param[in/out]  packedTokens_p  The packed tokens.
+ * @param[in]      tokenArray_p    The token array.
+ */
+void add_packed_token_array(PackedTokensS* const packedTokens_p,
+                            const TokenArrayS* const tokenArray_p);
+
+/**
+ * @brief Unpacks the tokens of a block. The start state of the tokens is set to 0 and the number
+ *        of examined chars to the token length plus one, since they are not stored.
+ * @param[in]   packedTokens_p  The packed tokens.
+ * @param[in]   blockIdx        The index of the block, numBlocks for the tail tokens.
+ * @param[out]  tokens          The unpacked tokens.
+ * @return The number of tokens in the block.
+ */
+int unpack_tokens_block(const PackedTokensS* const packedTokens_p,
+                        const int blockIdx,
+                        TokenS tokens[PACKED_TOKENS_BLOCK_SIZE]);
+
+/**
+ * @brief Places an iterator at the first token of a block.
+ * @param[out]  iterator_p      The iterator.
+ * @param[in]   packedTokens_p  The packed tokens.
+ * @param[in]   blockIdx        The index of the block, numBlocks for the tail tokens.
+ */
+void seek_packed_tokens_block(PackedTokenIteratorS* const iterator_p,
+                              const PackedTokensS* const packedTokens_p,
+                              const int blockIdx);
+
+/**
+ * @brief Reads the next packed token.
+ * @param[in/out]  iterator_p  The iterator.
+ * @param[out]     token_p     The token.
+ * @return true if a token was read, false after the last token.
+ */
+bool next_packed_token(PackedTokenIteratorS* const iterator_p, TokenS* const token_p);
+
+/**
+ * @brief Calculates the memory used by packed tokens.
+ * @param[in]  packedTokens_p  The packed tokens.
+ * @return The number of bytes used by blocks and words, excluding unused capacity.
+ */
+size_t packed_tokens_size(const PackedTokensS* const packedTokens_p);
+
+/**
+ * @brief Frees packed tokens and empties the container.
+ * @param[in/out]  packedTokens_p  The packed tokens.
+ */
+void free_packed_tokens(PackedTokensS* const packedTokens_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -6,6 +6,7 @@
 
 /*> Includes **************************************************************************************/
 #include <assert.h>
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +16,7 @@
 
 /*> Defines ***************************************************************************************/
 #define MAX_NUM_REGEXP_TOKENS 100
+#define INITIAL_MAX_NUM_UNFREED 16
 
 #define PARSING_ERROR(...) {\
   printf("Parsing error for RegExp \"%s\":\n", currRegExpString_p);\
@@ -39,7 +41,11 @@ typedef enum RegExpTokenTypeE
   REGEXP_TOKEN_LEFT_BRACKET = '[',
   REGEXP_TOKEN_RIGHT_BRACKET = ']',
   REGEXP_TOKEN_OR = '|',
+  REGEXP_TOKEN_CARET = '^',
   REGEXP_TOKEN_STRING,
+  REGEXP_TOKEN_CLASS,
+  REGEXP_TOKEN_REPEAT,
+  REGEXP_TOKEN_UNICODE_CLASS,
   REGEXP_TOKEN_END
 } RegExpTokenTypeE;
 
@@ -57,14 +63,20 @@ typedef struct RegExpCharBufferS
 /**
  * @brief A RegExp token.
  * @param type The type of token.
- * @param characters The characters encompassed by this token (only set for strings).
- * @param numChars The number of characters (only set for strings).
+ * @param characters The characters encompassed by this token (only set for strings), the letter
+ *                   of a char class shorthand such as 'd' in "\d", or the letter and name of a
+ *                   Unicode class such as "pL" in "\p{L}".
+ * @param numChars The number of characters (only set for strings and char classes).
+ * @param minRepeats The minimum count of a repetition such as "{2,5}".
+ * @param maxRepeats The maximum count of a repetition, or UNBOUNDED_REPEATS for "{2,}".
  */
 typedef struct RegExpTokenS
 {
   RegExpTokenTypeE type;
   char characters[MAX_REGEXP_STRING_LENGTH];
   int numChars;
+  int minRepeats;
+  int maxRepeats;
 } RegExpTokenS;
 
 /**
@@ -83,14 +95,57 @@ typedef struct RegExpTokenArrayS
  * @param tokenArray_p Pointer to the array of tokens.
  * @param tokenIndex   The index of the current token.
  * @param currToken_p  The current token of the parser.
+ * @param depth        The number of groups the current token is nested in.
  */
 typedef struct RegExpParserS
 {
   RegExpTokenArrayS* tokenArray_p;
   int tokenIndex;
   RegExpTokenS* currToken_p;
+  int depth;
 } RegExpParserS;
 
+/**
+ * @brief The members of a list being parsed. Members that are not ASCII chars encoded in UTF-8 are
+ *        code points, and a list with any of them matches code points instead of chars.
+ * @param charClass_p          The chars of the list.
+ * @param codePoints           The code points of the list above 0x7F.
+ * @param hasNegatedShorthand  True if the list has "\D", "\W" or "\S", which as code points also
+ *                             match everything above 0x7F.
+ */
+typedef struct RegExpListS
+{
+  RegExpS* charClass_p;
+  CodePointSetS codePoints;
+  bool hasNegatedShorthand;
+} RegExpListS;
+
+/**
+ * @brief A char or code point of a list.
+ * @param value        The char or code point.
+ * @param isCodePoint  True if the value was decoded from UTF-8.
+ */
+typedef struct RegExpListCharS
+{
+  uint32_t value;
+  bool isCodePoint;
+} RegExpListCharS;
+
+/**
+ * @brief Literals of a RegExp, used to find its required literal.
+ * @param isExact    True if the RegExp matches exactly one string, which is then the prefix.
+ * @param prefix     A literal every matched string starts with.
+ * @param factor     The best literal every matched string contains.
+ * @param maxLength  The maximum length of a matched string, or UNBOUNDED_LENGTH.
+ */
+typedef struct RegExpLiteralInfoS
+{
+  bool isExact;
+  RegExpLiteralS prefix;
+  RegExpLiteralS factor;
+  int maxLength;
+} RegExpLiteralInfoS;
+
 /*> Global Constant Definitions *******************************************************************/
 static const char* currRegExpString_p;
 
@@ -129,6 +184,81 @@ static void print_regexp_token(const RegExpTokenS* token_p);
  */
 static void add_regexp_token(RegExpTokenArrayS* const tokenArray_p, const RegExpTokenTypeE type);
 
+/**
+ * @brief Adds RegExp char class shorthand token to token array.
+ * @param[in/out] tokenArray_p  Pointer to the array.
+ * @param[in]     letter        The letter of the shorthand, e.g. 'd' for "\d".
+ */
+static void add_regexp_class_token(RegExpTokenArrayS* const tokenArray_p, const char letter);
+
+/**
+ * @brief Checks if a char is the letter of a char class shorthand such as "\d".
+ * @param[in] ch  The char to be checked.
+ * @return true or false.
+ */
+static bool is_char_class_shorthand(const char ch);
+
+/**
+ * @brief Reads a repetition such as "{2}", "{2,5}" or "{2,}" at the start of a string.
+ * @param[in]  string_p      The string.
+ * @param[out] minRepeats_p  The minimum count.
+ * @param[out] maxRepeats_p  The maximum count, UNBOUNDED_REPEATS if there is none.
+ * @return The number of chars of the repetition, 0 if the string does not start with one.
+ */
+static int read_repeat_counts(const char* const string_p,
+                              int* const minRepeats_p,
+                              int* const maxRepeats_p);
+
+/**
+ * @brief Reads a count of a repetition. Counts above MAX_NUM_REPEATS are read as
+ *        MAX_NUM_REPEATS + 1, so that they can be reported without overflowing.
+ * @param[in]  string_p  The string starting with the count.
+ * @param[out] count_p   The count.
+ * @return The number of digits of the count.
+ */
+static int read_repeat_count(const char* const string_p, int* const count_p);
+
+/**
+ * @brief Reads a code point such as "{20AC}", as written after "\u".
+ * @param[in]  string_p     The string starting with '{'.
+ * @param[out] codePoint_p  The code point.
+ * @return The number of chars read.
+ */
+static int read_code_point_escape(const char* const string_p, uint32_t* const codePoint_p);
+
+/**
+ * @brief Reads the name of a Unicode class such as "{Lu}", as written after "\p".
+ * @param[in]  string_p      The string starting with '{'.
+ * @param[out] name_pp       The first char of the name.
+ * @param[out] nameLength_p  The number of chars of the name.
+ * @return The number of chars read.
+ */
+static int read_unicode_class_name(const char* const string_p,
+                                   const char** const name_pp,
+                                   int* const nameLength_p);
+
+/**
+ * @brief Adds RegExp Unicode class token to token array.
+ * @param[in/out] tokenArray_p  Pointer to the array.
+ * @param[in]     letter        'p', or 'P' for the code points not in the class.
+ * @param[in]     name_p        The name of the class.
+ * @param[in]     nameLength    The number of chars of the name.
+ */
+static void add_regexp_unicode_class_token(RegExpTokenArrayS* const tokenArray_p,
+                                           const char letter,
+                                           const char* const name_p,
+                                           const int nameLength);
+
+/**
+ * @brief Adds RegExp repetition token to token array.
+ * @param[in/out] tokenArray_p  Pointer to the array.
+ * @param[in]     minRepeats    The minimum count.
+ * @param[in]     maxRepeats    The maximum count, or UNBOUNDED_REPEATS.
+ */
+static void add_regexp_repeat_token(RegExpTokenArrayS* const tokenArray_p,
+                                    const int minRepeats,
+                                    const int maxRepeats);
+
 /**
  * @brief Adds RegExp string token to token array.
  * @param[in/out] tokenArray_p      Pointer to the array.
@@ -154,7 +284,8 @@ static RegExpS* parse_start(RegExpParserS* const parser_p);
 static RegExpS* parse_sequence(RegExpParserS* const parser_p);
 
 /**
- * @brief Parses a component of a RegExp.
+ * @brief Parses a component of a RegExp. The alternatives are parsed in a loop rather than by
+ *        recursion, and nest to the right.
  *        Component -> Factor ('|' Component)?
  * @param[in/out] parser_p  Parser related info.
  * @return A regular expression.
@@ -163,7 +294,7 @@ static RegExpS* parse_component(RegExpParserS* const parser_p);
 
 /**
  * @brief Parses a factor of a RegExp.
- *        Factor -> Term ('?' | '*' | '+')?
+ *        Factor -> Term ('?' | '*' | '+' | REPEAT)?
  * @param[in/out] parser_p  Parser related info.
  * @return A regular expression.
  */
@@ -171,27 +302,54 @@ static RegExpS* parse_factor(RegExpParserS* const parser_p);
 
 /**
  * @brief Parses a term of a RegExp.
- *        Term -> STRING | '(' Sequence ')' | '[' List ']'
+ *        Term -> STRING | CLASS | UNICODE_CLASS | '(' Sequence ')' | '[' List ']'
  * @param[in/out] parser_p  Parser related info.
  * @return A regular expression.
  */
 static RegExpS* parse_term(RegExpParserS* const parser_p);
 
 /**
- * @brief Parses a list of a RegExp.
- *        List -> ListComponent (',' ListComponent)*
+ * @brief Parses a list of a RegExp into a char class, or a code point set if it has any code
+ *        points. The chars of a STRING are all members, so "[abc]" and "[a,b,c]" are the same.
+ *        List -> '^'? ListComponent (','? ListComponent)*
  * @param[in/out] parser_p  Parser related info.
  * @return A regular expression.
  */
 static RegExpS* parse_list(RegExpParserS* const parser_p);
 
 /**
- * @brief Parses a list component of a RegExp.
- *        ListComponent -> STRING '-' STRING | STRING
+ * @brief Parses a list component of a RegExp and adds its members to a list. A range is formed
+ *        by the chars directly around the '-'.
+ *        ListComponent -> STRING '-' STRING | STRING | CLASS | UNICODE_CLASS
  * @param[in/out] parser_p  Parser related info.
- * @return A regular expression.
+ * @param[in/out] list_p    The list.
+ */
+static void parse_list_component(RegExpParserS* const parser_p, RegExpListS* const list_p);
+
+/**
+ * @brief Splits the chars of a string token into the chars and code points of a list.
+ * @param[in]  token_p  The string token.
+ * @param[out] chars_p  Room for the chars of the token.
+ * @return The number of chars and code points.
+ */
+static int decode_list_chars(const RegExpTokenS* const token_p, RegExpListCharS* const chars_p);
+
+/**
+ * @brief Adds a range of chars or code points to a list.
+ * @param[in/out] list_p  The list.
+ * @param[in]     first   The first char of the range.
+ * @param[in]     last    The last char of the range.
  */
-static RegExpS* parse_list_component(RegExpParserS* const parser_p);
+static void add_list_range(RegExpListS* const list_p,
+                           const RegExpListCharS first,
+                           const RegExpListCharS last);
+
+/**
+ * @brief Adds the code points of the Unicode class of a token to a code point set.
+ * @param[in/out] codePoints_p  The code point set.
+ * @param[in]     token_p       The Unicode class token.
+ */
+static void add_unicode_class(CodePointSetS* const codePoints_p, const RegExpTokenS* const token_p);
 
 /**
  * @brief Accepts current token if it is of specified type.
@@ -228,6 +386,37 @@ static RegExpS* create_regexp(const RegExpTypeE regExpType);
  */
 static RegExpS* create_regexp_string(RegExpTokenS* const stringToken_p);
 
+/**
+ * @brief Allocates memory for a RegExp char class that matches no chars.
+ * @return Pointer to the allocated RegExp.
+ */
+static RegExpS* create_regexp_char_class(void);
+
+/**
+ * @brief Allocates memory for a RegExp code point set and takes over the code points.
+ * @param[in/out] codePoints_p  The code points, which are normalized and emptied.
+ * @return Pointer to the allocated RegExp.
+ */
+static RegExpS* create_regexp_code_point_set(CodePointSetS* const codePoints_p);
+
+/**
+ * @brief Adds a range of chars to a RegExp char class.
+ * @param[in/out] charClass_p  The char class.
+ * @param[in]     firstChar    The first char of the range.
+ * @param[in]     lastChar     The last char of the range.
+ */
+static void add_chars_to_class(RegExpS* const charClass_p,
+                               const unsigned char firstChar,
+                               const unsigned char lastChar);
+
+/**
+ * @brief Adds the chars of a shorthand to a RegExp char class: "\d" digits, "\w" word chars and
+ *        "\s" whitespace, or with an upper case letter every other char.
+ * @param[in/out] charClass_p  The char class.
+ * @param[in]     letter       The letter of the shorthand.
+ */
+static void add_shorthand_to_class(RegExpS* const charClass_p, const char letter);
+
 /**
  * @brief Adds child RegExp to parent RegExp.
  * @param[out] parent_p  The parent RegExp.
@@ -236,10 +425,72 @@ static RegExpS* create_regexp_string(RegExpTokenS* const stringToken_p);
 static void add_child_to_regexp(RegExpS* const parent_p, RegExpS* const child_p);
 
 /**
- * @brief Checks the RegExp is correctly formatted. Crashes otherwise.
- * @param[in] regexp_p  The RegExp.
+ * @brief Finds the literals of a RegExp.
+ * @param[in] regExp_p  The RegExp.
+ * @return The literals.
+ */
+static RegExpLiteralInfoS find_literals(const RegExpS* const regExp_p);
+
+/**
+ * @brief Finds the literals of a RegExp Sequence.
+ * @param[in] regExp_p  The RegExp Sequence.
+ * @return The literals.
+ */
+static RegExpLiteralInfoS find_sequence_literals(const RegExpS* const regExp_p);
+
+/**
+ * @brief Finds the literals of a RegExp whose children are alternatives, i.e. an Or.
+ * @param[in] regExp_p  The RegExp.
+ * @return The literals.
+ */
+static RegExpLiteralInfoS find_alternative_literals(const RegExpS* const regExp_p);
+
+/**
+ * @brief Appends the characters of a literal to another, as many as fit.
+ * @param[in/out]  literal_p  The literal to append to.
+ * @param[in]      suffix_p   The literal to append.
+ */
+static void append_literal(RegExpLiteralS* const literal_p, const RegExpLiteralS* const suffix_p);
+
+/**
+ * @brief Replaces a literal by a candidate if the candidate is better.
+ * @param[in/out]  best_p       The best literal so far.
+ * @param[in]      candidate_p  The candidate literal.
+ */
+static void keep_better_literal(RegExpLiteralS* const best_p,
+                                const RegExpLiteralS* const candidate_p);
+
+/**
+ * @brief Adds two lengths, either of which may be UNBOUNDED_LENGTH.
+ * @param[in]  length1  The first length.
+ * @param[in]  length2  The second length.
+ * @return The sum.
  */
-static void check_regexp_format(const RegExpS* const regexp_p);
+static int add_lengths(const int length1, const int length2);
+
+/**
+ * @brief Hashes a RegExp whose children are already shared, so that they are hashed by address.
+ * @param[in]  regExp_p  The RegExp.
+ * @return The hash.
+ */
+static uint32_t hash_regexp(const RegExpS* const regExp_p);
+
+/**
+ * @brief Checks if two RegExps whose children are already shared are equal.
+ * @param[in]  regExp1_p  The first RegExp.
+ * @param[in]  regExp2_p  The second RegExp.
+ * @return True if the RegExps are equal, false otherwise.
+ */
+static bool regexps_are_equal(const RegExpS* const regExp1_p, const RegExpS* const regExp2_p);
+
+/**
+ * @brief Finds the entry of a RegExp table holding a RegExp equal to the provided one, or the free
+ *        entry where it belongs.
+ * @param[in]  table_p   The table.
+ * @param[in]  regExp_p  The RegExp.
+ * @return Index of the entry.
+ */
+static int find_regexp_entry(const RegExpTableS* const table_p, const RegExpS* const regExp_p);
 
 /*> Local Function Definitions ********************************************************************/
 static void tokenize_regexp(RegExpTokenArrayS* tokenArray_p, const char* const regExpString_p)
@@ -251,7 +502,30 @@ static void tokenize_regexp(RegExpTokenArrayS* tokenArray_p, const char* const r
 
   while (currChar != '\0')
   {
-    if (is_regexp_operator_char(regExpString_p[charIndex]) && !escapeNextChar)
+    int minRepeats;
+    int maxRepeats;
+    int numRepeatChars = 0;
+    if (currChar == '{' && !escapeNextChar)
+    {
+      numRepeatChars = read_repeat_counts(&(regExpString_p[charIndex]), &minRepeats, &maxRepeats);
+    }
+
+    bool isListStart = charBuffer.numChars == 0 &&
+                       tokenArray_p->numTokens > 0 &&
+                       tokenArray_p->tokens[tokenArray_p->numTokens - 1].type == '[';
+    if (numRepeatChars > 0)
+    {
+      if (charBuffer.numChars > 0)
+      {
+        add_regexp_string_token(tokenArray_p, &charBuffer);
+        charBuffer.numChars = 0;
+      }
+
+      add_regexp_repeat_token(tokenArray_p, minRepeats, maxRepeats);
+      charIndex += numRepeatChars - 1;
+    }
+    else if ((is_regexp_operator_char(currChar) || (currChar == '^' && isListStart)) &&
+             !escapeNextChar)
     {
       if (charBuffer.numChars > 0)
       {
@@ -262,6 +536,39 @@ static void tokenize_regexp(RegExpTokenArrayS* tokenArray_p, const char* const r
       add_regexp_token(tokenArray_p, currChar);
       escapeNextChar = false;
     }
+    else if (is_char_class_shorthand(currChar) && escapeNextChar)
+    {
+      if (charBuffer.numChars > 0)
+      {
+        add_regexp_string_token(tokenArray_p, &charBuffer);
+        charBuffer.numChars = 0;
+      }
+
+      add_regexp_class_token(tokenArray_p, currChar);
+      escapeNextChar = false;
+    }
+    else if (currChar == 'u' && escapeNextChar)
+    {
+      uint32_t codePoint;
+      charIndex += read_code_point_escape(&(regExpString_p[charIndex + 1]), &codePoint);
+      assert(charBuffer.numChars + MAX_UTF8_LENGTH <= MAX_REGEXP_STRING_LENGTH);
+      charBuffer.numChars += encode_utf8(codePoint, &(charBuffer.characters[charBuffer.numChars]));
+      escapeNextChar = false;
+    }
+    else if ((currChar == 'p' || currChar == 'P') && escapeNextChar)
+    {
+      if (charBuffer.numChars > 0)
+      {
+        add_regexp_string_token(tokenArray_p, &charBuffer);
+        charBuffer.numChars = 0;
+      }
+
+      const char* name_p;
+      int nameLength;
+      charIndex += read_unicode_class_name(&(regExpString_p[charIndex + 1]), &name_p, &nameLength);
+      add_regexp_unicode_class_token(tokenArray_p, currChar, name_p, nameLength);
+      escapeNextChar = false;
+    }
     else if (currChar == '\\' && !escapeNextChar)
     {
       escapeNextChar = true;
@@ -298,6 +605,10 @@ static void print_regexp_token(const RegExpTokenS* token_p)
   {
     printf("'%.*s'", token_p->numChars, token_p->characters);
   }
+  else if (token_p->type == REGEXP_TOKEN_REPEAT)
+  {
+    printf("{%d,%d}", token_p->minRepeats, token_p->maxRepeats);
+  }
   else if (token_p->type == REGEXP_TOKEN_END)
   {
     printf("END");
@@ -315,6 +626,130 @@ static void add_regexp_token(RegExpTokenArrayS* const tokenArray_p, const RegExp
   assert(tokenArray_p->numTokens <= MAX_NUM_REGEXP_TOKENS);
 }
 
+static void add_regexp_class_token(RegExpTokenArrayS* const tokenArray_p, const char letter)
+{
+  tokenArray_p->tokens[tokenArray_p->numTokens].type = REGEXP_TOKEN_CLASS;
+  tokenArray_p->tokens[tokenArray_p->numTokens].characters[0] = letter;
+  tokenArray_p->tokens[tokenArray_p->numTokens].numChars = 1;
+  (tokenArray_p->numTokens)++;
+  assert(tokenArray_p->numTokens <= MAX_NUM_REGEXP_TOKENS);
+}
+
+static bool is_char_class_shorthand(const char ch)
+{
+  return (ch == 'd') || (ch == 'w') || (ch == 's') || (ch == 'D') || (ch == 'W') || (ch == 'S');
+}
+
+static int read_repeat_counts(const char* const string_p,
+                              int* const minRepeats_p,
+                              int* const maxRepeats_p)
+{
+  int charIdx = 1;
+  int numDigits = read_repeat_count(&(string_p[charIdx]), minRepeats_p);
+  if (numDigits == 0)
+  {
+    return 0;
+  }
+  charIdx += numDigits;
+  *maxRepeats_p = *minRepeats_p;
+
+  if (string_p[charIdx] == ',')
+  {
+    charIdx++;
+    numDigits = read_repeat_count(&(string_p[charIdx]), maxRepeats_p);
+    if (numDigits == 0)
+    {
+      *maxRepeats_p = UNBOUNDED_REPEATS;
+    }
+    charIdx += numDigits;
+  }
+
+  // Anything else, such as "{" on its own, stays a plain char.
+  if (string_p[charIdx] != '}')
+  {
+    return 0;
+  }
+  return charIdx + 1;
+}
+
+static int read_repeat_count(const char* const string_p, int* const count_p)
+{
+  int numDigits = 0;
+  *count_p = 0;
+  while (string_p[numDigits] >= '0' && string_p[numDigits] <= '9')
+  {
+    *count_p = *count_p * 10 + (string_p[numDigits] - '0');
+    if (*count_p > MAX_NUM_REPEATS)
+    {
+      *count_p = MAX_NUM_REPEATS + 1;
+    }
+    numDigits++;
+  }
+  return numDigits;
+}
+
+static int read_code_point_escape(const char* const string_p, uint32_t* const codePoint_p)
+{
+  int charIdx = 1;
+  uint32_t codePoint = 0;
+  while (string_p[0] == '{' && charIdx <= 6 && isxdigit((unsigned char) string_p[charIdx]))
+  {
+    char digit = tolower((unsigned char) string_p[charIdx]);
+    codePoint = codePoint * 16 + ((digit <= '9') ? digit - '0' : digit - 'a' + 10);
+    charIdx++;
+  }
+
+  if (charIdx == 1 || string_p[charIdx] != '}')
+  {
+    PARSING_ERROR("Expected a code point such as {20AC} after \\u");
+  }
+  if (codePoint > MAX_CODE_POINT || (codePoint >= MIN_SURROGATE && codePoint <= MAX_SURROGATE))
+  {
+    PARSING_ERROR("%X is not a code point that can be encoded in UTF-8", codePoint);
+  }
+  *codePoint_p = codePoint;
+  return charIdx + 1;
+}
+
+static int read_unicode_class_name(const char* const string_p,
+                                   const char** const name_pp,
+                                   int* const nameLength_p)
+{
+  const char* end_p = (string_p[0] == '{') ? strchr(string_p, '}') : NULL;
+  if (end_p == NULL || end_p == string_p + 1)
+  {
+    PARSING_ERROR("Expected a Unicode class such as {Lu} after \\p");
+  }
+  *name_pp = string_p + 1;
+  *nameLength_p = end_p - (string_p + 1);
+  assert(*nameLength_p < MAX_REGEXP_STRING_LENGTH);
+  return *nameLength_p + 2;
+}
+
+static void add_regexp_unicode_class_token(RegExpTokenArrayS* const tokenArray_p,
+                                           const char letter,
+                                           const char* const name_p,
+                                           const int nameLength)
+{
+  tokenArray_p->tokens[tokenArray_p->numTokens].type = REGEXP_TOKEN_UNICODE_CLASS;
+  tokenArray_p->tokens[tokenArray_p->numTokens].characters[0] = letter;
+  memcpy(&(tokenArray_p->tokens[tokenArray_p->numTokens].characters[1]), name_p, nameLength);
+  tokenArray_p->tokens[tokenArray_p->numTokens].numChars = nameLength + 1;
+  (tokenArray_p->numTokens)++;
+  assert(tokenArray_p->numTokens <= MAX_NUM_REGEXP_TOKENS);
+}
+
+static void add_regexp_repeat_token(RegExpTokenArrayS* const tokenArray_p,
+                                    const int minRepeats,
+                                    const int maxRepeats)
+{
+  tokenArray_p->tokens[tokenArray_p->numTokens].type = REGEXP_TOKEN_REPEAT;
+  tokenArray_p->tokens[tokenArray_p->numTokens].minRepeats = minRepeats;
+  tokenArray_p->tokens[tokenArray_p->numTokens].maxRepeats = maxRepeats;
+  (tokenArray_p->numTokens)++;
+  assert(tokenArray_p->numTokens <= MAX_NUM_REGEXP_TOKENS);
+}
+
 static void add_regexp_string_token(RegExpTokenArrayS* const tokenArray_p,
                                     const RegExpCharBufferS* const charBuffer_p)
 {
@@ -352,19 +787,23 @@ static RegExpS* parse_sequence(RegExpParserS* const parser_p)
 
 static RegExpS* parse_component(RegExpParserS* const parser_p)
 {
-  RegExpS* factor_p = parse_factor(parser_p);
-  if (parser_accept(parser_p, '|'))
+  // Every factor takes at least one token.
+  RegExpS* factors[MAX_NUM_REGEXP_TOKENS];
+  int numFactors = 0;
+  do
+  {
+    factors[numFactors++] = parse_factor(parser_p);
+  } while (parser_accept(parser_p, '|'));
+
+  RegExpS* component_p = factors[numFactors - 1];
+  for (int i = numFactors - 2; i >= 0; i--)
   {
-    RegExpS* component_p = parse_component(parser_p);
     RegExpS* orRegExp_p = create_regexp(REGEXP_OR);
-    add_child_to_regexp(orRegExp_p, factor_p);
+    add_child_to_regexp(orRegExp_p, factors[i]);
     add_child_to_regexp(orRegExp_p, component_p);
-    return orRegExp_p;
-  }
-  else 
-  {
-    return factor_p;
+    component_p = orRegExp_p;
   }
+  return component_p;
 }
 
 static RegExpS* parse_term(RegExpParserS* const parser_p)
@@ -375,10 +814,29 @@ static RegExpS* parse_term(RegExpParserS* const parser_p)
     RegExpS* stringRegExp_p = create_regexp_string(currToken_p);
     return stringRegExp_p;
   }
+  else if (parser_accept(parser_p, REGEXP_TOKEN_CLASS))
+  {
+    RegExpS* charClass_p = create_regexp_char_class();
+    add_shorthand_to_class(charClass_p, currToken_p->characters[0]);
+    return charClass_p;
+  }
+  else if (parser_accept(parser_p, REGEXP_TOKEN_UNICODE_CLASS))
+  {
+    CodePointSetS codePoints = { .ranges_p = NULL, .numRanges = 0, .maxNumRanges = 0 };
+    add_unicode_class(&codePoints, currToken_p);
+    return create_regexp_code_point_set(&codePoints);
+  }
   else if (parser_accept(parser_p, '('))
   {
+    // Groups are parsed by recursion, so their nesting is bounded.
+    if (parser_p->depth == MAX_REGEXP_NESTING_DEPTH)
+    {
+      PARSING_ERROR("Groups may be nested at most %d deep", MAX_REGEXP_NESTING_DEPTH);
+    }
+    parser_p->depth++;
     RegExpS* sequence_p = parse_sequence(parser_p);
     parser_expect(parser_p, ')');
+    parser_p->depth--;
     return sequence_p;
   }
   else if (parser_accept(parser_p, '['))
@@ -396,6 +854,7 @@ static RegExpS* parse_term(RegExpParserS* const parser_p)
 static RegExpS* parse_factor(RegExpParserS* const parser_p)
 {
   RegExpS* term_p = parse_term(parser_p);
+  RegExpTokenS* currToken_p = parser_p->currToken_p;
   if (parser_accept(parser_p, '?'))
   {
     RegExpS* optionalRegExp_p = create_regexp(REGEXP_OPTIONAL);
@@ -414,6 +873,26 @@ static RegExpS* parse_factor(RegExpParserS* const parser_p)
     add_child_to_regexp(oneOrMoreRegExp_p, term_p);
     return oneOrMoreRegExp_p;
   }
+  else if (parser_accept(parser_p, REGEXP_TOKEN_REPEAT))
+  {
+    if (currToken_p->minRepeats > MAX_NUM_REPEATS || currToken_p->maxRepeats > MAX_NUM_REPEATS)
+    {
+      PARSING_ERROR("Repetition counts may be at most %d", MAX_NUM_REPEATS);
+    }
+    if (currToken_p->maxRepeats != UNBOUNDED_REPEATS &&
+        currToken_p->minRepeats > currToken_p->maxRepeats)
+    {
+      PARSING_ERROR("Repetition {%d,%d} is empty",
+                    currToken_p->minRepeats,
+                    currToken_p->maxRepeats);
+    }
+
+    RegExpS* repeatRegExp_p = create_regexp(REGEXP_REPEAT);
+    repeatRegExp_p->minRepeats = currToken_p->minRepeats;
+    repeatRegExp_p->maxRepeats = currToken_p->maxRepeats;
+    add_child_to_regexp(repeatRegExp_p, term_p);
+    return repeatRegExp_p;
+  }
   else
   {
     return term_p;
@@ -422,38 +901,157 @@ static RegExpS* parse_factor(RegExpParserS* const parser_p)
 
 static RegExpS* parse_list(RegExpParserS* const parser_p)
 {
-  RegExpS* oneOfRegExp_p = create_regexp(REGEXP_ONE_OF);
-  RegExpS* firstListComponent_p = parse_list_component(parser_p);
-  add_child_to_regexp(oneOfRegExp_p, firstListComponent_p);
-  while (parser_accept(parser_p, ','))
+  RegExpListS list =
+  {
+    .charClass_p = create_regexp_char_class(),
+    .codePoints = { .ranges_p = NULL, .numRanges = 0, .maxNumRanges = 0 },
+    .hasNegatedShorthand = false
+  };
+  bool isNegated = parser_accept(parser_p, '^');
+  do
+  {
+    parse_list_component(parser_p, &list);
+    parser_accept(parser_p, ',');
+  } while (parser_p->currToken_p->type == REGEXP_TOKEN_STRING ||
+           parser_p->currToken_p->type == REGEXP_TOKEN_CLASS ||
+           parser_p->currToken_p->type == REGEXP_TOKEN_UNICODE_CLASS);
+
+  if (list.codePoints.numRanges == 0)
+  {
+    for (int i = 0; i < NUM_CHAR_CLASS_WORDS && isNegated; i++)
+    {
+      list.charClass_p->charClass[i] = ~list.charClass_p->charClass[i];
+    }
+    list.charClass_p->isNegated = isNegated;
+    return list.charClass_p;
+  }
+
+  // Chars above 0x7F only exist as raw bytes, which a code point set does not match.
+  for (int character = 0; character <= 0x7F; character++)
+  {
+    if (is_char_in_class(list.charClass_p, character))
+    {
+      add_code_point_range(&(list.codePoints), character, character);
+    }
+  }
+  if (list.hasNegatedShorthand)
+  {
+    add_code_point_range(&(list.codePoints), 0x80, MAX_CODE_POINT);
+  }
+  free_regexp(list.charClass_p);
+
+  normalize_code_point_set(&(list.codePoints));
+  if (isNegated)
   {
-    RegExpS* otherListComponent_p = parse_list_component(parser_p);
-    add_child_to_regexp(oneOfRegExp_p, otherListComponent_p);
+    invert_code_point_set(&(list.codePoints));
   }
-  return oneOfRegExp_p;
+  RegExpS* codePointSet_p = create_regexp_code_point_set(&(list.codePoints));
+  codePointSet_p->isNegated = isNegated;
+  return codePointSet_p;
 }
 
-static RegExpS* parse_list_component(RegExpParserS* const parser_p)
+static void parse_list_component(RegExpParserS* const parser_p, RegExpListS* const list_p)
 {
-  RegExpTokenS* currToken_p = parser_p->currToken_p;
+  RegExpTokenS* firstToken_p = parser_p->currToken_p;
+  if (parser_accept(parser_p, REGEXP_TOKEN_CLASS))
+  {
+    char letter = firstToken_p->characters[0];
+    add_shorthand_to_class(list_p->charClass_p, letter);
+    list_p->hasNegatedShorthand |= (letter == 'D') || (letter == 'W') || (letter == 'S');
+    return;
+  }
+  else if (parser_accept(parser_p, REGEXP_TOKEN_UNICODE_CLASS))
+  {
+    add_unicode_class(&(list_p->codePoints), firstToken_p);
+    return;
+  }
+
   parser_expect(parser_p, REGEXP_TOKEN_STRING);
-  RegExpS* firstRegExpString_p = create_regexp_string(currToken_p);
+  RegExpListCharS firstChars[MAX_REGEXP_STRING_LENGTH];
+  int numFirstChars = decode_list_chars(firstToken_p, firstChars);
   if (parser_accept(parser_p, '-'))
   {
-    currToken_p = parser_p->currToken_p;
+    RegExpTokenS* secondToken_p = parser_p->currToken_p;
     parser_expect(parser_p, REGEXP_TOKEN_STRING);
-    RegExpS* secondRegExpString_p = create_regexp_string(currToken_p);
-    RegExpS* rangeRegExp_p = create_regexp(REGEXP_RANGE);
-    add_child_to_regexp(rangeRegExp_p, firstRegExpString_p);
-    add_child_to_regexp(rangeRegExp_p, secondRegExpString_p);
-    return rangeRegExp_p;
+    RegExpListCharS secondChars[MAX_REGEXP_STRING_LENGTH];
+    int numSecondChars = decode_list_chars(secondToken_p, secondChars);
+    RegExpListCharS rangeFirstChar = firstChars[numFirstChars - 1];
+    RegExpListCharS rangeLastChar = secondChars[0];
+    if (rangeFirstChar.value > rangeLastChar.value)
+    {
+      PARSING_ERROR("Range %X-%X is empty", rangeFirstChar.value, rangeLastChar.value);
+    }
+
+    add_list_range(list_p, rangeFirstChar, rangeLastChar);
+    numFirstChars--;
+    for (int i = 1; i < numSecondChars; i++)
+    {
+      add_list_range(list_p, secondChars[i], secondChars[i]);
+    }
+  }
+
+  for (int i = 0; i < numFirstChars; i++)
+  {
+    add_list_range(list_p, firstChars[i], firstChars[i]);
+  }
+}
+
+static int decode_list_chars(const RegExpTokenS* const token_p, RegExpListCharS* const chars_p)
+{
+  int numListChars = 0;
+  int charIdx = 0;
+  while (charIdx < token_p->numChars)
+  {
+    uint32_t codePoint;
+    int numBytes = decode_utf8(&(token_p->characters[charIdx]),
+                               token_p->numChars - charIdx,
+                               &codePoint);
+    chars_p[numListChars].isCodePoint = numBytes > 0;
+    chars_p[numListChars].value = (numBytes > 0) ?
+                                  codePoint :
+                                  (unsigned char) token_p->characters[charIdx];
+    charIdx += (numBytes > 0) ? numBytes : 1;
+    numListChars++;
+  }
+  return numListChars;
+}
+
+static void add_list_range(RegExpListS* const list_p,
+                           const RegExpListCharS first,
+                           const RegExpListCharS last)
+{
+  if (first.isCodePoint || last.isCodePoint)
+  {
+    add_code_point_range(&(list_p->codePoints), first.value, last.value);
   }
   else
   {
-    return firstRegExpString_p;
+    add_chars_to_class(list_p->charClass_p, first.value, last.value);
   }
 }
 
+static void add_unicode_class(CodePointSetS* const codePoints_p, const RegExpTokenS* const token_p)
+{
+  CodePointSetS classCodePoints = { .ranges_p = NULL, .numRanges = 0, .maxNumRanges = 0 };
+  if (!add_unicode_category(&classCodePoints, &(token_p->characters[1]), token_p->numChars - 1))
+  {
+    PARSING_ERROR("Unknown Unicode class %.*s", token_p->numChars - 1, &(token_p->characters[1]));
+  }
+
+  normalize_code_point_set(&classCodePoints);
+  if (token_p->characters[0] == 'P')
+  {
+    invert_code_point_set(&classCodePoints);
+  }
+  for (int i = 0; i < classCodePoints.numRanges; i++)
+  {
+    add_code_point_range(codePoints_p,
+                         classCodePoints.ranges_p[i].first,
+                         classCodePoints.ranges_p[i].last);
+  }
+  free_code_point_set(&classCodePoints);
+}
+
 static bool parser_accept(RegExpParserS* const parser_p, const RegExpTokenTypeE tokenType)
 {
   if (parser_p->currToken_p->type == tokenType)
@@ -490,6 +1088,12 @@ static RegExpS* create_regexp(const RegExpTypeE regExpType)
 {
   RegExpS* newRegExp_p = malloc(sizeof(*newRegExp_p));
   newRegExp_p->type = regExpType;
+  newRegExp_p->numRefs = 1;
+  newRegExp_p->minRepeats = 1;
+  newRegExp_p->maxRepeats = 1;
+  newRegExp_p->isCaseInsensitive = false;
+  newRegExp_p->isReversed = false;
+  newRegExp_p->isNegated = false;
   newRegExp_p->numChildren = 0;
   return newRegExp_p;
 }
@@ -502,6 +1106,65 @@ static RegExpS* create_regexp_string(RegExpTokenS* const stringToken_p)
   return newRegExpString_p;
 }
 
+static RegExpS* create_regexp_char_class(void)
+{
+  RegExpS* newCharClass_p = create_regexp(REGEXP_CHAR_CLASS);
+  memset(newCharClass_p->charClass, 0, sizeof(newCharClass_p->charClass));
+  return newCharClass_p;
+}
+
+static RegExpS* create_regexp_code_point_set(CodePointSetS* const codePoints_p)
+{
+  RegExpS* newCodePointSet_p = create_regexp(REGEXP_CODE_POINT_SET);
+  normalize_code_point_set(codePoints_p);
+  newCodePointSet_p->codePoints = *codePoints_p;
+  codePoints_p->ranges_p = NULL;
+  codePoints_p->numRanges = 0;
+  codePoints_p->maxNumRanges = 0;
+  return newCodePointSet_p;
+}
+
+static void add_chars_to_class(RegExpS* const charClass_p,
+                               const unsigned char firstChar,
+                               const unsigned char lastChar)
+{
+  for (int character = firstChar; character <= lastChar; character++)
+  {
+    charClass_p->charClass[character / 64] |= (uint64_t) 1 << (character % 64);
+  }
+}
+
+static void add_shorthand_to_class(RegExpS* const charClass_p, const char letter)
+{
+  RegExpS* shorthand_p = create_regexp_char_class();
+  switch (letter)
+  {
+  case 'd':
+  case 'D':
+    add_chars_to_class(shorthand_p, '0', '9');
+    break;
+  case 'w':
+  case 'W':
+    add_chars_to_class(shorthand_p, 'a', 'z');
+    add_chars_to_class(shorthand_p, 'A', 'Z');
+    add_chars_to_class(shorthand_p, '0', '9');
+    add_chars_to_class(shorthand_p, '_', '_');
+    break;
+  case 's':
+  case 'S':
+    add_chars_to_class(shorthand_p, ' ', ' ');
+    add_chars_to_class(shorthand_p, '\t', '\r');
+    break;
+  }
+
+  bool isNegated = (letter == 'D') || (letter == 'W') || (letter == 'S');
+  for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+  {
+    charClass_p->charClass[i] |= isNegated ? ~shorthand_p->charClass[i] : shorthand_p->charClass[i];
+  }
+  free(shorthand_p);
+}
+
 static void add_child_to_regexp(RegExpS* const parent_p, RegExpS* const child_p)
 {
   parent_p->children[parent_p->numChildren] = child_p;
@@ -509,29 +1172,341 @@ static void add_child_to_regexp(RegExpS* const parent_p, RegExpS* const child_p)
   assert(parent_p->numChildren <= MAX_NUM_REGEXP_CHILDREN);
 }
 
-static void check_regexp_format(const RegExpS* const regexp_p)
+static RegExpLiteralInfoS find_literals(const RegExpS* const regExp_p)
+{
+  RegExpLiteralInfoS info = { .isExact = false, .maxLength = 0 };
+  info.prefix.numChars = 0;
+  info.prefix.maxOffset = 0;
+  info.factor = info.prefix;
+
+  switch (regExp_p->type)
+  {
+  case REGEXP_SEQUENCE:
+    return find_sequence_literals(regExp_p);
+  case REGEXP_OR:
+    return find_alternative_literals(regExp_p);
+  case REGEXP_STRING:
+    info.isExact = true;
+    for (int i = 0; i < regExp_p->numChars && info.isExact; i++)
+    {
+      // The literal finder compares chars exactly, so a literal stops at a folded letter.
+      unsigned char character = regExp_p->characters[i];
+      if (regExp_p->isCaseInsensitive && other_char_case(character) != character)
+      {
+        info.isExact = false;
+      }
+      else
+      {
+        info.prefix.characters[info.prefix.numChars] = character;
+        info.prefix.numChars++;
+      }
+    }
+    info.factor = info.prefix;
+    info.maxLength = regExp_p->numChars;
+    break;
+  case REGEXP_CHAR_CLASS:
+  {
+    // A class of a single char is the same as a string of it.
+    int numClassChars = 0;
+    for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+    {
+      numClassChars += __builtin_popcountll(regExp_p->charClass[i]);
+    }
+    for (int character = 0; character < 256 && numClassChars == 1; character++)
+    {
+      if (is_char_in_class(regExp_p, character))
+      {
+        info.isExact = true;
+        info.prefix.characters[0] = character;
+        info.prefix.numChars = 1;
+        info.factor = info.prefix;
+      }
+    }
+    info.maxLength = 1;
+    break;
+  }
+  case REGEXP_OPTIONAL:
+    info.maxLength = find_literals(regExp_p->child_p).maxLength;
+    break;
+  case REGEXP_ZERO_OR_MORE:
+    info.maxLength = UNBOUNDED_LENGTH;
+    break;
+  case REGEXP_ONE_OR_MORE:
+    info = find_literals(regExp_p->child_p);
+    info.isExact = false;
+    info.maxLength = UNBOUNDED_LENGTH;
+    break;
+  case REGEXP_CODE_POINT_SET:
+    info.maxLength = MAX_UTF8_LENGTH;
+    break;
+  case REGEXP_REPEAT:
+  {
+    RegExpLiteralInfoS childInfo = find_literals(regExp_p->child_p);
+    // The literals of the first copy are required if there is one.
+    if (regExp_p->minRepeats > 0)
+    {
+      info = childInfo;
+      info.isExact = childInfo.isExact && regExp_p->maxRepeats == 1;
+    }
+    info.maxLength = UNBOUNDED_LENGTH;
+    if (regExp_p->maxRepeats != UNBOUNDED_REPEATS && childInfo.maxLength != UNBOUNDED_LENGTH)
+    {
+      info.maxLength = childInfo.maxLength * regExp_p->maxRepeats;
+    }
+    break;
+  }
+  }
+
+  return info;
+}
+
+static RegExpLiteralInfoS find_sequence_literals(const RegExpS* const regExp_p)
+{
+  RegExpLiteralInfoS info = { .isExact = true, .maxLength = 0 };
+  info.factor.numChars = 0;
+  info.factor.maxOffset = 0;
+
+  // The exact children directly before the current child form a literal run.
+  RegExpLiteralS run = { .numChars = 0, .maxOffset = 0 };
+  for (int i = 0; i < regExp_p->numChildren; i++)
+  {
+    RegExpLiteralInfoS childInfo = find_literals(regExp_p->children[i]);
+
+    RegExpLiteralS childFactor = childInfo.factor;
+    childFactor.maxOffset = add_lengths(info.maxLength, childFactor.maxOffset);
+    keep_better_literal(&(info.factor), &childFactor);
+
+    append_literal(&run, &(childInfo.prefix));
+    keep_better_literal(&(info.factor), &run);
+    if (!childInfo.isExact)
+    {
+      if (info.isExact)
+      {
+        info.prefix = run;
+        info.isExact = false;
+      }
+      run.numChars = 0;
+      run.maxOffset = add_lengths(info.maxLength, childInfo.maxLength);
+    }
+
+    info.maxLength = add_lengths(info.maxLength, childInfo.maxLength);
+  }
+
+  if (info.isExact)
+  {
+    info.prefix = run;
+  }
+  return info;
+}
+
+static RegExpLiteralInfoS find_alternative_literals(const RegExpS* const regExp_p)
+{
+  RegExpLiteralInfoS info = find_literals(regExp_p->children[0]);
+
+  for (int i = 1; i < regExp_p->numChildren; i++)
+  {
+    RegExpLiteralInfoS childInfo = find_literals(regExp_p->children[i]);
+
+    int numCommonChars = 0;
+    while (numCommonChars < info.prefix.numChars &&
+           numCommonChars < childInfo.prefix.numChars &&
+           info.prefix.characters[numCommonChars] == childInfo.prefix.characters[numCommonChars])
+    {
+      numCommonChars++;
+    }
+
+    info.isExact = info.isExact &&
+                   childInfo.isExact &&
+                   numCommonChars == info.prefix.numChars &&
+                   numCommonChars == childInfo.prefix.numChars;
+    info.prefix.numChars = numCommonChars;
+
+    if (info.maxLength != UNBOUNDED_LENGTH &&
+        (childInfo.maxLength == UNBOUNDED_LENGTH || childInfo.maxLength > info.maxLength))
+    {
+      info.maxLength = childInfo.maxLength;
+    }
+  }
+
+  // Only the common prefix is known to be in every alternative.
+  if (regExp_p->numChildren > 1)
+  {
+    info.factor = info.prefix;
+  }
+  return info;
+}
+
+static void append_literal(RegExpLiteralS* const literal_p, const RegExpLiteralS* const suffix_p)
+{
+  int numChars = suffix_p->numChars;
+  if (literal_p->numChars + numChars > MAX_REGEXP_STRING_LENGTH)
+  {
+    numChars = MAX_REGEXP_STRING_LENGTH - literal_p->numChars;
+  }
+  memcpy(&(literal_p->characters[literal_p->numChars]), suffix_p->characters, numChars);
+  literal_p->numChars += numChars;
+}
+
+static void keep_better_literal(RegExpLiteralS* const best_p,
+                                const RegExpLiteralS* const candidate_p)
+{
+  if (candidate_p->numChars == 0)
+  {
+    return;
+  }
+
+  bool isBestBounded = best_p->maxOffset != UNBOUNDED_LENGTH;
+  bool isCandidateBounded = candidate_p->maxOffset != UNBOUNDED_LENGTH;
+  bool isBetter = (best_p->numChars == 0) ||
+                  (isCandidateBounded && !isBestBounded) ||
+                  (isCandidateBounded == isBestBounded && candidate_p->numChars > best_p->numChars);
+  if (isBetter)
+  {
+    *best_p = *candidate_p;
+  }
+}
+
+static int add_lengths(const int length1, const int length2)
+{
+  if (length1 == UNBOUNDED_LENGTH || length2 == UNBOUNDED_LENGTH)
+  {
+    return UNBOUNDED_LENGTH;
+  }
+  return length1 + length2;
+}
+
+static uint32_t hash_regexp(const RegExpS* const regExp_p)
+{
+  uint32_t hash = 2166136261u;
+  uint32_t fields[] =
+  {
+    regExp_p->type,
+    regExp_p->minRepeats,
+    regExp_p->maxRepeats,
+    regExp_p->isCaseInsensitive,
+    regExp_p->isReversed,
+    regExp_p->isNegated,
+    regExp_p->numChildren
+  };
+  for (int i = 0; i < (int) (sizeof(fields) / sizeof(fields[0])); i++)
+  {
+    hash = (hash ^ fields[i]) * 16777619u;
+  }
+
+  for (int i = 0; i < regExp_p->numChildren; i++)
+  {
+    hash = (hash ^ (uint32_t) ((uintptr_t) regExp_p->children[i] >> 4)) * 16777619u;
+  }
+  if (regExp_p->type == REGEXP_STRING)
+  {
+    for (int i = 0; i < regExp_p->numChars; i++)
+    {
+      hash = (hash ^ (unsigned char) regExp_p->characters[i]) * 16777619u;
+    }
+  }
+  else if (regExp_p->type == REGEXP_CHAR_CLASS)
+  {
+    for (int i = 0; i < NUM_CHAR_CLASS_WORDS; i++)
+    {
+      hash = (hash ^ (uint32_t) regExp_p->charClass[i]) * 16777619u;
+      hash = (hash ^ (uint32_t) (regExp_p->charClass[i] >> 32)) * 16777619u;
+    }
+  }
+  else if (regExp_p->type == REGEXP_CODE_POINT_SET)
+  {
+    for (int i = 0; i < regExp_p->codePoints.numRanges; i++)
+    {
+      hash = (hash ^ regExp_p->codePoints.ranges_p[i].first) * 16777619u;
+      hash = (hash ^ regExp_p->codePoints.ranges_p[i].last) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+static bool regexps_are_equal(const RegExpS* const regExp1_p, const RegExpS* const regExp2_p)
 {
-  if (regexp_p->type == REGEXP_RANGE)
+  if (regExp1_p->type != regExp2_p->type ||
+      regExp1_p->minRepeats != regExp2_p->minRepeats ||
+      regExp1_p->maxRepeats != regExp2_p->maxRepeats ||
+      regExp1_p->isCaseInsensitive != regExp2_p->isCaseInsensitive ||
+      regExp1_p->isReversed != regExp2_p->isReversed ||
+      regExp1_p->isNegated != regExp2_p->isNegated ||
+      regExp1_p->numChildren != regExp2_p->numChildren)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < regExp1_p->numChildren; i++)
+  {
+    if (regExp1_p->children[i] != regExp2_p->children[i])
+    {
+      return false;
+    }
+  }
+  if (regExp1_p->type == REGEXP_STRING)
+  {
+    return regExp1_p->numChars == regExp2_p->numChars &&
+           memcmp(regExp1_p->characters, regExp2_p->characters, regExp1_p->numChars) == 0;
+  }
+  else if (regExp1_p->type == REGEXP_CHAR_CLASS)
+  {
+    return memcmp(regExp1_p->charClass, regExp2_p->charClass, sizeof(regExp1_p->charClass)) == 0;
+  }
+  else if (regExp1_p->type == REGEXP_CODE_POINT_SET)
   {
-    assert(regexp_p->left_p->numChars == 1);
-    assert(regexp_p->right_p->numChars == 1);
-    assert(regexp_p->left_p->characters[0] <= regexp_p->right_p->characters[0]);
+    return regExp1_p->codePoints.numRanges == regExp2_p->codePoints.numRanges &&
+           memcmp(regExp1_p->codePoints.ranges_p,
+                  regExp2_p->codePoints.ranges_p,
+                  sizeof(CodePointRangeS) * regExp1_p->codePoints.numRanges) == 0;
   }
+  return true;
+}
 
-  for (int i = 0; i < regexp_p->numChildren; i++)
+static int find_regexp_entry(const RegExpTableS* const table_p, const RegExpS* const regExp_p)
+{
+  int entryIdx = hash_regexp(regExp_p) & (table_p->size - 1);
+  while (table_p->entries_pp[entryIdx] != NULL &&
+         !regexps_are_equal(table_p->entries_pp[entryIdx], regExp_p))
   {
-    check_regexp_format(regexp_p->children[i]);
+    entryIdx = (entryIdx + 1) & (table_p->size - 1);
   }
+  return entryIdx;
 }
 
 /*> Global Function Definitions *******************************************************************/
 void free_regexp(RegExpS* const regExp_p)
 {
-  for (int i = 0; i < regExp_p->numChildren; i++)
+  RegExpS** unfreed_pp = NULL;
+  int numUnfreed = 0;
+  int maxNumUnfreed = 0;
+  RegExpS* currRegExp_p = regExp_p;
+  while (currRegExp_p != NULL)
   {
-    free_regexp(regExp_p->children[i]);
+    currRegExp_p->numRefs--;
+    if (currRegExp_p->numRefs == 0)
+    {
+      if (currRegExp_p->type == REGEXP_CODE_POINT_SET)
+      {
+        free_code_point_set(&(currRegExp_p->codePoints));
+      }
+      if (numUnfreed + currRegExp_p->numChildren > maxNumUnfreed)
+      {
+        while (numUnfreed + currRegExp_p->numChildren > maxNumUnfreed)
+        {
+          maxNumUnfreed = maxNumUnfreed > 0 ? 2 * maxNumUnfreed : INITIAL_MAX_NUM_UNFREED;
+        }
+        unfreed_pp = realloc(unfreed_pp, sizeof(RegExpS*) * maxNumUnfreed);
+        assert(unfreed_pp != NULL);
+      }
+      for (int i = 0; i < currRegExp_p->numChildren; i++)
+      {
+        unfreed_pp[numUnfreed++] = currRegExp_p->children[i];
+      }
+      free(currRegExp_p);
+    }
+    currRegExp_p = (numUnfreed > 0) ? unfreed_pp[--numUnfreed] : NULL;
   }
-  free(regExp_p);
+  free(unfreed_pp);
 }
 
 void free_regexps(RegExpS** const regExps_pp, const int numRegExps)
@@ -545,19 +1520,214 @@ void free_regexps(RegExpS** const regExps_pp, const int numRegExps)
 RegExpS* parse_regexp(const char* const regExpString_p)
 {
   currRegExpString_p = regExpString_p;
+  size_t prefixLength = strlen(CASE_INSENSITIVE_PREFIX);
+  bool isCaseInsensitive = strncmp(regExpString_p, CASE_INSENSITIVE_PREFIX, prefixLength) == 0;
   RegExpTokenArrayS tokenArray = { .numTokens = 0 };
-  tokenize_regexp(&tokenArray, regExpString_p);
+  tokenize_regexp(&tokenArray, isCaseInsensitive ? regExpString_p + prefixLength : regExpString_p);
   RegExpParserS parser =
   {
     .tokenArray_p = &tokenArray,
     .tokenIndex = 0,
-    .currToken_p = &(tokenArray.tokens[0])
+    .currToken_p = &(tokenArray.tokens[0]),
+    .depth = 0
   };
   RegExpS* regexp_p = parse_start(&parser);
-  check_regexp_format(regexp_p);
+  if (isCaseInsensitive)
+  {
+    fold_regexp_case(regexp_p);
+  }
   return regexp_p;
 }
 
+void init_regexp_table(RegExpTableS* const table_p)
+{
+  table_p->entries_pp = calloc(INITIAL_REGEXP_TABLE_SIZE, sizeof(RegExpS*));
+  assert(table_p->entries_pp != NULL);
+  table_p->numEntries = 0;
+  table_p->size = INITIAL_REGEXP_TABLE_SIZE;
+}
+
+RegExpS* share_regexp(RegExpTableS* const table_p, RegExpS* const regExp_p)
+{
+  // Children are shared first, so that equal subtrees have equal children pointers.
+  for (int i = 0; i < regExp_p->numChildren; i++)
+  {
+    regExp_p->children[i] = share_regexp(table_p, regExp_p->children[i]);
+  }
+
+  int entryIdx = find_regexp_entry(table_p, regExp_p);
+  RegExpS* sharedRegExp_p = table_p->entries_pp[entryIdx];
+  if (sharedRegExp_p != NULL)
+  {
+    sharedRegExp_p->numRefs++;
+    free_regexp(regExp_p);
+    return sharedRegExp_p;
+  }
+
+  regExp_p->numRefs++;
+  table_p->entries_pp[entryIdx] = regExp_p;
+  table_p->numEntries++;
+
+  // Keep the table at most half full.
+  if (2 * table_p->numEntries > table_p->size)
+  {
+    RegExpS** oldEntries_pp = table_p->entries_pp;
+    int oldSize = table_p->size;
+    table_p->size *= 2;
+    table_p->entries_pp = calloc(table_p->size, sizeof(RegExpS*));
+    assert(table_p->entries_pp != NULL);
+    for (int i = 0; i < oldSize; i++)
+    {
+      if (oldEntries_pp[i] != NULL)
+      {
+        table_p->entries_pp[find_regexp_entry(table_p, oldEntries_pp[i])] = oldEntries_pp[i];
+      }
+    }
+    free(oldEntries_pp);
+  }
+
+  return regExp_p;
+}
+
+void free_regexp_table(RegExpTableS* const table_p)
+{
+  for (int i = 0; i < table_p->size; i++)
+  {
+    if (table_p->entries_pp[i] != NULL)
+    {
+      free_regexp(table_p->entries_pp[i]);
+    }
+  }
+  free(table_p->entries_pp);
+  table_p->entries_pp = NULL;
+  table_p->numEntries = 0;
+  table_p->size = 0;
+}
+
+void fold_regexp_case(RegExpS* const regExp_p)
+{
+  if (regExp_p->type == REGEXP_STRING)
+  {
+    regExp_p->isCaseInsensitive = true;
+  }
+  else if (regExp_p->type == REGEXP_CODE_POINT_SET)
+  {
+    // The members of a negated list are folded, not the code points it matches.
+    if (regExp_p->isNegated)
+    {
+      invert_code_point_set(&(regExp_p->codePoints));
+    }
+    // Added ranges are only sorted in by normalizing, so the set is looked up before adding any.
+    bool hasLetter['Z' - 'A' + 1];
+    for (uint32_t character = 'A'; character <= 'Z'; character++)
+    {
+      hasLetter[character - 'A'] =
+        is_code_point_in_set(&(regExp_p->codePoints), character) ||
+        is_code_point_in_set(&(regExp_p->codePoints), other_char_case(character));
+    }
+    for (uint32_t character = 'A'; character <= 'Z'; character++)
+    {
+      if (hasLetter[character - 'A'])
+      {
+        add_code_point_range(&(regExp_p->codePoints), character, character);
+        add_code_point_range(&(regExp_p->codePoints),
+                             other_char_case(character),
+                             other_char_case(character));
+      }
+    }
+    normalize_code_point_set(&(regExp_p->codePoints));
+    if (regExp_p->isNegated)
+    {
+      invert_code_point_set(&(regExp_p->codePoints));
+    }
+  }
+  else if (regExp_p->type == REGEXP_CHAR_CLASS)
+  {
+    for (int i = 0; i < NUM_CHAR_CLASS_WORDS && regExp_p->isNegated; i++)
+    {
+      regExp_p->charClass[i] = ~regExp_p->charClass[i];
+    }
+    for (int character = 'A'; character <= 'Z'; character++)
+    {
+      if (is_char_in_class(regExp_p, character) ||
+          is_char_in_class(regExp_p, other_char_case(character)))
+      {
+        add_chars_to_class(regExp_p, character, character);
+        add_chars_to_class(regExp_p, other_char_case(character), other_char_case(character));
+      }
+    }
+    for (int i = 0; i < NUM_CHAR_CLASS_WORDS && regExp_p->isNegated; i++)
+    {
+      regExp_p->charClass[i] = ~regExp_p->charClass[i];
+    }
+  }
+
+  for (int i = 0; i < regExp_p->numChildren; i++)
+  {
+    fold_regexp_case(regExp_p->children[i]);
+  }
+}
+
+unsigned char other_char_case(const unsigned char character)
+{
+  if (character >= 'a' && character <= 'z')
+  {
+    return character - 'a' + 'A';
+  }
+  else if (character >= 'A' && character <= 'Z')
+  {
+    return character - 'A' + 'a';
+  }
+  return character;
+}
+
+bool is_char_in_class(const RegExpS* const regExp_p, const unsigned char character)
+{
+  return (regExp_p->charClass[character / 64] >> (character % 64)) & 1;
+}
+
+RegExpLiteralS find_required_literal(const RegExpS* const regExp_p)
+{
+  return find_literals(regExp_p).factor;
+}
+
+RegExpS* reverse_regexp(const RegExpS* const regExp_p)
+{
+  RegExpS* reversed_p = create_regexp(regExp_p->type);
+  reversed_p->minRepeats = regExp_p->minRepeats;
+  reversed_p->maxRepeats = regExp_p->maxRepeats;
+  reversed_p->isCaseInsensitive = regExp_p->isCaseInsensitive;
+  reversed_p->isNegated = regExp_p->isNegated;
+
+  if (regExp_p->type == REGEXP_STRING)
+  {
+    for (int i = 0; i < regExp_p->numChars; i++)
+    {
+      reversed_p->characters[i] = regExp_p->characters[regExp_p->numChars - 1 - i];
+    }
+    reversed_p->numChars = regExp_p->numChars;
+  }
+  else if (regExp_p->type == REGEXP_CHAR_CLASS)
+  {
+    memcpy(reversed_p->charClass, regExp_p->charClass, sizeof(reversed_p->charClass));
+  }
+  else if (regExp_p->type == REGEXP_CODE_POINT_SET)
+  {
+    // The code points stay the same, only the order of the bytes of their encodings changes.
+    copy_code_point_set(&(reversed_p->codePoints), &(regExp_p->codePoints));
+    reversed_p->isReversed = !regExp_p->isReversed;
+  }
+
+  for (int i = 0; i < regExp_p->numChildren; i++)
+  {
+    // Only the order of a sequence matters.
+    int childIdx = (regExp_p->type == REGEXP_SEQUENCE) ? regExp_p->numChildren - 1 - i : i;
+    add_child_to_regexp(reversed_p, reverse_regexp(regExp_p->children[childIdx]));
+  }
+
+  return reversed_p;
+}
+
 void print_regexp(const RegExpS* const regExp_p, const int indentation)
 {
   for (int i = 0; i < indentation; i++)
@@ -581,19 +1751,42 @@ void print_regexp(const RegExpS* const regExp_p, const int indentation)
   case REGEXP_OR:
     printf("Or\n");
     break;
+  case REGEXP_REPEAT:
+    printf("Repeat{%d,%d}\n", regExp_p->minRepeats, regExp_p->maxRepeats);
+    break;
+  case REGEXP_CODE_POINT_SET:
+    printf(regExp_p->isReversed ? "ReversedCodePointSet(" : "CodePointSet(");
+    for (int i = 0; i < regExp_p->codePoints.numRanges; i++)
+    {
+      const CodePointRangeS* range_p = &(regExp_p->codePoints.ranges_p[i]);
+      printf("%X-%X ", range_p->first, range_p->last);
+    }
+    printf(")\n");
+    break;
   case REGEXP_STRING:
-    printf("String(\"");
+    printf(regExp_p->isCaseInsensitive ? "CaseInsensitiveString(\"" : "String(\"");
     for (int i = 0; i < regExp_p->numChars; i++)
     {
       printf("%c", regExp_p->characters[i]);
     }
     printf("\")\n");
     break;
-  case REGEXP_ONE_OF:
-    printf("OneOf\n");
-    break;
-  case REGEXP_RANGE:
-    printf("Range\n");
+  case REGEXP_CHAR_CLASS:
+    printf("CharClass(");
+    for (int character = 0; character < 256; character++)
+    {
+      if (is_char_in_class(regExp_p, character))
+      {
+        int lastChar = character;
+        while (lastChar + 1 < 256 && is_char_in_class(regExp_p, lastChar + 1))
+        {
+          lastChar++;
+        }
+        printf(lastChar > character ? "%d-%d " : "%d ", character, lastChar);
+        character = lastChar;
+      }
+    }
+    printf(")\n");
     break;
   }
 
@@ -9,10 +9,21 @@
 #define REG_EXP_H
 
 /*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "unicode.h"
 
 /*> Defines ***************************************************************************************/
 #define MAX_NUM_REGEXP_CHILDREN 20
 #define MAX_REGEXP_STRING_LENGTH 100
+#define UNBOUNDED_LENGTH -1
+#define NUM_CHAR_CLASS_WORDS 4
+#define MAX_NUM_REPEATS 1000
+#define MAX_REGEXP_NESTING_DEPTH 32
+#define UNBOUNDED_REPEATS -1
+#define CASE_INSENSITIVE_PREFIX "(?i)"
+#define INITIAL_REGEXP_TABLE_SIZE 64
 
 /*> Type Declarations *****************************************************************************/
 /**
@@ -26,8 +37,9 @@ typedef enum RegExpTypeE
   REGEXP_ZERO_OR_MORE,
   REGEXP_OR,
   REGEXP_STRING,
-  REGEXP_ONE_OF,
-  REGEXP_RANGE
+  REGEXP_CHAR_CLASS,
+  REGEXP_REPEAT,
+  REGEXP_CODE_POINT_SET
 } RegExpTypeE;
 
 /**
@@ -40,10 +52,27 @@ typedef enum RegExpTypeE
  * @param right_p     The RegExp on the right side of an operator.
  * @param characters  The characters contained in this RegExp. Only used for RegExp strings.
  * @param numChars    The number of characters of the string contained in the RegExp.
+ * @param charClass   The chars matched by a RegExp char class, as a bit set of 256 bits.
+ * @param minRepeats  The minimum number of times the child of a RegExp repeat is matched.
+ * @param maxRepeats  The maximum number of times the child of a RegExp repeat is matched, or
+ *                    UNBOUNDED_REPEATS.
+ * @param isCaseInsensitive  True if a RegExp string also matches its letters in the other case.
+ * @param isReversed  True if a RegExp code point set matches the UTF-8 encodings backwards.
+ * @param isNegated   True if a RegExp char class or code point set is the complement of the
+ *                    members of a list such as "[^a]", so case folding folds the members.
+ * @param codePoints  The code points matched by a RegExp code point set, normalized.
+ * @param numRefs     The number of references to this RegExp. RegExps shared by share_regexp() are
+ *                    only freed once the last reference is freed.
  */
 typedef struct RegExpS
 {
   RegExpTypeE type;
+  int numRefs;
+  int minRepeats;
+  int maxRepeats;
+  bool isCaseInsensitive;
+  bool isReversed;
+  bool isNegated;
   
   int numChildren;
   union 
@@ -60,16 +89,45 @@ typedef struct RegExpS
       char characters[MAX_REGEXP_STRING_LENGTH];
       int numChars;
     };
+    uint64_t charClass[NUM_CHAR_CLASS_WORDS];
+    CodePointSetS codePoints;
   };
 } RegExpS;
 
+/**
+ * @brief A literal string contained in every string matched by a RegExp.
+ * @param characters  The characters of the literal.
+ * @param numChars    The number of characters, 0 if there is no such literal.
+ * @param maxOffset   The maximum index of the literal in a matched string, or UNBOUNDED_LENGTH.
+ */
+typedef struct RegExpLiteralS
+{
+  char characters[MAX_REGEXP_STRING_LENGTH];
+  int numChars;
+  int maxOffset;
+} RegExpLiteralS;
+
+/**
+ * @brief A hash table of RegExps, used to share equal RegExps instead of storing copies.
+ * @param entries_pp  The RegExps, NULL where an entry is free. Holds a reference to each.
+ * @param numEntries  The number of RegExps in the table.
+ * @param size        The number of entries of the table, a power of 2.
+ */
+typedef struct RegExpTableS
+{
+  RegExpS** entries_pp;
+  int numEntries;
+  int size;
+} RegExpTableS;
+
 /*> Constant Declarations *************************************************************************/
 
 /*> Variable Declarations *************************************************************************/
 
 /*> Function Declarations *************************************************************************/
 /**
- * @brief Frees a regular expression.
+ * @brief Frees a reference to a regular expression, and the RegExp once no references are left.
+ *        The RegExps left to free are kept on a work stack instead of the call stack.
  * @param[in]  regExp_p  The RegExp.
  */
 void free_regexp(RegExpS* const regExp_p);
@@ -82,12 +140,75 @@ void free_regexp(RegExpS* const regExp_p);
 void free_regexps(RegExpS** const regExps_pp, const int numRegExps);
 
 /**
- * @brief Parses a regular expression.
+ * @brief Parses a regular expression. A regular expression starting with CASE_INSENSITIVE_PREFIX
+ *        is folded with fold_regexp_case().
  * @param[in] regExpString_p The regular expression as a string.
  * @return The regular expression.
  */
 RegExpS* parse_regexp(const char* const regExpString_p);
 
+/**
+ * @brief Initializes an empty RegExp table.
+ * @param[out]  table_p  The table.
+ */
+void init_regexp_table(RegExpTableS* const table_p);
+
+/**
+ * @brief Replaces a RegExp and its subtrees with equal RegExps from a table, adding those that are
+ *        not in it yet. Identical subtrees of all RegExps shared through the table are then stored
+ *        once, so later passes can memoize per RegExp. Shared RegExps must not be changed, so
+ *        fold_regexp_case() must be called before.
+ * @param[in/out]  table_p   The table.
+ * @param[in]      regExp_p  The RegExp, which is freed if an equal one is in the table.
+ * @return The shared RegExp, which must be freed with free_regexp().
+ */
+RegExpS* share_regexp(RegExpTableS* const table_p, RegExpS* const regExp_p);
+
+/**
+ * @brief Frees a RegExp table and its references to its RegExps.
+ * @param[in/out]  table_p  The table.
+ */
+void free_regexp_table(RegExpTableS* const table_p);
+
+/**
+ * @brief Makes a RegExp match every letter in both upper and lower case. Char classes get the other
+ *        case added to their bit set, strings are marked so that the NFA gets an edge for both. A
+ *        negated class gets the other case added to its members before it is inverted again, so
+ *        it matches neither case of a listed letter.
+ * @param[in/out]  regExp_p  The RegExp.
+ */
+void fold_regexp_case(RegExpS* const regExp_p);
+
+/**
+ * @brief Gets the other case of an ASCII letter.
+ * @param[in]  character  The char.
+ * @return The char in the other case, or the char itself if it is not a letter.
+ */
+unsigned char other_char_case(const unsigned char character);
+
+/**
+ * @brief Checks if a char is matched by a RegExp char class.
+ * @param[in]  regExp_p   The RegExp char class.
+ * @param[in]  character  The char.
+ * @return true if the char is in the class, false otherwise.
+ */
+bool is_char_in_class(const RegExpS* const regExp_p, const unsigned char character);
+
+/**
+ * @brief Finds a literal that every string matched by the RegExp contains, preferring literals at a
+ *        bounded offset from the start of the match and then longer literals.
+ * @param[in]  regExp_p  The RegExp.
+ * @return The literal, with numChars 0 if the RegExp has no required literal.
+ */
+RegExpLiteralS find_required_literal(const RegExpS* const regExp_p);
+
+/**
+ * @brief Creates a RegExp matching the reverse of every string the provided RegExp matches.
+ * @param[in]  regExp_p  The RegExp.
+ * @return The reversed RegExp, which must be freed with free_regexp().
+ */
+RegExpS* reverse_regexp(const RegExpS* const regExp_p);
+
 /**
  * @brief Prints the structure of a regexp.
  * @param[in]  regExp_p     The RegExp to print.
@@ -0,0 +1,709 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Finds all occurrences of a set of regular expressions anywhere in an input.
+* @file search.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+#include "dfa.h"
+#include "nfa.h"
+#include "reg_exp.h"
+#include "search.h"
+
+/*> Defines ***************************************************************************************/
+#define MIN_SEARCH_CHUNK_LENGTH  (64 * 1024)
+#define INITIAL_MAX_NUM_INDICIES 64
+#define NO_START                 ((size_t) -1)
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A growable array of indicies into the input.
+ * @param indicies_p      The indicies.
+ * @param numIndicies     The number of indicies.
+ * @param maxNumIndicies  The number of indicies there is room for.
+ */
+typedef struct IndexArrayS
+{
+  size_t* indicies_p;
+  int numIndicies;
+  int maxNumIndicies;
+} IndexArrayS;
+
+/**
+ * @brief The result of searching a chunk of the input for match ends.
+ * @param ends_p      The match ends found in the chunk, one index array per RegExp.
+ * @param finalState  The state of the unanchored DFA after the chunk.
+ */
+typedef struct ChunkResultS
+{
+  IndexArrayS* ends_p;
+  int finalState;
+} ChunkResultS;
+
+/**
+ * @brief The work of one search thread.
+ * @param searcher_p  The searcher.
+ * @param input_p     The input.
+ * @param startIdx    The index of the first char of the chunk.
+ * @param endIdx      The index after the last char of the chunk.
+ * @param result_p    The result of the chunk.
+ */
+typedef struct ChunkWorkS
+{
+  const SearcherS* searcher_p;
+  const unsigned char* input_p;
+  size_t startIdx;
+  size_t endIdx;
+  ChunkResultS* result_p;
+} ChunkWorkS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Appends an index to an index array.
+ * @param[in/out]  indexArray_p  The index array.
+ * @param[in]      charIdx       The index.
+ */
+static void add_index(IndexArrayS* const indexArray_p, const size_t charIdx);
+
+/**
+ * @brief Appends a match to a match array.
+ * @param[in/out]  matches_p  The match array.
+ * @param[in]      match_p    The match.
+ */
+static void add_match(SearchMatchArrayS* const matches_p, const SearchMatchS* const match_p);
+
+/**
+ * @brief Converts an NFA of a searcher to a DFA and frees the NFA.
+ * @param[in]  nfa_p  The NFA.
+ * @return Pointer to allocated DFA, NULL if it would have more than MAX_NUM_DFA_STATES - 1 states.
+ */
+static DfaS* convert_searcher_nfa(NfaS* const nfa_p);
+
+/**
+ * @brief Checks if a DFA state is an end state of a RegExp.
+ * @param[in]  dfa_p  The DFA.
+ * @param[in]  state  The index of the state.
+ * @param[in]  rule   The index of the RegExp.
+ * @return true if the state accepts the RegExp, false otherwise.
+ */
+static bool accepts_rule(const DfaS* const dfa_p, const int state, const int rule);
+
+/**
+ * @brief Appends an index to the match ends of every RegExp a DFA state accepts.
+ * @param[in]      dfa_p    The DFA.
+ * @param[in]      state    The index of the state.
+ * @param[in]      charIdx  The index.
+ * @param[in/out]  ends_p   The match ends, one index array per RegExp.
+ */
+static void add_accepted_ends(const DfaS* const dfa_p,
+                              const int state,
+                              const size_t charIdx,
+                              IndexArrayS* const ends_p);
+
+/**
+ * @brief Runs the unanchored DFA over part of the input and records every index where it accepts,
+ *        for each RegExp it accepts there.
+ * @param[in]   dfa_p     The unanchored DFA.
+ * @param[in]   input_p   The input.
+ * @param[in]   startIdx  The index of the first char to read.
+ * @param[in]   endIdx    The index after the last char to read.
+ * @param[in]   state     The state to start in.
+ * @param[out]  ends_p    The match ends, one index array per RegExp.
+ * @return The state after reading the chars.
+ */
+static int find_ends(const DfaS* const dfa_p,
+                     const unsigned char* const input_p,
+                     const size_t startIdx,
+                     const size_t endIdx,
+                     int state,
+                     IndexArrayS* const ends_p);
+
+/**
+ * @brief Runs the unanchored DFA only near the occurrences of the required literals and records
+ *        every index where it accepts, for each RegExp it accepts there. Every match containing an
+ *        occurrence starts at most maxOffset chars before it, so the DFA is started there from its
+ *        start state and run until it is back in the start state after the occurrence.
+ * @param[in]   dfa_p          The unanchored DFA.
+ * @param[in]   input_p        The input.
+ * @param[in]   inputLength    The number of chars in the input.
+ * @param[in]   candidates_p   The indicies of the occurrences, in increasing order.
+ * @param[in]   maxOffset      The maximum index of a literal in a match.
+ * @param[out]  ends_p         The match ends, one index array per RegExp.
+ */
+static void find_candidate_ends(const DfaS* const dfa_p,
+                                const unsigned char* const input_p,
+                                const size_t inputLength,
+                                const IndexArrayS* const candidates_p,
+                                const int maxOffset,
+                                IndexArrayS* const ends_p);
+
+/**
+ * @brief Searches a chunk for the match ends of every RegExp, assuming no match started before it.
+ * @param[in/out]  work_p  The chunk work, a ChunkWorkS.
+ * @return NULL.
+ */
+static void* search_chunk(void* work_p);
+
+/**
+ * @brief Corrects the result of a chunk that was searched from the start state of the unanchored
+ *        DFA, given the state the DFA actually has at the start of the chunk. Both states are run
+ *        in lockstep until they meet, after which the original result is correct.
+ * @param[in]      dfa_p       The unanchored DFA.
+ * @param[in]      input_p     The input.
+ * @param[in]      startIdx    The index of the first char of the chunk.
+ * @param[in]      endIdx      The index after the last char of the chunk.
+ * @param[in]      state       The state of the DFA at the start of the chunk.
+ * @param[in]      numRules    The number of RegExps.
+ * @param[in/out]  result_p    The result of the chunk.
+ */
+static void fix_chunk_result(const DfaS* const dfa_p,
+                             const unsigned char* const input_p,
+                             const size_t startIdx,
+                             const size_t endIdx,
+                             const int state,
+                             const int numRules,
+                             ChunkResultS* const result_p);
+
+/**
+ * @brief Finds the earliest start of a match of a RegExp ending at an index by running the reverse
+ *        DFA backwards from it.
+ * @param[in]  dfa_p          The reverse DFA.
+ * @param[in]  input_p        The input.
+ * @param[in]  endIdx         The end of the match.
+ * @param[in]  minStartIdx    The earliest allowed start.
+ * @param[in]  rule           The index of the RegExp.
+ * @return The start index, NO_START if no non-empty match starts at or after minStartIdx.
+ */
+static size_t find_start(const DfaS* const dfa_p,
+                         const unsigned char* const input_p,
+                         const size_t endIdx,
+                         const size_t minStartIdx,
+                         const int rule);
+
+/**
+ * @brief Finds the end of the longest match of a RegExp starting at an index.
+ * @param[in]  dfa_p        The anchored DFA.
+ * @param[in]  input_p      The input.
+ * @param[in]  inputLength  The number of chars in the input.
+ * @param[in]  startIdx     The start of the match.
+ * @param[in]  rule         The index of the RegExp.
+ * @return The end index, startIdx if there is no non-empty match.
+ */
+static size_t find_longest_end(const DfaS* const dfa_p,
+                               const unsigned char* const input_p,
+                               const size_t inputLength,
+                               const size_t startIdx,
+                               const int rule);
+
+/**
+ * @brief Compares two matches by start index and then rule, for qsort().
+ * @param[in]  match1_p  The first match.
+ * @param[in]  match2_p  The second match.
+ * @return Negative, zero or positive if the first match is ordered before, with or after the second.
+ */
+static int compare_matches(const void* match1_p, const void* match2_p);
+
+/*> Local Function Definitions ********************************************************************/
+static void add_index(IndexArrayS* const indexArray_p, const size_t charIdx)
+{
+  if (indexArray_p->numIndicies == indexArray_p->maxNumIndicies)
+  {
+    indexArray_p->maxNumIndicies = indexArray_p->maxNumIndicies > 0 ?
+                                   2 * indexArray_p->maxNumIndicies :
+                                   INITIAL_MAX_NUM_INDICIES;
+    indexArray_p->indicies_p = realloc(indexArray_p->indicies_p,
+                                       sizeof(size_t) * indexArray_p->maxNumIndicies);
+    assert(indexArray_p->indicies_p != NULL);
+  }
+  indexArray_p->indicies_p[indexArray_p->numIndicies] = charIdx;
+  indexArray_p->numIndicies++;
+}
+
+static void add_match(SearchMatchArrayS* const matches_p, const SearchMatchS* const match_p)
+{
+  if (matches_p->numMatches == matches_p->maxNumMatches)
+  {
+    matches_p->maxNumMatches = matches_p->maxNumMatches > 0 ?
+                               2 * matches_p->maxNumMatches :
+                               INITIAL_MAX_NUM_INDICIES;
+    matches_p->matches_p = realloc(matches_p->matches_p,
+                                   sizeof(SearchMatchS) * matches_p->maxNumMatches);
+    assert(matches_p->matches_p != NULL);
+  }
+  matches_p->matches_p[matches_p->numMatches] = *match_p;
+  matches_p->numMatches++;
+}
+
+static DfaS* convert_searcher_nfa(NfaS* const nfa_p)
+{
+  DfaS* dfa_p = try_convert_to_dfa(nfa_p, MAX_NUM_DFA_STATES - 1);
+  free(nfa_p);
+  return dfa_p;
+}
+
+static bool accepts_rule(const DfaS* const dfa_p, const int state, const int rule)
+{
+  const DfaStateS* dfaState_p = &(dfa_p->states[state]);
+  if (dfa_p->hasRuleBitmaps)
+  {
+    return is_in_bitset(&(dfaState_p->acceptedRuleBitmap), rule);
+  }
+  for (int i = 0; i < dfaState_p->numAcceptedRules; i++)
+  {
+    if (dfa_p->acceptedRules_p[dfaState_p->acceptedRulesIdx + i] == rule)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void add_accepted_ends(const DfaS* const dfa_p,
+                              const int state,
+                              const size_t charIdx,
+                              IndexArrayS* const ends_p)
+{
+  const DfaStateS* dfaState_p = &(dfa_p->states[state]);
+  for (int i = 0; i < dfaState_p->numAcceptedRules; i++)
+  {
+    add_index(&(ends_p[dfa_p->acceptedRules_p[dfaState_p->acceptedRulesIdx + i]]), charIdx);
+  }
+}
+
+static int find_ends(const DfaS* const dfa_p,
+                     const unsigned char* const input_p,
+                     const size_t startIdx,
+                     const size_t endIdx,
+                     int state,
+                     IndexArrayS* const ends_p)
+{
+  // The start state of an unanchored DFA loops on every char, so the DFA never gets stuck.
+  for (size_t i = startIdx; i < endIdx; i++)
+  {
+    state = dfa_p->states[state].transitions[input_p[i]];
+    if (dfa_p->states[state].isEndState)
+    {
+      add_accepted_ends(dfa_p, state, i + 1, ends_p);
+    }
+  }
+  return state;
+}
+
+static void find_candidate_ends(const DfaS* const dfa_p,
+                                const unsigned char* const input_p,
+                                const size_t inputLength,
+                                const IndexArrayS* const candidates_p,
+                                const int maxOffset,
+                                IndexArrayS* const ends_p)
+{
+  int state = 0;
+  size_t charIdx = 0;
+  for (int i = 0; i < candidates_p->numIndicies; i++)
+  {
+    size_t candidateIdx = candidates_p->indicies_p[i];
+    size_t wakeIdx = candidateIdx > (size_t) maxOffset ? candidateIdx - maxOffset : 0;
+    if (state == 0 && wakeIdx > charIdx)
+    {
+      charIdx = wakeIdx;
+    }
+
+    while (charIdx < inputLength && (charIdx <= candidateIdx || state != 0))
+    {
+      state = dfa_p->states[state].transitions[input_p[charIdx]];
+      charIdx++;
+      if (dfa_p->states[state].isEndState)
+      {
+        add_accepted_ends(dfa_p, state, charIdx, ends_p);
+      }
+    }
+  }
+}
+
+static void* search_chunk(void* work_p)
+{
+  ChunkWorkS* chunkWork_p = work_p;
+  ChunkResultS* result_p = chunkWork_p->result_p;
+
+  result_p->finalState = find_ends(chunkWork_p->searcher_p->unanchoredDfa_p,
+                                   chunkWork_p->input_p,
+                                   chunkWork_p->startIdx,
+                                   chunkWork_p->endIdx,
+                                   0,
+                                   result_p->ends_p);
+
+  return NULL;
+}
+
+static void fix_chunk_result(const DfaS* const dfa_p,
+                             const unsigned char* const input_p,
+                             const size_t startIdx,
+                             const size_t endIdx,
+                             const int state,
+                             const int numRules,
+                             ChunkResultS* const result_p)
+{
+  IndexArrayS* fixedEnds_p = calloc(numRules, sizeof(IndexArrayS));
+  assert(fixedEnds_p != NULL);
+  int actualState = state;
+  int guessedState = 0;
+  size_t charIdx = startIdx;
+
+  while (charIdx < endIdx && actualState != guessedState)
+  {
+    actualState = dfa_p->states[actualState].transitions[input_p[charIdx]];
+    guessedState = dfa_p->states[guessedState].transitions[input_p[charIdx]];
+    charIdx++;
+    if (actualState != guessedState && dfa_p->states[actualState].isEndState)
+    {
+      add_accepted_ends(dfa_p, actualState, charIdx, fixedEnds_p);
+    }
+  }
+
+  // From charIdx on the guessed run equals the actual run, so its ends can be kept.
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    const IndexArrayS* ends_p = &(result_p->ends_p[rule]);
+    for (int i = 0; i < ends_p->numIndicies; i++)
+    {
+      if (ends_p->indicies_p[i] >= charIdx && actualState == guessedState)
+      {
+        add_index(&(fixedEnds_p[rule]), ends_p->indicies_p[i]);
+      }
+    }
+    free(ends_p->indicies_p);
+  }
+  if (actualState != guessedState)
+  {
+    result_p->finalState = actualState;
+  }
+
+  free(result_p->ends_p);
+  result_p->ends_p = fixedEnds_p;
+}
+
+static size_t find_start(const DfaS* const dfa_p,
+                         const unsigned char* const input_p,
+                         const size_t endIdx,
+                         const size_t minStartIdx,
+                         const int rule)
+{
+  size_t startIdx = NO_START;
+  int state = 0;
+  for (size_t charIdx = endIdx; charIdx > minStartIdx; charIdx--)
+  {
+    state = dfa_p->states[state].transitions[input_p[charIdx - 1]];
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (accepts_rule(dfa_p, state, rule))
+    {
+      startIdx = charIdx - 1;
+    }
+  }
+  return startIdx;
+}
+
+static size_t find_longest_end(const DfaS* const dfa_p,
+                               const unsigned char* const input_p,
+                               const size_t inputLength,
+                               const size_t startIdx,
+                               const int rule)
+{
+  size_t endIdx = startIdx;
+  int state = 0;
+  for (size_t charIdx = startIdx; charIdx < inputLength; charIdx++)
+  {
+    state = dfa_p->states[state].transitions[input_p[charIdx]];
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (accepts_rule(dfa_p, state, rule))
+    {
+      endIdx = charIdx + 1;
+    }
+  }
+  return endIdx;
+}
+
+static int compare_matches(const void* match1_p, const void* match2_p)
+{
+  const SearchMatchS* first_p = match1_p;
+  const SearchMatchS* second_p = match2_p;
+  if (first_p->startIdx != second_p->startIdx)
+  {
+    return first_p->startIdx < second_p->startIdx ? -1 : 1;
+  }
+  return first_p->rule - second_p->rule;
+}
+
+/*> Global Function Definitions *******************************************************************/
+SearcherS* generate_searcher(const char** const regExpStrs_pp, const int numRegExps)
+{
+  RegExpS* regExps_pp[numRegExps];
+  RegExpS* reversedRegExps_pp[numRegExps];
+  for (int i = 0; i < numRegExps; i++)
+  {
+    regExps_pp[i] = parse_regexp(regExpStrs_pp[i]);
+    reversedRegExps_pp[i] = reverse_regexp(regExps_pp[i]);
+  }
+
+  // The unanchored NFA has the same states as the anchored one, and reversing keeps the count.
+  DfaS* unanchoredDfa_p = NULL;
+  DfaS* reverseDfa_p = NULL;
+  DfaS* anchoredDfa_p = NULL;
+  if (count_combined_nfa_states(regExps_pp, numRegExps) < MAX_NUM_NFA_STATES)
+  {
+    unanchoredDfa_p = convert_searcher_nfa(generate_unanchored_combined_nfa(regExps_pp,
+                                                                            numRegExps));
+  }
+  if (unanchoredDfa_p != NULL)
+  {
+    reverseDfa_p = convert_searcher_nfa(generate_combined_nfa(reversedRegExps_pp, numRegExps));
+  }
+  if (reverseDfa_p != NULL)
+  {
+    anchoredDfa_p = convert_searcher_nfa(generate_combined_nfa(regExps_pp, numRegExps));
+  }
+
+  SearcherS* searcher_p = NULL;
+  if (anchoredDfa_p != NULL)
+  {
+    searcher_p = malloc(sizeof(*searcher_p));
+    assert(searcher_p != NULL);
+    searcher_p->unanchoredDfa_p = unanchoredDfa_p;
+    searcher_p->reverseDfa_p = reverseDfa_p;
+    searcher_p->anchoredDfa_p = anchoredDfa_p;
+  }
+  else if (reverseDfa_p != NULL)
+  {
+    free_dfa(unanchoredDfa_p);
+    free_dfa(reverseDfa_p);
+  }
+  else if (unanchoredDfa_p != NULL)
+  {
+    free_dfa(unanchoredDfa_p);
+  }
+
+  if (searcher_p != NULL)
+  {
+    searcher_p->numRules = numRegExps;
+    searcher_p->literals_p = malloc(sizeof(RegExpLiteralS) * numRegExps);
+    searcher_p->ruleLiterals_p = malloc(sizeof(int) * numRegExps);
+    searcher_p->literalRules_p = malloc(sizeof(int) * numRegExps);
+    searcher_p->maxLiteralOffset = 0;
+    searcher_p->literalFinder_p = malloc(sizeof(LiteralFinderS));
+    init_literal_finder(searcher_p->literalFinder_p);
+
+    for (int i = 0; i < numRegExps; i++)
+    {
+      searcher_p->literals_p[i] = find_required_literal(regExps_pp[i]);
+      searcher_p->ruleLiterals_p[i] = add_finder_literal(searcher_p->literalFinder_p,
+                                                         &(searcher_p->literals_p[i]));
+      if (searcher_p->ruleLiterals_p[i] != NO_LITERAL)
+      {
+        searcher_p->literalRules_p[searcher_p->ruleLiterals_p[i]] = i;
+        if (searcher_p->literals_p[i].maxOffset != UNBOUNDED_LENGTH &&
+            searcher_p->literals_p[i].maxOffset > searcher_p->maxLiteralOffset)
+        {
+          searcher_p->maxLiteralOffset = searcher_p->literals_p[i].maxOffset;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < numRegExps; i++)
+  {
+    free_regexp(regExps_pp[i]);
+    free_regexp(reversedRegExps_pp[i]);
+  }
+
+  return searcher_p;
+}
+
+void free_searcher(SearcherS* const searcher_p)
+{
+  free_dfa(searcher_p->unanchoredDfa_p);
+  free_dfa(searcher_p->reverseDfa_p);
+  free_dfa(searcher_p->anchoredDfa_p);
+  free(searcher_p->literals_p);
+  free(searcher_p->ruleLiterals_p);
+  free(searcher_p->literalRules_p);
+  free(searcher_p->literalFinder_p);
+  free(searcher_p);
+}
+
+void search(const SearcherS* const searcher_p,
+            const char* const input_p,
+            const size_t inputLength,
+            const int numThreads,
+            SearchMatchArrayS* const matches_p)
+{
+  const unsigned char* uInput_p = (const unsigned char*) input_p;
+  const int numRules = searcher_p->numRules;
+
+  // Find the required literals of all RegExps in one pass.
+  LiteralMatchArrayS literalMatches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+  find_literals_in_input(searcher_p->literalFinder_p, input_p, inputLength, &literalMatches);
+  IndexArrayS candidates = { .indicies_p = NULL, .numIndicies = 0, .maxNumIndicies = 0 };
+  bool hasCandidates[numRules];
+  memset(hasCandidates, 0, sizeof(hasCandidates));
+  for (int i = 0; i < literalMatches.numMatches; i++)
+  {
+    hasCandidates[searcher_p->literalRules_p[literalMatches.matches_p[i].literal]] = true;
+    add_index(&candidates, literalMatches.matches_p[i].charIdx);
+  }
+  free_literal_match_array(&literalMatches);
+
+  // A RegExp without a literal, or with a literal that occurs but may be anywhere in a match, needs
+  // the whole input to be searched. Otherwise the DFA only has to run near the occurrences.
+  bool needsFullScan = false;
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    needsFullScan = needsFullScan ||
+                    searcher_p->ruleLiterals_p[rule] == NO_LITERAL ||
+                    (hasCandidates[rule] &&
+                     searcher_p->literals_p[rule].maxOffset == UNBOUNDED_LENGTH);
+  }
+
+  IndexArrayS* ends_p = calloc(numRules, sizeof(IndexArrayS));
+  assert(ends_p != NULL);
+  if (!needsFullScan)
+  {
+    find_candidate_ends(searcher_p->unanchoredDfa_p,
+                        uInput_p,
+                        inputLength,
+                        &candidates,
+                        searcher_p->maxLiteralOffset,
+                        ends_p);
+  }
+  else
+  {
+    int numChunks = numThreads;
+    if (numChunks < 1 || inputLength < (size_t) numChunks * MIN_SEARCH_CHUNK_LENGTH)
+    {
+      numChunks = 1;
+    }
+
+    // Search every chunk in parallel as if no match started before it.
+    ChunkWorkS chunkWorks[numChunks];
+    ChunkResultS results[numChunks];
+    pthread_t threads[numChunks];
+    for (int i = 0; i < numChunks; i++)
+    {
+      results[i].ends_p = calloc(numRules, sizeof(IndexArrayS));
+      assert(results[i].ends_p != NULL);
+      chunkWorks[i].searcher_p = searcher_p;
+      chunkWorks[i].input_p = uInput_p;
+      chunkWorks[i].startIdx = inputLength / numChunks * i;
+      chunkWorks[i].endIdx = (i == numChunks - 1) ? inputLength : inputLength / numChunks * (i + 1);
+      chunkWorks[i].result_p = &(results[i]);
+      if (i > 0)
+      {
+        int error = pthread_create(&(threads[i]), NULL, search_chunk, &(chunkWorks[i]));
+        assert(error == 0);
+      }
+    }
+    search_chunk(&(chunkWorks[0]));
+    for (int i = 1; i < numChunks; i++)
+    {
+      pthread_join(threads[i], NULL);
+    }
+
+    // Correct the chunks for the matches that did start before them.
+    for (int i = 0; i < numChunks; i++)
+    {
+      if (i > 0)
+      {
+        fix_chunk_result(searcher_p->unanchoredDfa_p,
+                         uInput_p,
+                         chunkWorks[i].startIdx,
+                         chunkWorks[i].endIdx,
+                         results[i - 1].finalState,
+                         numRules,
+                         &(results[i]));
+      }
+      for (int rule = 0; rule < numRules; rule++)
+      {
+        IndexArrayS* chunkEnds_p = &(results[i].ends_p[rule]);
+        for (int j = 0; j < chunkEnds_p->numIndicies; j++)
+        {
+          add_index(&(ends_p[rule]), chunkEnds_p->indicies_p[j]);
+        }
+        free(chunkEnds_p->indicies_p);
+      }
+      free(results[i].ends_p);
+    }
+  }
+
+  // Turn ends into matches.
+  int firstNewMatchIdx = matches_p->numMatches;
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    size_t prevEndIdx = 0;
+    for (int i = 0; i < ends_p[rule].numIndicies; i++)
+    {
+      size_t endIdx = ends_p[rule].indicies_p[i];
+      if (endIdx <= prevEndIdx)
+      {
+        continue;
+      }
+
+      size_t startIdx = find_start(searcher_p->reverseDfa_p, uInput_p, endIdx, prevEndIdx, rule);
+      if (startIdx != NO_START)
+      {
+        SearchMatchS match =
+        {
+          .rule = rule,
+          .startIdx = startIdx,
+          .endIdx = find_longest_end(searcher_p->anchoredDfa_p,
+                                     uInput_p,
+                                     inputLength,
+                                     startIdx,
+                                     rule)
+        };
+        add_match(matches_p, &match);
+        prevEndIdx = match.endIdx;
+      }
+    }
+  }
+
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    free(ends_p[rule].indicies_p);
+  }
+  free(ends_p);
+  free(candidates.indicies_p);
+
+  if (matches_p->numMatches > firstNewMatchIdx)
+  {
+    qsort(&(matches_p->matches_p[firstNewMatchIdx]),
+          matches_p->numMatches - firstNewMatchIdx,
+          sizeof(SearchMatchS),
+          compare_matches);
+  }
+}
+
+void free_search_match_array(SearchMatchArrayS* const matches_p)
+{
+  free(matches_p->matches_p);
+  matches_p->matches_p = NULL;
+  matches_p->numMatches = 0;
+  matches_p->maxNumMatches = 0;
+}
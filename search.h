@@ -0,0 +1,123 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Finds all occurrences of a set of regular expressions anywhere in an input.
+ * @file search.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef SEARCH_H
+#define SEARCH_H
+
+/*> Includes **************************************************************************************/
+#include <stddef.h>
+
+#include "dfa.h"
+#include "reg_exp.h"
+#include "simd_scan.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief Compiled regular expressions to search for. The RegExps R1..Rn are compiled together to
+ *        three DFAs whose end states list the RegExps they accept: one for ".*(R1|...|Rn)" that
+ *        finds where matches end, one for the reversed RegExps that finds where a match ending at
+ *        a given index starts, and one for the RegExps that finds the longest match from a start.
+ *        If every RegExp has a required literal, the input is only searched near occurrences of
+ *        them.
+ * @param numRules          The number of RegExps.
+ * @param unanchoredDfa_p   The DFA finding match ends.
+ * @param reverseDfa_p      The DFA finding match starts.
+ * @param anchoredDfa_p     The DFA finding the longest match from a start.
+ * @param literals_p        The required literal of each RegExp.
+ * @param ruleLiterals_p    The index of each RegExp's literal in the finder, or NO_LITERAL.
+ * @param literalRules_p    The RegExp of each literal in the finder.
+ * @param maxLiteralOffset  The highest maxOffset of the literals in the finder.
+ * @param literalFinder_p   Finds the required literals of all RegExps at once.
+ */
+typedef struct SearcherS
+{
+  int numRules;
+  DfaS* unanchoredDfa_p;
+  DfaS* reverseDfa_p;
+  DfaS* anchoredDfa_p;
+  RegExpLiteralS* literals_p;
+  int* ruleLiterals_p;
+  int* literalRules_p;
+  int maxLiteralOffset;
+  LiteralFinderS* literalFinder_p;
+} SearcherS;
+
+/**
+ * @brief A match of a RegExp.
+ * @param rule      The index of the matching RegExp.
+ * @param startIdx  The index of the first char of the match.
+ * @param endIdx    The index after the last char of the match.
+ */
+typedef struct SearchMatchS
+{
+  int rule;
+  size_t startIdx;
+  size_t endIdx;
+} SearchMatchS;
+
+/**
+ * @brief A growable array of matches.
+ * @param matches_p      The matches.
+ * @param numMatches     The number of matches.
+ * @param maxNumMatches  The number of matches there is room for.
+ */
+typedef struct SearchMatchArrayS
+{
+  SearchMatchS* matches_p;
+  int numMatches;
+  int maxNumMatches;
+} SearchMatchArrayS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Generates a searcher for the input regular expressions.
+ * @param[in]  regExpStrs_pp  Array of regular expressions as strings.
+ * @param[in]  numRegExps     The number of regular expressions.
+ * @return The generated searcher, NULL if one of its DFAs would have more than
+ *         MAX_NUM_DFA_STATES - 1 states or the RegExps need too many NFA states.
+ */
+SearcherS* generate_searcher(const char** const regExpStrs_pp, const int numRegExps);
+
+/**
+ * @brief Frees a searcher.
+ * @param[in]  searcher_p  The searcher.
+ */
+void free_searcher(SearcherS* const searcher_p);
+
+/**
+ * @brief Finds the matches of every RegExp in the input. For each RegExp, matches are found in
+ *        order of their end; a match starts at the earliest index that does not overlap the
+ *        previous match of the RegExp and is extended to the longest match from that start. Empty
+ *        matches are not reported. If every RegExp has a required literal at a bounded offset, the
+ *        DFA is only run near their occurrences; otherwise it is run over the whole input once,
+ *        split in chunks searched in parallel.
+ * @param[in]   searcher_p   The searcher.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[in]   numThreads   The maximum number of threads to search with.
+ * @param[out]  matches_p    The array to append the matches to, sorted by start index and rule.
+ */
+void search(const SearcherS* const searcher_p,
+            const char* const input_p,
+            const size_t inputLength,
+            const int numThreads,
+            SearchMatchArrayS* const matches_p);
+
+/**
+ * @brief Frees the matches of a match array and empties it.
+ * @param[in/out]  matches_p  The match array.
+ */
+void free_search_match_array(SearchMatchArrayS* const matches_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
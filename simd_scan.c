@@ -0,0 +1,626 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Finds candidate positions in an input many chars at a time, so that the DFAs only need to
+*        run near them.
+* @file simd_scan.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "simd_scan.h"
+
+/*> Defines ***************************************************************************************/
+#define VECTOR_SIZE                   16
+#define INITIAL_MAX_NUM_LITERAL_MATCHES 64
+
+// The kinds of malformed UTF-8 flagged by the nibble lookup tables, one bit each. Where the first
+// byte of a pair is a lead byte, the continuation byte after it decides between them.
+#define UTF8_TOO_SHORT                (1 << 0)
+#define UTF8_TOO_LONG                 (1 << 1)
+#define UTF8_OVERLONG_3               (1 << 2)
+#define UTF8_TOO_LARGE                (1 << 3)
+#define UTF8_SURROGATE                (1 << 4)
+#define UTF8_OVERLONG_2               (1 << 5)
+#define UTF8_TOO_LARGE_1000           (1 << 6)
+#define UTF8_OVERLONG_4               (1 << 6)
+#define UTF8_TWO_CONTINUATIONS        (1 << 7)
+#define UTF8_CARRY                    (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTINUATIONS)
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+#ifdef __SSSE3__
+// Errors possible per high nibble of the first byte of a pair of consecutive bytes.
+static const uint8_t utf8FirstHighNibbleErrors[NUM_NIBBLES] =
+{
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+  UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS,
+  UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+  UTF8_TOO_SHORT,
+  UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+  UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+// Errors possible per low nibble of the first byte of a pair.
+static const uint8_t utf8FirstLowNibbleErrors[NUM_NIBBLES] =
+{
+  UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+  UTF8_CARRY | UTF8_OVERLONG_2,
+  UTF8_CARRY,
+  UTF8_CARRY,
+  UTF8_CARRY | UTF8_TOO_LARGE,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+// Errors possible per high nibble of the second byte of a pair.
+static const uint8_t utf8SecondHighNibbleErrors[NUM_NIBBLES] =
+{
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 |
+    UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+#endif
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Appends a literal occurrence to an occurrence array.
+ * @param[in/out]  matches_p  The occurrence array.
+ * @param[in]      charIdx    The index of the occurrence.
+ * @param[in]      literal    The index of the literal.
+ */
+static void add_literal_match(LiteralMatchArrayS* const matches_p,
+                              const size_t charIdx,
+                              const int literal);
+
+/**
+ * @brief Looks up the buckets that may have a literal starting at an index.
+ * @param[in]  finder_p  The literal finder.
+ * @param[in]  input_p   The input, with at least fingerprintLength chars from the index.
+ * @return The buckets as a bit set.
+ */
+static uint8_t find_candidate_buckets(const LiteralFinderS* const finder_p,
+                                      const unsigned char* const input_p);
+
+/**
+ * @brief Verifies which literals of the candidate buckets start at an index, and records them.
+ * @param[in]      finder_p     The literal finder.
+ * @param[in]      input_p      The input.
+ * @param[in]      inputLength  The number of chars in the input.
+ * @param[in]      charIdx      The index.
+ * @param[in]      buckets      The candidate buckets as a bit set.
+ * @param[in/out]  matches_p    The array to append the occurrences to.
+ */
+static void verify_candidate(const LiteralFinderS* const finder_p,
+                             const unsigned char* const input_p,
+                             const size_t inputLength,
+                             const size_t charIdx,
+                             uint8_t buckets,
+                             LiteralMatchArrayS* const matches_p);
+
+/**
+ * @brief Checks the UTF-8 sequence at the start of some chars.
+ * @param[in]  chars_p   The chars.
+ * @param[in]  numChars  The number of chars, at least 1.
+ * @return The number of chars of the sequence if it is valid, 0 if the chars end before the
+ *         sequence does, or minus the length of its longest prefix that could start a valid one if
+ *         it is invalid.
+ */
+static int check_utf8_sequence(const unsigned char* const chars_p, const size_t numChars);
+
+#ifdef __SSSE3__
+/**
+ * @brief Moves an index of an input back to the start of the code point it may be inside of.
+ * @param[in]  input_p   The input.
+ * @param[in]  startIdx  The index not to move back past.
+ * @param[in]  charIdx   The index.
+ * @return The index of the lead byte of the code point, or charIdx if it starts a code point.
+ */
+static size_t back_to_code_point_start(const unsigned char* const input_p,
+                                       const size_t startIdx,
+                                       const size_t charIdx);
+
+/**
+ * @brief Skips the valid UTF-8 of part of an input, 16 chars at a time.
+ * @param[in]  input_p   The input.
+ * @param[in]  startIdx  The index to start from, at the start of a code point.
+ * @param[in]  endIdx    The index to stop at.
+ * @return The start of a code point at or before the first invalid sequence and the end of the
+ *         part, up to which every code point is valid.
+ */
+static size_t skip_valid_utf8_vectors(const unsigned char* const input_p,
+                                      const size_t startIdx,
+                                      const size_t endIdx);
+#endif
+
+/*> Local Function Definitions ********************************************************************/
+static void add_literal_match(LiteralMatchArrayS* const matches_p,
+                              const size_t charIdx,
+                              const int literal)
+{
+  if (matches_p->numMatches == matches_p->maxNumMatches)
+  {
+    matches_p->maxNumMatches = matches_p->maxNumMatches > 0 ?
+                               2 * matches_p->maxNumMatches :
+                               INITIAL_MAX_NUM_LITERAL_MATCHES;
+    matches_p->matches_p = realloc(matches_p->matches_p,
+                                   sizeof(LiteralMatchS) * matches_p->maxNumMatches);
+    assert(matches_p->matches_p != NULL);
+  }
+  matches_p->matches_p[matches_p->numMatches].charIdx = charIdx;
+  matches_p->matches_p[matches_p->numMatches].literal = literal;
+  matches_p->numMatches++;
+}
+
+static uint8_t find_candidate_buckets(const LiteralFinderS* const finder_p,
+                                      const unsigned char* const input_p)
+{
+  uint8_t buckets = UINT8_MAX;
+  for (int i = 0; i < finder_p->fingerprintLength; i++)
+  {
+    buckets &= finder_p->lowNibbleMasks[i][input_p[i] & 0x0f] &
+               finder_p->highNibbleMasks[i][input_p[i] >> 4];
+  }
+  return buckets;
+}
+
+static void verify_candidate(const LiteralFinderS* const finder_p,
+                             const unsigned char* const input_p,
+                             const size_t inputLength,
+                             const size_t charIdx,
+                             uint8_t buckets,
+                             LiteralMatchArrayS* const matches_p)
+{
+  uint64_t literals = 0;
+  while (buckets != 0)
+  {
+    literals |= finder_p->bucketLiterals[__builtin_ctz(buckets)];
+    buckets &= buckets - 1;
+  }
+
+  while (literals != 0)
+  {
+    int literal = __builtin_ctzll(literals);
+    size_t literalLength = finder_p->literalLengths[literal];
+    if (inputLength - charIdx >= literalLength &&
+        memcmp(&(input_p[charIdx]), finder_p->literals[literal], literalLength) == 0)
+    {
+      add_literal_match(matches_p, charIdx, literal);
+    }
+    literals &= literals - 1;
+  }
+}
+
+static int check_utf8_sequence(const unsigned char* const chars_p, const size_t numChars)
+{
+  const unsigned char leadByte = chars_p[0];
+  size_t length;
+  unsigned char minSecondByte = 0x80;
+  unsigned char maxSecondByte = 0xBF;
+
+  // The well-formed byte sequences of the Unicode standard; the second byte range excludes
+  // overlong encodings, surrogates and code points above MAX_CODE_POINT.
+  if (leadByte < 0x80)
+  {
+    return 1;
+  }
+  else if (leadByte >= 0xC2 && leadByte <= 0xDF)
+  {
+    length = 2;
+  }
+  else if (leadByte >= 0xE0 && leadByte <= 0xEF)
+  {
+    length = 3;
+    minSecondByte = leadByte == 0xE0 ? 0xA0 : 0x80;
+    maxSecondByte = leadByte == 0xED ? 0x9F : 0xBF;
+  }
+  else if (leadByte >= 0xF0 && leadByte <= 0xF4)
+  {
+    length = 4;
+    minSecondByte = leadByte == 0xF0 ? 0x90 : 0x80;
+    maxSecondByte = leadByte == 0xF4 ? 0x8F : 0xBF;
+  }
+  else
+  {
+    return -1;
+  }
+
+  for (size_t i = 1; i < length; i++)
+  {
+    if (i == numChars)
+    {
+      return 0;
+    }
+    if (chars_p[i] < (i == 1 ? minSecondByte : 0x80) ||
+        chars_p[i] > (i == 1 ? maxSecondByte : 0xBF))
+    {
+      return -(int) i;
+    }
+  }
+  return length;
+}
+
+#ifdef __SSSE3__
+static size_t back_to_code_point_start(const unsigned char* const input_p,
+                                       const size_t startIdx,
+                                       const size_t charIdx)
+{
+  for (size_t i = 1; i < MAX_UTF8_LENGTH && charIdx - startIdx >= i; i++)
+  {
+    unsigned char byte = input_p[charIdx - i];
+    if ((byte & 0xC0) != 0x80)
+    {
+      return byte >= 0xC0 ? charIdx - i : charIdx;
+    }
+  }
+  return charIdx;
+}
+
+static size_t skip_valid_utf8_vectors(const unsigned char* const input_p,
+                                      const size_t startIdx,
+                                      const size_t endIdx)
+{
+  const __m128i firstHighTable = _mm_loadu_si128((const __m128i*) utf8FirstHighNibbleErrors);
+  const __m128i firstLowTable = _mm_loadu_si128((const __m128i*) utf8FirstLowNibbleErrors);
+  const __m128i secondHighTable = _mm_loadu_si128((const __m128i*) utf8SecondHighNibbleErrors);
+  const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i thirdByteOffset = _mm_set1_epi8(0xE0 - 0x80);
+  const __m128i fourthByteOffset = _mm_set1_epi8(0xF0 - 0x80);
+  const __m128i highBit = _mm_set1_epi8((char) 0x80);
+  const __m128i zero = _mm_setzero_si128();
+  // startIdx starts a code point, so the chars before it act like ASCII.
+  __m128i prevChars = zero;
+  size_t charIdx = startIdx;
+
+  for (; charIdx + VECTOR_SIZE <= endIdx; charIdx += VECTOR_SIZE)
+  {
+    __m128i chars = _mm_loadu_si128((const __m128i*) &(input_p[charIdx]));
+    __m128i prev1 = _mm_alignr_epi8(chars, prevChars, VECTOR_SIZE - 1);
+    __m128i prev2 = _mm_alignr_epi8(chars, prevChars, VECTOR_SIZE - 2);
+    __m128i prev3 = _mm_alignr_epi8(chars, prevChars, VECTOR_SIZE - 3);
+
+    // Lane k holds the errors the pair of chars k - 1 and k can have in common.
+    __m128i pairErrors =
+      _mm_and_si128(_mm_and_si128(_mm_shuffle_epi8(firstHighTable,
+                                                   _mm_and_si128(_mm_srli_epi16(prev1, 4),
+                                                                 nibbleMask)),
+                                  _mm_shuffle_epi8(firstLowTable,
+                                                   _mm_and_si128(prev1, nibbleMask))),
+                    _mm_shuffle_epi8(secondHighTable,
+                                     _mm_and_si128(_mm_srli_epi16(chars, 4), nibbleMask)));
+    // Two continuations in a row are only valid as the third or fourth byte of a code point.
+    __m128i mustContinue = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(prev2, thirdByteOffset),
+                                                      _mm_subs_epu8(prev3, fourthByteOffset)),
+                                         highBit);
+    __m128i errors = _mm_xor_si128(pairErrors, mustContinue);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(errors, zero)) != 0xffff)
+    {
+      break;
+    }
+    prevChars = chars;
+  }
+
+  // The code point at the end of the last vector may be cut off or continue in the error vector.
+  return back_to_code_point_start(input_p, startIdx, charIdx);
+}
+#endif
+
+/*> Global Function Definitions *******************************************************************/
+void init_literal_finder(LiteralFinderS* const finder_p)
+{
+  memset(finder_p, 0, sizeof(*finder_p));
+  finder_p->fingerprintLength = MAX_FINGERPRINT_LENGTH;
+}
+
+int add_finder_literal(LiteralFinderS* const finder_p, const RegExpLiteralS* const literal_p)
+{
+  if (finder_p->numLiterals == MAX_NUM_FINDER_LITERALS || literal_p->numChars == 0)
+  {
+    return NO_LITERAL;
+  }
+
+  int literal = finder_p->numLiterals;
+  int bucket = literal % NUM_FINDER_BUCKETS;
+  finder_p->numLiterals++;
+  memcpy(finder_p->literals[literal], literal_p->characters, literal_p->numChars);
+  finder_p->literalLengths[literal] = literal_p->numChars;
+  finder_p->bucketLiterals[bucket] |= (uint64_t) 1 << literal;
+
+  if (literal_p->numChars < finder_p->fingerprintLength)
+  {
+    finder_p->fingerprintLength = literal_p->numChars;
+  }
+  for (int i = 0; i < MAX_FINGERPRINT_LENGTH && i < literal_p->numChars; i++)
+  {
+    unsigned char character = literal_p->characters[i];
+    finder_p->lowNibbleMasks[i][character & 0x0f] |= 1 << bucket;
+    finder_p->highNibbleMasks[i][character >> 4] |= 1 << bucket;
+  }
+
+  return literal;
+}
+
+void find_literals_in_input(const LiteralFinderS* const finder_p,
+                            const char* const input_p,
+                            const size_t inputLength,
+                            LiteralMatchArrayS* const matches_p)
+{
+  const unsigned char* uInput_p = (const unsigned char*) input_p;
+  const size_t fingerprintLength = finder_p->fingerprintLength;
+  size_t charIdx = 0;
+
+  if (finder_p->numLiterals == 0 || inputLength < fingerprintLength)
+  {
+    return;
+  }
+
+  // A single one char literal is found fastest by the C library.
+  if (finder_p->numLiterals == 1 && finder_p->literalLengths[0] == 1)
+  {
+    const unsigned char* match_p = memchr(uInput_p, finder_p->literals[0][0], inputLength);
+    while (match_p != NULL)
+    {
+      charIdx = match_p - uInput_p;
+      add_literal_match(matches_p, charIdx, 0);
+      match_p = memchr(match_p + 1, finder_p->literals[0][0], inputLength - charIdx - 1);
+    }
+    return;
+  }
+
+#ifdef __SSSE3__
+  __m128i lowMasks[MAX_FINGERPRINT_LENGTH];
+  __m128i highMasks[MAX_FINGERPRINT_LENGTH];
+  for (size_t i = 0; i < fingerprintLength; i++)
+  {
+    lowMasks[i] = _mm_loadu_si128((const __m128i*) finder_p->lowNibbleMasks[i]);
+    highMasks[i] = _mm_loadu_si128((const __m128i*) finder_p->highNibbleMasks[i]);
+  }
+  const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; charIdx + VECTOR_SIZE + fingerprintLength - 1 <= inputLength; charIdx += VECTOR_SIZE)
+  {
+    // Lane k holds the buckets that may have a literal starting at charIdx + k.
+    __m128i buckets = _mm_set1_epi8((char) UINT8_MAX);
+    for (size_t i = 0; i < fingerprintLength; i++)
+    {
+      __m128i chars = _mm_loadu_si128((const __m128i*) &(uInput_p[charIdx + i]));
+      __m128i lowNibbles = _mm_and_si128(chars, nibbleMask);
+      __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(chars, 4), nibbleMask);
+      buckets = _mm_and_si128(buckets,
+                              _mm_and_si128(_mm_shuffle_epi8(lowMasks[i], lowNibbles),
+                                            _mm_shuffle_epi8(highMasks[i], highNibbles)));
+    }
+
+    unsigned int candidates = ~_mm_movemask_epi8(_mm_cmpeq_epi8(buckets, zero)) & 0xffff;
+    if (candidates != 0)
+    {
+      uint8_t laneBuckets[VECTOR_SIZE];
+      _mm_storeu_si128((__m128i*) laneBuckets, buckets);
+      while (candidates != 0)
+      {
+        int lane = __builtin_ctz(candidates);
+        verify_candidate(finder_p,
+                         uInput_p,
+                         inputLength,
+                         charIdx + lane,
+                         laneBuckets[lane],
+                         matches_p);
+        candidates &= candidates - 1;
+      }
+    }
+  }
+#endif
+
+  for (; charIdx + fingerprintLength <= inputLength; charIdx++)
+  {
+    uint8_t buckets = find_candidate_buckets(finder_p, &(uInput_p[charIdx]));
+    if (buckets != 0)
+    {
+      verify_candidate(finder_p, uInput_p, inputLength, charIdx, buckets, matches_p);
+    }
+  }
+}
+
+void free_literal_match_array(LiteralMatchArrayS* const matches_p)
+{
+  free(matches_p->matches_p);
+  matches_p->matches_p = NULL;
+  matches_p->numMatches = 0;
+  matches_p->maxNumMatches = 0;
+}
+
+void init_byte_set(ByteSetS* const byteSet_p)
+{
+  memset(byteSet_p, 0, sizeof(*byteSet_p));
+}
+
+void add_byte_to_set(ByteSetS* const byteSet_p, const unsigned char byte)
+{
+  if (byte < 0x80)
+  {
+    byteSet_p->lowBitmaps[byte & 0x0f] |= 1 << (byte >> 4);
+  }
+  else
+  {
+    byteSet_p->highBitmaps[byte & 0x0f] |= 1 << ((byte >> 4) - 8);
+  }
+}
+
+bool is_byte_in_set(const ByteSetS* const byteSet_p, const unsigned char byte)
+{
+  uint8_t bitmap = byte < 0x80 ? byteSet_p->lowBitmaps[byte & 0x0f] :
+                                 byteSet_p->highBitmaps[byte & 0x0f];
+  return (bitmap & (1 << ((byte >> 4) & 0x07))) != 0;
+}
+
+size_t find_byte_in_set(const ByteSetS* const byteSet_p,
+                        const char* const input_p,
+                        const size_t startIdx,
+                        const size_t inputLength)
+{
+  const unsigned char* uInput_p = (const unsigned char*) input_p;
+  size_t charIdx = startIdx;
+
+#ifdef __SSSE3__
+  const __m128i lowBitmaps = _mm_loadu_si128((const __m128i*) byteSet_p->lowBitmaps);
+  const __m128i highBitmaps = _mm_loadu_si128((const __m128i*) byteSet_p->highBitmaps);
+  const __m128i highNibbleBits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128,
+                                               1, 2, 4, 8, 16, 32, 64, (char) 128);
+  const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; charIdx + VECTOR_SIZE <= inputLength; charIdx += VECTOR_SIZE)
+  {
+    __m128i chars = _mm_loadu_si128((const __m128i*) &(uInput_p[charIdx]));
+    __m128i lowNibbles = _mm_and_si128(chars, nibbleMask);
+    __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(chars, 4), nibbleMask);
+    // Chars of 0x80 and above are negative as signed bytes and take their bitmap from highBitmaps.
+    __m128i isHighHalf = _mm_cmplt_epi8(chars, zero);
+    __m128i bitmaps = _mm_or_si128(_mm_and_si128(isHighHalf,
+                                                 _mm_shuffle_epi8(highBitmaps, lowNibbles)),
+                                   _mm_andnot_si128(isHighHalf,
+                                                    _mm_shuffle_epi8(lowBitmaps, lowNibbles)));
+    __m128i bits = _mm_shuffle_epi8(highNibbleBits, highNibbles);
+    int inSet = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bitmaps, bits), bits));
+    if (inSet != 0)
+    {
+      return charIdx + __builtin_ctz(inSet);
+    }
+  }
+#endif
+
+  for (; charIdx < inputLength; charIdx++)
+  {
+    if (is_byte_in_set(byteSet_p, uInput_p[charIdx]))
+    {
+      return charIdx;
+    }
+  }
+  return inputLength;
+}
+
+size_t find_invalid_utf8(const char* const input_p,
+                         const size_t startIdx,
+                         const size_t endIdx,
+                         const bool isInputEnd,
+                         int* const invalidLength_p)
+{
+  const unsigned char* uInput_p = (const unsigned char*) input_p;
+  size_t charIdx = startIdx;
+
+#ifdef __SSSE3__
+  charIdx = skip_valid_utf8_vectors(uInput_p, startIdx, endIdx);
+#endif
+
+  *invalidLength_p = 0;
+  while (charIdx < endIdx)
+  {
+    int length = check_utf8_sequence(&(uInput_p[charIdx]), endIdx - charIdx);
+    if (length > 0)
+    {
+      charIdx += length;
+    }
+    else if (length == 0 && !isInputEnd)
+    {
+      // Cut off; the rest of the code point follows endIdx.
+      return charIdx;
+    }
+    else
+    {
+      *invalidLength_p = length == 0 ? (int) (endIdx - charIdx) : -length;
+      return charIdx;
+    }
+  }
+  return endIdx;
+}
+
+void init_utf8_validator(Utf8ValidatorS* const validator_p)
+{
+  validator_p->numPendingChars = 0;
+}
+
+bool validate_utf8_chunk(Utf8ValidatorS* const validator_p,
+                         const char* const chunk_p,
+                         const size_t chunkLength,
+                         const bool isLastChunk,
+                         size_t* const invalidIdx_p,
+                         int* const invalidLength_p)
+{
+  size_t startIdx = 0;
+
+  if (validator_p->numPendingChars > 0)
+  {
+    // Complete the code point cut off at the end of the last chunk with the first chars of this.
+    const int numPendingChars = validator_p->numPendingChars;
+    char chars[MAX_UTF8_LENGTH];
+    int numChars = numPendingChars;
+    memcpy(chars, validator_p->pendingChars, numPendingChars);
+    while (numChars < MAX_UTF8_LENGTH && (size_t) (numChars - numPendingChars) < chunkLength)
+    {
+      chars[numChars] = chunk_p[numChars - numPendingChars];
+      numChars++;
+    }
+
+    int length = check_utf8_sequence((const unsigned char*) chars, numChars);
+    if (length == 0 && !isLastChunk)
+    {
+      memcpy(validator_p->pendingChars, chars, numChars);
+      validator_p->numPendingChars = numChars;
+      return true;
+    }
+
+    validator_p->numPendingChars = 0;
+    if (length <= 0)
+    {
+      int invalidLength = length == 0 ? numChars : -length;
+      *invalidIdx_p = 0;
+      *invalidLength_p = invalidLength > numPendingChars ? invalidLength - numPendingChars : 0;
+      return false;
+    }
+    startIdx = length - numPendingChars;
+  }
+
+  size_t validEndIdx = find_invalid_utf8(chunk_p,
+                                         startIdx,
+                                         chunkLength,
+                                         isLastChunk,
+                                         invalidLength_p);
+  if (*invalidLength_p > 0)
+  {
+    *invalidIdx_p = validEndIdx;
+    return false;
+  }
+
+  validator_p->numPendingChars = chunkLength - validEndIdx;
+  memcpy(validator_p->pendingChars, &(chunk_p[validEndIdx]), validator_p->numPendingChars);
+  return true;
+}
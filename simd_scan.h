@@ -0,0 +1,219 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Finds candidate positions in an input many chars at a time, so that the DFAs only need to
+ *        run near them.
+ * @file simd_scan.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reg_exp.h"
+#include "unicode.h"
+
+/*> Defines ***************************************************************************************/
+#define MAX_NUM_FINDER_LITERALS     64
+#define NUM_FINDER_BUCKETS          8
+#define MAX_FINGERPRINT_LENGTH      3
+#define NUM_NIBBLES                 16
+#define NO_LITERAL                  -1
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief Finds occurrences of several literals at once (Teddy). Literals are spread over
+ *        NUM_FINDER_BUCKETS buckets. For each of the first fingerprintLength chars of the literals,
+ *        two tables map the low and high nibble of an input char to the buckets whose literals may
+ *        have that char there. Looking the tables up for 16 input chars at a time gives the
+ *        positions where a literal of some bucket may start, which are then verified.
+ * @param numLiterals        The number of literals.
+ * @param literals           The literals.
+ * @param literalLengths     The number of chars in each literal.
+ * @param fingerprintLength  The number of leading chars used to find candidates.
+ * @param lowNibbleMasks     Buckets per low nibble, for each fingerprint char.
+ * @param highNibbleMasks    Buckets per high nibble, for each fingerprint char.
+ * @param bucketLiterals     The literals in each bucket as a bit set.
+ */
+typedef struct LiteralFinderS
+{
+  int numLiterals;
+  char literals[MAX_NUM_FINDER_LITERALS][MAX_REGEXP_STRING_LENGTH];
+  int literalLengths[MAX_NUM_FINDER_LITERALS];
+  int fingerprintLength;
+  uint8_t lowNibbleMasks[MAX_FINGERPRINT_LENGTH][NUM_NIBBLES];
+  uint8_t highNibbleMasks[MAX_FINGERPRINT_LENGTH][NUM_NIBBLES];
+  uint64_t bucketLiterals[NUM_FINDER_BUCKETS];
+} LiteralFinderS;
+
+/**
+ * @brief An occurrence of a literal.
+ * @param charIdx  The index of the first char of the occurrence.
+ * @param literal  The index of the literal.
+ */
+typedef struct LiteralMatchS
+{
+  size_t charIdx;
+  int literal;
+} LiteralMatchS;
+
+/**
+ * @brief A growable array of literal occurrences.
+ * @param matches_p      The occurrences.
+ * @param numMatches     The number of occurrences.
+ * @param maxNumMatches  The number of occurrences there is room for.
+ */
+typedef struct LiteralMatchArrayS
+{
+  LiteralMatchS* matches_p;
+  int numMatches;
+  int maxNumMatches;
+} LiteralMatchArrayS;
+
+/**
+ * @brief A set of bytes that can be tested for 16 input chars at a time. A byte is split in its low
+ *        nibble, which selects a bitmap, and its high nibble, which selects a bit in it.
+ * @param lowBitmaps   Per low nibble, the bits of the high nibbles 0 to 7 in the set.
+ * @param highBitmaps  Per low nibble, the bits of the high nibbles 8 to 15 in the set.
+ */
+typedef struct ByteSetS
+{
+  uint8_t lowBitmaps[NUM_NIBBLES];
+  uint8_t highBitmaps[NUM_NIBBLES];
+} ByteSetS;
+
+/**
+ * @brief Validates a stream of UTF-8 that arrives in chunks. A code point cut off at the end of a
+ *        chunk is kept until the next chunk completes it.
+ * @param pendingChars     The chars of the code point cut off at the end of the last chunk.
+ * @param numPendingChars  The number of pending chars.
+ */
+typedef struct Utf8ValidatorS
+{
+  char pendingChars[MAX_UTF8_LENGTH];
+  int numPendingChars;
+} Utf8ValidatorS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Initializes a literal finder without literals.
+ * @param[out]  finder_p  The literal finder.
+ */
+void init_literal_finder(LiteralFinderS* const finder_p);
+
+/**
+ * @brief Adds a literal to a literal finder.
+ * @param[in/out]  finder_p  The literal finder.
+ * @param[in]      literal_p The literal.
+ * @return The index of the literal, NO_LITERAL if the finder is full or the literal is empty.
+ */
+int add_finder_literal(LiteralFinderS* const finder_p, const RegExpLiteralS* const literal_p);
+
+/**
+ * @brief Finds all occurrences of the literals of a literal finder, including overlapping ones.
+ * @param[in]   finder_p     The literal finder.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[out]  matches_p    The array to append the occurrences to, in order of their index.
+ */
+void find_literals_in_input(const LiteralFinderS* const finder_p,
+                            const char* const input_p,
+                            const size_t inputLength,
+                            LiteralMatchArrayS* const matches_p);
+
+/**
+ * @brief Frees the occurrences of an occurrence array and empties it.
+ * @param[in/out]  matches_p  The occurrence array.
+ */
+void free_literal_match_array(LiteralMatchArrayS* const matches_p);
+
+/**
+ * @brief Initializes an empty byte set.
+ * @param[out]  byteSet_p  The byte set.
+ */
+void init_byte_set(ByteSetS* const byteSet_p);
+
+/**
+ * @brief Adds a byte to a byte set.
+ * @param[in/out]  byteSet_p  The byte set.
+ * @param[in]      byte       The byte.
+ */
+void add_byte_to_set(ByteSetS* const byteSet_p, const unsigned char byte);
+
+/**
+ * @brief Checks if a byte is in a byte set.
+ * @param[in]  byteSet_p  The byte set.
+ * @param[in]  byte       The byte.
+ * @return True if the byte is in the set.
+ */
+bool is_byte_in_set(const ByteSetS* const byteSet_p, const unsigned char byte);
+
+/**
+ * @brief Finds the first char of an input at or after an index that is in a byte set.
+ * @param[in]  byteSet_p    The byte set.
+ * @param[in]  input_p      The input.
+ * @param[in]  startIdx     The index to start looking from.
+ * @param[in]  inputLength  The number of chars in the input.
+ * @return The index of the char, inputLength if there is none.
+ */
+size_t find_byte_in_set(const ByteSetS* const byteSet_p,
+                        const char* const input_p,
+                        const size_t startIdx,
+                        const size_t inputLength);
+
+/**
+ * @brief Finds the first invalid UTF-8 sequence in part of an input, 16 chars at a time. Valid
+ *        input is checked with nibble lookup tables that flag every kind of malformed sequence at
+ *        once; only the chars around an error are decoded one by one.
+ * @param[in]   input_p          The input.
+ * @param[in]   startIdx         The index to start checking from, at the start of a code point.
+ * @param[in]   endIdx           The index to stop checking at.
+ * @param[in]   isInputEnd       True if the input ends at endIdx, so that a code point cut off
+ *                               there is invalid.
+ * @param[out]  invalidLength_p  The number of chars of the invalid sequence, i.e. its longest
+ *                               prefix that could start a valid one (at least 1), or 0 if there
+ *                               is none.
+ * @return The index of the invalid sequence. Without one, endIdx, or the start of the code point
+ *         cut off at endIdx if the input does not end there.
+ */
+size_t find_invalid_utf8(const char* const input_p,
+                         const size_t startIdx,
+                         const size_t endIdx,
+                         const bool isInputEnd,
+                         int* const invalidLength_p);
+
+/**
+ * @brief Initializes a UTF-8 validator at the start of a stream.
+ * @param[out]  validator_p  The validator.
+ */
+void init_utf8_validator(Utf8ValidatorS* const validator_p);
+
+/**
+ * @brief Validates the next chunk of a UTF-8 stream. After an invalid sequence, validation can
+ *        continue with the chars after it.
+ * @param[in/out]  validator_p      The validator.
+ * @param[in]      chunk_p          The chunk.
+ * @param[in]      chunkLength      The number of chars in the chunk.
+ * @param[in]      isLastChunk      True if the stream ends with this chunk.
+ * @param[out]     invalidIdx_p     The index in the chunk of the first invalid sequence. One that
+ *                                  started in an earlier chunk is reported at index 0.
+ * @param[out]     invalidLength_p  The number of chars of the invalid sequence in this chunk.
+ * @return True if the chunk has no invalid sequence.
+ */
+bool validate_utf8_chunk(Utf8ValidatorS* const validator_p,
+                         const char* const chunk_p,
+                         const size_t chunkLength,
+                         const bool isLastChunk,
+                         size_t* const invalidIdx_p,
+                         int* const invalidLength_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -0,0 +1,85 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests byte sets against an array of flags, for random sets of every size and random
+*        inputs. Built with -mssse3, the 16 char path is tested as well.
+* @file test_byte_set.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+
+#include "simd_scan.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_RANDOM_SETS       500
+#define NUM_RANDOM_INPUTS     20
+#define MAX_TEST_INPUT_SIZE   300
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+
+/*> Local Function Definitions ********************************************************************/
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(57);
+
+  int numBadSets = 0;
+  int numBadInputs = 0;
+  for (int i = 0; i < NUM_RANDOM_SETS; i++)
+  {
+    // Sets from empty to every byte, so that inputs have long runs of bytes not in the set.
+    ByteSetS byteSet;
+    bool isInSet[256] = {false};
+    init_byte_set(&byteSet);
+    const int numBytes = rand() % 257;
+    for (int j = 0; j < numBytes; j++)
+    {
+      unsigned char byte = rand() % 256;
+      add_byte_to_set(&byteSet, byte);
+      isInSet[byte] = true;
+    }
+
+    bool isSame = true;
+    for (int byte = 0; byte < 256; byte++)
+    {
+      isSame = isSame && is_byte_in_set(&byteSet, byte) == isInSet[byte];
+    }
+    numBadSets += isSame ? 0 : 1;
+
+    char input[MAX_TEST_INPUT_SIZE];
+    const int numInputBytes = 1 + rand() % 256;
+    for (int j = 0; j < NUM_RANDOM_INPUTS; j++)
+    {
+      size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+      for (size_t k = 0; k < inputLength; k++)
+      {
+        input[k] = rand() % numInputBytes;
+      }
+      size_t startIdx = rand() % (inputLength + 1);
+      size_t expectedIdx = startIdx;
+      while (expectedIdx < inputLength && !isInSet[(unsigned char) input[expectedIdx]])
+      {
+        expectedIdx++;
+      }
+      numBadInputs += (find_byte_in_set(&byteSet, input, startIdx, inputLength) == expectedIdx) ?
+                      0 :
+                      1;
+    }
+  }
+  CHECK(numBadSets == 0);
+  CHECK(numBadInputs == 0);
+
+  return finish_test("byte_set");
+}
@@ -0,0 +1,74 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests case-insensitive rules, in particular negated lists, which must match neither case
+*        of a listed letter.
+* @file test_case_folding.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <string.h>
+
+#include "classifier.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Classifies a string with a lexer of one RegExp.
+ * @param[in]  regExpStr_p        The RegExp.
+ * @param[in]  isCaseInsensitive  True if the lexer is generated case-insensitive.
+ * @param[in]  str_p              The string.
+ * @return True if the RegExp matches the whole string.
+ */
+static bool matches(const char* const regExpStr_p, const bool isCaseInsensitive, const char* str_p);
+
+/*> Local Function Definitions ********************************************************************/
+static bool matches(const char* const regExpStr_p, const bool isCaseInsensitive, const char* str_p)
+{
+  LexerOptionsS options = { .isCaseInsensitive = isCaseInsensitive };
+  const char* regExpStrs[] = {regExpStr_p};
+  LexerS* lexer_p = generate_lexer_with_options(regExpStrs, 1, &options);
+  bool isMatch = classify_string(lexer_p, str_p, strlen(str_p)) == 0;
+  free_lexer(lexer_p);
+  return isMatch;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  CHECK(matches("(?i)abc", false, "aBC"));
+  CHECK(matches("(?i)[a-c]+", false, "CaB"));
+  CHECK(!matches("(?i)[a-c]+", false, "d"));
+  CHECK(matches("[x,y]z", true, "YZ"));
+
+  // Negated lists exclude both cases of their letters.
+  CHECK(!matches("(?i)[^a]", false, "a"));
+  CHECK(!matches("(?i)[^a]", false, "A"));
+  CHECK(matches("(?i)[^a]", false, "b"));
+  CHECK(matches("(?i)[^a]", false, "B"));
+  CHECK(!matches("[^A]", true, "a"));
+  CHECK(!matches("(?i)[^\\u{e9},a]", false, "a"));
+  CHECK(!matches("(?i)[^\\u{e9},a]", false, "A"));
+  CHECK(!matches("(?i)[^\\u{e9},a]", false, "\xc3\xa9"));
+  CHECK(matches("(?i)[^\\u{e9},a]", false, "z"));
+  CHECK(matches("(?i)[^\\u{e9},a]", false, "\xc3\xa8"));
+  CHECK(!matches("(?i)[^a-c,X]", false, "x"));
+  CHECK(matches("(?i)[^a-c,X]", false, "d"));
+
+  // Without folding the other case still matches.
+  CHECK(matches("[^a]", false, "A"));
+
+  return finish_test("case_folding");
+}
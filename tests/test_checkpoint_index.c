@@ -0,0 +1,152 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests reading tokens from checkpoints against reading the whole input, and that checkpoint
+*        files which do not fit the lexer are rejected.
+* @file test_checkpoint_index.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "checkpoint_index.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define TEST_INPUT_SIZE       300000
+#define NUM_TEST_RANGES       2000
+#define MAX_TEST_RANGE_SIZE   5000
+#define TEST_INDEX_PATH       "/tmp/test_checkpoint_index.bin"
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Writes a checkpoint index and checks if it is read back for a lexer.
+ * @param[in]  lexer_p  The lexer.
+ * @param[in]  index_p  The checkpoint index.
+ * @return True if the written index was accepted.
+ */
+static bool is_read_back(const LexerS* const lexer_p, const CheckpointIndexS* const index_p);
+
+/*> Local Function Definitions ********************************************************************/
+static bool is_read_back(const LexerS* const lexer_p, const CheckpointIndexS* const index_p)
+{
+  CheckpointIndexS readIndex = { .checkpoints_p = NULL };
+  bool isRead = write_checkpoint_index(index_p, TEST_INDEX_PATH) &&
+                read_checkpoint_index(lexer_p, &readIndex, TEST_INDEX_PATH);
+  free_checkpoint_index(&readIndex);
+  return isRead;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(52);
+
+  const char* regExpStrs[] = {"int", "char", "[0-9]+", "ba(g|d|[h,2])?(ab(hg)+)*"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 4);
+  const char alphabet[] = "intchar0123bagdh2 x";
+  char* input_p = malloc(TEST_INPUT_SIZE);
+  for (size_t i = 0; i < TEST_INPUT_SIZE; i++)
+  {
+    input_p[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+
+  TokenArrayS tokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  CheckpointIndexS index;
+  start_reading_buffer(lexer_p, input_p, TEST_INPUT_SIZE);
+  create_checkpoint_index(lexer_p, 4, &index, &tokens);
+  CHECK(index.numCheckpoints > 1);
+  CHECK(index.checkpoints_p[0].charIdx == 0);
+
+  CheckpointIndexS readIndex;
+  CHECK(write_checkpoint_index(&index, TEST_INDEX_PATH));
+  CHECK(read_checkpoint_index(lexer_p, &readIndex, TEST_INDEX_PATH));
+  CHECK(readIndex.numCheckpoints == index.numCheckpoints);
+  for (int i = 0; i < index.numCheckpoints && i < readIndex.numCheckpoints; i++)
+  {
+    CHECK(readIndex.checkpoints_p[i].charIdx == index.checkpoints_p[i].charIdx);
+    CHECK(readIndex.checkpoints_p[i].state == index.checkpoints_p[i].state);
+  }
+
+  // The tokens of a range read from a checkpoint are the tokens of the whole input overlapping it.
+  int numBadRanges = 0;
+  for (int i = 0; i < NUM_TEST_RANGES; i++)
+  {
+    size_t startIdx = rand() % TEST_INPUT_SIZE;
+    size_t endIdx = startIdx + rand() % MAX_TEST_RANGE_SIZE;
+    endIdx = endIdx > TEST_INPUT_SIZE ? TEST_INPUT_SIZE : endIdx;
+
+    TokenArrayS rangeTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+    read_tokens_in_range(lexer_p, &readIndex, startIdx, endIdx, &rangeTokens);
+    int tokenIdx = 0;
+    while (tokens.tokens_p[tokenIdx].startIdx + tokens.tokens_p[tokenIdx].length <= startIdx)
+    {
+      tokenIdx++;
+    }
+    bool isSame = true;
+    for (int j = 0; j < rangeTokens.numTokens; j++, tokenIdx++)
+    {
+      isSame = isSame &&
+               tokenIdx < tokens.numTokens &&
+               rangeTokens.tokens_p[j].startIdx == tokens.tokens_p[tokenIdx].startIdx &&
+               rangeTokens.tokens_p[j].type == tokens.tokens_p[tokenIdx].type;
+    }
+    isSame = isSame &&
+             (tokenIdx == tokens.numTokens || tokens.tokens_p[tokenIdx].startIdx >= endIdx);
+    numBadRanges += isSame ? 0 : 1;
+    free_token_array(&rangeTokens);
+  }
+  CHECK(numBadRanges == 0);
+  free_checkpoint_index(&readIndex);
+
+  // An index recorded with another lexer is rejected.
+  const char* otherRegExpStrs[] = {"int", "char", "[0-9]+"};
+  LexerS* otherLexer_p = generate_lexer(otherRegExpStrs, 3);
+  CHECK(!is_read_back(otherLexer_p, &index));
+  free_lexer(otherLexer_p);
+
+  // Checkpoints that cannot be resumed from are rejected.
+  CHECK(is_read_back(lexer_p, &index));
+  CheckpointS savedCheckpoint = index.checkpoints_p[0];
+  index.checkpoints_p[0].charIdx = 1;
+  CHECK(!is_read_back(lexer_p, &index));
+  index.checkpoints_p[0] = savedCheckpoint;
+
+  savedCheckpoint = index.checkpoints_p[1];
+  index.checkpoints_p[1].charIdx = 0;
+  CHECK(!is_read_back(lexer_p, &index));
+  index.checkpoints_p[1].charIdx = savedCheckpoint.charIdx;
+  index.checkpoints_p[1].state = lexer_p->dfa_p->numStates;
+  CHECK(!is_read_back(lexer_p, &index));
+  index.checkpoints_p[1].state = -1;
+  CHECK(!is_read_back(lexer_p, &index));
+  index.checkpoints_p[1] = savedCheckpoint;
+
+  savedCheckpoint = index.checkpoints_p[index.numCheckpoints - 1];
+  index.checkpoints_p[index.numCheckpoints - 1].charIdx = TEST_INPUT_SIZE + 1;
+  CHECK(!is_read_back(lexer_p, &index));
+  index.checkpoints_p[index.numCheckpoints - 1] = savedCheckpoint;
+  CHECK(is_read_back(lexer_p, &index));
+
+  // A missing file is not read.
+  remove(TEST_INDEX_PATH);
+  CHECK(!read_checkpoint_index(lexer_p, &readIndex, TEST_INDEX_PATH));
+
+  free_checkpoint_index(&index);
+  free_token_array(&tokens);
+  free(input_p);
+  free_lexer(lexer_p);
+
+  return finish_test("checkpoint_index");
+}
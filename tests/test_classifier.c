@@ -0,0 +1,108 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests classifying strings in interleaved lanes against classifying each string on its own,
+*        for batches that are empty, smaller than, as large as and larger than the lanes.
+* @file test_classifier.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+
+#include "classifier.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define MAX_NUM_TEST_STRINGS     (NUM_CLASSIFY_LANES + 1)
+#define MAX_TEST_STRING_LENGTH   12
+#define NUM_RANDOM_BATCHES       50
+#define UNSET_CLASS              -2
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Classifies random batches of strings, the first of which is empty, with
+ *        classify_strings() and compares the classes with classify_string().
+ * @param[in]  lexer_p     The lexer whose RegExps classify the strings.
+ * @param[in]  numStrings  The number of strings in each batch.
+ * @return The number of strings whose classes differ, or which were not classified.
+ */
+static int count_bad_classes(const LexerS* const lexer_p, const int numStrings);
+
+/*> Local Function Definitions ********************************************************************/
+static int count_bad_classes(const LexerS* const lexer_p, const int numStrings)
+{
+  static const char alphabet[] = "abc1";
+  char strChars[MAX_NUM_TEST_STRINGS][MAX_TEST_STRING_LENGTH];
+  const char* strs_pp[MAX_NUM_TEST_STRINGS];
+  size_t lengths[MAX_NUM_TEST_STRINGS];
+  int classes[MAX_NUM_TEST_STRINGS + 1];
+  int numBadClasses = 0;
+  for (int i = 0; i < NUM_RANDOM_BATCHES; i++)
+  {
+    for (int j = 0; j < numStrings; j++)
+    {
+      lengths[j] = (j == 0) ? 0 : rand() % MAX_TEST_STRING_LENGTH;
+      for (size_t k = 0; k < lengths[j]; k++)
+      {
+        strChars[j][k] = alphabet[rand() % (sizeof(alphabet) - 1)];
+      }
+      strs_pp[j] = strChars[j];
+    }
+    for (int j = 0; j <= numStrings; j++)
+    {
+      classes[j] = UNSET_CLASS;
+    }
+
+    classify_strings(lexer_p, strs_pp, lengths, numStrings, classes);
+    for (int j = 0; j < numStrings; j++)
+    {
+      numBadClasses += (classes[j] == classify_string(lexer_p, strs_pp[j], lengths[j])) ? 0 : 1;
+    }
+    // Nothing is written past the classes of the batch.
+    numBadClasses += (classes[numStrings] == UNSET_CLASS) ? 0 : 1;
+  }
+  return numBadClasses;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(60);
+
+  // The empty string matches the starred RegExp, so an empty string has a class.
+  const char* regExpStrs[] = {"a[b,c]*", "[a-c]+1", "1*", "b{2,3}", "[a,1]+c"};
+  const int batchSizes[] = {0, 1, NUM_CLASSIFY_LANES - 1, NUM_CLASSIFY_LANES, MAX_NUM_TEST_STRINGS};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 5);
+  LexerOptionsS groupOptions = { .maxNumDfaStates = 4 };
+  LexerS* groupLexer_p = generate_lexer_with_options(regExpStrs, 5, &groupOptions);
+  CHECK(groupLexer_p->numDfas > 1);
+  for (int i = 0; i < (int) (sizeof(batchSizes) / sizeof(batchSizes[0])); i++)
+  {
+    CHECK(count_bad_classes(lexer_p, batchSizes[i]) == 0);
+    CHECK(count_bad_classes(groupLexer_p, batchSizes[i]) == 0);
+  }
+
+  // An empty string that no RegExp matches.
+  const char* emptyStrs_pp[] = {""};
+  const size_t emptyLengths[] = {0};
+  int emptyClass = UNSET_CLASS;
+  const char* nonEmptyRegExpStrs[] = {"a+"};
+  LexerS* nonEmptyLexer_p = generate_lexer(nonEmptyRegExpStrs, 1);
+  classify_strings(nonEmptyLexer_p, emptyStrs_pp, emptyLengths, 1, &emptyClass);
+  CHECK(emptyClass == NO_CLASS);
+
+  free_lexer(nonEmptyLexer_p);
+  free_lexer(groupLexer_p);
+  free_lexer(lexer_p);
+  return finish_test("classifier");
+}
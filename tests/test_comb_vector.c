@@ -0,0 +1,129 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests packing the transitions of a DFA into a comb vector against the DFA.
+* @file test_comb_vector.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+
+#include "comb_vector.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_RANDOM_INPUTS   2000
+#define MAX_TEST_INPUT_SIZE 32
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Counts the transitions of a comb vector that differ from those of the DFA it was made
+ *        from.
+ * @param[in]  dfa_p         The DFA.
+ * @param[in]  combVector_p  The comb vector.
+ * @return The number of differing transitions.
+ */
+static int count_bad_transitions(const DfaS* const dfa_p, const CombVectorS* const combVector_p);
+
+/**
+ * @brief Finds the longest match of a DFA from the start of an input.
+ * @param[in]   dfa_p          The DFA.
+ * @param[in]   input_p        The input.
+ * @param[in]   inputLength    The number of chars in the input.
+ * @param[out]  matchLength_p  The number of chars of the match.
+ * @return The output value of the match, NO_STATE if there is none.
+ */
+static int match_dfa(const DfaS* const dfa_p,
+                     const char* const input_p,
+                     const size_t inputLength,
+                     size_t* const matchLength_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int count_bad_transitions(const DfaS* const dfa_p, const CombVectorS* const combVector_p)
+{
+  int numBadTransitions = 0;
+  for (int i = 0; i < dfa_p->numStates; i++)
+  {
+    for (int c = 0; c < NUM_CHARS; c++)
+    {
+      numBadTransitions += (get_comb_vector_transition(combVector_p, i, c) ==
+                            dfa_p->states[i].transitions[c]) ? 0 : 1;
+    }
+  }
+  return numBadTransitions;
+}
+
+static int match_dfa(const DfaS* const dfa_p,
+                     const char* const input_p,
+                     const size_t inputLength,
+                     size_t* const matchLength_p)
+{
+  int outputValue = NO_STATE;
+  int state = 0;
+  *matchLength_p = 0;
+  for (size_t charIdx = 0; charIdx < inputLength; charIdx++)
+  {
+    state = dfa_p->states[state].transitions[(unsigned char) input_p[charIdx]];
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (dfa_p->states[state].isEndState)
+    {
+      outputValue = dfa_p->states[state].outputValue;
+      *matchLength_p = charIdx + 1;
+    }
+  }
+  return outputValue;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(72);
+
+  const char* regExpStrs[] = {"int", "char", "if", "for", "[a-z]+", "[0-9]+", "\\p{L}+",
+                              "ba(g|d|[h,2])?(ab(hg)+)*"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 8);
+  const DfaS* dfa_p = lexer_p->dfa_p;
+  const char alphabet[] = "intcharfo0123bagdh2 x\xc3\xa4";
+
+  // Every transition is that of the DFA, in less room than a dense table.
+  CombVectorS* combVector_p = pack_comb_vector(dfa_p);
+  CHECK(count_bad_transitions(dfa_p, combVector_p) == 0);
+  CHECK(get_comb_vector_size(combVector_p) < sizeof(int) * NUM_CHARS * dfa_p->numStates);
+
+  // Reading a token from the comb vector matches reading it from the DFA.
+  char input[MAX_TEST_INPUT_SIZE];
+  int numBadMatches = 0;
+  for (int i = 0; i < NUM_RANDOM_INPUTS; i++)
+  {
+    size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+    for (size_t j = 0; j < inputLength; j++)
+    {
+      input[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    size_t matchLength;
+    size_t expectedMatchLength;
+    int outputValue = match_comb_vector(combVector_p, input, inputLength, &matchLength);
+    int expectedOutputValue = match_dfa(dfa_p, input, inputLength, &expectedMatchLength);
+    numBadMatches += (outputValue == expectedOutputValue &&
+                      matchLength == expectedMatchLength) ? 0 : 1;
+  }
+  CHECK(numBadMatches == 0);
+
+  free_comb_vector(combVector_p);
+  free_lexer(lexer_p);
+
+  return finish_test("comb_vector");
+}
@@ -0,0 +1,136 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests compressing a DFA with default transitions against the DFA, and that deeper caps on
+*        the default transitions never give a larger D2FA.
+* @file test_d2fa.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+
+#include "d2fa.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define MAX_TEST_DEPTH      8
+#define NUM_RANDOM_INPUTS   2000
+#define MAX_TEST_INPUT_SIZE 32
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Counts the transitions of a D2FA that differ from those of the DFA it was made from.
+ * @param[in]  dfa_p   The DFA.
+ * @param[in]  d2fa_p  The D2FA.
+ * @return The number of differing transitions.
+ */
+static int count_bad_transitions(const DfaS* const dfa_p, const D2faS* const d2fa_p);
+
+/**
+ * @brief Finds the longest match of a DFA from the start of an input.
+ * @param[in]   dfa_p          The DFA.
+ * @param[in]   input_p        The input.
+ * @param[in]   inputLength    The number of chars in the input.
+ * @param[out]  matchLength_p  The number of chars of the match.
+ * @return The output value of the match, NO_STATE if there is none.
+ */
+static int match_dfa(const DfaS* const dfa_p,
+                     const char* const input_p,
+                     const size_t inputLength,
+                     size_t* const matchLength_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int count_bad_transitions(const DfaS* const dfa_p, const D2faS* const d2fa_p)
+{
+  int numBadTransitions = 0;
+  for (int i = 0; i < dfa_p->numStates; i++)
+  {
+    for (int c = 0; c < NUM_CHARS; c++)
+    {
+      numBadTransitions += (get_d2fa_transition(d2fa_p, i, c) ==
+                            dfa_p->states[i].transitions[c]) ? 0 : 1;
+    }
+  }
+  return numBadTransitions;
+}
+
+static int match_dfa(const DfaS* const dfa_p,
+                     const char* const input_p,
+                     const size_t inputLength,
+                     size_t* const matchLength_p)
+{
+  int outputValue = NO_STATE;
+  int state = 0;
+  *matchLength_p = 0;
+  for (size_t charIdx = 0; charIdx < inputLength; charIdx++)
+  {
+    state = dfa_p->states[state].transitions[(unsigned char) input_p[charIdx]];
+    if (state == NO_STATE)
+    {
+      break;
+    }
+    if (dfa_p->states[state].isEndState)
+    {
+      outputValue = dfa_p->states[state].outputValue;
+      *matchLength_p = charIdx + 1;
+    }
+  }
+  return outputValue;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(71);
+
+  // Capped at 2, the greedy tree of this lexer takes more transitions than capped at 1.
+  const char* regExpStrs[] = {"int", "char", "if", "for", "[a-z]+", "[0-9]+"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 6);
+  const DfaS* dfa_p = lexer_p->dfa_p;
+  const char alphabet[] = "intcharfo0123456789 x";
+
+  // Every cap gives the transitions of the DFA, and a deeper cap never gives more of them.
+  size_t prevSize = 0;
+  for (int maxDepth = 0; maxDepth <= MAX_TEST_DEPTH; maxDepth++)
+  {
+    D2faS* d2fa_p = compress_dfa_with_defaults(dfa_p, maxDepth);
+    CHECK(d2fa_p->maxDepth <= maxDepth);
+    CHECK(count_bad_transitions(dfa_p, d2fa_p) == 0);
+    CHECK(maxDepth == 0 || get_d2fa_size(d2fa_p) <= prevSize);
+    prevSize = get_d2fa_size(d2fa_p);
+
+    // Reading a token from the D2FA matches reading it from the DFA.
+    char input[MAX_TEST_INPUT_SIZE];
+    int numBadMatches = 0;
+    for (int i = 0; i < NUM_RANDOM_INPUTS; i++)
+    {
+      size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+      for (size_t j = 0; j < inputLength; j++)
+      {
+        input[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+      }
+      size_t matchLength;
+      size_t expectedMatchLength;
+      int outputValue = match_d2fa(d2fa_p, input, inputLength, &matchLength);
+      int expectedOutputValue = match_dfa(dfa_p, input, inputLength, &expectedMatchLength);
+      numBadMatches += (outputValue == expectedOutputValue &&
+                        matchLength == expectedMatchLength) ? 0 : 1;
+    }
+    CHECK(numBadMatches == 0);
+    free_d2fa(d2fa_p);
+  }
+
+  free_lexer(lexer_p);
+
+  return finish_test("d2fa");
+}
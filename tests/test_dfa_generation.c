@@ -0,0 +1,241 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests lexers whose DFAs are generated in different ways, split into groups or built on
+*        several threads, against a lexer whose DFA is converted from the combined NFA on one
+*        thread, on random inputs.
+* @file test_dfa_generation.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer_generator.h"
+#include "nfa.h"
+#include "reg_exp.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_TEST_REGEXPS      11
+#define NUM_RANDOM_INPUTS     300
+#define MAX_TEST_INPUT_SIZE   500
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+/**
+ * @brief RegExps with keywords, overlapping rules, bounded repetition, Unicode classes and
+ *        case-insensitive and negated lists.
+ */
+static const char* testRegExpStrs[NUM_TEST_REGEXPS] = {"if", "int", "(?i)while",
+                                                       "[a-z,A-Z,_][a-z,A-Z,0-9,_]*", "[0-9]+",
+                                                       "0x[0-9,a-f]{1,4}", "\\p{L}+", "(ab|a)*c",
+                                                       "[^a-z,0-9, ]", " +", "b[a,b]{3}"};
+
+/**
+ * @brief The chars of the random inputs, including the UTF-8 encodings of ä and λ.
+ */
+static const char* const testAlphabet[] = {"i", "f", "n", "t", "w", "h", "I", "L", "E", "a", "b",
+                                           "c", "x", "0", "1", "9", " ", "_", "-", "\xc3\xa4",
+                                           "\xce\xbb"};
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Fills an input with random strings of testAlphabet.
+ * @param[out]  input_p  Room for MAX_TEST_INPUT_SIZE chars.
+ * @return The number of chars in the input.
+ */
+static size_t generate_input(char* const input_p);
+
+/**
+ * @brief Checks if two lexers read the same tokens from random inputs.
+ * @param[in/out]  lexer1_p  The first lexer.
+ * @param[in/out]  lexer2_p  The second lexer.
+ * @return True if both lexers read the same tokens from every input.
+ */
+static bool reads_same_tokens(LexerS* const lexer1_p, LexerS* const lexer2_p);
+
+/**
+ * @brief Checks if two DFAs have the same states, with the same indicies.
+ * @param[in]  dfa1_p  The first DFA.
+ * @param[in]  dfa2_p  The second DFA.
+ * @return True if every state has the same transitions and output value in both DFAs.
+ */
+static bool dfas_are_equal(const DfaS* const dfa1_p, const DfaS* const dfa2_p);
+
+/*> Local Function Definitions ********************************************************************/
+static size_t generate_input(char* const input_p)
+{
+  const size_t maxInputLength = rand() % MAX_TEST_INPUT_SIZE;
+  size_t inputLength = 0;
+  while (true)
+  {
+    const char* str_p = testAlphabet[rand() % (sizeof(testAlphabet) / sizeof(testAlphabet[0]))];
+    size_t strLength = strlen(str_p);
+    if (inputLength + strLength > maxInputLength)
+    {
+      return inputLength;
+    }
+    memcpy(&(input_p[inputLength]), str_p, strLength);
+    inputLength += strLength;
+  }
+}
+
+static bool reads_same_tokens(LexerS* const lexer1_p, LexerS* const lexer2_p)
+{
+  char input[MAX_TEST_INPUT_SIZE];
+  bool isSame = true;
+  for (int i = 0; i < NUM_RANDOM_INPUTS && isSame; i++)
+  {
+    const size_t inputLength = generate_input(input);
+    start_reading_buffer(lexer1_p, input, inputLength);
+    start_reading_buffer(lexer2_p, input, inputLength);
+    TokenS token1;
+    do
+    {
+      token1 = get_next_token(lexer1_p);
+      TokenS token2 = get_next_token(lexer2_p);
+      isSame = token1.type == token2.type &&
+               token1.startIdx == token2.startIdx &&
+               token1.length == token2.length;
+    } while (isSame && token1.type != TOKEN_TYPE_END);
+  }
+  return isSame;
+}
+
+static bool dfas_are_equal(const DfaS* const dfa1_p, const DfaS* const dfa2_p)
+{
+  if (dfa1_p->numStates != dfa2_p->numStates)
+  {
+    return false;
+  }
+  for (int i = 0; i < dfa1_p->numStates; i++)
+  {
+    const DfaStateS* state1_p = &(dfa1_p->states[i]);
+    const DfaStateS* state2_p = &(dfa2_p->states[i]);
+    if (state1_p->isEndState != state2_p->isEndState ||
+        (state1_p->isEndState && state1_p->outputValue != state2_p->outputValue) ||
+        memcmp(state1_p->transitions, state2_p->transitions, sizeof(state1_p->transitions)) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(67);
+
+  // Repeats the parser accepts but whose copies do not fit an NFA are not converted.
+  RegExpS* regExp_p = parse_regexp("(ab){100}");
+  NfaS* nfa_p = generate_nfa(regExp_p, 0);
+  CHECK(nfa_p != NULL);
+  free(nfa_p);
+  free_regexp(regExp_p);
+  regExp_p = parse_regexp("(ab){1000}");
+  CHECK(generate_nfa(regExp_p, 0) == NULL);
+  CHECK(generate_combined_nfa(&regExp_p, 1) == NULL);
+  free_regexp(regExp_p);
+
+  // A lexer builds such a RegExp with derivatives instead.
+  const char* repeatRegExpStrs[] = {"(ab){1000}", "[a,b]"};
+  LexerS* repeatLexer_p = generate_lexer(repeatRegExpStrs, 2);
+  CHECK(repeatLexer_p != NULL);
+  if (repeatLexer_p != NULL)
+  {
+    char repeatInput[2001];
+    for (int i = 0; i < 2000; i++)
+    {
+      repeatInput[i] = (i % 2 == 0) ? 'a' : 'b';
+    }
+    repeatInput[2000] = 'a';
+    start_reading_buffer(repeatLexer_p, repeatInput, sizeof(repeatInput));
+    TokenS token = get_next_token(repeatLexer_p);
+    CHECK(token.type == 0 && token.length == 2000);
+    token = get_next_token(repeatLexer_p);
+    CHECK(token.type == 1 && token.length == 1);
+    free_lexer(repeatLexer_p);
+  }
+
+  // A RegExp whose DFA has more than MAX_NUM_DFA_STATES - 1 states fits no group, so no lexer is
+  // generated.
+  const char* largeRegExpStrs[] = {"int", "[a,b]*a[a,b]{12}", "[0-9]+"};
+  CHECK(generate_lexer(&(largeRegExpStrs[1]), 1) == NULL);
+  CHECK(generate_lexer(largeRegExpStrs, 3) == NULL);
+  LexerOptionsS largeOptions = { .usesDerivatives = true, .maxNumDfaStates = 16 };
+  CHECK(generate_lexer_with_options(largeRegExpStrs, 3, &largeOptions) == NULL);
+
+  LexerS* nfaLexer_p = generate_lexer(testRegExpStrs, NUM_TEST_REGEXPS);
+
+  // A DFA built from derivatives is minimized like one converted from the NFA, so both have the
+  // same number of states.
+  LexerOptionsS derivativeOptions = { .usesDerivatives = true };
+  LexerS* derivativeLexer_p = generate_lexer_with_options(testRegExpStrs,
+                                                          NUM_TEST_REGEXPS,
+                                                          &derivativeOptions);
+  CHECK(derivativeLexer_p->numDfas == 1);
+  CHECK(derivativeLexer_p->dfa_p->numStates == nfaLexer_p->dfa_p->numStates);
+  CHECK(reads_same_tokens(derivativeLexer_p, nfaLexer_p));
+  free_lexer(derivativeLexer_p);
+
+  // The derivative of a*a* by 'a' does not simplify back to a*a*, but both states are joined, as
+  // are the equal states of a*(a|ab)* that only lead to each other.
+  const char* starRegExpStrs[] = {"a*a*", "b+b*", "a*(a|ab)*"};
+  for (int i = 0; i < 3; i++)
+  {
+    LexerS* starNfaLexer_p = generate_lexer(&(starRegExpStrs[i]), 1);
+    derivativeLexer_p = generate_lexer_with_options(&(starRegExpStrs[i]), 1, &derivativeOptions);
+    CHECK(derivativeLexer_p->dfa_p->numStates == starNfaLexer_p->dfa_p->numStates);
+    free_lexer(derivativeLexer_p);
+    free_lexer(starNfaLexer_p);
+  }
+
+  // RegExps that do not fit DFAs of 16 states are split into groups scanned in lockstep, also when
+  // the DFAs are built from derivatives.
+  LexerOptionsS groupOptions = { .maxNumDfaStates = 16 };
+  LexerS* groupLexer_p = generate_lexer_with_options(testRegExpStrs,
+                                                     NUM_TEST_REGEXPS,
+                                                     &groupOptions);
+  CHECK(groupLexer_p->numDfas > 1);
+  CHECK(reads_same_tokens(groupLexer_p, nfaLexer_p));
+  free_lexer(groupLexer_p);
+  groupOptions.usesDerivatives = true;
+  groupLexer_p = generate_lexer_with_options(testRegExpStrs, NUM_TEST_REGEXPS, &groupOptions);
+  CHECK(groupLexer_p->numDfas > 1);
+  CHECK(reads_same_tokens(groupLexer_p, nfaLexer_p));
+  free_lexer(groupLexer_p);
+
+  // Subset construction on 4 threads gives the same DFAs as on one, also for groups.
+  LexerOptionsS threadOptions = { .numThreads = 4 };
+  LexerS* threadLexer_p = generate_lexer_with_options(testRegExpStrs,
+                                                      NUM_TEST_REGEXPS,
+                                                      &threadOptions);
+  CHECK(threadLexer_p->numDfas == 1);
+  CHECK(dfas_are_equal(threadLexer_p->dfa_p, nfaLexer_p->dfa_p));
+  CHECK(reads_same_tokens(threadLexer_p, nfaLexer_p));
+  free_lexer(threadLexer_p);
+  threadOptions.maxNumDfaStates = 16;
+  groupOptions.usesDerivatives = false;
+  threadLexer_p = generate_lexer_with_options(testRegExpStrs, NUM_TEST_REGEXPS, &threadOptions);
+  groupLexer_p = generate_lexer_with_options(testRegExpStrs, NUM_TEST_REGEXPS, &groupOptions);
+  CHECK(threadLexer_p->numDfas == groupLexer_p->numDfas);
+  for (int i = 0; i < threadLexer_p->numDfas && i < groupLexer_p->numDfas; i++)
+  {
+    CHECK(dfas_are_equal(threadLexer_p->dfas_pp[i], groupLexer_p->dfas_pp[i]));
+  }
+  CHECK(reads_same_tokens(threadLexer_p, nfaLexer_p));
+  free_lexer(threadLexer_p);
+  free_lexer(groupLexer_p);
+
+  free_lexer(nfaLexer_p);
+
+  return finish_test("dfa_generation");
+}
@@ -0,0 +1,122 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests re-reading the tokens affected by random edits against reading the whole edited
+*        input again.
+* @file test_incremental_lexer.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "incremental_lexer.h"
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define TEST_INPUT_SIZE      2000
+#define MAX_TEST_EDIT_SIZE   12
+#define NUM_TEST_EDITS       1000
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Checks if two token arrays have the same tokens.
+ * @param[in]  tokens1_p  The first token array.
+ * @param[in]  tokens2_p  The second token array.
+ * @return True if both have the same tokens, read from the same states.
+ */
+static bool token_arrays_are_equal(const TokenArrayS* const tokens1_p,
+                                   const TokenArrayS* const tokens2_p);
+
+/*> Local Function Definitions ********************************************************************/
+static bool token_arrays_are_equal(const TokenArrayS* const tokens1_p,
+                                   const TokenArrayS* const tokens2_p)
+{
+  if (tokens1_p->numTokens != tokens2_p->numTokens)
+  {
+    return false;
+  }
+  for (int i = 0; i < tokens1_p->numTokens; i++)
+  {
+    const TokenS* token1_p = &(tokens1_p->tokens_p[i]);
+    const TokenS* token2_p = &(tokens2_p->tokens_p[i]);
+    if (token1_p->type != token2_p->type ||
+        token1_p->startIdx != token2_p->startIdx ||
+        token1_p->length != token2_p->length ||
+        token1_p->startState != token2_p->startState ||
+        token1_p->numCharsExamined != token2_p->numCharsExamined)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(51);
+
+  // The last RegExp looks ahead past the tokens it reads, so edits can change earlier tokens.
+  const char* regExpStrs[] = {"int", "char", "[0-9]+", " +", "ba(g|d|[h,2])?(ab(hg)+)*"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 5);
+  const char alphabet[] = "intchar0123bagdh2 x";
+  char* input_p = malloc(TEST_INPUT_SIZE + NUM_TEST_EDITS * MAX_TEST_EDIT_SIZE);
+  size_t inputLength = TEST_INPUT_SIZE;
+  for (size_t i = 0; i < inputLength; i++)
+  {
+    input_p[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+
+  TokenArrayS tokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  start_reading_buffer(lexer_p, input_p, inputLength);
+  read_all_tokens(lexer_p, &tokens);
+
+  // After every edit the changed tokens turn the old tokens into those of the new input.
+  int numBadEdits = 0;
+  for (int i = 0; i < NUM_TEST_EDITS; i++)
+  {
+    EditS edit;
+    edit.offset = rand() % (inputLength + 1);
+    edit.removedLength = rand() % (MAX_TEST_EDIT_SIZE + 1);
+    edit.removedLength = (edit.offset + edit.removedLength > inputLength) ?
+                         inputLength - edit.offset :
+                         edit.removedLength;
+    edit.insertedLength = rand() % (MAX_TEST_EDIT_SIZE + 1);
+    memmove(&(input_p[edit.offset + edit.insertedLength]),
+            &(input_p[edit.offset + edit.removedLength]),
+            inputLength - edit.offset - edit.removedLength);
+    for (size_t j = 0; j < edit.insertedLength; j++)
+    {
+      input_p[edit.offset + j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    inputLength = inputLength - edit.removedLength + edit.insertedLength;
+
+    TokenChangeS change = relex_edit(lexer_p, &tokens, input_p, inputLength, &edit);
+    apply_token_change(&tokens, &change, &edit);
+    free_token_array(&(change.newTokens));
+
+    TokenArrayS expectedTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+    start_reading_buffer(lexer_p, input_p, inputLength);
+    read_all_tokens(lexer_p, &expectedTokens);
+    numBadEdits += token_arrays_are_equal(&tokens, &expectedTokens) ? 0 : 1;
+    free_token_array(&expectedTokens);
+  }
+  CHECK(numBadEdits == 0);
+
+  free_token_array(&tokens);
+  free(input_p);
+  free_lexer(lexer_p);
+
+  return finish_test("incremental_lexer");
+}
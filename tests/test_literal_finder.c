@@ -0,0 +1,166 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests finding several literals at once against comparing every literal at every index,
+*        with random literals and inputs. Built with -mssse3, the 16 char path is tested as well.
+* @file test_literal_finder.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd_scan.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_RANDOM_FINDERS    300
+#define NUM_RANDOM_INPUTS     20
+#define MAX_TEST_LITERAL_SIZE 8
+#define MAX_TEST_INPUT_SIZE   200
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+/**
+ * @brief The chars of the literals and inputs, with chars that share a nibble and chars above 127.
+ */
+static const char testAlphabet[] = "abcqrs\x81\xa1\xe1";
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Orders literal occurrences by index and then literal, for qsort().
+ * @param[in]  match1_p  The first occurrence.
+ * @param[in]  match2_p  The second occurrence.
+ * @return Negative, zero or positive as the first occurrence is before, equal to or after the
+ *         second.
+ */
+static int compare_literal_matches(const void* const match1_p, const void* const match2_p);
+
+/**
+ * @brief Finds the occurrences of the literals of a literal finder by comparing every literal at
+ *        every index.
+ * @param[in]   finder_p     The literal finder.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[out]  matches_p    The array to append the occurrences to, sorted by index and literal.
+ */
+static void find_literals_slowly(const LiteralFinderS* const finder_p,
+                                 const char* const input_p,
+                                 const size_t inputLength,
+                                 LiteralMatchArrayS* const matches_p);
+
+/*> Local Function Definitions ********************************************************************/
+static int compare_literal_matches(const void* const match1_p, const void* const match2_p)
+{
+  const LiteralMatchS* literalMatch1_p = match1_p;
+  const LiteralMatchS* literalMatch2_p = match2_p;
+  if (literalMatch1_p->charIdx != literalMatch2_p->charIdx)
+  {
+    return (literalMatch1_p->charIdx < literalMatch2_p->charIdx) ? -1 : 1;
+  }
+  return literalMatch1_p->literal - literalMatch2_p->literal;
+}
+
+static void find_literals_slowly(const LiteralFinderS* const finder_p,
+                                 const char* const input_p,
+                                 const size_t inputLength,
+                                 LiteralMatchArrayS* const matches_p)
+{
+  for (size_t i = 0; i < inputLength; i++)
+  {
+    for (int literal = 0; literal < finder_p->numLiterals; literal++)
+    {
+      const size_t literalLength = finder_p->literalLengths[literal];
+      if (i + literalLength > inputLength ||
+          memcmp(&(input_p[i]), finder_p->literals[literal], literalLength) != 0)
+      {
+        continue;
+      }
+      matches_p->matches_p = realloc(matches_p->matches_p,
+                                     sizeof(LiteralMatchS) * (matches_p->numMatches + 1));
+      matches_p->matches_p[matches_p->numMatches].charIdx = i;
+      matches_p->matches_p[matches_p->numMatches].literal = literal;
+      matches_p->numMatches++;
+    }
+  }
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(56);
+
+  // Finders from one literal of one char, found by memchr(), to a full finder.
+  const size_t alphabetSize = sizeof(testAlphabet) - 1;
+  int numBadInputs = 0;
+  for (int i = 0; i < NUM_RANDOM_FINDERS; i++)
+  {
+    LiteralFinderS finder;
+    init_literal_finder(&finder);
+    const int numLiterals = (i == 0) ? 1 : 1 + rand() % MAX_NUM_FINDER_LITERALS;
+    for (int j = 0; j < numLiterals; j++)
+    {
+      RegExpLiteralS literal = { .numChars = (i == 0) ? 1 : 1 + rand() % MAX_TEST_LITERAL_SIZE };
+      for (int k = 0; k < literal.numChars; k++)
+      {
+        literal.characters[k] = testAlphabet[rand() % alphabetSize];
+      }
+      CHECK(add_finder_literal(&finder, &literal) == j);
+    }
+
+    char input[MAX_TEST_INPUT_SIZE];
+    for (int j = 0; j < NUM_RANDOM_INPUTS; j++)
+    {
+      size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+      for (size_t k = 0; k < inputLength; k++)
+      {
+        input[k] = testAlphabet[rand() % alphabetSize];
+      }
+
+      LiteralMatchArrayS matches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+      LiteralMatchArrayS expectedMatches =
+      {
+        .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0
+      };
+      find_literals_in_input(&finder, input, inputLength, &matches);
+      find_literals_slowly(&finder, input, inputLength, &expectedMatches);
+      if (matches.numMatches > 0)
+      {
+        qsort(matches.matches_p,
+              matches.numMatches,
+              sizeof(LiteralMatchS),
+              compare_literal_matches);
+      }
+      bool isSame = matches.numMatches == expectedMatches.numMatches;
+      for (int k = 0; k < matches.numMatches && isSame; k++)
+      {
+        isSame = compare_literal_matches(&(matches.matches_p[k]),
+                                         &(expectedMatches.matches_p[k])) == 0;
+      }
+      numBadInputs += isSame ? 0 : 1;
+      free_literal_match_array(&matches);
+      free_literal_match_array(&expectedMatches);
+    }
+  }
+  CHECK(numBadInputs == 0);
+
+  // Empty literals and literals beyond MAX_NUM_FINDER_LITERALS are not added.
+  LiteralFinderS finder;
+  init_literal_finder(&finder);
+  RegExpLiteralS literal = { .characters = "ab", .numChars = 0 };
+  CHECK(add_finder_literal(&finder, &literal) == NO_LITERAL);
+  literal.numChars = 2;
+  for (int i = 0; i < MAX_NUM_FINDER_LITERALS; i++)
+  {
+    CHECK(add_finder_literal(&finder, &literal) == i);
+  }
+  CHECK(add_finder_literal(&finder, &literal) == NO_LITERAL);
+
+  return finish_test("literal_finder");
+}
@@ -0,0 +1,109 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests merging lexers against lexers generated from all their RegExps at once, including
+*        lexers whose product does not fit one DFA.
+* @file test_merge.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define TEST_INPUT_SIZE  20000
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Checks if two lexers read the same tokens from a random input of chars from an alphabet.
+ * @param[in/out]  lexer1_p    The first lexer.
+ * @param[in/out]  lexer2_p    The second lexer.
+ * @param[in]      alphabet_p  The chars of the input.
+ * @return True if both read the same token types and lengths.
+ */
+static bool read_same_tokens(LexerS* const lexer1_p,
+                             LexerS* const lexer2_p,
+                             const char* const alphabet_p);
+
+/*> Local Function Definitions ********************************************************************/
+static bool read_same_tokens(LexerS* const lexer1_p,
+                             LexerS* const lexer2_p,
+                             const char* const alphabet_p)
+{
+  char* input_p = malloc(TEST_INPUT_SIZE);
+  const size_t alphabetSize = strlen(alphabet_p);
+  for (size_t i = 0; i < TEST_INPUT_SIZE; i++)
+  {
+    input_p[i] = alphabet_p[rand() % alphabetSize];
+  }
+
+  start_reading_buffer(lexer1_p, input_p, TEST_INPUT_SIZE);
+  start_reading_buffer(lexer2_p, input_p, TEST_INPUT_SIZE);
+  bool isSame = true;
+  TokenS token1;
+  do
+  {
+    token1 = get_next_token(lexer1_p);
+    TokenS token2 = get_next_token(lexer2_p);
+    isSame = token1.type == token2.type && token1.length == token2.length;
+  } while (isSame && token1.type != TOKEN_TYPE_END);
+
+  free(input_p);
+  return isSame;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(69);
+
+  // Small lexers are merged into one DFA.
+  const char* numberRegExpStrs[] = {"[0-9]+", "[0-9]+\\.[0-9]+", "0x[0-9,a-f]+"};
+  const char* wordRegExpStrs[] = {"if", "int", "in", "for", "[a-z]+", "return"};
+  const char* allRegExpStrs[] = {"[0-9]+", "[0-9]+\\.[0-9]+", "0x[0-9,a-f]+",
+                                 "if", "int", "in", "for", "[a-z]+", "return"};
+  LexerS* numberLexer_p = generate_lexer(numberRegExpStrs, 3);
+  LexerS* wordLexer_p = generate_lexer(wordRegExpStrs, 6);
+  LexerS* allLexer_p = generate_lexer(allRegExpStrs, 9);
+  const LexerS* lexers_pp[] = {numberLexer_p, wordLexer_p};
+  LexerS* mergedLexer_p = merge_lexers(lexers_pp, 2);
+  CHECK(mergedLexer_p->numDfas == 1);
+  CHECK(mergedLexer_p->numRules == 9);
+  CHECK(read_same_tokens(mergedLexer_p, allLexer_p, "0123456789.xabcdefinrtu "));
+  free_lexer(mergedLexer_p);
+  free_lexer(allLexer_p);
+  free_lexer(numberLexer_p);
+  free_lexer(wordLexer_p);
+
+  // Each lexer has 256 states, but their product has more than a DFA may have, so the merged lexer
+  // scans both DFAs in lockstep.
+  const char* firstRegExpStrs[] = {"[a-d]*a[a-d]{7}"};
+  const char* secondRegExpStrs[] = {"[a-d]*[a,b][a-d]{7}"};
+  const char* bothRegExpStrs[] = {"[a-d]*a[a-d]{7}", "[a-d]*[a,b][a-d]{7}"};
+  LexerS* firstLexer_p = generate_lexer(firstRegExpStrs, 1);
+  LexerS* secondLexer_p = generate_lexer(secondRegExpStrs, 1);
+  LexerS* bothLexer_p = generate_lexer(bothRegExpStrs, 2);
+  CHECK(firstLexer_p->numDfas == 1 && secondLexer_p->numDfas == 1);
+  const LexerS* largeLexers_pp[] = {firstLexer_p, secondLexer_p};
+  mergedLexer_p = merge_lexers(largeLexers_pp, 2);
+  CHECK(mergedLexer_p->numDfas == 2);
+  CHECK(read_same_tokens(mergedLexer_p, bothLexer_p, "abcde"));
+  free_lexer(mergedLexer_p);
+  free_lexer(bothLexer_p);
+  free_lexer(firstLexer_p);
+  free_lexer(secondLexer_p);
+
+  return finish_test("merge");
+}
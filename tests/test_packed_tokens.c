@@ -0,0 +1,158 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests packing tokens and unpacking them again, for tokens read by a lexer and for random
+*        tokens whose columns take every bit width.
+* @file test_packed_tokens.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lexer_generator.h"
+#include "packed_tokens.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define TEST_INPUT_SIZE       100000
+#define NUM_RANDOM_TOKENS     (40 * PACKED_TOKENS_BLOCK_SIZE + 17)
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Gets a random value that fits in a bit width.
+ * @param[in]  bitWidth  The bit width, at most 32.
+ * @return The value.
+ */
+static uint32_t get_random_value(const int bitWidth);
+
+/**
+ * @brief Checks if packed tokens unpack to the tokens of a token array, both through an iterator
+ *        from the first block and block by block.
+ * @param[in]  packedTokens_p  The packed tokens.
+ * @param[in]  tokenArray_p    The tokens that were packed.
+ * @return True if every token is unpacked as it was packed.
+ */
+static bool unpacks_to(const PackedTokensS* const packedTokens_p,
+                       const TokenArrayS* const tokenArray_p);
+
+/*> Local Function Definitions ********************************************************************/
+static uint32_t get_random_value(const int bitWidth)
+{
+  uint32_t value = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+  return (bitWidth == 32) ? value : value & (((uint32_t) 1 << bitWidth) - 1);
+}
+
+static bool unpacks_to(const PackedTokensS* const packedTokens_p,
+                       const TokenArrayS* const tokenArray_p)
+{
+  bool isSame = packedTokens_p->numTokens == tokenArray_p->numTokens;
+  PackedTokenIteratorS iterator;
+  TokenS token;
+  int numTokens = 0;
+  seek_packed_tokens_block(&iterator, packedTokens_p, 0);
+  while (next_packed_token(&iterator, &token))
+  {
+    const TokenS* expectedToken_p = &(tokenArray_p->tokens_p[numTokens]);
+    isSame = isSame &&
+             numTokens < tokenArray_p->numTokens &&
+             token.type == expectedToken_p->type &&
+             token.startIdx == expectedToken_p->startIdx &&
+             token.length == expectedToken_p->length &&
+             token.startState == 0 &&
+             token.numCharsExamined == token.length + 1;
+    numTokens++;
+  }
+  isSame = isSame && numTokens == tokenArray_p->numTokens;
+
+  TokenS tokens[PACKED_TOKENS_BLOCK_SIZE];
+  int firstTokenIdx = 0;
+  for (int i = 0; i <= packedTokens_p->numBlocks && isSame; i++)
+  {
+    int numBlockTokens = unpack_tokens_block(packedTokens_p, i, tokens);
+    isSame = (i < packedTokens_p->numBlocks) ?
+             numBlockTokens == PACKED_TOKENS_BLOCK_SIZE :
+             firstTokenIdx + numBlockTokens == tokenArray_p->numTokens;
+    for (int j = 0; j < numBlockTokens && isSame; j++)
+    {
+      isSame = tokens[j].startIdx == tokenArray_p->tokens_p[firstTokenIdx + j].startIdx;
+    }
+    firstTokenIdx += numBlockTokens;
+  }
+  return isSame;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(54);
+
+  // Tokens read by a lexer, including error tokens.
+  const char* regExpStrs[] = {"int", "char", "[0-9]+", "ba(g|d|[h,2])?(ab(hg)+)*"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 4);
+  const char alphabet[] = "intchar0123bagdh2 x";
+  char* input_p = malloc(TEST_INPUT_SIZE);
+  for (size_t i = 0; i < TEST_INPUT_SIZE; i++)
+  {
+    input_p[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+  TokenArrayS tokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  start_reading_buffer(lexer_p, input_p, TEST_INPUT_SIZE);
+  read_all_tokens(lexer_p, &tokens);
+
+  PackedTokensS packedTokens;
+  init_packed_tokens(&packedTokens);
+  add_packed_token_array(&packedTokens, &tokens);
+  CHECK(packedTokens.numBlocks > 2);
+  CHECK(unpacks_to(&packedTokens, &tokens));
+  CHECK(packed_tokens_size(&packedTokens) < sizeof(TokenS) * tokens.numTokens);
+  free_packed_tokens(&packedTokens);
+  free_token_array(&tokens);
+
+  // Random tokens, with the bit widths of each block's columns drawn from 0 to 32.
+  TokenArrayS randomTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  size_t endIdx = 0;
+  int typeBits = 0;
+  int distanceBits = 0;
+  int lengthBits = 0;
+  for (int i = 0; i < NUM_RANDOM_TOKENS; i++)
+  {
+    if (i % PACKED_TOKENS_BLOCK_SIZE == 0)
+    {
+      typeBits = rand() % 32;
+      distanceBits = rand() % 33;
+      lengthBits = rand() % 33;
+    }
+    TokenS token =
+    {
+      .type = (int) get_random_value(typeBits) - 1,
+      .startIdx = endIdx + get_random_value(distanceBits),
+      .length = get_random_value(lengthBits)
+    };
+    add_token(&randomTokens, &token);
+    endIdx = token.startIdx + token.length;
+  }
+  init_packed_tokens(&packedTokens);
+  for (int i = 0; i < randomTokens.numTokens; i++)
+  {
+    add_packed_token(&packedTokens, &(randomTokens.tokens_p[i]));
+  }
+  CHECK(packedTokens.numBlocks == NUM_RANDOM_TOKENS / PACKED_TOKENS_BLOCK_SIZE);
+  CHECK(unpacks_to(&packedTokens, &randomTokens));
+  free_packed_tokens(&packedTokens);
+  free_token_array(&randomTokens);
+
+  free(input_p);
+  free_lexer(lexer_p);
+
+  return finish_test("packed_tokens");
+}
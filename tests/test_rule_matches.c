@@ -0,0 +1,207 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests reading all matches of overlapping RegExps against matching each RegExp on its own
+*        at every offset, with and without only the longest match of each RegExp.
+* @file test_rule_matches.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer_generator.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define MAX_NUM_TEST_RULES    80
+#define NUM_RANDOM_INPUTS     100
+#define MAX_TEST_INPUT_SIZE   40
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Finds the ends of the matches of a RegExp from a start index with its own lexer.
+ * @param[in]   ruleLexer_p  The lexer of the RegExp alone.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[in]   startIdx     The index the matches start at.
+ * @param[out]  isEnd_p      For each index from startIdx to inputLength, true if a match ends
+ *                           there.
+ */
+static void find_rule_ends(const LexerS* const ruleLexer_p,
+                           const char* const input_p,
+                           const size_t inputLength,
+                           const size_t startIdx,
+                           bool* const isEnd_p);
+
+/**
+ * @brief Reads the matches of several RegExps from random inputs at every offset, and compares
+ *        them with the matches of each RegExp on its own, in both modes of read_rule_matches().
+ * @param[in]  regExpStrs_pp  The RegExps.
+ * @param[in]  numRules       The number of RegExps.
+ * @param[in]  options_p      The options to generate the lexer of all RegExps with.
+ * @param[in]  alphabet_p     The chars of the inputs.
+ * @return The number of offsets whose matches differ.
+ */
+static int count_bad_offsets(const char** const regExpStrs_pp,
+                             const int numRules,
+                             const LexerOptionsS* const options_p,
+                             const char* const alphabet_p);
+
+/*> Local Function Definitions ********************************************************************/
+static void find_rule_ends(const LexerS* const ruleLexer_p,
+                           const char* const input_p,
+                           const size_t inputLength,
+                           const size_t startIdx,
+                           bool* const isEnd_p)
+{
+  const DfaS* dfa_p = ruleLexer_p->dfa_p;
+  int state = 0;
+  isEnd_p[0] = false;
+  for (size_t charIdx = startIdx; charIdx < inputLength; charIdx++)
+  {
+    state = (state == NO_STATE) ?
+            (int) NO_STATE :
+            dfa_p->states[state].transitions[(unsigned char) input_p[charIdx]];
+    isEnd_p[charIdx + 1 - startIdx] = state != NO_STATE && dfa_p->states[state].isEndState;
+  }
+}
+
+static int count_bad_offsets(const char** const regExpStrs_pp,
+                             const int numRules,
+                             const LexerOptionsS* const options_p,
+                             const char* const alphabet_p)
+{
+  LexerS* lexer_p = generate_lexer_with_options(regExpStrs_pp, numRules, options_p);
+  LexerS* ruleLexers_pp[MAX_NUM_TEST_RULES];
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    ruleLexers_pp[rule] = generate_lexer(&(regExpStrs_pp[rule]), 1);
+  }
+
+  const size_t alphabetSize = strlen(alphabet_p);
+  char input[MAX_TEST_INPUT_SIZE];
+  static bool isEnd[MAX_NUM_TEST_RULES][MAX_TEST_INPUT_SIZE + 1];
+  int numBadOffsets = 0;
+  for (int i = 0; i < NUM_RANDOM_INPUTS; i++)
+  {
+    size_t inputLength = 1 + rand() % MAX_TEST_INPUT_SIZE;
+    for (size_t j = 0; j < inputLength; j++)
+    {
+      input[j] = alphabet_p[rand() % alphabetSize];
+    }
+    start_reading_buffer(lexer_p, input, inputLength);
+
+    for (size_t startIdx = 0; startIdx < inputLength; startIdx++)
+    {
+      for (int rule = 0; rule < numRules; rule++)
+      {
+        find_rule_ends(ruleLexers_pp[rule], input, inputLength, startIdx, isEnd[rule]);
+      }
+
+      // Every (RegExp, end) pair, by end and then RegExp.
+      RuleMatchArrayS matches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+      read_rule_matches(lexer_p, startIdx, false, &matches);
+      bool isSame = true;
+      int matchIdx = 0;
+      for (size_t endIdx = startIdx + 1; endIdx <= inputLength; endIdx++)
+      {
+        for (int rule = 0; rule < numRules; rule++)
+        {
+          if (!isEnd[rule][endIdx - startIdx])
+          {
+            continue;
+          }
+          isSame = isSame &&
+                   matchIdx < matches.numMatches &&
+                   matches.matches_p[matchIdx].rule == rule &&
+                   matches.matches_p[matchIdx].endIdx == endIdx;
+          matchIdx++;
+        }
+      }
+      isSame = isSame && matchIdx == matches.numMatches;
+      free_rule_match_array(&matches);
+
+      // The longest match of each RegExp, in the order the RegExps first matched.
+      read_rule_matches(lexer_p, startIdx, true, &matches);
+      matchIdx = 0;
+      for (size_t firstEndIdx = startIdx + 1; firstEndIdx <= inputLength; firstEndIdx++)
+      {
+        for (int rule = 0; rule < numRules; rule++)
+        {
+          size_t endIdx = firstEndIdx;
+          if (!isEnd[rule][endIdx - startIdx])
+          {
+            continue;
+          }
+          bool isFirstEnd = true;
+          for (size_t j = startIdx + 1; j < firstEndIdx; j++)
+          {
+            isFirstEnd = isFirstEnd && !isEnd[rule][j - startIdx];
+          }
+          if (!isFirstEnd)
+          {
+            continue;
+          }
+          for (size_t j = firstEndIdx + 1; j <= inputLength; j++)
+          {
+            endIdx = isEnd[rule][j - startIdx] ? j : endIdx;
+          }
+          isSame = isSame &&
+                   matchIdx < matches.numMatches &&
+                   matches.matches_p[matchIdx].rule == rule &&
+                   matches.matches_p[matchIdx].endIdx == endIdx;
+          matchIdx++;
+        }
+      }
+      isSame = isSame && matchIdx == matches.numMatches;
+      free_rule_match_array(&matches);
+      numBadOffsets += isSame ? 0 : 1;
+    }
+  }
+
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    free_lexer(ruleLexers_pp[rule]);
+  }
+  free_lexer(lexer_p);
+  return numBadOffsets;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(58);
+
+  // Overlapping RegExps, one of which only matches at the end of an input of its chars.
+  const char* regExpStrs[] = {"[a,b]+", "ab", "b[a,b]a", "a*", "(ab)+c?", "[a-c]+c", "c"};
+  LexerOptionsS options = { .maxNumDfaStates = 0 };
+  CHECK(count_bad_offsets(regExpStrs, 7, &options, "abc") == 0);
+
+  // The same RegExps split into groups that are run in lockstep.
+  options.maxNumDfaStates = 4;
+  CHECK(count_bad_offsets(regExpStrs, 7, &options, "abc") == 0);
+
+  // More RegExps than fit the bitmap of accepted rules, so they are kept in lists.
+  char regExpChars[MAX_NUM_TEST_RULES][16];
+  const char* manyRegExpStrs[MAX_NUM_TEST_RULES];
+  for (int i = 0; i < MAX_NUM_TEST_RULES; i++)
+  {
+    snprintf(regExpChars[i], sizeof(regExpChars[i]), "a{%d}[a,b]*", 1 + i % 20);
+    manyRegExpStrs[i] = regExpChars[i];
+  }
+  options.maxNumDfaStates = 0;
+  CHECK(count_bad_offsets(manyRegExpStrs, MAX_NUM_TEST_RULES, &options, "aab") == 0);
+
+  return finish_test("rule_matches");
+}
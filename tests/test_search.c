@@ -0,0 +1,277 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests search mode against a brute force search with one anchored DFA per RegExp, on random
+*        inputs, with and without required literals and with several threads.
+* @file test_search.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfa.h"
+#include "nfa.h"
+#include "reg_exp.h"
+#include "search.h"
+#include "test_utils.h"
+
+/*> Defines ***************************************************************************************/
+#define MAX_NUM_TEST_RULES   8
+#define MAX_TEST_INPUT_SIZE  64
+#define NUM_RANDOM_INPUTS    2000
+#define LARGE_INPUT_SIZE     (1024 * 1024)
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Checks if an anchored DFA matches exactly the chars from startIdx to endIdx.
+ * @param[in]  dfa_p     The DFA.
+ * @param[in]  input_p   The input.
+ * @param[in]  startIdx  The index of the first char.
+ * @param[in]  endIdx    The index after the last char.
+ * @return True if the chars match.
+ */
+static bool matches_exactly(const DfaS* const dfa_p,
+                            const char* const input_p,
+                            const size_t startIdx,
+                            const size_t endIdx);
+
+/**
+ * @brief Searches an input like search(), by trying every start and end of every RegExp.
+ * @param[in]   dfas_pp      The anchored DFA of each RegExp.
+ * @param[in]   numRules     The number of RegExps.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[out]  matches_p    The array to append the matches to, sorted by start index and rule.
+ */
+static void search_brute_force(DfaS* const* const dfas_pp,
+                               const int numRules,
+                               const char* const input_p,
+                               const size_t inputLength,
+                               SearchMatchArrayS* const matches_p);
+
+/**
+ * @brief Checks if two match arrays are equal.
+ * @param[in]  matches1_p  The first match array.
+ * @param[in]  matches2_p  The second match array.
+ * @return True if both have the same matches in the same order.
+ */
+static bool match_arrays_are_equal(const SearchMatchArrayS* const matches1_p,
+                                   const SearchMatchArrayS* const matches2_p);
+
+/**
+ * @brief Searches random inputs of chars from an alphabet and compares the matches with a brute
+ *        force search.
+ * @param[in]  regExpStrs_pp  The RegExps.
+ * @param[in]  numRules       The number of RegExps.
+ * @param[in]  alphabet_p     The chars of the inputs.
+ */
+static void check_random_inputs(const char** const regExpStrs_pp,
+                                const int numRules,
+                                const char* const alphabet_p);
+
+/*> Local Function Definitions ********************************************************************/
+static bool matches_exactly(const DfaS* const dfa_p,
+                            const char* const input_p,
+                            const size_t startIdx,
+                            const size_t endIdx)
+{
+  int state = 0;
+  for (size_t i = startIdx; i < endIdx && state != NO_STATE; i++)
+  {
+    state = dfa_p->states[state].transitions[(unsigned char) input_p[i]];
+  }
+  return state != NO_STATE && dfa_p->states[state].isEndState;
+}
+
+static void search_brute_force(DfaS* const* const dfas_pp,
+                               const int numRules,
+                               const char* const input_p,
+                               const size_t inputLength,
+                               SearchMatchArrayS* const matches_p)
+{
+  SearchMatchArrayS ruleMatches[MAX_NUM_TEST_RULES] = {{0}};
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    size_t prevEndIdx = 0;
+    for (size_t endIdx = prevEndIdx + 1; endIdx <= inputLength; endIdx++)
+    {
+      size_t startIdx = prevEndIdx;
+      while (startIdx < endIdx && !matches_exactly(dfas_pp[rule], input_p, startIdx, endIdx))
+      {
+        startIdx++;
+      }
+      if (startIdx == endIdx)
+      {
+        continue;
+      }
+
+      SearchMatchS match = { .rule = rule, .startIdx = startIdx, .endIdx = endIdx };
+      for (size_t longerEndIdx = endIdx + 1; longerEndIdx <= inputLength; longerEndIdx++)
+      {
+        if (matches_exactly(dfas_pp[rule], input_p, startIdx, longerEndIdx))
+        {
+          match.endIdx = longerEndIdx;
+        }
+      }
+      SearchMatchArrayS* ruleMatches_p = &(ruleMatches[rule]);
+      ruleMatches_p->matches_p = realloc(ruleMatches_p->matches_p,
+                                         sizeof(SearchMatchS) * (ruleMatches_p->numMatches + 1));
+      ruleMatches_p->matches_p[ruleMatches_p->numMatches] = match;
+      ruleMatches_p->numMatches++;
+      prevEndIdx = match.endIdx;
+      endIdx = prevEndIdx;
+    }
+  }
+
+  // Merge the matches of the RegExps by start index and then rule.
+  int nextMatchIdxs[MAX_NUM_TEST_RULES] = {0};
+  while (true)
+  {
+    int nextRule = -1;
+    for (int rule = 0; rule < numRules; rule++)
+    {
+      if (nextMatchIdxs[rule] < ruleMatches[rule].numMatches &&
+          (nextRule == -1 ||
+           ruleMatches[rule].matches_p[nextMatchIdxs[rule]].startIdx <
+           ruleMatches[nextRule].matches_p[nextMatchIdxs[nextRule]].startIdx))
+      {
+        nextRule = rule;
+      }
+    }
+    if (nextRule == -1)
+    {
+      break;
+    }
+    matches_p->matches_p = realloc(matches_p->matches_p,
+                                   sizeof(SearchMatchS) * (matches_p->numMatches + 1));
+    matches_p->matches_p[matches_p->numMatches] =
+      ruleMatches[nextRule].matches_p[nextMatchIdxs[nextRule]];
+    matches_p->numMatches++;
+    nextMatchIdxs[nextRule]++;
+  }
+
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    free(ruleMatches[rule].matches_p);
+  }
+}
+
+static bool match_arrays_are_equal(const SearchMatchArrayS* const matches1_p,
+                                   const SearchMatchArrayS* const matches2_p)
+{
+  if (matches1_p->numMatches != matches2_p->numMatches)
+  {
+    return false;
+  }
+  for (int i = 0; i < matches1_p->numMatches; i++)
+  {
+    const SearchMatchS* match1_p = &(matches1_p->matches_p[i]);
+    const SearchMatchS* match2_p = &(matches2_p->matches_p[i]);
+    if (match1_p->rule != match2_p->rule ||
+        match1_p->startIdx != match2_p->startIdx ||
+        match1_p->endIdx != match2_p->endIdx)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void check_random_inputs(const char** const regExpStrs_pp,
+                                const int numRules,
+                                const char* const alphabet_p)
+{
+  SearcherS* searcher_p = generate_searcher(regExpStrs_pp, numRules);
+  CHECK(searcher_p != NULL);
+  if (searcher_p == NULL)
+  {
+    return;
+  }
+
+  DfaS* dfas_pp[MAX_NUM_TEST_RULES];
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    RegExpS* regExp_p = parse_regexp(regExpStrs_pp[rule]);
+    NfaS* nfa_p = generate_nfa(regExp_p, rule);
+    dfas_pp[rule] = convert_to_dfa(nfa_p);
+    free(nfa_p);
+    free_regexp(regExp_p);
+  }
+
+  const size_t alphabetSize = strlen(alphabet_p);
+  char input[MAX_TEST_INPUT_SIZE];
+  int numMismatches = 0;
+  for (int i = 0; i < NUM_RANDOM_INPUTS; i++)
+  {
+    size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+    for (size_t j = 0; j < inputLength; j++)
+    {
+      input[j] = alphabet_p[rand() % alphabetSize];
+    }
+
+    SearchMatchArrayS matches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+    SearchMatchArrayS expectedMatches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+    search(searcher_p, input, inputLength, 1, &matches);
+    search_brute_force(dfas_pp, numRules, input, inputLength, &expectedMatches);
+    numMismatches += match_arrays_are_equal(&matches, &expectedMatches) ? 0 : 1;
+    free_search_match_array(&matches);
+    free_search_match_array(&expectedMatches);
+  }
+  CHECK(numMismatches == 0);
+
+  // Chunks searched on several threads must give the same matches as one pass.
+  char* largeInput_p = malloc(LARGE_INPUT_SIZE);
+  for (size_t j = 0; j < LARGE_INPUT_SIZE; j++)
+  {
+    largeInput_p[j] = alphabet_p[rand() % alphabetSize];
+  }
+  SearchMatchArrayS matches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+  SearchMatchArrayS parallelMatches = { .matches_p = NULL, .numMatches = 0, .maxNumMatches = 0 };
+  search(searcher_p, largeInput_p, LARGE_INPUT_SIZE, 1, &matches);
+  search(searcher_p, largeInput_p, LARGE_INPUT_SIZE, 4, &parallelMatches);
+  CHECK(matches.numMatches > 0);
+  CHECK(match_arrays_are_equal(&matches, &parallelMatches));
+  free_search_match_array(&matches);
+  free_search_match_array(&parallelMatches);
+  free(largeInput_p);
+
+  for (int rule = 0; rule < numRules; rule++)
+  {
+    free_dfa(dfas_pp[rule]);
+  }
+  free_searcher(searcher_p);
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(55);
+
+  // Every RegExp has a literal at a bounded offset, so only the input near them is searched.
+  const char* literalRegExpStrs[] = {"int", "char", "ba(g|d|[h,2])?(ab(hg)+)*", "(ab|b)c"};
+  check_random_inputs(literalRegExpStrs, 4, "intchar0123bagdhabc2 x");
+
+  // A RegExp without a literal makes the whole input be searched.
+  const char* regExpStrs[] = {"int", "[0-9]+", "ba(g|d|[h,2])?(ab(hg)+)*", "(ab|b)c", "a*b"};
+  check_random_inputs(regExpStrs, 5, "intchar0123bagdhabc2 x");
+
+  // Overlapping RegExps are all reported.
+  const char* overlappingRegExpStrs[] = {"[a,b]+", "ab", "b[a,b]a"};
+  check_random_inputs(overlappingRegExpStrs, 3, "abc");
+
+  // The DFA of ".*a[a,b]{11}" needs 4096 states, one more than a DFA may have.
+  const char* largeRegExpStrs[] = {"a[a,b]{11}"};
+  CHECK(generate_searcher(largeRegExpStrs, 1) == NULL);
+
+  return finish_test("search");
+}
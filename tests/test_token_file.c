@@ -0,0 +1,201 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests writing read tokens to a token file and reading them back, and that corrupt token
+*        files are rejected instead of read past their columns.
+* @file test_token_file.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer_generator.h"
+#include "test_utils.h"
+#include "token_file.h"
+
+/*> Defines ***************************************************************************************/
+#define TEST_INPUT_SIZE        300000
+#define TEST_TOKEN_FILE_PATH   "/tmp/test_token_file.bin"
+#define TEST_HEADER_SIZE       32
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Reads a whole file.
+ * @param[in]   path_p  The path of the file.
+ * @param[out]  size_p  The size of the file.
+ * @return The allocated contents of the file.
+ */
+static unsigned char* read_file(const char* const path_p, size_t* const size_p);
+
+/**
+ * @brief Writes a whole file.
+ * @param[in]  path_p  The path of the file.
+ * @param[in]  data_p  The contents of the file.
+ * @param[in]  size    The size of the file.
+ */
+static void write_file(const char* const path_p,
+                       const unsigned char* const data_p,
+                       const size_t size);
+
+/**
+ * @brief Counts the tokens that can be read from a token file.
+ * @param[in]  path_p  The path of the file.
+ * @return The number of tokens, -1 if the file is not opened.
+ */
+static int count_readable_tokens(const char* const path_p);
+
+/*> Local Function Definitions ********************************************************************/
+static unsigned char* read_file(const char* const path_p, size_t* const size_p)
+{
+  FILE* file_p = fopen(path_p, "rb");
+  fseek(file_p, 0, SEEK_END);
+  *size_p = ftell(file_p);
+  fseek(file_p, 0, SEEK_SET);
+  unsigned char* data_p = malloc(*size_p);
+  CHECK(fread(data_p, 1, *size_p, file_p) == *size_p);
+  fclose(file_p);
+  return data_p;
+}
+
+static void write_file(const char* const path_p,
+                       const unsigned char* const data_p,
+                       const size_t size)
+{
+  FILE* file_p = fopen(path_p, "wb");
+  CHECK(fwrite(data_p, 1, size, file_p) == size);
+  fclose(file_p);
+}
+
+static int count_readable_tokens(const char* const path_p)
+{
+  TokenFileS file;
+  if (!open_token_file(&file, path_p))
+  {
+    return -1;
+  }
+
+  TokenFileIteratorS iterator;
+  TokenS token;
+  int numTokens = 0;
+  seek_token_file_block(&iterator, &file, 0);
+  while (next_token_file_token(&iterator, &token))
+  {
+    numTokens++;
+  }
+  close_token_file(&file);
+  return numTokens;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(53);
+
+  const char* regExpStrs[] = {"int", "char", "[0-9]+", "ba(g|d|[h,2])?(ab(hg)+)*"};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 4);
+  const char alphabet[] = "intchar0123bagdh2 x";
+  char* input_p = malloc(TEST_INPUT_SIZE);
+  for (size_t i = 0; i < TEST_INPUT_SIZE; i++)
+  {
+    input_p[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+  }
+  TokenArrayS tokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  start_reading_buffer(lexer_p, input_p, TEST_INPUT_SIZE);
+  read_all_tokens(lexer_p, &tokens);
+
+  // Every token is read back, from the start and from the block found for a char index.
+  TokenFileS file;
+  CHECK(write_token_file(&tokens, TEST_TOKEN_FILE_PATH));
+  CHECK(open_token_file(&file, TEST_TOKEN_FILE_PATH));
+  CHECK(file.numTokens == (uint64_t) tokens.numTokens);
+  CHECK(file.numBlocks > 2);
+
+  TokenFileIteratorS iterator;
+  TokenS token;
+  int numTokens = 0;
+  int numBadTokens = 0;
+  seek_token_file_block(&iterator, &file, 0);
+  while (next_token_file_token(&iterator, &token) && numTokens < tokens.numTokens)
+  {
+    const TokenS* expectedToken_p = &(tokens.tokens_p[numTokens]);
+    numBadTokens += (token.type == expectedToken_p->type &&
+                     token.startIdx == expectedToken_p->startIdx &&
+                     token.length == expectedToken_p->length) ? 0 : 1;
+    numTokens++;
+  }
+  CHECK(numTokens == tokens.numTokens);
+  CHECK(numBadTokens == 0);
+
+  const size_t charIdx = TEST_INPUT_SIZE / 2;
+  seek_token_file_block(&iterator, &file, find_token_file_block(&file, charIdx));
+  CHECK(next_token_file_token(&iterator, &token));
+  CHECK(token.startIdx <= charIdx);
+  close_token_file(&file);
+
+  // Token types are stored in 16 bits, so larger ones are not written.
+  TokenArrayS largeTypeTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+  TokenS largeTypeToken = { .type = 40000, .startIdx = 0, .length = 1 };
+  add_token(&largeTypeTokens, &largeTypeToken);
+  CHECK(!write_token_file(&largeTypeTokens, TEST_TOKEN_FILE_PATH "2"));
+  free_token_array(&largeTypeTokens);
+
+  size_t size;
+  unsigned char* data_p = read_file(TEST_TOKEN_FILE_PATH, &size);
+  const size_t directoryOffset = data_p[24] | (data_p[25] << 8) | (data_p[26] << 16);
+  unsigned char* firstEntry_p = &(data_p[directoryOffset]);
+  const size_t numFirstBlockTokens = firstEntry_p[16] | (firstEntry_p[17] << 8);
+  const size_t firstDistancesLength = firstEntry_p[20] | (firstEntry_p[21] << 8);
+  const size_t firstLengthsLength = firstEntry_p[24] | (firstEntry_p[25] << 8);
+  unsigned char* firstDistances_p = &(data_p[TEST_HEADER_SIZE + 2 * numFirstBlockTokens]);
+  unsigned char* firstLengths_p = firstDistances_p + firstDistancesLength;
+
+  // Blocks whose first tokens do not start in order are rejected.
+  unsigned char savedFirstStartIdx[8];
+  memcpy(savedFirstStartIdx, &(firstEntry_p[8]), 8);
+  memset(&(firstEntry_p[8]), 0xff, 8);
+  write_file(TEST_TOKEN_FILE_PATH, data_p, size);
+  CHECK(count_readable_tokens(TEST_TOKEN_FILE_PATH) == -1);
+  memcpy(&(firstEntry_p[8]), savedFirstStartIdx, 8);
+
+  // A varint longer than MAX_VARINT_SIZE bytes stops reading.
+  unsigned char savedBytes[16];
+  memcpy(savedBytes, firstDistances_p, 16);
+  memset(firstDistances_p, 0xff, 16);
+  write_file(TEST_TOKEN_FILE_PATH, data_p, size);
+  CHECK(count_readable_tokens(TEST_TOKEN_FILE_PATH) == 0);
+
+  // A varint of 10 bytes that does not fit in 64 bits stops reading.
+  firstDistances_p[9] = 0x02;
+  write_file(TEST_TOKEN_FILE_PATH, data_p, size);
+  CHECK(count_readable_tokens(TEST_TOKEN_FILE_PATH) == 0);
+  memcpy(firstDistances_p, savedBytes, 16);
+
+  // A varint running past the end of its column stops reading at the token it belongs to.
+  unsigned char savedByte = firstLengths_p[firstLengthsLength - 1];
+  firstLengths_p[firstLengthsLength - 1] |= 0x80;
+  write_file(TEST_TOKEN_FILE_PATH, data_p, size);
+  CHECK(count_readable_tokens(TEST_TOKEN_FILE_PATH) == (int) numFirstBlockTokens - 1);
+  firstLengths_p[firstLengthsLength - 1] = savedByte;
+
+  write_file(TEST_TOKEN_FILE_PATH, data_p, size);
+  CHECK(count_readable_tokens(TEST_TOKEN_FILE_PATH) == tokens.numTokens);
+  free(data_p);
+  remove(TEST_TOKEN_FILE_PATH);
+
+  free_token_array(&tokens);
+  free(input_p);
+  free_lexer(lexer_p);
+
+  return finish_test("token_file");
+}
@@ -0,0 +1,291 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Tests finding invalid UTF-8 against a scalar reference decoder, for whole inputs, for
+*        streams split in random chunks and for lexers validating their input. Built with -mssse3,
+*        the 16 char path is tested as well.
+* @file test_utf8_validation.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <stdlib.h>
+
+#include "lexer_generator.h"
+#include "simd_scan.h"
+#include "test_utils.h"
+#include "unicode.h"
+
+/*> Defines ***************************************************************************************/
+#define NUM_RANDOM_INPUTS     3000
+#define MAX_TEST_INPUT_SIZE   400
+#define MAX_NUM_TEST_ERRORS   (MAX_TEST_INPUT_SIZE / 2)
+#define MAX_TEST_CHUNK_SIZE   40
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief An invalid UTF-8 sequence.
+ * @param charIdx  The index of its first char.
+ * @param length   The number of chars of its longest prefix that could start a valid sequence.
+ */
+typedef struct Utf8ErrorS
+{
+  size_t charIdx;
+  int length;
+} Utf8ErrorS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+/**
+ * @brief Sequences that are not valid UTF-8: continuation bytes, bytes that never occur,
+ *        overlong encodings, surrogates and code points above 0x10FFFF.
+ */
+static const char* const invalidSequences[] = {"\x80", "\xbf", "\xc0\x80", "\xc1\xbf", "\xf5",
+                                               "\xff", "\xe0\x80\x80", "\xed\xa0\x80",
+                                               "\xf0\x80\x80\x80", "\xf4\x90\x80\x80"};
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Fills an input with random valid code points and, if asked, invalid sequences.
+ * @param[out]  input_p    Room for MAX_TEST_INPUT_SIZE chars.
+ * @param[in]   hasErrors  True if invalid and cut off sequences are added.
+ * @return The number of chars in the input.
+ */
+static size_t generate_input(char* const input_p, const bool hasErrors);
+
+/**
+ * @brief Finds the invalid UTF-8 sequences of an input one char at a time.
+ * @param[in]   input_p      The input.
+ * @param[in]   inputLength  The number of chars in the input.
+ * @param[out]  errors_p     Room for MAX_NUM_TEST_ERRORS invalid sequences.
+ * @return The number of invalid sequences.
+ */
+static int find_utf8_errors_slowly(const char* const input_p,
+                                   const size_t inputLength,
+                                   Utf8ErrorS* const errors_p);
+
+/*> Local Function Definitions ********************************************************************/
+static size_t generate_input(char* const input_p, const bool hasErrors)
+{
+  const size_t inputLength = rand() % MAX_TEST_INPUT_SIZE;
+  size_t charIdx = 0;
+  while (charIdx + MAX_UTF8_LENGTH <= inputLength)
+  {
+    int kind = rand() % 16;
+    if (hasErrors && kind == 0)
+    {
+      const char* sequence_p = invalidSequences[rand() % (sizeof(invalidSequences) /
+                                                          sizeof(invalidSequences[0]))];
+      while (*sequence_p != '\0')
+      {
+        input_p[charIdx++] = *sequence_p++;
+      }
+      continue;
+    }
+
+    const uint32_t maxCodePoints[] = {0x7f, 0x7ff, 0xffff, 0x10ffff};
+    uint32_t codePoint;
+    do
+    {
+      codePoint = (((uint32_t) rand() << 16) ^ (uint32_t) rand()) % (maxCodePoints[kind % 4] + 1);
+    } while (codePoint >= 0xd800 && codePoint <= 0xdfff);
+    int numChars = encode_utf8(codePoint, &(input_p[charIdx]));
+    // A code point cut off before its end.
+    if (hasErrors && kind == 1 && numChars > 1)
+    {
+      numChars = 1 + rand() % (numChars - 1);
+    }
+    charIdx += numChars;
+  }
+  return charIdx;
+}
+
+static int find_utf8_errors_slowly(const char* const input_p,
+                                   const size_t inputLength,
+                                   Utf8ErrorS* const errors_p)
+{
+  const unsigned char* chars_p = (const unsigned char*) input_p;
+  int numErrors = 0;
+  size_t charIdx = 0;
+  while (charIdx < inputLength)
+  {
+    // The number of chars of the sequence and the range of its second char, by its first char.
+    const unsigned char leadChar = chars_p[charIdx];
+    int numChars = 1;
+    unsigned char minSecondChar = 0x80;
+    unsigned char maxSecondChar = 0xbf;
+    if (leadChar >= 0xc2 && leadChar <= 0xdf)
+    {
+      numChars = 2;
+    }
+    else if (leadChar >= 0xe0 && leadChar <= 0xef)
+    {
+      numChars = 3;
+      minSecondChar = (leadChar == 0xe0) ? 0xa0 : 0x80;
+      maxSecondChar = (leadChar == 0xed) ? 0x9f : 0xbf;
+    }
+    else if (leadChar >= 0xf0 && leadChar <= 0xf4)
+    {
+      numChars = 4;
+      minSecondChar = (leadChar == 0xf0) ? 0x90 : 0x80;
+      maxSecondChar = (leadChar == 0xf4) ? 0x8f : 0xbf;
+    }
+    else if (leadChar >= 0x80)
+    {
+      errors_p[numErrors].charIdx = charIdx;
+      errors_p[numErrors].length = 1;
+      numErrors++;
+      charIdx++;
+      continue;
+    }
+
+    int numValidChars = 1;
+    while (numValidChars < numChars && charIdx + numValidChars < inputLength)
+    {
+      const unsigned char character = chars_p[charIdx + numValidChars];
+      if (character < ((numValidChars == 1) ? minSecondChar : 0x80) ||
+          character > ((numValidChars == 1) ? maxSecondChar : 0xbf))
+      {
+        break;
+      }
+      numValidChars++;
+    }
+    if (numValidChars < numChars)
+    {
+      errors_p[numErrors].charIdx = charIdx;
+      errors_p[numErrors].length = numValidChars;
+      numErrors++;
+    }
+    charIdx += numValidChars;
+  }
+  return numErrors;
+}
+
+/*> Global Function Definitions *******************************************************************/
+int main()
+{
+  srand(65);
+
+  const char* regExpStrs[] = {"[a-z]+", "[0-9]+", "\\p{L}+", " "};
+  LexerS* lexer_p = generate_lexer(regExpStrs, 4);
+  LexerOptionsS options = { .validatesUtf8 = true };
+  LexerS* validatingLexer_p = generate_lexer_with_options(regExpStrs, 4, &options);
+
+  char input[MAX_TEST_INPUT_SIZE];
+  Utf8ErrorS errors[MAX_NUM_TEST_ERRORS];
+  int numBadInputs = 0;
+  int numBadStreams = 0;
+  int numBadLexes = 0;
+  for (int i = 0; i < NUM_RANDOM_INPUTS; i++)
+  {
+    const bool hasErrors = (i % 2 == 0);
+    const size_t inputLength = generate_input(input, hasErrors);
+    const int numErrors = find_utf8_errors_slowly(input, inputLength, errors);
+
+    // Every invalid sequence is found, continuing after each one.
+    bool isSame = true;
+    size_t charIdx = 0;
+    int numFoundErrors = 0;
+    while (charIdx < inputLength && isSame)
+    {
+      int invalidLength;
+      charIdx = find_invalid_utf8(input, charIdx, inputLength, true, &invalidLength);
+      if (invalidLength == 0)
+      {
+        isSame = charIdx == inputLength;
+        break;
+      }
+      isSame = numFoundErrors < numErrors &&
+               charIdx == errors[numFoundErrors].charIdx &&
+               invalidLength == errors[numFoundErrors].length;
+      numFoundErrors++;
+      charIdx += invalidLength;
+    }
+    numBadInputs += (isSame && numFoundErrors == numErrors) ? 0 : 1;
+
+    // A stream in random chunks reports the first invalid sequence.
+    Utf8ValidatorS validator;
+    init_utf8_validator(&validator);
+    size_t chunkStartIdx = 0;
+    isSame = true;
+    do
+    {
+      size_t chunkLength = rand() % (MAX_TEST_CHUNK_SIZE + 1);
+      chunkLength = (chunkStartIdx + chunkLength > inputLength) ?
+                    inputLength - chunkStartIdx :
+                    chunkLength;
+      const bool isLastChunk = chunkStartIdx + chunkLength == inputLength;
+      size_t invalidIdx;
+      int invalidLength;
+      bool isValid = validate_utf8_chunk(&validator,
+                                         &(input[chunkStartIdx]),
+                                         chunkLength,
+                                         isLastChunk,
+                                         &invalidIdx,
+                                         &invalidLength);
+      if (!isValid)
+      {
+        // Only the chars of the invalid sequence in this chunk are counted.
+        const size_t errorEndIdx = errors[0].charIdx + errors[0].length;
+        const size_t reportedIdx = (errors[0].charIdx > chunkStartIdx) ?
+                                   errors[0].charIdx :
+                                   chunkStartIdx;
+        isSame = numErrors > 0 &&
+                 errors[0].charIdx < chunkStartIdx + chunkLength &&
+                 errorEndIdx >= chunkStartIdx &&
+                 chunkStartIdx + invalidIdx == reportedIdx &&
+                 reportedIdx + invalidLength == errorEndIdx;
+        break;
+      }
+      isSame = !isLastChunk || numErrors == 0;
+      chunkStartIdx += chunkLength;
+    } while (chunkStartIdx < inputLength && isSame);
+    numBadStreams += isSame ? 0 : 1;
+
+    // A validating lexer reads each invalid sequence as an error token of its own, and valid
+    // input like a lexer that does not validate.
+    TokenArrayS tokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+    start_reading_buffer(validatingLexer_p, input, inputLength);
+    read_all_tokens(validatingLexer_p, &tokens);
+    isSame = true;
+    int errorIdx = 0;
+    for (int j = 0; j < tokens.numTokens; j++)
+    {
+      const TokenS* token_p = &(tokens.tokens_p[j]);
+      if (errorIdx < numErrors && token_p->startIdx == errors[errorIdx].charIdx)
+      {
+        isSame = isSame &&
+                 token_p->type == TOKEN_TYPE_ERROR &&
+                 token_p->length == (size_t) errors[errorIdx].length;
+        errorIdx++;
+      }
+    }
+    isSame = isSame && errorIdx == numErrors;
+    if (numErrors == 0)
+    {
+      TokenArrayS expectedTokens = { .tokens_p = NULL, .numTokens = 0, .maxNumTokens = 0 };
+      start_reading_buffer(lexer_p, input, inputLength);
+      read_all_tokens(lexer_p, &expectedTokens);
+      isSame = isSame && tokens.numTokens == expectedTokens.numTokens;
+      for (int j = 0; j < tokens.numTokens && isSame; j++)
+      {
+        isSame = tokens.tokens_p[j].type == expectedTokens.tokens_p[j].type &&
+                 tokens.tokens_p[j].length == expectedTokens.tokens_p[j].length;
+      }
+      free_token_array(&expectedTokens);
+    }
+    numBadLexes += isSame ? 0 : 1;
+    free_token_array(&tokens);
+  }
+  CHECK(numBadInputs == 0);
+  CHECK(numBadStreams == 0);
+  CHECK(numBadLexes == 0);
+
+  free_lexer(lexer_p);
+  free_lexer(validatingLexer_p);
+
+  return finish_test("utf8_validation");
+}
@@ -0,0 +1,66 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Checks for the behaviour tests. Each test is a program of its own, built from the test
+ *        and every source file but main.c, and run from the top directory:
+ *          gcc -I. -pthread -o test tests/test_<name>.c $(ls *.c | grep -v main.c) -lm && ./test
+ *        A test prints the checks that fail and exits with 1 if there are any.
+ * @file test_utils.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stdio.h>
+
+/*> Defines ***************************************************************************************/
+/**
+ * @brief Checks a condition, printing it with its place if it does not hold.
+ */
+#define CHECK(condition) check_condition((condition), #condition, __FILE__, __LINE__)
+
+/*> Type Declarations *****************************************************************************/
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+/**
+ * @brief The number of checks that failed so far.
+ */
+static int numFailedChecks = 0;
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Counts and prints a check that fails.
+ * @param[in]  holds        True if the checked condition holds.
+ * @param[in]  condition_p  The condition as a string.
+ * @param[in]  file_p       The file of the check.
+ * @param[in]  line         The line of the check.
+ */
+static inline void check_condition(const bool holds,
+                                   const char* const condition_p,
+                                   const char* const file_p,
+                                   const int line)
+{
+  if (!holds)
+  {
+    fprintf(stderr, "%s:%d: check failed: %s\n", file_p, line, condition_p);
+    numFailedChecks++;
+  }
+}
+
+/**
+ * @brief Prints the result of a test.
+ * @param[in]  name_p  The name of the test.
+ * @return The exit code of the test, 0 if every check held.
+ */
+static inline int finish_test(const char* const name_p)
+{
+  fprintf(stderr, "%s: %s\n", name_p, (numFailedChecks == 0) ? "passed" : "FAILED");
+  return (numFailedChecks == 0) ? 0 : 1;
+}
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
@@ -0,0 +1,435 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Stores read tokens in a compact file that can be memory mapped and read back without
+*        reading the input again.
+* @file token_file.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lexer_generator.h"
+#include "token_file.h"
+
+/*> Defines ***************************************************************************************/
+#define TOKEN_FILE_MAGIC        0x49544c58 // "XLTI"
+#define TOKEN_FILE_VERSION      1
+#define TOKEN_FILE_HEADER_SIZE  32
+#define TOKEN_FILE_ENTRY_SIZE   32
+#define MAX_VARINT_SIZE         10
+// The encoded types, distances and lengths of a block are built in one scratch buffer.
+#define BLOCK_SCRATCH_SIZE      ((2 + 2 * MAX_VARINT_SIZE) * TOKEN_FILE_BLOCK_SIZE)
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief An entry of the block directory.
+ * @param fileOffset       The offset of the block in the file.
+ * @param firstStartIdx    The start index of the first token of the block.
+ * @param numTokens        The number of tokens in the block.
+ * @param distancesLength  The number of bytes in the distance column.
+ * @param lengthsLength    The number of bytes in the length column.
+ */
+typedef struct BlockEntryS
+{
+  uint64_t fileOffset;
+  uint64_t firstStartIdx;
+  uint32_t numTokens;
+  uint32_t distancesLength;
+  uint32_t lengthsLength;
+} BlockEntryS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Stores an unsigned integer as little endian.
+ * @param[out]  bytes_p   The bytes to store the value in.
+ * @param[in]   value     The value.
+ * @param[in]   numBytes  The number of bytes to store.
+ */
+static void store_uint(unsigned char* const bytes_p, const uint64_t value, const int numBytes);
+
+/**
+ * @brief Loads a little endian unsigned integer.
+ * @param[in]  bytes_p   The bytes to load the value from.
+ * @param[in]  numBytes  The number of bytes to load.
+ * @return The value.
+ */
+static uint64_t load_uint(const unsigned char* const bytes_p, const int numBytes);
+
+/**
+ * @brief Stores an unsigned integer as a varint, 7 bits per byte with the high bit set on all but
+ *        the last byte.
+ * @param[out]  bytes_p  The bytes to store the value in, room for MAX_VARINT_SIZE bytes.
+ * @param[in]   value    The value.
+ * @return The number of bytes stored.
+ */
+static int store_varint(unsigned char* const bytes_p, uint64_t value);
+
+/**
+ * @brief Loads a varint and moves past it. The varint must end before the end of its column, take
+ *        at most MAX_VARINT_SIZE bytes and fit in 64 bits.
+ * @param[in/out]  bytes_pp  The bytes to load the value from.
+ * @param[in]      end_p     The end of the column.
+ * @param[out]     value_p   The value.
+ * @return true if the varint was loaded, false if it is not valid.
+ */
+static bool load_varint(const unsigned char** const bytes_pp,
+                        const unsigned char* const end_p,
+                        uint64_t* const value_p);
+
+/**
+ * @brief Writes a block of tokens to a file.
+ * @param[in]   file_p    The file.
+ * @param[in]   tokens_p  The tokens of the block.
+ * @param[in]   numTokens The number of tokens in the block.
+ * @param[out]  scratch_p BLOCK_SCRATCH_SIZE bytes to encode the block in.
+ * @param[out]  entry_p   The directory entry of the block; the file offset must already be set.
+ * @return true if the block was written, false otherwise.
+ */
+static bool write_block(FILE* const file_p,
+                        const TokenS* const tokens_p,
+                        const int numTokens,
+                        unsigned char* const scratch_p,
+                        BlockEntryS* const entry_p);
+
+/**
+ * @brief Reads an entry of the block directory.
+ * @param[in]  file_p    The token file.
+ * @param[in]  blockIdx  The index of the block.
+ * @return The directory entry.
+ */
+static BlockEntryS read_block_entry(const TokenFileS* const file_p, const uint64_t blockIdx);
+
+/*> Local Function Definitions ********************************************************************/
+static void store_uint(unsigned char* const bytes_p, const uint64_t value, const int numBytes)
+{
+  for (int i = 0; i < numBytes; i++)
+  {
+    bytes_p[i] = (unsigned char) (value >> (8 * i));
+  }
+}
+
+static uint64_t load_uint(const unsigned char* const bytes_p, const int numBytes)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < numBytes; i++)
+  {
+    value |= (uint64_t) bytes_p[i] << (8 * i);
+  }
+  return value;
+}
+
+static int store_varint(unsigned char* const bytes_p, uint64_t value)
+{
+  int numBytes = 0;
+  while (value >= 0x80)
+  {
+    bytes_p[numBytes] = (unsigned char) (value | 0x80);
+    value >>= 7;
+    numBytes++;
+  }
+  bytes_p[numBytes] = (unsigned char) value;
+  return numBytes + 1;
+}
+
+static bool load_varint(const unsigned char** const bytes_pp,
+                        const unsigned char* const end_p,
+                        uint64_t* const value_p)
+{
+  const unsigned char* bytes_p = *bytes_pp;
+  uint64_t value = 0;
+  for (int i = 0; i < MAX_VARINT_SIZE && bytes_p < end_p; i++)
+  {
+    // The last byte only has room for the highest bit of a 64 bit value.
+    if (i == MAX_VARINT_SIZE - 1 && *bytes_p > 1)
+    {
+      return false;
+    }
+
+    value |= (uint64_t) (*bytes_p & 0x7f) << (7 * i);
+    if ((*bytes_p & 0x80) == 0)
+    {
+      *bytes_pp = bytes_p + 1;
+      *value_p = value;
+      return true;
+    }
+    bytes_p++;
+  }
+  return false;
+}
+
+static bool write_block(FILE* const file_p,
+                        const TokenS* const tokens_p,
+                        const int numTokens,
+                        unsigned char* const scratch_p,
+                        BlockEntryS* const entry_p)
+{
+  unsigned char* types_p = scratch_p;
+  unsigned char* distances_p = &(scratch_p[2 * TOKEN_FILE_BLOCK_SIZE]);
+  unsigned char* lengths_p = &(distances_p[MAX_VARINT_SIZE * TOKEN_FILE_BLOCK_SIZE]);
+  assert(numTokens <= TOKEN_FILE_BLOCK_SIZE);
+
+  entry_p->firstStartIdx = tokens_p[0].startIdx;
+  entry_p->numTokens = numTokens;
+  entry_p->distancesLength = 0;
+  entry_p->lengthsLength = 0;
+
+  size_t prevEndIdx = tokens_p[0].startIdx;
+  for (int i = 0; i < numTokens; i++)
+  {
+    assert(tokens_p[i].startIdx >= prevEndIdx);
+    store_uint(&(types_p[2 * i]), (uint16_t) tokens_p[i].type, 2);
+    entry_p->distancesLength += store_varint(&(distances_p[entry_p->distancesLength]),
+                                             tokens_p[i].startIdx - prevEndIdx);
+    entry_p->lengthsLength += store_varint(&(lengths_p[entry_p->lengthsLength]),
+                                           tokens_p[i].length);
+    prevEndIdx = tokens_p[i].startIdx + tokens_p[i].length;
+  }
+
+  return fwrite(types_p, 1, 2 * numTokens, file_p) == (size_t) (2 * numTokens) &&
+         fwrite(distances_p, 1, entry_p->distancesLength, file_p) == entry_p->distancesLength &&
+         fwrite(lengths_p, 1, entry_p->lengthsLength, file_p) == entry_p->lengthsLength;
+}
+
+static BlockEntryS read_block_entry(const TokenFileS* const file_p, const uint64_t blockIdx)
+{
+  const unsigned char* entryBytes_p = &(file_p->directory_p[blockIdx * TOKEN_FILE_ENTRY_SIZE]);
+  BlockEntryS entry =
+  {
+    .fileOffset = load_uint(&(entryBytes_p[0]), 8),
+    .firstStartIdx = load_uint(&(entryBytes_p[8]), 8),
+    .numTokens = load_uint(&(entryBytes_p[16]), 4),
+    .distancesLength = load_uint(&(entryBytes_p[20]), 4),
+    .lengthsLength = load_uint(&(entryBytes_p[24]), 4)
+  };
+  return entry;
+}
+
+/*> Global Function Definitions *******************************************************************/
+bool write_token_file(const TokenArrayS* const tokenArray_p, const char* const path_p)
+{
+  for (int i = 0; i < tokenArray_p->numTokens; i++)
+  {
+    if (tokenArray_p->tokens_p[i].type < INT16_MIN || tokenArray_p->tokens_p[i].type > INT16_MAX)
+    {
+      return false;
+    }
+  }
+
+  FILE* file_p = fopen(path_p, "wb");
+  if (file_p == NULL)
+  {
+    return false;
+  }
+
+  const uint64_t numTokens = tokenArray_p->numTokens;
+  const uint64_t numBlocks = (numTokens + TOKEN_FILE_BLOCK_SIZE - 1) / TOKEN_FILE_BLOCK_SIZE;
+  unsigned char* directory_p = calloc(numBlocks + 1, TOKEN_FILE_ENTRY_SIZE);
+  assert(directory_p != NULL);
+  unsigned char* scratch_p = malloc(BLOCK_SCRATCH_SIZE);
+  assert(scratch_p != NULL);
+  unsigned char header[TOKEN_FILE_HEADER_SIZE] = {0};
+  bool isWritten = fwrite(header, 1, TOKEN_FILE_HEADER_SIZE, file_p) == TOKEN_FILE_HEADER_SIZE;
+  uint64_t fileOffset = TOKEN_FILE_HEADER_SIZE;
+
+  for (uint64_t blockIdx = 0; isWritten && blockIdx < numBlocks; blockIdx++)
+  {
+    uint64_t firstTokenIdx = blockIdx * TOKEN_FILE_BLOCK_SIZE;
+    uint64_t numTokensInBlock = numTokens - firstTokenIdx;
+    if (numTokensInBlock > TOKEN_FILE_BLOCK_SIZE)
+    {
+      numTokensInBlock = TOKEN_FILE_BLOCK_SIZE;
+    }
+
+    BlockEntryS entry = { .fileOffset = fileOffset };
+    isWritten = write_block(file_p,
+                            &(tokenArray_p->tokens_p[firstTokenIdx]),
+                            numTokensInBlock,
+                            scratch_p,
+                            &entry);
+    fileOffset += 2 * entry.numTokens + entry.distancesLength + entry.lengthsLength;
+
+    unsigned char* entryBytes_p = &(directory_p[blockIdx * TOKEN_FILE_ENTRY_SIZE]);
+    store_uint(&(entryBytes_p[0]), entry.fileOffset, 8);
+    store_uint(&(entryBytes_p[8]), entry.firstStartIdx, 8);
+    store_uint(&(entryBytes_p[16]), entry.numTokens, 4);
+    store_uint(&(entryBytes_p[20]), entry.distancesLength, 4);
+    store_uint(&(entryBytes_p[24]), entry.lengthsLength, 4);
+  }
+
+  store_uint(&(header[0]), TOKEN_FILE_MAGIC, 4);
+  store_uint(&(header[4]), TOKEN_FILE_VERSION, 4);
+  store_uint(&(header[8]), numTokens, 8);
+  store_uint(&(header[16]), numBlocks, 8);
+  store_uint(&(header[24]), fileOffset, 8);
+  isWritten = isWritten &&
+              fwrite(directory_p, TOKEN_FILE_ENTRY_SIZE, numBlocks, file_p) == numBlocks &&
+              fseek(file_p, 0, SEEK_SET) == 0 &&
+              fwrite(header, 1, TOKEN_FILE_HEADER_SIZE, file_p) == TOKEN_FILE_HEADER_SIZE;
+
+  free(scratch_p);
+  free(directory_p);
+  return (fclose(file_p) == 0) && isWritten;
+}
+
+bool open_token_file(TokenFileS* const file_p, const char* const path_p)
+{
+  memset(file_p, 0, sizeof(*file_p));
+
+  int fd = open(path_p, O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size < TOKEN_FILE_HEADER_SIZE)
+  {
+    close(fd);
+    return false;
+  }
+
+  void* data_p = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data_p == MAP_FAILED)
+  {
+    return false;
+  }
+
+  file_p->data_p = data_p;
+  file_p->size = fileStat.st_size;
+  file_p->numTokens = load_uint(&(file_p->data_p[8]), 8);
+  file_p->numBlocks = load_uint(&(file_p->data_p[16]), 8);
+  uint64_t directoryOffset = load_uint(&(file_p->data_p[24]), 8);
+
+  bool isValid = load_uint(&(file_p->data_p[0]), 4) == TOKEN_FILE_MAGIC &&
+                 load_uint(&(file_p->data_p[4]), 4) == TOKEN_FILE_VERSION &&
+                 directoryOffset <= file_p->size &&
+                 file_p->numBlocks <= (file_p->size - directoryOffset) / TOKEN_FILE_ENTRY_SIZE;
+  file_p->directory_p = &(file_p->data_p[directoryOffset]);
+
+  // find_token_file_block() searches the blocks by the start index of their first token.
+  uint64_t numTokensInBlocks = 0;
+  uint64_t prevFirstStartIdx = 0;
+  for (uint64_t i = 0; isValid && i < file_p->numBlocks; i++)
+  {
+    BlockEntryS entry = read_block_entry(file_p, i);
+    uint64_t blockLength = 2 * (uint64_t) entry.numTokens +
+                           entry.distancesLength +
+                           entry.lengthsLength;
+    isValid = entry.numTokens > 0 &&
+              entry.numTokens <= TOKEN_FILE_BLOCK_SIZE &&
+              entry.fileOffset >= TOKEN_FILE_HEADER_SIZE &&
+              entry.fileOffset <= directoryOffset &&
+              blockLength <= directoryOffset - entry.fileOffset &&
+              entry.firstStartIdx >= prevFirstStartIdx;
+    numTokensInBlocks += entry.numTokens;
+    prevFirstStartIdx = entry.firstStartIdx;
+  }
+  isValid = isValid && numTokensInBlocks == file_p->numTokens;
+
+  if (!isValid)
+  {
+    close_token_file(file_p);
+  }
+  return isValid;
+}
+
+void close_token_file(TokenFileS* const file_p)
+{
+  if (file_p->data_p != NULL)
+  {
+    munmap((void*) file_p->data_p, file_p->size);
+  }
+  memset(file_p, 0, sizeof(*file_p));
+}
+
+uint64_t find_token_file_block(const TokenFileS* const file_p, const size_t charIdx)
+{
+  // Find the last block starting at or before charIdx.
+  uint64_t low = 0;
+  uint64_t high = file_p->numBlocks;
+  while (low < high)
+  {
+    uint64_t middle = low + (high - low) / 2;
+    if (read_block_entry(file_p, middle).firstStartIdx <= charIdx)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low > 0 ? low - 1 : 0;
+}
+
+void seek_token_file_block(TokenFileIteratorS* const iterator_p,
+                           const TokenFileS* const file_p,
+                           const uint64_t blockIdx)
+{
+  iterator_p->file_p = file_p;
+  iterator_p->blockIdx = blockIdx;
+  iterator_p->tokenIdxInBlock = 0;
+
+  if (blockIdx >= file_p->numBlocks)
+  {
+    iterator_p->blockIdx = file_p->numBlocks;
+    iterator_p->numTokensInBlock = 0;
+    return;
+  }
+
+  BlockEntryS entry = read_block_entry(file_p, blockIdx);
+  iterator_p->numTokensInBlock = entry.numTokens;
+  iterator_p->type_p = &(file_p->data_p[entry.fileOffset]);
+  iterator_p->distance_p = iterator_p->type_p + 2 * entry.numTokens;
+  iterator_p->length_p = iterator_p->distance_p + entry.distancesLength;
+  iterator_p->distanceEnd_p = iterator_p->length_p;
+  iterator_p->lengthEnd_p = iterator_p->length_p + entry.lengthsLength;
+  iterator_p->prevEndIdx = entry.firstStartIdx;
+}
+
+bool next_token_file_token(TokenFileIteratorS* const iterator_p, TokenS* const token_p)
+{
+  if (iterator_p->tokenIdxInBlock == iterator_p->numTokensInBlock)
+  {
+    if (iterator_p->blockIdx + 1 >= iterator_p->file_p->numBlocks)
+    {
+      return false;
+    }
+    seek_token_file_block(iterator_p, iterator_p->file_p, iterator_p->blockIdx + 1);
+  }
+
+  uint64_t distance;
+  uint64_t length;
+  if (!load_varint(&(iterator_p->distance_p), iterator_p->distanceEnd_p, &distance) ||
+      !load_varint(&(iterator_p->length_p), iterator_p->lengthEnd_p, &length))
+  {
+    return false;
+  }
+
+  token_p->type = (int16_t) load_uint(iterator_p->type_p, 2);
+  token_p->startIdx = iterator_p->prevEndIdx + distance;
+  token_p->length = length;
+  token_p->startState = 0;
+  token_p->numCharsExamined = token_p->length + 1;
+
+  iterator_p->type_p += 2;
+  iterator_p->prevEndIdx = token_p->startIdx + token_p->length;
+  iterator_p->tokenIdxInBlock++;
+  return true;
+}
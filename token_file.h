@@ -0,0 +1,134 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Stores read tokens in a compact file that can be memory mapped and read back without
+ *        reading the input again.
+ * @file token_file.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef TOKEN_FILE_H
+#define TOKEN_FILE_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lexer_generator.h"
+
+/*> Defines ***************************************************************************************/
+#define TOKEN_FILE_BLOCK_SIZE 1024
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A memory mapped token file.
+ *
+ * The file starts with a header, followed by blocks of up to TOKEN_FILE_BLOCK_SIZE tokens and a
+ * block directory. Each block stores its tokens column by column: the types as 16 bit integers,
+ * then the distance from the end of the previous token to the start of each token as varints, then
+ * the token lengths as varints. The directory holds the file offset, the start index of the first
+ * token and the column sizes of every block, so any block can be read on its own.
+ *
+ * @param data_p       The mapped file.
+ * @param size         The size of the mapped file in bytes.
+ * @param numTokens    The number of tokens in the file.
+ * @param numBlocks    The number of blocks in the file.
+ * @param directory_p  The block directory.
+ */
+typedef struct TokenFileS
+{
+  const unsigned char* data_p;
+  size_t size;
+  uint64_t numTokens;
+  uint64_t numBlocks;
+  const unsigned char* directory_p;
+} TokenFileS;
+
+/**
+ * @brief Iterates over the tokens of a token file.
+ * @param file_p            The token file.
+ * @param blockIdx          The index of the current block.
+ * @param numTokensInBlock  The number of tokens in the current block.
+ * @param tokenIdxInBlock   The index of the next token in the current block.
+ * @param type_p            The type of the next token.
+ * @param distance_p        The distance from the end of the previous token to the next token.
+ * @param length_p          The length of the next token.
+ * @param distanceEnd_p     The end of the distance column of the current block.
+ * @param lengthEnd_p       The end of the length column of the current block.
+ * @param prevEndIdx        The index after the last char of the previous token.
+ */
+typedef struct TokenFileIteratorS
+{
+  const TokenFileS* file_p;
+  uint64_t blockIdx;
+  uint32_t numTokensInBlock;
+  uint32_t tokenIdxInBlock;
+  const unsigned char* type_p;
+  const unsigned char* distance_p;
+  const unsigned char* length_p;
+  const unsigned char* distanceEnd_p;
+  const unsigned char* lengthEnd_p;
+  size_t prevEndIdx;
+} TokenFileIteratorS;
+
+/*> Constant Declarations *************************************************************************/
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Writes tokens to a token file. Only the type, start index and length of the tokens are
+ *        stored.
+ * @param[in]  tokenArray_p  The tokens, sorted by start index.
+ * @param[in]  path_p        The path of the file.
+ * @return true if the file was written, false if it could not be or a token type does not fit
+ *         in 16 bits.
+ */
+bool write_token_file(const TokenArrayS* const tokenArray_p, const char* const path_p);
+
+/**
+ * @brief Memory maps a token file. The blocks must lie between the header and the directory and
+ *        start at non-decreasing indicies.
+ * @param[out]  file_p  The token file.
+ * @param[in]   path_p  The path of the file.
+ * @return true if the file was opened, false if it could not be mapped or is not a token file.
+ */
+bool open_token_file(TokenFileS* const file_p, const char* const path_p);
+
+/**
+ * @brief Unmaps a token file.
+ * @param[in/out]  file_p  The token file.
+ */
+void close_token_file(TokenFileS* const file_p);
+
+/**
+ * @brief Finds the block containing the token that covers, or is the first to start after, a char
+ *        index.
+ * @param[in]  file_p   The token file.
+ * @param[in]  charIdx  The index of the char.
+ * @return The index of the block.
+ */
+uint64_t find_token_file_block(const TokenFileS* const file_p, const size_t charIdx);
+
+/**
+ * @brief Places an iterator at the first token of a block.
+ * @param[out]  iterator_p  The iterator.
+ * @param[in]   file_p      The token file.
+ * @param[in]   blockIdx    The index of the block, numBlocks places the iterator at the end.
+ */
+void seek_token_file_block(TokenFileIteratorS* const iterator_p,
+                           const TokenFileS* const file_p,
+                           const uint64_t blockIdx);
+
+/**
+ * @brief Reads the next token of a token file. The start state of the token is set to 0 and the
+ *        number of examined chars to the token length plus one, since they are not stored.
+ * @param[in/out]  iterator_p  The iterator.
+ * @param[out]     token_p     The token.
+ * @return true if a token was read, false at the end of the file or at a distance or length that
+ *         is not a valid varint within its column.
+ */
+bool next_token_file_token(TokenFileIteratorS* const iterator_p, TokenS* const token_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif
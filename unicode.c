@@ -0,0 +1,544 @@
+/*> Description ***********************************************************************************/
+/**
+* @brief Deals with sets of Unicode code points and their UTF-8 encodings, so that RegExps over
+*        code points can be matched by byte-level automata.
+* @file unicode.c
+*/
+
+/*> Includes **************************************************************************************/
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unicode.h"
+
+/*> Defines ***************************************************************************************/
+#define INITIAL_MAX_NUM_CODE_POINT_RANGES 16
+#define INITIAL_MAX_NUM_UTF8_SEQUENCES    64
+#define INITIAL_MAX_NUM_UTF8_STATES       16
+#define MAX_ONE_BYTE_CODE_POINT           0x7F
+#define MAX_TWO_BYTE_CODE_POINT           0x7FF
+#define MAX_THREE_BYTE_CODE_POINT         0xFFFF
+#define CONTINUATION_BITS                 6
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief The UTF-8 encodings of a range of code points that differ in one byte range per position.
+ * @param firstBytes  The first byte of the byte range at each position.
+ * @param lastBytes   The last byte of the byte range at each position.
+ * @param numBytes    The number of bytes of the encodings.
+ */
+typedef struct Utf8SequenceS
+{
+  uint8_t firstBytes[MAX_UTF8_LENGTH];
+  uint8_t lastBytes[MAX_UTF8_LENGTH];
+  int numBytes;
+} Utf8SequenceS;
+
+/**
+ * @brief A growable array of UTF-8 sequences.
+ * @param sequences_p      The sequences.
+ * @param numSequences     The number of sequences.
+ * @param maxNumSequences  The number of sequences there is room for.
+ */
+typedef struct Utf8SequenceArrayS
+{
+  Utf8SequenceS* sequences_p;
+  int numSequences;
+  int maxNumSequences;
+} Utf8SequenceArrayS;
+
+/**
+ * @brief State kept while building a UTF-8 automaton.
+ * @param automaton_p  The automaton being built.
+ * @param sequences_p  The sequences the automaton matches.
+ * @param hashes_p     The hash of the transitions of each state, to find equal states quickly.
+ */
+typedef struct Utf8BuilderS
+{
+  Utf8AutomatonS* automaton_p;
+  const Utf8SequenceArrayS* sequences_p;
+  uint32_t* hashes_p;
+} Utf8BuilderS;
+
+/*> Global Constant Definitions *******************************************************************/
+
+/*> Global Variable Definitions *******************************************************************/
+
+/*> Local Constant Definitions ********************************************************************/
+
+/*> Local Variable Definitions ********************************************************************/
+
+/*> Local Function Declarations *******************************************************************/
+/**
+ * @brief Compares two code point ranges by their first code point, for qsort().
+ * @param[in]  range1_p  The first range.
+ * @param[in]  range2_p  The second range.
+ * @return Negative, zero or positive if the first range starts before, with or after the second.
+ */
+static int compare_code_point_ranges(const void* range1_p, const void* range2_p);
+
+/**
+ * @brief Splits a range of code points into UTF-8 sequences, leaving out surrogates.
+ * @param[in]      first        The first code point of the range.
+ * @param[in]      last         The last code point of the range.
+ * @param[in/out]  sequences_p  The array to append the sequences to.
+ */
+static void split_utf8_range(const uint32_t first,
+                             const uint32_t last,
+                             Utf8SequenceArrayS* const sequences_p);
+
+/**
+ * @brief Builds the state of a UTF-8 automaton that matches the rest of some sequences, or reuses
+ *        an equal state.
+ * @param[in/out]  builder_p     The builder.
+ * @param[in]      indicies_p    The indicies of the sequences.
+ * @param[in]      numIndicies   The number of sequences.
+ * @param[in]      depth         The number of bytes of the sequences already matched.
+ * @return The state, or UTF8_ACCEPT if the sequences are complete.
+ */
+static int build_utf8_state(Utf8BuilderS* const builder_p,
+                            const int* const indicies_p,
+                            const int numIndicies,
+                            const int depth);
+
+/**
+ * @brief Adds a state to a UTF-8 automaton unless it already has one with equal transitions.
+ * @param[in/out]  builder_p    The builder.
+ * @param[in]      transitions  The transitions of the state.
+ * @return The state.
+ */
+static int add_utf8_state(Utf8BuilderS* const builder_p, const int transitions[NUM_BYTE_VALUES]);
+
+/*> Local Function Definitions ********************************************************************/
+static int compare_code_point_ranges(const void* range1_p, const void* range2_p)
+{
+  uint32_t first1 = ((const CodePointRangeS*) range1_p)->first;
+  uint32_t first2 = ((const CodePointRangeS*) range2_p)->first;
+  return (first1 > first2) - (first1 < first2);
+}
+
+static void split_utf8_range(const uint32_t first,
+                             const uint32_t last,
+                             Utf8SequenceArrayS* const sequences_p)
+{
+  if (first > last)
+  {
+    return;
+  }
+
+  if (first <= MAX_SURROGATE && last >= MIN_SURROGATE)
+  {
+    if (first < MIN_SURROGATE)
+    {
+      split_utf8_range(first, MIN_SURROGATE - 1, sequences_p);
+    }
+    split_utf8_range(MAX_SURROGATE + 1, last, sequences_p);
+    return;
+  }
+
+  // Encodings of different lengths cannot share a sequence.
+  const uint32_t maxCodePoints[] = {MAX_ONE_BYTE_CODE_POINT,
+                                    MAX_TWO_BYTE_CODE_POINT,
+                                    MAX_THREE_BYTE_CODE_POINT};
+  for (int i = 0; i < 3; i++)
+  {
+    if (first <= maxCodePoints[i] && last > maxCodePoints[i])
+    {
+      split_utf8_range(first, maxCodePoints[i], sequences_p);
+      split_utf8_range(maxCodePoints[i] + 1, last, sequences_p);
+      return;
+    }
+  }
+
+  // Within one length, split until the trailing bytes are either equal or span all values.
+  char firstChars[MAX_UTF8_LENGTH];
+  char lastChars[MAX_UTF8_LENGTH];
+  int numBytes = encode_utf8(first, firstChars);
+  encode_utf8(last, lastChars);
+  for (int i = 1; i < numBytes; i++)
+  {
+    uint32_t mask = ((uint32_t) 1 << (CONTINUATION_BITS * i)) - 1;
+    if ((first & ~mask) != (last & ~mask))
+    {
+      if ((first & mask) != 0)
+      {
+        split_utf8_range(first, first | mask, sequences_p);
+        split_utf8_range((first | mask) + 1, last, sequences_p);
+        return;
+      }
+      if ((last & mask) != mask)
+      {
+        split_utf8_range(first, (last & ~mask) - 1, sequences_p);
+        split_utf8_range(last & ~mask, last, sequences_p);
+        return;
+      }
+    }
+  }
+
+  if (sequences_p->numSequences == sequences_p->maxNumSequences)
+  {
+    sequences_p->maxNumSequences = sequences_p->maxNumSequences > 0 ?
+                                   2 * sequences_p->maxNumSequences :
+                                   INITIAL_MAX_NUM_UTF8_SEQUENCES;
+    sequences_p->sequences_p = realloc(sequences_p->sequences_p,
+                                       sizeof(Utf8SequenceS) * sequences_p->maxNumSequences);
+    assert(sequences_p->sequences_p != NULL);
+  }
+  Utf8SequenceS* sequence_p = &(sequences_p->sequences_p[sequences_p->numSequences]);
+  sequences_p->numSequences++;
+  sequence_p->numBytes = numBytes;
+  for (int i = 0; i < numBytes; i++)
+  {
+    sequence_p->firstBytes[i] = firstChars[i];
+    sequence_p->lastBytes[i] = lastChars[i];
+  }
+}
+
+static int build_utf8_state(Utf8BuilderS* const builder_p,
+                            const int* const indicies_p,
+                            const int numIndicies,
+                            const int depth)
+{
+  const Utf8SequenceS* sequences_p = builder_p->sequences_p->sequences_p;
+  // No encoding is a prefix of another, forwards or backwards, so the sequences end together.
+  if (numIndicies > 0 && sequences_p[indicies_p[0]].numBytes == depth)
+  {
+    return UTF8_ACCEPT;
+  }
+
+  int transitions[NUM_BYTE_VALUES];
+  for (int i = 0; i < NUM_BYTE_VALUES; i++)
+  {
+    transitions[i] = NO_UTF8_STATE;
+  }
+
+  // The bytes are split into runs that are in the byte range of the same sequences, and every
+  // run gets the state matching the rest of those sequences.
+  int* runIndicies_p = malloc(sizeof(int) * (numIndicies > 0 ? numIndicies : 1));
+  assert(runIndicies_p != NULL);
+  int byte = 0;
+  while (byte < NUM_BYTE_VALUES)
+  {
+    int numRunIndicies = 0;
+    int lastByte = NUM_BYTE_VALUES - 1;
+    for (int i = 0; i < numIndicies; i++)
+    {
+      const Utf8SequenceS* sequence_p = &(sequences_p[indicies_p[i]]);
+      int firstByte = sequence_p->firstBytes[depth];
+      if (firstByte <= byte && byte <= sequence_p->lastBytes[depth])
+      {
+        runIndicies_p[numRunIndicies] = indicies_p[i];
+        numRunIndicies++;
+        if (sequence_p->lastBytes[depth] < lastByte)
+        {
+          lastByte = sequence_p->lastBytes[depth];
+        }
+      }
+      else if (firstByte > byte && firstByte - 1 < lastByte)
+      {
+        lastByte = firstByte - 1;
+      }
+    }
+
+    if (numRunIndicies > 0)
+    {
+      int nextState = build_utf8_state(builder_p, runIndicies_p, numRunIndicies, depth + 1);
+      for (int i = byte; i <= lastByte; i++)
+      {
+        transitions[i] = nextState;
+      }
+    }
+    byte = lastByte + 1;
+  }
+  free(runIndicies_p);
+
+  return add_utf8_state(builder_p, transitions);
+}
+
+static int add_utf8_state(Utf8BuilderS* const builder_p, const int transitions[NUM_BYTE_VALUES])
+{
+  Utf8AutomatonS* automaton_p = builder_p->automaton_p;
+
+  // FNV-1a over the transitions.
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < NUM_BYTE_VALUES; i++)
+  {
+    hash = (hash ^ (uint32_t) transitions[i]) * 16777619u;
+  }
+
+  for (int i = 0; i < automaton_p->numStates; i++)
+  {
+    if (builder_p->hashes_p[i] == hash &&
+        memcmp(automaton_p->transitions_p[i], transitions, sizeof(int) * NUM_BYTE_VALUES) == 0)
+    {
+      return i;
+    }
+  }
+
+  if (automaton_p->numStates == automaton_p->maxNumStates)
+  {
+    automaton_p->maxNumStates = automaton_p->maxNumStates > 0 ?
+                                2 * automaton_p->maxNumStates :
+                                INITIAL_MAX_NUM_UTF8_STATES;
+    automaton_p->transitions_p = realloc(automaton_p->transitions_p,
+                                         sizeof(*(automaton_p->transitions_p)) *
+                                         automaton_p->maxNumStates);
+    builder_p->hashes_p = realloc(builder_p->hashes_p,
+                                  sizeof(uint32_t) * automaton_p->maxNumStates);
+    assert(automaton_p->transitions_p != NULL && builder_p->hashes_p != NULL);
+  }
+  int newState = automaton_p->numStates;
+  automaton_p->numStates++;
+  memcpy(automaton_p->transitions_p[newState], transitions, sizeof(int) * NUM_BYTE_VALUES);
+  builder_p->hashes_p[newState] = hash;
+  return newState;
+}
+
+/*> Global Function Definitions *******************************************************************/
+void add_code_point_range(CodePointSetS* const set_p, const uint32_t first, const uint32_t last)
+{
+  assert(first <= last && last <= MAX_CODE_POINT);
+  if (set_p->numRanges == set_p->maxNumRanges)
+  {
+    set_p->maxNumRanges = set_p->maxNumRanges > 0 ?
+                          2 * set_p->maxNumRanges :
+                          INITIAL_MAX_NUM_CODE_POINT_RANGES;
+    set_p->ranges_p = realloc(set_p->ranges_p, sizeof(CodePointRangeS) * set_p->maxNumRanges);
+    assert(set_p->ranges_p != NULL);
+  }
+  set_p->ranges_p[set_p->numRanges].first = first;
+  set_p->ranges_p[set_p->numRanges].last = last;
+  set_p->numRanges++;
+}
+
+bool add_unicode_category(CodePointSetS* const set_p,
+                          const char* const name_p,
+                          const int nameLength)
+{
+  bool isFound = false;
+  for (int i = 0; i < numUnicodeCategories; i++)
+  {
+    const UnicodeCategoryS* category_p = &(unicodeCategories[i]);
+    bool isMatch = (nameLength == 1) ?
+                   category_p->name_p[0] == name_p[0] :
+                   (int) strlen(category_p->name_p) == nameLength &&
+                   strncmp(category_p->name_p, name_p, nameLength) == 0;
+    if (isMatch)
+    {
+      for (int j = 0; j < category_p->numRanges; j++)
+      {
+        add_code_point_range(set_p, category_p->ranges_p[j].first, category_p->ranges_p[j].last);
+      }
+      isFound = true;
+    }
+  }
+  return isFound;
+}
+
+void normalize_code_point_set(CodePointSetS* const set_p)
+{
+  if (set_p->numRanges == 0)
+  {
+    return;
+  }
+
+  qsort(set_p->ranges_p, set_p->numRanges, sizeof(CodePointRangeS), compare_code_point_ranges);
+  int numMergedRanges = 1;
+  for (int i = 1; i < set_p->numRanges; i++)
+  {
+    CodePointRangeS* lastRange_p = &(set_p->ranges_p[numMergedRanges - 1]);
+    if (set_p->ranges_p[i].first <= lastRange_p->last + 1)
+    {
+      if (set_p->ranges_p[i].last > lastRange_p->last)
+      {
+        lastRange_p->last = set_p->ranges_p[i].last;
+      }
+    }
+    else
+    {
+      set_p->ranges_p[numMergedRanges] = set_p->ranges_p[i];
+      numMergedRanges++;
+    }
+  }
+  set_p->numRanges = numMergedRanges;
+}
+
+void invert_code_point_set(CodePointSetS* const set_p)
+{
+  CodePointSetS inverted = { .ranges_p = NULL, .numRanges = 0, .maxNumRanges = 0 };
+  uint32_t nextCodePoint = 0;
+  for (int i = 0; i < set_p->numRanges; i++)
+  {
+    if (set_p->ranges_p[i].first > nextCodePoint)
+    {
+      add_code_point_range(&inverted, nextCodePoint, set_p->ranges_p[i].first - 1);
+    }
+    nextCodePoint = set_p->ranges_p[i].last + 1;
+  }
+  if (nextCodePoint <= MAX_CODE_POINT)
+  {
+    add_code_point_range(&inverted, nextCodePoint, MAX_CODE_POINT);
+  }
+
+  free_code_point_set(set_p);
+  *set_p = inverted;
+}
+
+bool is_code_point_in_set(const CodePointSetS* const set_p, const uint32_t codePoint)
+{
+  int low = 0;
+  int high = set_p->numRanges - 1;
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+    if (codePoint < set_p->ranges_p[middle].first)
+    {
+      high = middle - 1;
+    }
+    else if (codePoint > set_p->ranges_p[middle].last)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void copy_code_point_set(CodePointSetS* const dest_p, const CodePointSetS* const source_p)
+{
+  dest_p->ranges_p = NULL;
+  dest_p->numRanges = 0;
+  dest_p->maxNumRanges = 0;
+  for (int i = 0; i < source_p->numRanges; i++)
+  {
+    add_code_point_range(dest_p, source_p->ranges_p[i].first, source_p->ranges_p[i].last);
+  }
+}
+
+void free_code_point_set(CodePointSetS* const set_p)
+{
+  free(set_p->ranges_p);
+  set_p->ranges_p = NULL;
+  set_p->numRanges = 0;
+  set_p->maxNumRanges = 0;
+}
+
+int encode_utf8(const uint32_t codePoint, char* const chars_p)
+{
+  assert(codePoint <= MAX_CODE_POINT && (codePoint < MIN_SURROGATE || codePoint > MAX_SURROGATE));
+  if (codePoint <= MAX_ONE_BYTE_CODE_POINT)
+  {
+    chars_p[0] = codePoint;
+    return 1;
+  }
+  else if (codePoint <= MAX_TWO_BYTE_CODE_POINT)
+  {
+    chars_p[0] = 0xC0 | (codePoint >> 6);
+    chars_p[1] = 0x80 | (codePoint & 0x3F);
+    return 2;
+  }
+  else if (codePoint <= MAX_THREE_BYTE_CODE_POINT)
+  {
+    chars_p[0] = 0xE0 | (codePoint >> 12);
+    chars_p[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+    chars_p[2] = 0x80 | (codePoint & 0x3F);
+    return 3;
+  }
+  chars_p[0] = 0xF0 | (codePoint >> 18);
+  chars_p[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+  chars_p[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+  chars_p[3] = 0x80 | (codePoint & 0x3F);
+  return 4;
+}
+
+int decode_utf8(const char* const chars_p, const int numChars, uint32_t* const codePoint_p)
+{
+  const unsigned char* bytes_p = (const unsigned char*) chars_p;
+  int numBytes = 0;
+  if (numChars == 0 || bytes_p[0] < 0xC2 || bytes_p[0] > 0xF4)
+  {
+    return 0;
+  }
+  numBytes = (bytes_p[0] < 0xE0) ? 2 : (bytes_p[0] < 0xF0) ? 3 : 4;
+  if (numBytes > numChars)
+  {
+    return 0;
+  }
+
+  uint32_t codePoint = bytes_p[0] & (0x7F >> numBytes);
+  for (int i = 1; i < numBytes; i++)
+  {
+    if ((bytes_p[i] & 0xC0) != 0x80)
+    {
+      return 0;
+    }
+    codePoint = (codePoint << CONTINUATION_BITS) | (bytes_p[i] & 0x3F);
+  }
+
+  // Overlong encodings, surrogates and code points past the last one are not valid.
+  const uint32_t minCodePoints[] = {0, 0, MAX_ONE_BYTE_CODE_POINT + 1,
+                                    MAX_TWO_BYTE_CODE_POINT + 1, MAX_THREE_BYTE_CODE_POINT + 1};
+  if (codePoint < minCodePoints[numBytes] || codePoint > MAX_CODE_POINT ||
+      (codePoint >= MIN_SURROGATE && codePoint <= MAX_SURROGATE))
+  {
+    return 0;
+  }
+  *codePoint_p = codePoint;
+  return numBytes;
+}
+
+void build_utf8_automaton(const CodePointSetS* const set_p,
+                          const bool isReversed,
+                          Utf8AutomatonS* const automaton_p)
+{
+  Utf8SequenceArrayS sequences = { .sequences_p = NULL, .numSequences = 0, .maxNumSequences = 0 };
+  for (int i = 0; i < set_p->numRanges; i++)
+  {
+    split_utf8_range(set_p->ranges_p[i].first, set_p->ranges_p[i].last, &sequences);
+  }
+
+  int* indicies_p = malloc(sizeof(int) * (sequences.numSequences > 0 ? sequences.numSequences : 1));
+  assert(indicies_p != NULL);
+  for (int i = 0; i < sequences.numSequences; i++)
+  {
+    indicies_p[i] = i;
+    Utf8SequenceS* sequence_p = &(sequences.sequences_p[i]);
+    for (int j = 0; isReversed && j < sequence_p->numBytes / 2; j++)
+    {
+      int k = sequence_p->numBytes - 1 - j;
+      uint8_t firstByte = sequence_p->firstBytes[j];
+      uint8_t lastByte = sequence_p->lastBytes[j];
+      sequence_p->firstBytes[j] = sequence_p->firstBytes[k];
+      sequence_p->lastBytes[j] = sequence_p->lastBytes[k];
+      sequence_p->firstBytes[k] = firstByte;
+      sequence_p->lastBytes[k] = lastByte;
+    }
+  }
+
+  automaton_p->transitions_p = NULL;
+  automaton_p->numStates = 0;
+  automaton_p->maxNumStates = 0;
+  Utf8BuilderS builder =
+  {
+    .automaton_p = automaton_p,
+    .sequences_p = &sequences,
+    .hashes_p = NULL
+  };
+  automaton_p->startState = build_utf8_state(&builder, indicies_p, sequences.numSequences, 0);
+
+  free(builder.hashes_p);
+  free(indicies_p);
+  free(sequences.sequences_p);
+}
+
+void free_utf8_automaton(Utf8AutomatonS* const automaton_p)
+{
+  free(automaton_p->transitions_p);
+  automaton_p->transitions_p = NULL;
+  automaton_p->numStates = 0;
+  automaton_p->maxNumStates = 0;
+}
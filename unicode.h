@@ -0,0 +1,177 @@
+/*> Description ***********************************************************************************/
+/**
+ * @brief Deals with sets of Unicode code points and their UTF-8 encodings, so that RegExps over
+ *        code points can be matched by byte-level automata.
+ * @file unicode.h
+ */
+
+/*> Multiple Inclusion Protection *****************************************************************/
+#ifndef UNICODE_H
+#define UNICODE_H
+
+/*> Includes **************************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+/*> Defines ***************************************************************************************/
+#define MAX_CODE_POINT        0x10FFFF
+#define MIN_SURROGATE         0xD800
+#define MAX_SURROGATE         0xDFFF
+#define MAX_UTF8_LENGTH       4
+#define NUM_BYTE_VALUES       256
+#define NO_UTF8_STATE         -1
+#define UTF8_ACCEPT           -2
+
+/*> Type Declarations *****************************************************************************/
+/**
+ * @brief A range of code points.
+ * @param first  The first code point of the range.
+ * @param last   The last code point of the range.
+ */
+typedef struct CodePointRangeS
+{
+  uint32_t first;
+  uint32_t last;
+} CodePointRangeS;
+
+/**
+ * @brief A growable set of code points.
+ * @param ranges_p      The ranges of the set. Sorted and not overlapping once normalized.
+ * @param numRanges     The number of ranges.
+ * @param maxNumRanges  The number of ranges there is room for.
+ */
+typedef struct CodePointSetS
+{
+  CodePointRangeS* ranges_p;
+  int numRanges;
+  int maxNumRanges;
+} CodePointSetS;
+
+/**
+ * @brief A Unicode general category.
+ * @param name_p     The short name of the category, e.g. "Lu".
+ * @param ranges_p   The sorted code point ranges of the category.
+ * @param numRanges  The number of ranges.
+ */
+typedef struct UnicodeCategoryS
+{
+  const char* name_p;
+  const CodePointRangeS* ranges_p;
+  int numRanges;
+} UnicodeCategoryS;
+
+/**
+ * @brief A deterministic automaton matching the UTF-8 encodings of a set of code points, one byte
+ *        per transition. It is minimal: equal suffixes of encodings share their states.
+ * @param transitions_p  Per state, the state to go to on each byte, NO_UTF8_STATE if there is
+ *                       none or UTF8_ACCEPT if the byte completes an encoding.
+ * @param numStates      The number of states.
+ * @param maxNumStates   The number of states there is room for.
+ * @param startState     The state encodings start in.
+ */
+typedef struct Utf8AutomatonS
+{
+  int (*transitions_p)[NUM_BYTE_VALUES];
+  int numStates;
+  int maxNumStates;
+  int startState;
+} Utf8AutomatonS;
+
+/*> Constant Declarations *************************************************************************/
+extern const UnicodeCategoryS unicodeCategories[];
+extern const int numUnicodeCategories;
+
+/*> Variable Declarations *************************************************************************/
+
+/*> Function Declarations *************************************************************************/
+/**
+ * @brief Adds a range of code points to a code point set.
+ * @param[in/out]  set_p  The code point set.
+ * @param[in]      first  The first code point of the range.
+ * @param[in]      last   The last code point of the range.
+ */
+void add_code_point_range(CodePointSetS* const set_p, const uint32_t first, const uint32_t last);
+
+/**
+ * @brief Adds the code points of a Unicode general category to a code point set. A one letter
+ *        name such as "L" adds every category starting with that letter.
+ * @param[in/out]  set_p       The code point set.
+ * @param[in]      name_p      The name of the category.
+ * @param[in]      nameLength  The number of chars in the name.
+ * @return True if the category exists, false otherwise.
+ */
+bool add_unicode_category(CodePointSetS* const set_p,
+                          const char* const name_p,
+                          const int nameLength);
+
+/**
+ * @brief Sorts the ranges of a code point set and merges overlapping and adjacent ones.
+ * @param[in/out]  set_p  The code point set.
+ */
+void normalize_code_point_set(CodePointSetS* const set_p);
+
+/**
+ * @brief Replaces a normalized code point set with all other code points.
+ * @param[in/out]  set_p  The code point set.
+ */
+void invert_code_point_set(CodePointSetS* const set_p);
+
+/**
+ * @brief Checks if a code point is in a normalized code point set.
+ * @param[in]  set_p      The code point set.
+ * @param[in]  codePoint  The code point.
+ * @return True if the code point is in the set.
+ */
+bool is_code_point_in_set(const CodePointSetS* const set_p, const uint32_t codePoint);
+
+/**
+ * @brief Copies a code point set.
+ * @param[out]  dest_p    The copy.
+ * @param[in]   source_p  The code point set to copy.
+ */
+void copy_code_point_set(CodePointSetS* const dest_p, const CodePointSetS* const source_p);
+
+/**
+ * @brief Frees the ranges of a code point set and empties it.
+ * @param[in/out]  set_p  The code point set.
+ */
+void free_code_point_set(CodePointSetS* const set_p);
+
+/**
+ * @brief Encodes a code point in UTF-8.
+ * @param[in]   codePoint  The code point, not a surrogate.
+ * @param[out]  chars_p    Room for MAX_UTF8_LENGTH chars.
+ * @return The number of chars of the encoding.
+ */
+int encode_utf8(const uint32_t codePoint, char* const chars_p);
+
+/**
+ * @brief Decodes the UTF-8 encoding of a code point at the start of some chars.
+ * @param[in]   chars_p      The chars.
+ * @param[in]   numChars     The number of chars.
+ * @param[out]  codePoint_p  The code point.
+ * @return The number of chars of the encoding, 0 if the chars do not start with a valid encoding
+ *         of a code point above 0x7F.
+ */
+int decode_utf8(const char* const chars_p, const int numChars, uint32_t* const codePoint_p);
+
+/**
+ * @brief Builds the minimal automaton matching the UTF-8 encodings of a code point set. Each code
+ *        point range is split into ranges whose encodings differ in one byte range per position,
+ *        and the automaton is built over these byte ranges with equal states merged.
+ * @param[in]   set_p         The normalized code point set.
+ * @param[in]   isReversed    True if the automaton should match the encodings backwards.
+ * @param[out]  automaton_p   The automaton, which must be freed with free_utf8_automaton().
+ */
+void build_utf8_automaton(const CodePointSetS* const set_p,
+                          const bool isReversed,
+                          Utf8AutomatonS* const automaton_p);
+
+/**
+ * @brief Frees the states of a UTF-8 automaton.
+ * @param[in/out]  automaton_p  The automaton.
+ */
+void free_utf8_automaton(Utf8AutomatonS* const automaton_p);
+
+/*> End of Multiple Inclusion Protection **********************************************************/
+#endif